@@ -1 +1,355 @@
 #include "AnimationHandler.h"
+
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "Timer/Timer.h"
+
+AnimationHandler* anim = NULL;
+
+AnimationHandler::AnimationHandler() {
+	m_dTime = (engine != NULL ? engine->getTime() : 0.0);
+}
+
+AnimationHandler::~AnimationHandler() {
+	;
+}
+
+void AnimationHandler::update() {
+	update(engine->getTime());
+}
+
+void AnimationHandler::update(double time) {
+	m_dTime = time;
+
+	for (int i = 0; i < (int)ANIMATION_TYPE::COUNT; i++) {
+		updateGroup((ANIMATION_TYPE)i, (float)time);
+	}
+}
+
+void AnimationHandler::updateGroup(ANIMATION_TYPE type, float time) {
+	ANIMATION_GROUP& group = m_groups[(int)type];
+	const int count = (int)group.base.size();
+	if (count < 1) return;
+
+	if ((int)group.percent.size() < count) {
+		group.percent.resize(count);
+		group.value.resize(count);
+	}
+
+	float* const percent = &group.percent[0];
+	float* const value = &group.value[0];
+	const float* const target = &group.target[0];
+	const float* const startTime = &group.startTime[0];
+	const float* const duration = &group.duration[0];
+
+	// start delayed animations (the start value is whatever the base is at that point)
+	for (int i = 0; i < count; i++) {
+		if (!group.started[i] && time >= startTime[i]) {
+			group.startValue[i] = *group.base[i];
+			group.started[i] = 1;
+		}
+	}
+
+	// percentages and new values, no pointers are touched here so that the compiler can vectorize
+	for (int i = 0; i < count; i++) {
+		percent[i] = (duration[i] > 0.0f ? clamp<float>((time - startTime[i]) / duration[i], 0.0f, 1.0f) : 1.0f);
+	}
+
+	ease(type, percent, &group.factor[0], count);
+
+	const float* const startValue = &group.startValue[0];
+	for (int i = 0; i < count; i++) {
+		value[i] = startValue[i] + percent[i] * (target[i] - startValue[i]);
+	}
+
+	// write back
+	m_finished.clear();
+	for (int i = 0; i < count; i++) {
+		if (!group.started[i]) continue;
+
+		bool finished = (percent[i] >= 1.0f);
+		if (type == ANIMATION_TYPE::MOVE_SMOOTH_END && (int)value[i] == (int)target[i])
+			finished = true;
+
+		if (finished) {
+			*group.base[i] = target[i];
+			m_finished.push_back(i);
+		}
+		else
+			*group.base[i] = value[i];
+	}
+
+	// descending, so that swap-removing never moves an animation which still has to be removed
+	for (int i = (int)m_finished.size() - 1; i >= 0; i--) {
+		removeAnimation(type, m_finished[i]);
+	}
+}
+
+void AnimationHandler::ease(ANIMATION_TYPE type, float* percent, const float* factor, int count) {
+	switch (type) {
+	case ANIMATION_TYPE::MOVE_LINEAR:
+		break;
+
+	case ANIMATION_TYPE::MOVE_SMOOTH_END:
+		for (int i = 0; i < count; i++) {
+			percent[i] = clamp<float>(1.0f - std::pow(1.0f - percent[i], factor[i]), 0.0f, 1.0f);
+		}
+		break;
+
+	case ANIMATION_TYPE::MOVE_QUAD_INOUT:
+		for (int i = 0; i < count; i++) {
+			const float p = percent[i] * 2.0f;
+			const float q = p - 1.0f;
+			percent[i] = (p < 1.0f ? 0.5f * p * p : -0.5f * (q * (q - 2.0f) - 1.0f));
+		}
+		break;
+
+	case ANIMATION_TYPE::MOVE_QUAD_IN:
+		for (int i = 0; i < count; i++) {
+			percent[i] = percent[i] * percent[i];
+		}
+		break;
+
+	case ANIMATION_TYPE::MOVE_QUAD_OUT:
+		for (int i = 0; i < count; i++) {
+			percent[i] = -percent[i] * (percent[i] - 2.0f);
+		}
+		break;
+
+	case ANIMATION_TYPE::MOVE_CUBIC_IN:
+		for (int i = 0; i < count; i++) {
+			percent[i] = percent[i] * percent[i] * percent[i];
+		}
+		break;
+
+	case ANIMATION_TYPE::MOVE_CUBIC_OUT:
+		for (int i = 0; i < count; i++) {
+			const float p = percent[i] - 1.0f;
+			percent[i] = p * p * p + 1.0f;
+		}
+		break;
+
+	case ANIMATION_TYPE::MOVE_QUART_IN:
+		for (int i = 0; i < count; i++) {
+			percent[i] = percent[i] * percent[i] * percent[i] * percent[i];
+		}
+		break;
+
+	case ANIMATION_TYPE::MOVE_QUART_OUT:
+		for (int i = 0; i < count; i++) {
+			const float p = percent[i] - 1.0f;
+			percent[i] = 1.0f - p * p * p * p;
+		}
+		break;
+
+	case ANIMATION_TYPE::COUNT:
+		break;
+	}
+}
+
+void AnimationHandler::moveLinear(float* base, float target, float duration, float delay, bool overrideExisting) {
+	addAnimation(base, target, duration, delay, overrideExisting, ANIMATION_TYPE::MOVE_LINEAR);
+}
+
+void AnimationHandler::moveQuadIn(float* base, float target, float duration, float delay, bool overrideExisting) {
+	addAnimation(base, target, duration, delay, overrideExisting, ANIMATION_TYPE::MOVE_QUAD_IN);
+}
+
+void AnimationHandler::moveQuadOut(float* base, float target, float duration, float delay, bool overrideExisting) {
+	addAnimation(base, target, duration, delay, overrideExisting, ANIMATION_TYPE::MOVE_QUAD_OUT);
+}
+
+void AnimationHandler::moveQuadInOut(float* base, float target, float duration, float delay, bool overrideExisting) {
+	addAnimation(base, target, duration, delay, overrideExisting, ANIMATION_TYPE::MOVE_QUAD_INOUT);
+}
+
+void AnimationHandler::moveCubicIn(float* base, float target, float duration, float delay, bool overrideExisting) {
+	addAnimation(base, target, duration, delay, overrideExisting, ANIMATION_TYPE::MOVE_CUBIC_IN);
+}
+
+void AnimationHandler::moveCubicOut(float* base, float target, float duration, float delay, bool overrideExisting) {
+	addAnimation(base, target, duration, delay, overrideExisting, ANIMATION_TYPE::MOVE_CUBIC_OUT);
+}
+
+void AnimationHandler::moveQuartIn(float* base, float target, float duration, float delay, bool overrideExisting) {
+	addAnimation(base, target, duration, delay, overrideExisting, ANIMATION_TYPE::MOVE_QUART_IN);
+}
+
+void AnimationHandler::moveQuartOut(float* base, float target, float duration, float delay, bool overrideExisting) {
+	addAnimation(base, target, duration, delay, overrideExisting, ANIMATION_TYPE::MOVE_QUART_OUT);
+}
+
+void AnimationHandler::moveSmoothEnd(float* base, float target, float duration, int smoothFactor, float delay) {
+	addAnimation(base, target, duration, delay, true, ANIMATION_TYPE::MOVE_SMOOTH_END, (float)smoothFactor);
+}
+
+void AnimationHandler::addAnimation(float* base, float target, float duration, float delay, bool overrideExisting, ANIMATION_TYPE type, float smoothFactor) {
+	if (base == NULL) return;
+
+	if (overrideExisting)
+		overrideExistingAnimation(base);
+
+	ANIMATION_GROUP& group = m_groups[(int)type];
+
+	ANIMATION_SLOT slot;
+	slot.type = type;
+	slot.index = (unsigned int)group.base.size();
+
+	group.base.push_back(base);
+	group.target.push_back(target);
+	group.startValue.push_back(*base);
+	group.startTime.push_back((float)m_dTime + delay);
+	group.duration.push_back(std::max(duration, 0.0f));
+	group.factor.push_back(smoothFactor);
+	group.started.push_back(0);
+
+	m_index.insert(std::make_pair(base, slot));
+}
+
+void AnimationHandler::overrideExistingAnimation(float* base) {
+	// removing can move other animations of the same base around, so always look up again
+	auto it = m_index.find(base);
+	while (it != m_index.end()) {
+		removeAnimation(it->second.type, it->second.index);
+		it = m_index.find(base);
+	}
+}
+
+void AnimationHandler::removeAnimation(ANIMATION_TYPE type, unsigned int index) {
+	ANIMATION_GROUP& group = m_groups[(int)type];
+	const unsigned int last = (unsigned int)group.base.size() - 1;
+
+	// unlink from the index
+	auto range = m_index.equal_range(group.base[index]);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second.type == type && it->second.index == index) {
+			m_index.erase(it);
+			break;
+		}
+	}
+
+	// swap-remove, and relink the moved animation
+	if (index != last) {
+		range = m_index.equal_range(group.base[last]);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second.type == type && it->second.index == last) {
+				it->second.index = index;
+				break;
+			}
+		}
+
+		group.base[index] = group.base[last];
+		group.target[index] = group.target[last];
+		group.startValue[index] = group.startValue[last];
+		group.startTime[index] = group.startTime[last];
+		group.duration[index] = group.duration[last];
+		group.factor[index] = group.factor[last];
+		group.started[index] = group.started[last];
+	}
+
+	group.base.pop_back();
+	group.target.pop_back();
+	group.startValue.pop_back();
+	group.startTime.pop_back();
+	group.duration.pop_back();
+	group.factor.pop_back();
+	group.started.pop_back();
+}
+
+void AnimationHandler::deleteExistingAnimation(float* base) {
+	overrideExistingAnimation(base);
+}
+
+float AnimationHandler::getRemainingDuration(float* base) const {
+	const float time = (float)m_dTime;
+
+	float remainingDuration = 0.0f;
+	auto range = m_index.equal_range(base);
+	for (auto it = range.first; it != range.second; ++it) {
+		const ANIMATION_GROUP& group = m_groups[(int)it->second.type];
+		const unsigned int index = it->second.index;
+		remainingDuration = std::max(remainingDuration, (group.startTime[index] + group.duration[index]) - time);
+	}
+
+	return remainingDuration;
+}
+
+bool AnimationHandler::isAnimating(float* base) const {
+	return (m_index.find(base) != m_index.end());
+}
+
+
+
+//**************//
+//	Benchmark  //
+//**************//
+
+void _anim_benchmark(void) {
+	const int numTweens = 50000;
+	const int numFrames = 120;
+	const double frameTime = 1.0 / 60.0;
+
+	std::vector<float> values(numTweens, 0.0f);
+
+	AnimationHandler handler;
+	Timer timer;
+
+	// add (overriding, which used to be a linear scan per add)
+	timer.start();
+	for (int i = 0; i < numTweens; i++) {
+		float* base = &values[i];
+		const float target = (float)(i % 100);
+		const float duration = 3.0f + (float)(i % 7) * 0.1f;
+		switch (i % 9) {
+		case 0: handler.moveLinear(base, target, duration, true); break;
+		case 1: handler.moveQuadIn(base, target, duration, true); break;
+		case 2: handler.moveQuadOut(base, target, duration, true); break;
+		case 3: handler.moveQuadInOut(base, target, duration, true); break;
+		case 4: handler.moveCubicIn(base, target, duration, true); break;
+		case 5: handler.moveCubicOut(base, target, duration, true); break;
+		case 6: handler.moveQuartIn(base, target, duration, true); break;
+		case 7: handler.moveQuartOut(base, target, duration, true); break;
+		case 8: handler.moveSmoothEnd(base, target, duration); break;
+		}
+	}
+	timer.update();
+	const double addTime = timer.getElapsedTime();
+
+	// update
+	const double startTime = engine->getTime();
+	timer.start();
+	for (int f = 0; f < numFrames; f++) {
+		handler.update(startTime + f * frameTime);
+	}
+	timer.update();
+	const double updateTime = timer.getElapsedTime();
+	const size_t numActive = handler.getNumActiveAnimations();
+
+	// lookups
+	int numAnimating = 0;
+	timer.start();
+	for (int i = 0; i < numTweens; i++) {
+		if (handler.isAnimating(&values[i]))
+			numAnimating++;
+	}
+	timer.update();
+	const double lookupTime = timer.getElapsedTime();
+
+	// finish everything
+	timer.start();
+	handler.update(startTime + 10.0);
+	timer.update();
+	const double finishTime = timer.getElapsedTime();
+
+	int numWrong = 0;
+	for (int i = 0; i < numTweens; i++) {
+		if (values[i] != (float)(i % 100))
+			numWrong++;
+	}
+
+	debugLog("AnimationHandler: %i tweens\n", numTweens);
+	debugLog("AnimationHandler: add = %f ms, update = %f ms/frame (%i frames, %i active), lookup = %f ms (%i animating)\n", addTime * 1000.0, (updateTime / numFrames) * 1000.0, numFrames, (int)numActive, lookupTime * 1000.0, numAnimating);
+	debugLog("AnimationHandler: finish = %f ms, %i remaining, %i wrong values\n", finishTime * 1000.0, (int)handler.getNumActiveAnimations(), numWrong);
+}
+
+ConVar _anim_benchmark_("anim_benchmark", "runs 50k simultaneous tweens (all easing types) through a private AnimationHandler", _anim_benchmark);
@@ -3,12 +3,16 @@
 
 #include "cbase.h"
 
+// fire-and-forget float tweens
+// animations are stored as structure of arrays, one group per easing type, so that the update loop of every group is a tight (vectorizable) loop
+// finished animations are swap-removed, lookups by base pointer go through a hash index (several animations may target the same base, e.g. delayed fades)
 class AnimationHandler {
 public:
 	AnimationHandler();
 	~AnimationHandler();
 
-	void update();
+	void update(); // uses engine->getTime()
+	void update(double time); // new animations start relative to the time of the last update
 
 	void moveLinear(float* base, float target, float duration, float delay, bool overrideExisting = false);
 	void moveQuadIn(float* base, float target, float duration, float delay, bool overrideExisting = false);
@@ -35,7 +39,7 @@ public:
 	float getRemainingDuration(float* base) const;
 	bool isAnimating(float* base) const;
 
-	inline size_t getNumActiveAnimations() const { return m_vAnimations.size(); }
+	inline size_t getNumActiveAnimations() const { return m_index.size(); }
 
 private:
 	enum class ANIMATION_TYPE {
@@ -47,27 +51,42 @@ private:
 		MOVE_CUBIC_IN,
 		MOVE_CUBIC_OUT,
 		MOVE_QUART_IN,
-		MOVE_QUART_OUT
+		MOVE_QUART_OUT,
+		COUNT // not a type
 	};
 
-	struct Animation {
-		float* m_fBase;
-		float m_fTarget;
-		float m_fDuration;
-
-		float m_fStartValue;
-		float m_fStartTime;
-		ANIMATION_TYPE m_animType;
+	// all animations of one type, index i of every array belongs to the same animation
+	struct ANIMATION_GROUP {
+		std::vector<float*> base;
+		std::vector<float> target;
+		std::vector<float> startValue;
+		std::vector<float> startTime;
+		std::vector<float> duration;
+		std::vector<float> factor;
+		std::vector<unsigned char> started;
+
+		// scratch, only valid during update()
+		std::vector<float> percent;
+		std::vector<float> value;
+	};
 
-		float m_fFactor;
-		bool m_bStarted;
+	// where an animation lives, for the base pointer index
+	struct ANIMATION_SLOT {
+		ANIMATION_TYPE type;
+		unsigned int index;
 	};
 
+	static void ease(ANIMATION_TYPE type, float* percent, const float* factor, int count);
+
 	void addAnimation(float* base, float target, float duration, float delay, bool overrideExisting, ANIMATION_TYPE type, float smoothFactor = 0.0f);
 	void overrideExistingAnimation(float* base);
+	void updateGroup(ANIMATION_TYPE type, float time);
+	void removeAnimation(ANIMATION_TYPE type, unsigned int index);
 
-	std::vector<Animation> m_vAnimations;
-
+	ANIMATION_GROUP m_groups[(int)ANIMATION_TYPE::COUNT];
+	std::unordered_multimap<float*, ANIMATION_SLOT> m_index;
+	std::vector<unsigned int> m_finished; // scratch
+	double m_dTime; // of the last update(), the clock of the caller
 };
 extern AnimationHandler* anim;
 
@@ -1,5 +1,18 @@
 #include "Camera.h"
 #include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "Timer/Timer.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#define CAMERA_AVX2
+#define CAMERA_SSE2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CAMERA_SSE2
+#include <emmintrin.h>
+#endif
 
 Matrix4 Camera::buildMatrixOrtho2D(float left, float right, float bottom, float top, float zn, float zf) {
 	const float invX = 1.0f / (right - left);
@@ -408,4 +421,252 @@ float Camera::planeDotCoord(CAM_PLANE plane, Vector3 point) {
 
 float Camera::planeDotCoord(Vector3 planeNormal, Vector3 planePoint, Vector3& pv) {
 	return planeNormal.dot(pv - planePoint);
-}
\ No newline at end of file
+}
+
+
+//************//
+//	Culling  //
+//************//
+
+Camera::FRUSTUM Camera::buildFrustum(const Matrix4& viewProjection) {
+	// gribb/hartmann, rows of the (column major) matrix
+	const float* m = viewProjection.get();
+	const float rows[4][4] = {
+		{ m[0], m[4], m[8], m[12] },
+		{ m[1], m[5], m[9], m[13] },
+		{ m[2], m[6], m[10], m[14] },
+		{ m[3], m[7], m[11], m[15] }
+	};
+
+	// left, right, top, bottom, near, far
+	const int rowIndex[6] = { 0, 0, 1, 1, 2, 2 };
+	const float sign[6] = { 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f };
+
+	FRUSTUM frustum;
+	for (int i = 0; i < 6; i++) {
+		CAM_PLANE& plane = frustum.planes[i];
+		plane.a = rows[3][0] + sign[i] * rows[rowIndex[i]][0];
+		plane.b = rows[3][1] + sign[i] * rows[rowIndex[i]][1];
+		plane.c = rows[3][2] + sign[i] * rows[rowIndex[i]][2];
+		plane.d = rows[3][3] + sign[i] * rows[rowIndex[i]][3];
+
+		const float norm = std::sqrt(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c);
+		if (norm > 0.0f) {
+			plane.a /= norm;
+			plane.b /= norm;
+			plane.c /= norm;
+			plane.d /= norm;
+		}
+		else {
+			// degenerate plane, never culls
+			plane.a = 0.0f;
+			plane.b = 0.0f;
+			plane.c = 0.0f;
+			plane.d = 0.0f;
+		}
+	}
+
+	return frustum;
+}
+
+Camera::FRUSTUM Camera::getFrustum(float aspect, float zn, float zf) const {
+	return buildFrustum(buildMatrixPerspectiveFov(m_fFov, aspect, zn, zf) * buildMatrixLookAt(m_vPos, m_vPos + m_vViewDir, m_vViewUp));
+}
+
+// shared kernel for spheres and boxes: object i is visible if (plane.a*x[p][i] + plane.b*y[p][i] + plane.c*z[p][i] + plane.d) >= -radius[i] for all six planes p
+// spheres pass the same center arrays for every plane, boxes pass the positive vertex arrays (per plane) and no radius
+static void cullPlanes(const Camera::FRUSTUM& frustum, const float* const* x, const float* const* y, const float* const* z, const float* radius, int count, uint32_t* visibleMask, bool allowSIMD) {
+	if (count < 1) return;
+
+	std::memset(visibleMask, 0, ((count + 31) / 32) * sizeof(uint32_t));
+
+	int i = 0;
+
+#if defined(CAMERA_AVX2)
+	if (allowSIMD) {
+		for (; i + 8 <= count; i += 8) {
+			const __m256 minusRadius = (radius != NULL ? _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i)) : _mm256_setzero_ps());
+			__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				const Camera::CAM_PLANE& plane = frustum.planes[p];
+				const __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.a), _mm256_loadu_ps(x[p] + i)), _mm256_mul_ps(_mm256_set1_ps(plane.b), _mm256_loadu_ps(y[p] + i))),
+					_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.c), _mm256_loadu_ps(z[p] + i)), _mm256_set1_ps(plane.d)));
+				visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, minusRadius, _CMP_GE_OQ));
+			}
+			visibleMask[i >> 5] |= (uint32_t)_mm256_movemask_ps(visible) << (i & 31);
+		}
+	}
+#endif
+
+#if defined(CAMERA_SSE2)
+	if (allowSIMD) {
+		for (; i + 4 <= count; i += 4) {
+			const __m128 minusRadius = (radius != NULL ? _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i)) : _mm_setzero_ps());
+			__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				const Camera::CAM_PLANE& plane = frustum.planes[p];
+				const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.a), _mm_loadu_ps(x[p] + i)), _mm_mul_ps(_mm_set1_ps(plane.b), _mm_loadu_ps(y[p] + i))),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.c), _mm_loadu_ps(z[p] + i)), _mm_set1_ps(plane.d)));
+				visible = _mm_and_ps(visible, _mm_cmpge_ps(dist, minusRadius));
+			}
+			visibleMask[i >> 5] |= (uint32_t)_mm_movemask_ps(visible) << (i & 31);
+		}
+	}
+#endif
+
+	// scalar path and remainder
+	for (; i < count; i++) {
+		const float minusRadius = (radius != NULL ? -radius[i] : 0.0f);
+		bool visible = true;
+		for (int p = 0; p < 6; p++) {
+			const Camera::CAM_PLANE& plane = frustum.planes[p];
+			if (((plane.a * x[p][i] + plane.b * y[p][i]) + (plane.c * z[p][i] + plane.d)) < minusRadius) {
+				visible = false;
+				break;
+			}
+		}
+
+		if (visible)
+			visibleMask[i >> 5] |= (1u << (i & 31));
+	}
+}
+
+static void cullSpheresInt(const Camera::FRUSTUM& frustum, const float* x, const float* y, const float* z, const float* radius, int count, uint32_t* visibleMask, bool allowSIMD) {
+	const float* xs[6] = { x, x, x, x, x, x };
+	const float* ys[6] = { y, y, y, y, y, y };
+	const float* zs[6] = { z, z, z, z, z, z };
+	cullPlanes(frustum, xs, ys, zs, radius, count, visibleMask, allowSIMD);
+}
+
+static void cullAABBsInt(const Camera::FRUSTUM& frustum, const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, int count, uint32_t* visibleMask, bool allowSIMD) {
+	// the corner furthest along the plane normal (positive vertex) only depends on the plane, so it is selected once per plane instead of per box
+	const float* xs[6];
+	const float* ys[6];
+	const float* zs[6];
+	for (int p = 0; p < 6; p++) {
+		xs[p] = (frustum.planes[p].a >= 0.0f ? maxX : minX);
+		ys[p] = (frustum.planes[p].b >= 0.0f ? maxY : minY);
+		zs[p] = (frustum.planes[p].c >= 0.0f ? maxZ : minZ);
+	}
+	cullPlanes(frustum, xs, ys, zs, NULL, count, visibleMask, allowSIMD);
+}
+
+void Camera::cullSpheres(const FRUSTUM& frustum, const float* x, const float* y, const float* z, const float* radius, int count, uint32_t* visibleMask) {
+	cullSpheresInt(frustum, x, y, z, radius, count, visibleMask, true);
+}
+
+void Camera::cullAABBs(const FRUSTUM& frustum, const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, int count, uint32_t* visibleMask) {
+	cullAABBsInt(frustum, minX, minY, minZ, maxX, maxY, maxZ, count, visibleMask, true);
+}
+
+void Camera::cullSpheresScalar(const FRUSTUM& frustum, const float* x, const float* y, const float* z, const float* radius, int count, uint32_t* visibleMask) {
+	cullSpheresInt(frustum, x, y, z, radius, count, visibleMask, false);
+}
+
+void Camera::cullAABBsScalar(const FRUSTUM& frustum, const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, int count, uint32_t* visibleMask) {
+	cullAABBsInt(frustum, minX, minY, minZ, maxX, maxY, maxZ, count, visibleMask, false);
+}
+
+int Camera::countVisible(const uint32_t* visibleMask, int count) {
+	int numVisible = 0;
+	for (int w = 0; w < (count + 31) / 32; w++) {
+		uint32_t bits = visibleMask[w];
+		if (w == count / 32)
+			bits &= (1u << (count & 31)) - 1; // ignore bits past count in the last partial word
+
+		// popcount
+		bits = bits - ((bits >> 1) & 0x55555555u);
+		bits = (bits & 0x33333333u) + ((bits >> 2) & 0x33333333u);
+		numVisible += (int)((((bits + (bits >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24);
+	}
+	return numVisible;
+}
+
+
+
+//**************//
+//	Benchmark  //
+//**************//
+
+void _camera_culling_benchmark(void) {
+	const int numObjects = 100000;
+	const int numIterations = 100;
+
+	// random bounds in a 200^3 cube around a camera at the origin looking down -z
+	std::mt19937 rng(1337);
+	std::uniform_real_distribution<float> posDist(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> sizeDist(0.1f, 5.0f);
+
+	std::vector<float> x(numObjects), y(numObjects), z(numObjects), radius(numObjects);
+	std::vector<float> minX(numObjects), minY(numObjects), minZ(numObjects), maxX(numObjects), maxY(numObjects), maxZ(numObjects);
+	for (int i = 0; i < numObjects; i++) {
+		x[i] = posDist(rng);
+		y[i] = posDist(rng);
+		z[i] = posDist(rng);
+		radius[i] = sizeDist(rng);
+
+		minX[i] = x[i] - radius[i];
+		minY[i] = y[i] - radius[i];
+		minZ[i] = z[i] - radius[i];
+		maxX[i] = x[i] + radius[i];
+		maxY[i] = y[i] + radius[i];
+		maxZ[i] = z[i] + radius[i];
+	}
+
+	const Camera::FRUSTUM frustum = Camera::buildFrustum(Camera::buildMatrixPerspectiveFov(deg2rad(90.0f), 16.0f / 9.0f, 0.1f, 75.0f) * Camera::buildMatrixLookAt(Vector3(0, 0, 0), Vector3(0, 0, -1), Vector3(0, 1, 0)));
+
+	std::vector<uint32_t> maskScalar((numObjects + 31) / 32);
+	std::vector<uint32_t> maskSIMD((numObjects + 31) / 32);
+
+	Timer timer;
+
+	// spheres
+	timer.start();
+	for (int i = 0; i < numIterations; i++) {
+		Camera::cullSpheresScalar(frustum, &x[0], &y[0], &z[0], &radius[0], numObjects, &maskScalar[0]);
+	}
+	timer.update();
+	const double sphereScalarTime = timer.getElapsedTime();
+
+	timer.start();
+	for (int i = 0; i < numIterations; i++) {
+		Camera::cullSpheres(frustum, &x[0], &y[0], &z[0], &radius[0], numObjects, &maskSIMD[0]);
+	}
+	timer.update();
+	const double sphereSIMDTime = timer.getElapsedTime();
+
+	const int numSphereMismatches = std::memcmp(&maskScalar[0], &maskSIMD[0], maskScalar.size() * sizeof(uint32_t)) == 0 ? 0 : 1;
+	const int numSpheresVisible = Camera::countVisible(&maskSIMD[0], numObjects);
+
+	// boxes
+	timer.start();
+	for (int i = 0; i < numIterations; i++) {
+		Camera::cullAABBsScalar(frustum, &minX[0], &minY[0], &minZ[0], &maxX[0], &maxY[0], &maxZ[0], numObjects, &maskScalar[0]);
+	}
+	timer.update();
+	const double aabbScalarTime = timer.getElapsedTime();
+
+	timer.start();
+	for (int i = 0; i < numIterations; i++) {
+		Camera::cullAABBs(frustum, &minX[0], &minY[0], &minZ[0], &maxX[0], &maxY[0], &maxZ[0], numObjects, &maskSIMD[0]);
+	}
+	timer.update();
+	const double aabbSIMDTime = timer.getElapsedTime();
+
+	const int numAABBMismatches = std::memcmp(&maskScalar[0], &maskSIMD[0], maskScalar.size() * sizeof(uint32_t)) == 0 ? 0 : 1;
+	const int numAABBsVisible = Camera::countVisible(&maskSIMD[0], numObjects);
+
+#if defined(CAMERA_AVX2)
+	const char* instructionSet = "avx2";
+#elif defined(CAMERA_SSE2)
+	const char* instructionSet = "sse2";
+#else
+	const char* instructionSet = "scalar";
+#endif
+
+	debugLog("Camera: culling %i bounds x %i iterations (%s)\n", numObjects, numIterations, instructionSet);
+	debugLog("Camera: spheres: scalar = %f ms, simd = %f ms (%.2fx), %i visible%s\n", (sphereScalarTime / numIterations) * 1000.0, (sphereSIMDTime / numIterations) * 1000.0, sphereScalarTime / (sphereSIMDTime > 0.0 ? sphereSIMDTime : 1.0), numSpheresVisible, numSphereMismatches > 0 ? ", MISMATCH" : "");
+	debugLog("Camera: aabbs: scalar = %f ms, simd = %f ms (%.2fx), %i visible%s\n", (aabbScalarTime / numIterations) * 1000.0, (aabbSIMDTime / numIterations) * 1000.0, aabbScalarTime / (aabbSIMDTime > 0.0 ? aabbSIMDTime : 1.0), numAABBsVisible, numAABBMismatches > 0 ? ", MISMATCH" : "");
+}
+
+ConVar _camera_culling_benchmark_("camera_culling_benchmark", "culls 100k random spheres and boxes against a frustum, scalar vs simd", _camera_culling_benchmark);
@@ -6,6 +6,17 @@
 
 class Camera {
 public:
+	struct CAM_PLANE
+	{
+		float a, b, c, d;
+	};
+
+	// left, right, top, bottom, near, far; normalized, normals point inwards
+	struct FRUSTUM
+	{
+		CAM_PLANE planes[6];
+	};
+
 	static Matrix4 buildMatrixOrtho2D(float left, float right, float bottom, float top, float zn, float zf);
 	static Matrix4 buildMatrixOrtho2DGLLH(float left, float right, float bottom, float top, float zn, float zf);
 	static Matrix4 buildMatrixOrtho2DDXLH(float left, float right, float bottom, float top, float zn, float zf);
@@ -17,6 +28,18 @@ public:
 	static Matrix4 buildMatrixPerspectiveFovHorizontal(float fovRad, float aspectRatioHeightToWidth, float zn, float zf);
 	static Matrix4 buildMatrixPerspectiveFovHorizontalDXLH(float fovRad, float aspectRatioHeightToWidth, float zn, float zf);
 
+	// viewProjection maps world space to gl clip space (clip = viewProjection * point), e.g. projection * view
+	static FRUSTUM buildFrustum(const Matrix4& viewProjection);
+
+	// batch culling over structure of arrays input, bit i of visibleMask[i / 32] is set if object i intersects the frustum
+	// visibleMask must have room for (count + 31) / 32 words, all of which are overwritten
+	static void cullSpheres(const FRUSTUM& frustum, const float* x, const float* y, const float* z, const float* radius, int count, uint32_t* visibleMask);
+	static void cullAABBs(const FRUSTUM& frustum, const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, int count, uint32_t* visibleMask);
+	static void cullSpheresScalar(const FRUSTUM& frustum, const float* x, const float* y, const float* z, const float* radius, int count, uint32_t* visibleMask); // reference implementation
+	static void cullAABBsScalar(const FRUSTUM& frustum, const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, int count, uint32_t* visibleMask); // reference implementation
+	static int countVisible(const uint32_t* visibleMask, int count);
+	static inline bool isVisible(const uint32_t* visibleMask, int index) { return (visibleMask[index >> 5] >> (index & 31)) & 1; }
+
 public:
 	enum CAMERA_TYPE {
 		CAMERA_TYPE_FIRST_PERSON,
@@ -70,12 +93,9 @@ public:
 	bool isPointVisibleFrustum(Vector3 point) const; // within our viewing frustum
 	bool isPointVisiblePlane(Vector3 point) const; // just in front of the camera plane
 
-private:
-	struct CAM_PLANE
-	{
-		float a, b, c, d;
-	};
+	FRUSTUM getFrustum(float aspect, float zn, float zf) const; // full six plane frustum of this camera, for cullSpheres()/cullAABBs()
 
+private:
 	static float planeDotCoord(CAM_PLANE plane, Vector3 point);
 	static float planeDotCoord(Vector3 planeNormal, Vector3 planePoint, Vector3& pv);
 
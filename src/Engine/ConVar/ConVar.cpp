@@ -1,26 +1,325 @@
 #include "ConVar.h"
 #include "Engine.h"
+#include "Timer/Timer.h"
+
+#include <mutex>
+#include <queue>
+#include <climits>
+#include <thread>
+
+// hazard pointers for ConVar::ValueSnapshot: every reader thread claims a record of slots, a slot holds the VALUE it is reading
+// records are never freed, threads which exit hand theirs to later ones; deeper nesting than one record chains another one, so there is no limit on threads or nesting
+// writers (serialized by the write mutex) only delete replaced VALUEs which are not in any slot
+#define CONVAR_HAZARD_SLOTS_PER_RECORD 4
+
+struct CONVAR_HAZARD_RECORD {
+	alignas(64) std::atomic<const void*> values[CONVAR_HAZARD_SLOTS_PER_RECORD];
+	std::atomic<bool> used;
+	CONVAR_HAZARD_RECORD* next; // all records, immutable once published
+
+	// owner thread
+	CONVAR_HAZARD_RECORD* nextOwned; // for the snapshots which don't fit into this one
+	unsigned int usedSlots; // bitmask, snapshots don't have to be destroyed in reverse order
+};
+
+static std::atomic<CONVAR_HAZARD_RECORD*> g_convarHazardRecords(NULL);
+
+static CONVAR_HAZARD_RECORD* _acquireHazardRecord() {
+	for (CONVAR_HAZARD_RECORD* record = g_convarHazardRecords.load(std::memory_order_acquire); record != NULL; record = record->next) {
+		bool expected = false;
+		if (!record->used.load(std::memory_order_relaxed) && record->used.compare_exchange_strong(expected, true))
+			return record;
+	}
+
+	// once per thread (or nesting level) which doesn't find a free one
+	CONVAR_HAZARD_RECORD* record = new CONVAR_HAZARD_RECORD();
+	for (int i = 0; i < CONVAR_HAZARD_SLOTS_PER_RECORD; i++) {
+		record->values[i].store(NULL, std::memory_order_relaxed);
+	}
+	record->used.store(true, std::memory_order_relaxed);
+	record->nextOwned = NULL;
+	record->usedSlots = 0;
+
+	record->next = g_convarHazardRecords.load(std::memory_order_relaxed);
+	while (!g_convarHazardRecords.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) {
+		;
+	}
+	return record;
+}
+
+struct CONVAR_THREAD_HAZARDS {
+	CONVAR_HAZARD_RECORD* records;
+
+	CONVAR_THREAD_HAZARDS() : records(NULL) { ; }
+	~CONVAR_THREAD_HAZARDS() {
+		while (records != NULL) {
+			CONVAR_HAZARD_RECORD* record = records;
+			records = record->nextOwned;
+
+			record->nextOwned = NULL;
+			record->usedSlots = 0;
+			record->used.store(false, std::memory_order_release);
+		}
+	}
+};
+
+static thread_local CONVAR_THREAD_HAZARDS t_convarThreadHazards;
+
+static std::atomic<const void*>* _acquireHazardSlot() {
+	CONVAR_HAZARD_RECORD** link = &t_convarThreadHazards.records;
+	while (true) {
+		if (*link == NULL)
+			*link = _acquireHazardRecord();
+
+		CONVAR_HAZARD_RECORD* record = *link;
+		for (int i = 0; i < CONVAR_HAZARD_SLOTS_PER_RECORD; i++) {
+			if (!(record->usedSlots & (1u << i))) {
+				record->usedSlots |= (1u << i);
+				return &record->values[i];
+			}
+		}
+
+		link = &record->nextOwned;
+	}
+}
+
+static void _releaseHazardSlot(std::atomic<const void*>* slot) {
+	slot->store(NULL, std::memory_order_release);
+
+	for (CONVAR_HAZARD_RECORD* record = t_convarThreadHazards.records; record != NULL; record = record->nextOwned) {
+		if (slot >= &record->values[0] && slot < &record->values[CONVAR_HAZARD_SLOTS_PER_RECORD]) {
+			record->usedSlots &= ~(1u << (int)(slot - &record->values[0]));
+			break;
+		}
+	}
+}
+
+// replaced VALUEs which may still be in a hazard slot (write mutex), freed once the last ConVar is destroyed
+static std::vector<void*>* g_convarRetiredValues = NULL;
+static std::atomic<int> g_iNumConVars(0);
+
+static std::mutex& _getConVarWriteMutex() {
+	static std::mutex g_convarWriteMutex;
+	return g_convarWriteMutex;
+}
+
+// guards the registry (array, map and name index), ConVarDecls construct and register their convar on whichever thread uses it first
+// lock order: the decl mutex before this one
+static std::mutex& _getConVarRegistryMutex() {
+	static std::mutex g_convarRegistryMutex;
+	return g_convarRegistryMutex;
+}
 
 static std::vector<ConVar*>& _getGlobalConVarArray() {
 	static std::vector<ConVar*> g_vConVars;
 	return g_vConVars;
 }
 
-static std::unordered_map<std::string, ConVar*>& _getGlobalConVarMap() {
-	static std::unordered_map<std::string, ConVar*> g_vConVarMap;
+// transparent, so that lookups by std::string_view don't have to build a std::string
+struct CONVAR_NAME_HASH {
+	using is_transparent = void;
+	size_t operator () (std::string_view name) const { return std::hash<std::string_view>()(name); }
+};
+
+typedef std::unordered_map<std::string, ConVar*, CONVAR_NAME_HASH, std::equal_to<>> CONVAR_MAP;
+
+static CONVAR_MAP& _getGlobalConVarMap() {
+	static CONVAR_MAP g_vConVarMap;
 	return g_vConVarMap;
 }
 
+// name index for console autocompletion
+// a compressed prefix trie (every edge holds a whole string, nodes only exist where names branch or end) for prefix searches,
+// and a flat list of lowercase names with a character mask for fuzzy searches (most names are rejected by the mask alone)
+struct CONVAR_TRIE_NODE {
+	std::string label; // edge from the parent
+	ConVar* convar; // if a name ends here
+	unsigned int depth; // length of the name up to the end of the label
+	unsigned int preorder; // alphabetical rank, breaks ties between names of the same length
+	std::vector<unsigned int> children; // sorted by the first character of their label
+};
+
+struct CONVAR_FUZZY_ENTRY {
+	ConVar* convar;
+	std::string lowerName;
+	unsigned long long charMask;
+};
+
+struct CONVAR_NAME_INDEX {
+	std::vector<CONVAR_TRIE_NODE> nodes; // 0 is the root
+	bool preorderDirty;
+	std::vector<CONVAR_FUZZY_ENTRY> fuzzy;
+
+	CONVAR_NAME_INDEX() : preorderDirty(false) {
+		CONVAR_TRIE_NODE root;
+		root.convar = NULL;
+		root.depth = 0;
+		root.preorder = 0;
+		nodes.push_back(root);
+	}
+};
+
+static CONVAR_NAME_INDEX& _getGlobalConVarNameIndex() {
+	static CONVAR_NAME_INDEX g_convarNameIndex;
+	return g_convarNameIndex;
+}
+
+static unsigned long long _getFuzzyCharMask(std::string_view lowerStr) {
+	unsigned long long mask = 0;
+	for (size_t i = 0; i < lowerStr.length(); i++) {
+		mask |= (1ull << ((unsigned char)lowerStr[i] & 63));
+	}
+	return mask;
+}
+
+static std::string _toLowerAscii(std::string_view str) {
+	std::string lower(str);
+	for (size_t i = 0; i < lower.length(); i++) {
+		if (lower[i] >= 'A' && lower[i] <= 'Z')
+			lower[i] += ('a' - 'A');
+	}
+	return lower;
+}
+
+// child of node whose label starts with c, or the insert position (as a negative index - 1)
+static int _findTrieChild(const CONVAR_NAME_INDEX& index, unsigned int node, char c) {
+	const std::vector<unsigned int>& children = index.nodes[node].children;
+
+	size_t low = 0;
+	size_t high = children.size();
+	while (low < high) {
+		const size_t mid = (low + high) / 2;
+		if ((unsigned char)index.nodes[children[mid]].label[0] < (unsigned char)c)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low < children.size() && index.nodes[children[low]].label[0] == c)
+		return (int)low;
+
+	return -(int)low - 1;
+}
+
+static void _addConVarToNameIndex(ConVar* c, std::string_view name) {
+	CONVAR_NAME_INDEX& index = _getGlobalConVarNameIndex();
+	index.preorderDirty = true;
+
+	// trie (indices only, nodes may move while inserting)
+	unsigned int node = 0;
+	size_t pos = 0;
+	while (pos < name.length()) {
+		const int childSlot = _findTrieChild(index, node, name[pos]);
+		if (childSlot < 0) {
+			// new leaf
+			CONVAR_TRIE_NODE leaf;
+			leaf.label = std::string(name.substr(pos));
+			leaf.convar = c;
+			leaf.depth = (unsigned int)name.length();
+			leaf.preorder = 0;
+			index.nodes.push_back(leaf);
+
+			std::vector<unsigned int>& children = index.nodes[node].children;
+			children.insert(children.begin() + (-childSlot - 1), (unsigned int)index.nodes.size() - 1);
+			break;
+		}
+
+		const unsigned int child = index.nodes[node].children[childSlot];
+		const std::string& label = index.nodes[child].label;
+		size_t common = 0;
+		while (common < label.length() && pos + common < name.length() && label[common] == name[pos + common]) {
+			common++;
+		}
+
+		if (common < label.length()) {
+			// split the edge, the new node takes the common part
+			CONVAR_TRIE_NODE middle;
+			middle.label = label.substr(0, common);
+			middle.convar = NULL;
+			middle.depth = index.nodes[node].depth + (unsigned int)common;
+			middle.preorder = 0;
+			middle.children.push_back(child);
+
+			index.nodes[child].label.erase(0, common);
+			index.nodes.push_back(middle);
+			index.nodes[node].children[childSlot] = (unsigned int)index.nodes.size() - 1;
+			node = (unsigned int)index.nodes.size() - 1;
+		}
+		else
+			node = child;
+
+		pos += common;
+	}
+	if (pos == name.length())
+		index.nodes[node].convar = c;
+
+	// fuzzy
+	CONVAR_FUZZY_ENTRY entry;
+	entry.convar = c;
+	entry.lowerName = _toLowerAscii(name);
+	entry.charMask = _getFuzzyCharMask(entry.lowerName);
+	index.fuzzy.push_back(entry);
+}
+
+static void _removeConVarFromNameIndex(ConVar* c, std::string_view name) {
+	CONVAR_NAME_INDEX& index = _getGlobalConVarNameIndex();
+
+	// the nodes stay, an empty branch only costs a few bytes and keeps the indices stable
+	unsigned int node = 0;
+	size_t pos = 0;
+	while (pos < name.length()) {
+		const int childSlot = _findTrieChild(index, node, name[pos]);
+		if (childSlot < 0)
+			break;
+
+		node = index.nodes[node].children[childSlot];
+		pos += index.nodes[node].label.length();
+	}
+	if (pos == name.length() && index.nodes[node].convar == c)
+		index.nodes[node].convar = NULL;
+
+	for (size_t i = 0; i < index.fuzzy.size(); i++) {
+		if (index.fuzzy[i].convar == c) {
+			index.fuzzy.erase(index.fuzzy.begin() + i);
+			break;
+		}
+	}
+}
+
 static void _addConVar(ConVar* c) {
+	std::lock_guard<std::mutex> lock(_getConVarRegistryMutex());
+
 	if (_getGlobalConVarArray().size() < 1) {
 		_getGlobalConVarArray().reserve(1024);
+		_getGlobalConVarMap().reserve(1024);
 	}
 	_getGlobalConVarArray().push_back(c);
 	_getGlobalConVarMap()[std::string(c->getName().toUtf8(), c->getName().lengthUtf8())] = c;
+	_addConVarToNameIndex(c, std::string_view(c->getName().toUtf8(), c->getName().lengthUtf8()));
+}
+
+static void _removeConVar(ConVar* c) {
+	std::lock_guard<std::mutex> lock(_getConVarRegistryMutex());
+
+	std::vector<ConVar*>& convars = _getGlobalConVarArray();
+	for (size_t i = convars.size(); i > 0; i--) {
+		if (convars[i - 1] == c) {
+			convars.erase(convars.begin() + (i - 1));
+			break;
+		}
+	}
+
+	const auto result = _getGlobalConVarMap().find(std::string_view(c->getName().toUtf8(), c->getName().lengthUtf8()));
+	if (result != _getGlobalConVarMap().end() && result->second == c)
+		_getGlobalConVarMap().erase(result);
+
+	_removeConVarFromNameIndex(c, std::string_view(c->getName().toUtf8(), c->getName().lengthUtf8()));
 }
 
-static ConVar* _getConVar(const UString& name) {
-	const auto result = _getGlobalConVarMap().find(std::string(name.toUtf8(), name.lengthUtf8()));
+static ConVar* _getConVar(std::string_view name) {
+	std::lock_guard<std::mutex> lock(_getConVarRegistryMutex());
+
+	const auto result = _getGlobalConVarMap().find(name);
 	if (result != _getGlobalConVarMap().end()) {
 		return result->second;
 	}
@@ -44,10 +343,15 @@ UString ConVar::typeToString(CONVAR_TYPE type) {
 }
 
 void ConVar::init() {
+	g_iNumConVars++;
+
 	m_callbackfunc = NULL;
 	m_callbackfuncargs = NULL;
 	m_changecallback = NULL;
 
+	VALUE* value = new VALUE();
+	value->fValue = 0.0f;
+	m_value = value;
 	m_fValue = 0.0f;
 	m_fDefaultValue = 0.0f;
 
@@ -102,7 +406,10 @@ void ConVar::init(UString& name, float defaultValue, UString helpString, ConVarC
 	m_sName = name;
 	setDefaultFloat(defaultValue);
 	{
-		setValue(defaultValue);
+		VALUE* value = new VALUE();
+		value->fValue = defaultValue;
+		value->sValue = UString::format("%g", defaultValue);
+		initValue(value);
 	}
 	m_sHelpString = helpString;
 	m_changecallback = callback;
@@ -115,7 +422,10 @@ void ConVar::init(UString& name, UString defaultValue, UString helpString, ConVa
 	m_sName = name;
 	setDefaultString(defaultValue);
 	{
-		setValue(defaultValue);
+		VALUE* value = new VALUE();
+		value->fValue = (defaultValue.length() > 0 ? defaultValue.toFloat() : 0.0f);
+		value->sValue = defaultValue;
+		initValue(value);
 	}
 	m_sHelpString = helpString;
 	m_changecallback = callback;
@@ -250,6 +560,17 @@ ConVar::ConVar(UString name, const char* sDefaultValue, const char* helpString,
 	_addConVar(this);
 }
 
+ConVar::~ConVar() {
+	_removeConVar(this);
+
+	delete m_value.load();
+	m_value = NULL;
+
+	// nothing can publish (or read) a value anymore
+	if (--g_iNumConVars == 0)
+		freeRetiredValues();
+}
+
 void ConVar::exec() {
 	if (m_callbackfunc != NULL)
 		m_callbackfunc();
@@ -270,56 +591,140 @@ void ConVar::setDefaultString(UString defaultValue) {
 }
 
 void ConVar::setValue(float value) {
-	// TODO: make this less unsafe in multithreaded environments (for float convars at least)
+	VALUE* newValue = new VALUE();
+	newValue->fValue = value;
+	newValue->sValue = UString::format("%g", value);
+
+	setValueInternal(newValue, false);
+}
+
+void ConVar::setValue(UString sValue) {
+	VALUE* newValue = new VALUE();
+	newValue->sValue = sValue;
+
+	// an empty string keeps the previous float value
+	const bool hasFloatValue = (sValue.length() > 0);
+	newValue->fValue = (hasFloatValue ? sValue.toFloat() : 0.0f);
+
+	setValueInternal(newValue, !hasFloatValue);
+}
+
+void ConVar::initValue(VALUE* value) {
+	// the default is not a change: no callbacks, and nothing for a ConVarTransaction to record (lazy ConVarDecls may be constructed inside of one)
+	// nobody else can see this convar yet
+	delete m_value.load();
+	m_value = value;
+	m_fValue = value->fValue;
+}
 
-	// backup previous value
-	const float oldValue = m_fValue.load();
+void ConVar::setValueInternal(VALUE* newValue, bool keepFloatValue) {
+	const UString newStringValue = newValue->sValue; // newValue may already be deleted by another writer once it is published
+	const bool deferCallbacks = ConVarTransaction::isActive();
 
-	// then set the new value
-	const UString newStringValue = UString::format("%g", value);
+	// swap in the new value
+	UString oldValue;
 	{
-		m_fValue = value;
-		m_sValue = newStringValue;
+		std::lock_guard<std::mutex> lock(_getConVarWriteMutex());
+
+		VALUE* old = m_value.load();
+		if (keepFloatValue)
+			newValue->fValue = old->fValue;
+
+		publishValue(newValue);
+		if (deferCallbacks)
+			ConVarTransaction::onValueChange(this, old->sValue);
+		else if (m_changecallback != NULL)
+			oldValue = old->sValue;
+		retireValue(old);
 	}
 
-	// handle callbacks
-	{
-		// possible void callback
-		exec();
+	if (!deferCallbacks)
+		runCallbacks(oldValue, newStringValue);
+}
 
-		// possible change callback
-		if (m_changecallback != NULL)
-			m_changecallback(UString::format("%g", oldValue), newStringValue);
+void ConVar::runCallbacks(const UString& oldValue, const UString& newValue) {
+	// possible void callback
+	exec();
 
-		// possible arg callback
-		execArgs(newStringValue);
-	}
+	// possible change callback
+	if (m_changecallback != NULL)
+		m_changecallback(oldValue, newValue);
+
+	// possible arg callback
+	execArgs(newValue);
 }
 
-void ConVar::setValue(UString sValue) {
-	// backup previous value
-	const UString oldValue = m_sValue;
+ConVar::VALUE* ConVar::publishValue(VALUE* newValue) {
+	// write mutex must be held
+	VALUE* oldValue = m_value.exchange(newValue);
+	m_fValue.store(newValue->fValue, std::memory_order_release);
+	return oldValue;
+}
 
-	// then set the new value
-	{
-		m_sValue = sValue;
+void ConVar::retireValue(VALUE* oldValue) {
+	// write mutex must be held
+	// values which are still being read stay in the list until a later write finds them unused
+	if (g_convarRetiredValues == NULL)
+		g_convarRetiredValues = new std::vector<void*>();
+	std::vector<void*>& retiredValues = *g_convarRetiredValues;
+	retiredValues.push_back(oldValue);
+
+	for (size_t i = 0; i < retiredValues.size();) {
+		bool inUse = false;
+		for (CONVAR_HAZARD_RECORD* record = g_convarHazardRecords.load(std::memory_order_acquire); record != NULL && !inUse; record = record->next) {
+			for (int s = 0; s < CONVAR_HAZARD_SLOTS_PER_RECORD; s++) {
+				if (record->values[s].load() == retiredValues[i]) {
+					inUse = true;
+					break;
+				}
+			}
+		}
+
+		if (inUse)
+			i++;
+		else {
+			delete (VALUE*)retiredValues[i];
+			retiredValues[i] = retiredValues.back();
+			retiredValues.pop_back();
+		}
+	}
+}
+
+void ConVar::freeRetiredValues() {
+	if (g_convarRetiredValues == NULL) return;
 
-		if (sValue.length() > 0)
-			m_fValue = sValue.toFloat();
+	for (size_t i = 0; i < g_convarRetiredValues->size(); i++) {
+		delete (VALUE*)(*g_convarRetiredValues)[i];
 	}
+	delete g_convarRetiredValues;
+	g_convarRetiredValues = NULL;
+}
 
-	// handle callbacks
-	{
-		// possible void callback
-		exec();
+const UString ConVar::getString() const {
+	ValueSnapshot snapshot(this);
+	return snapshot.getString();
+}
 
-		// possible change callback
-		if (m_changecallback != NULL)
-			m_changecallback(oldValue, sValue);
+ConVar::ValueSnapshot::ValueSnapshot(const ConVar* convar) {
+	std::atomic<const void*>* slot = _acquireHazardSlot();
+	m_hazardSlot = slot;
 
-		// possible arg callback
-		execArgs(sValue);
+	// publish what we are about to read, then make sure that it was not replaced (and possibly deleted) in the meantime
+	const VALUE* value = convar->m_value.load(std::memory_order_acquire);
+	while (true) {
+		slot->store(value);
+
+		const VALUE* current = convar->m_value.load();
+		if (current == value)
+			break;
+
+		value = current;
 	}
+	m_value = value;
+}
+
+ConVar::ValueSnapshot::~ValueSnapshot() {
+	_releaseHazardSlot((std::atomic<const void*>*)m_hazardSlot);
 }
 
 void ConVar::setCallback(NativeConVarCallback callback) {
@@ -356,24 +761,895 @@ ConVarHandler::~ConVarHandler() {
 	convar = NULL;
 }
 
-const std::vector<ConVar*>& ConVarHandler::getConVarArray() const {
+std::vector<ConVar*> ConVarHandler::getConVarArray() const {
+	ConVarDecl::constructAll();
+
+	std::lock_guard<std::mutex> lock(_getConVarRegistryMutex());
 	return _getGlobalConVarArray();
 }
 
 int ConVarHandler::getNumConVar() const {
+	ConVarDecl::constructAll();
+
+	std::lock_guard<std::mutex> lock(_getConVarRegistryMutex());
 	return _getGlobalConVarArray().size();
 }
 
 ConVar* ConVarHandler::getConVarByName(UString name, bool warnIfNotFound) const {
-	ConVar* found = _getConVar(name);
+	ConVar* found = ConVarDecl::find(std::string_view(name.toUtf8(), name.lengthUtf8()));
 	if (found != NULL)
 		return found;
 
-	if (warnIfNotFound) {
-		UString errormsg = UString("ENGINE: ConVar \"");
-		errormsg.append(name);
-		errormsg.append("\" does not exist...\n");
+	if (warnIfNotFound)
+		return ConVarDecl::notFound(std::string_view(name.toUtf8(), name.lengthUtf8()));
+
+	return &_emptyDummyConVar;
+}
+
+
+std::vector<ConVar*> ConVarHandler::getConVarByLetter(UString letters, size_t maxResults) const {
+	ConVarDecl::constructAll();
+
+	std::lock_guard<std::mutex> lock(_getConVarRegistryMutex());
+
+	std::vector<ConVar*> matches;
+	CONVAR_NAME_INDEX& index = _getGlobalConVarNameIndex();
+	const std::string_view prefix(letters.toUtf8(), letters.lengthUtf8());
+
+	// find the subtree of all names starting with prefix (which may end in the middle of an edge)
+	unsigned int node = 0;
+	size_t pos = 0;
+	while (pos < prefix.length()) {
+		const int childSlot = _findTrieChild(index, node, prefix[pos]);
+		if (childSlot < 0)
+			return matches;
+
+		node = index.nodes[node].children[childSlot];
+		const std::string& label = index.nodes[node].label;
+		const size_t length = std::min(label.length(), prefix.length() - pos);
+		if (label.compare(0, length, prefix.substr(pos, length)) != 0)
+			return matches;
+
+		pos += length;
+	}
+
+	if (index.preorderDirty) {
+		unsigned int preorder = 0;
+		std::vector<unsigned int> stack(1, 0);
+		while (stack.size() > 0) {
+			const unsigned int current = stack.back();
+			stack.pop_back();
+
+			index.nodes[current].preorder = preorder++;
+			const std::vector<unsigned int>& children = index.nodes[current].children;
+			for (size_t i = children.size(); i > 0; i--) {
+				stack.push_back(children[i - 1]);
+			}
+		}
+		index.preorderDirty = false;
+	}
+
+	// best first: shortest names first (exact match first), then alphabetical
+	// every node is shorter than its subtree, so only the nodes up to the length of the last result are visited
+	typedef std::pair<unsigned long long, unsigned int> QUEUE_ENTRY; // (depth << 32 | preorder, node)
+	std::priority_queue<QUEUE_ENTRY, std::vector<QUEUE_ENTRY>, std::greater<QUEUE_ENTRY>> queue;
+	queue.push(QUEUE_ENTRY(((unsigned long long)index.nodes[node].depth << 32) | index.nodes[node].preorder, node));
+	while (queue.size() > 0 && (maxResults == 0 || matches.size() < maxResults)) {
+		const unsigned int current = queue.top().second;
+		queue.pop();
+
+		if (index.nodes[current].convar != NULL)
+			matches.push_back(index.nodes[current].convar);
+
+		const std::vector<unsigned int>& children = index.nodes[current].children;
+		for (size_t i = 0; i < children.size(); i++) {
+			queue.push(QUEUE_ENTRY(((unsigned long long)index.nodes[children[i]].depth << 32) | index.nodes[children[i]].preorder, children[i]));
+		}
+	}
+
+	return matches;
+}
+
+std::vector<ConVar*> ConVarHandler::getConVarByFuzzyMatch(UString pattern, size_t maxResults) const {
+	ConVarDecl::constructAll();
+
+	struct FUZZY_MATCH {
+		int score;
+		const CONVAR_FUZZY_ENTRY* entry;
+	};
+
+	if (pattern.lengthUtf8() < 1)
+		return getConVarByLetter(pattern, maxResults);
+
+	std::lock_guard<std::mutex> lock(_getConVarRegistryMutex());
+
+	const CONVAR_NAME_INDEX& index = _getGlobalConVarNameIndex();
+	const std::string lowerPattern = _toLowerAscii(std::string_view(pattern.toUtf8(), pattern.lengthUtf8()));
+	const unsigned long long patternMask = _getFuzzyCharMask(lowerPattern);
+
+	std::vector<FUZZY_MATCH> matches;
+	for (size_t i = 0; i < index.fuzzy.size(); i++) {
+		const CONVAR_FUZZY_ENTRY& entry = index.fuzzy[i];
+		if ((entry.charMask & patternMask) != patternMask || entry.lowerName.length() < lowerPattern.length())
+			continue;
+
+		// every occurrence of the first pattern character is a possible start, the rest is matched greedily
+		const std::string& name = entry.lowerName;
+		int bestScore = INT_MIN;
+		for (size_t start = name.find(lowerPattern[0]); start != std::string::npos; start = name.find(lowerPattern[0], start + 1)) {
+			int score = 0;
+			size_t n = start;
+			size_t lastMatch = std::string::npos;
+			size_t p = 0;
+			for (; p < lowerPattern.length() && n < name.length(); n++) {
+				if (name[n] != lowerPattern[p])
+					continue;
+
+				score += 16;
+				if (n == 0 || name[n - 1] == '_')
+					score += 12; // word start
+				if (lastMatch != std::string::npos && lastMatch + 1 == n)
+					score += 8; // consecutive
+				else if (lastMatch != std::string::npos)
+					score -= std::min<int>((int)(n - lastMatch - 1), 8); // gap
+
+				lastMatch = n;
+				p++;
+			}
+
+			if (p < lowerPattern.length())
+				break; // later starts can't match either
+
+			bestScore = std::max(bestScore, score);
+		}
+
+		if (bestScore == INT_MIN)
+			continue;
+
+		FUZZY_MATCH match;
+		match.score = bestScore - (int)name.length() / 4; // prefer shorter names
+		match.entry = &entry;
+		matches.push_back(match);
+	}
+
+	const auto isBetter = [](const FUZZY_MATCH& a, const FUZZY_MATCH& b) {
+		if (a.score != b.score)
+			return (a.score > b.score);
+		return (a.entry->lowerName < b.entry->lowerName);
+	};
+
+	const size_t numResults = (maxResults == 0 ? matches.size() : std::min(maxResults, matches.size()));
+	std::partial_sort(matches.begin(), matches.begin() + numResults, matches.end(), isBetter);
+
+	std::vector<ConVar*> results(numResults);
+	for (size_t i = 0; i < numResults; i++) {
+		results[i] = matches[i].entry->convar;
+	}
+	return results;
+}
+
+
+//****************//
+//	ConVarDecl   //
+//****************//
+
+static ConVarDecl* g_pendingConVarDecls = NULL; // constant initialized, declarations link themselves in during dynamic static init
+
+static std::mutex& _getConVarDeclMutex() {
+	static std::mutex g_convarDeclMutex;
+	return g_convarDeclMutex;
+}
+
+ConVarDecl::ConVarDecl(std::string_view name, float defaultValue, std::string_view helpString, ConVar::ConVarChangeCallback callback) : m_name(name), m_helpString(helpString), m_type(ConVar::CONVAR_TYPE::CONVAR_TYPE_FLOAT), m_fDefaultValue(defaultValue), m_sDefaultValue(NULL), m_callback(callback), m_convar(NULL), m_next(NULL) {
+	link();
+}
+
+ConVarDecl::ConVarDecl(std::string_view name, int defaultValue, std::string_view helpString, ConVar::ConVarChangeCallback callback) : m_name(name), m_helpString(helpString), m_type(ConVar::CONVAR_TYPE::CONVAR_TYPE_INT), m_fDefaultValue((float)defaultValue), m_sDefaultValue(NULL), m_callback(callback), m_convar(NULL), m_next(NULL) {
+	link();
+}
+
+ConVarDecl::ConVarDecl(std::string_view name, bool defaultValue, std::string_view helpString, ConVar::ConVarChangeCallback callback) : m_name(name), m_helpString(helpString), m_type(ConVar::CONVAR_TYPE::CONVAR_TYPE_BOOL), m_fDefaultValue(defaultValue ? 1.0f : 0.0f), m_sDefaultValue(NULL), m_callback(callback), m_convar(NULL), m_next(NULL) {
+	link();
+}
+
+ConVarDecl::ConVarDecl(std::string_view name, const char* defaultValue, std::string_view helpString, ConVar::ConVarChangeCallback callback) : m_name(name), m_helpString(helpString), m_type(ConVar::CONVAR_TYPE::CONVAR_TYPE_STRING), m_fDefaultValue(0.0f), m_sDefaultValue(defaultValue), m_callback(callback), m_convar(NULL), m_next(NULL) {
+	link();
+}
+
+ConVarDecl::~ConVarDecl() {
+	{
+		std::lock_guard<std::mutex> lock(_getConVarDeclMutex());
+		unlink();
+	}
+
+	delete m_convar.load(); // unregisters itself
+	m_convar = NULL;
+}
+
+void ConVarDecl::link() {
+	// make sure that the registry outlives every declaration (function statics are destroyed in reverse order of construction)
+	_getConVarRegistryMutex();
+	_getGlobalConVarArray();
+	_getGlobalConVarMap();
+	_getGlobalConVarNameIndex();
+
+	std::lock_guard<std::mutex> lock(_getConVarDeclMutex());
+	m_next = g_pendingConVarDecls;
+	g_pendingConVarDecls = this;
+}
+
+void ConVarDecl::unlink() {
+	// decl mutex must be held
+	for (ConVarDecl** decl = &g_pendingConVarDecls; *decl != NULL; decl = &(*decl)->m_next) {
+		if (*decl == this) {
+			*decl = m_next;
+			break;
+		}
+	}
+	m_next = NULL;
+}
+
+ConVar* ConVarDecl::construct() {
+	std::lock_guard<std::mutex> lock(_getConVarDeclMutex());
+
+	// another thread may have been faster
+	ConVar* convar = m_convar.load();
+	if (convar != NULL)
+		return convar;
+
+	const UString name(m_name.data(), (int)m_name.length());
+	const std::string helpString(m_helpString); // the view is not necessarily null terminated
+	switch (m_type) {
+	case ConVar::CONVAR_TYPE::CONVAR_TYPE_BOOL:
+		convar = new ConVar(name, m_fDefaultValue > 0.0f, helpString.c_str(), m_callback);
+		break;
+	case ConVar::CONVAR_TYPE::CONVAR_TYPE_INT:
+		convar = new ConVar(name, (int)m_fDefaultValue, helpString.c_str(), m_callback);
+		break;
+	case ConVar::CONVAR_TYPE::CONVAR_TYPE_FLOAT:
+		convar = new ConVar(name, m_fDefaultValue, helpString.c_str(), m_callback);
+		break;
+	case ConVar::CONVAR_TYPE::CONVAR_TYPE_STRING:
+		convar = new ConVar(name, m_sDefaultValue != NULL ? m_sDefaultValue : "", helpString.c_str(), m_callback);
+		break;
+	}
+
+	unlink();
+	m_convar.store(convar, std::memory_order_release);
+	return convar;
+}
+
+ConVar* ConVarDecl::find(std::string_view name) {
+	ConVar* convar = _getConVar(name);
+	if (convar != NULL)
+		return convar;
+
+	ConVarDecl* found = NULL;
+	{
+		std::lock_guard<std::mutex> lock(_getConVarDeclMutex());
+		for (ConVarDecl* decl = g_pendingConVarDecls; decl != NULL; decl = decl->m_next) {
+			if (decl->m_name == name) {
+				found = decl;
+				break;
+			}
+		}
+	}
+
+	return (found != NULL ? found->get() : NULL);
+}
+
+ConVar* ConVarDecl::notFound(std::string_view name) {
+	debugLog("ENGINE: ConVar \"%.*s\" does not exist...\n", (int)name.length(), name.data());
+	return &_emptyDummyConVar;
+}
+
+void ConVarDecl::constructAll() {
+	// the list is in reverse declaration order
+	std::vector<ConVarDecl*> pending;
+	{
+		std::lock_guard<std::mutex> lock(_getConVarDeclMutex());
+		for (ConVarDecl* decl = g_pendingConVarDecls; decl != NULL; decl = decl->m_next) {
+			pending.push_back(decl);
+		}
+	}
+
+	for (size_t i = pending.size(); i > 0; i--) {
+		pending[i - 1]->get();
+	}
+}
+
+int ConVarDecl::getNumPending() {
+	std::lock_guard<std::mutex> lock(_getConVarDeclMutex());
+
+	int numPending = 0;
+	for (ConVarDecl* decl = g_pendingConVarDecls; decl != NULL; decl = decl->m_next) {
+		numPending++;
+	}
+	return numPending;
+}
+
+
+//*********************//
+//	ConVarTransaction  //
+//*********************//
+
+struct CONVAR_TRANSACTION_CHANGE {
+	ConVar* convar;
+	UString oldValue; // from before the first change
+};
+
+struct CONVAR_TRANSACTION_STATE {
+	int depth;
+	std::vector<CONVAR_TRANSACTION_CHANGE> changes; // in order of the first change
+	std::unordered_set<ConVar*> changed;
+
+	CONVAR_TRANSACTION_STATE() : depth(0) { ; }
+};
+
+static thread_local CONVAR_TRANSACTION_STATE t_convarTransaction;
+
+ConVarTransaction::ConVarTransaction() {
+	t_convarTransaction.depth++;
+}
+
+ConVarTransaction::~ConVarTransaction() {
+	CONVAR_TRANSACTION_STATE& state = t_convarTransaction;
+	if (--state.depth > 0)
+		return;
+
+	// the transaction is closed now, changes made by the callbacks are not deferred again
+	std::vector<CONVAR_TRANSACTION_CHANGE> changes;
+	changes.swap(state.changes);
+	state.changed.clear();
+
+	for (size_t i = 0; i < changes.size(); i++) {
+		const UString newValue = changes[i].convar->getString();
+		if (newValue == changes[i].oldValue)
+			continue;
+
+		changes[i].convar->runCallbacks(changes[i].oldValue, newValue);
+	}
+}
+
+bool ConVarTransaction::isActive() {
+	return (t_convarTransaction.depth > 0);
+}
+
+void ConVarTransaction::onValueChange(ConVar* convar, const UString& oldValue) {
+	CONVAR_TRANSACTION_STATE& state = t_convarTransaction;
+	if (state.changed.insert(convar).second) {
+		CONVAR_TRANSACTION_CHANGE change;
+		change.convar = convar;
+		change.oldValue = oldValue;
+		state.changes.push_back(change);
+	}
+}
+
+
+
+//****************//
+//	Config Files //
+//****************//
+
+static std::string_view _trimConfigWhitespace(std::string_view str) {
+	size_t start = 0;
+	while (start < str.length() && (str[start] == ' ' || str[start] == '\t' || str[start] == '\r')) {
+		start++;
+	}
+
+	size_t end = str.length();
+	while (end > start && (str[end - 1] == ' ' || str[end - 1] == '\t' || str[end - 1] == '\r')) {
+		end--;
+	}
+
+	return str.substr(start, end - start);
+}
+
+bool ConVarHandler::execConfigFile(UString filePath) {
+	std::string path(filePath.toUtf8(), filePath.lengthUtf8());
+	if (path.find('/') == std::string::npos && path.find('\\') == std::string::npos)
+		path.insert(0, "cfg/");
+	if (path.length() < 4 || path.compare(path.length() - 4, 4, ".cfg") != 0)
+		path.append(".cfg");
+
+	std::ifstream file(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.good()) {
+		debugLog("ENGINE: can't open config file %s\n", path.c_str());
+		return false;
+	}
+
+	std::string config((size_t)file.tellg(), '\0');
+	file.seekg(0);
+	file.read(&config[0], config.length());
+
+	execConfig(config, path.c_str());
+	return true;
+}
+
+int ConVarHandler::execConfig(std::string_view config, const char* sourceName) {
+	ConVarTransaction transaction;
+
+	int numExecuted = 0;
+	int line = 1;
+	size_t pos = 0;
+	while (pos < config.length()) {
+		// one command ends at the end of the line, or at a ';' or "//" outside of quotes
+		size_t end = pos;
+		bool inQuotes = false;
+		while (end < config.length() && config[end] != '\n') {
+			const char c = config[end];
+			if (c == '"')
+				inQuotes = !inQuotes;
+			else if (!inQuotes && (c == ';' || (c == '/' && end + 1 < config.length() && config[end + 1] == '/')))
+				break;
+
+			end++;
+		}
+
+		const std::string_view command = _trimConfigWhitespace(config.substr(pos, end - pos));
+		const int commandLine = line;
+
+		// comments run until the end of the line
+		if (end < config.length() && config[end] == '/') {
+			while (end < config.length() && config[end] != '\n') {
+				end++;
+			}
+		}
+		if (end < config.length() && config[end] == '\n')
+			line++;
+		pos = end + 1;
+
+		if (command.empty())
+			continue;
+
+		// name, then everything else as the value/args
+		size_t nameEnd = 0;
+		while (nameEnd < command.length() && command[nameEnd] != ' ' && command[nameEnd] != '\t') {
+			nameEnd++;
+		}
+		const std::string_view name = command.substr(0, nameEnd);
+		std::string_view args = _trimConfigWhitespace(command.substr(nameEnd));
+		const bool hasArgs = !args.empty();
+		if (args.length() > 1 && args.front() == '"' && args.back() == '"')
+			args = args.substr(1, args.length() - 2);
+
+		ConVar* found = ConVarDecl::find(name);
+		if (found == NULL) {
+			debugLog("ENGINE: %s:%i: unknown command \"%.*s\"\n", sourceName, commandLine, (int)name.length(), name.data());
+			continue;
+		}
+
+		if (found->hasValue()) {
+			if (!hasArgs)
+				continue; // would only print the value
+
+			found->setValue(UString(args.data(), (int)args.length()));
+		}
+		else {
+			// commands are not deferred, only the value changes they cause are
+			if (hasArgs)
+				found->execArgs(UString(args.data(), (int)args.length()));
+			else
+				found->exec();
+		}
+
+		numExecuted++;
+	}
+
+	return numExecuted;
+}
+
+void _exec(UString args) {
+	convar->execConfigFile(args.trim());
+}
+
+ConVar _exec_("exec", "executes a config file (every changed convar runs its callbacks once, with its final value)", _exec);
+
+
+//****************//
+//	Stress Test  //
+//****************//
+
+ConVar _convar_test_value("convar_test_value", "0", "written and read by convar_stress_test and convar_benchmark");
+
+static int _getNumConVarTestReaders() {
+	return clamp<int>((int)std::thread::hardware_concurrency() - 1, 2, 8);
+}
+
+void _convar_stress_test(void) {
+	const int numWrites = 100000;
+	const int numReaders = _getNumConVarTestReaders();
+
+	ConVar* value = &_convar_test_value;
+	value->setValue(0.0f);
+
+	std::atomic<bool> done(false);
+	std::atomic<long long> numReads(0);
+	std::atomic<long long> numErrors(0);
+
+	std::vector<std::thread> readers;
+	for (int r = 0; r < numReaders; r++) {
+		readers.push_back(std::thread([&, r]() {
+			long long reads = 0;
+			long long errors = 0;
+			float lastFloatValue = 0.0f;
+			while (!done.load()) {
+				// float and string must always belong to the same write
+				{
+					ConVar::ValueSnapshot snapshot(value);
+					if (snapshot.getString().toFloat() != snapshot.getFloat())
+						errors++;
+				}
+
+				// the single writer only counts up
+				const float floatValue = value->getFloat();
+				if (floatValue < lastFloatValue)
+					errors++;
+				lastFloatValue = floatValue;
+
+				// copies, and nested snapshots
+				if ((reads % 16) == r) {
+					const UString stringValue = value->getString();
+					ConVar::ValueSnapshot outer(value);
+					ConVar::ValueSnapshot inner(value);
+					if (stringValue.toFloat() > inner.getFloat() || outer.getFloat() > inner.getFloat())
+						errors++;
+				}
+
+				reads++;
+			}
+			numReads += reads;
+			numErrors += errors;
+		}));
+	}
+
+	// alternate between both setters
+	for (int i = 1; i <= numWrites; i++) {
+		if (i % 2 == 0)
+			value->setValue((float)i);
+		else
+			value->setValue(UString::format("%i", i));
+	}
+
+	done = true;
+	for (size_t r = 0; r < readers.size(); r++) {
+		readers[r].join();
+	}
+
+	const bool passed = (numErrors.load() == 0 && value->getFloat() == (float)numWrites && value->getString().toFloat() == (float)numWrites);
+	debugLog("ConVar: stress test %s, %i writes, %i readers, %lld reads, %lld errors\n", passed ? "PASSED" : "FAILED", numWrites, numReaders, numReads.load(), numErrors.load());
+
+	value->setValue(0.0f);
+}
+
+void _convar_benchmark(void) {
+	const int numReadsPerReader = 2000000;
+	const int numReaders = _getNumConVarTestReaders();
+
+	ConVar* value = &_convar_test_value;
+	value->setValue(0.0f);
+
+	// reference: what a mutex around the string (the obvious fix) would cost
+	std::mutex referenceMutex;
+	UString referenceValue = "0";
+	float referenceFloatValue = 0.0f;
+
+	for (int pass = 0; pass < 2; pass++) {
+		const bool withWriter = (pass == 1);
+
+		std::atomic<bool> done(false);
+		std::atomic<long long> numWrites(0);
+		std::thread writer;
+		if (withWriter) {
+			writer = std::thread([&]() {
+				long long writes = 0;
+				while (!done.load()) {
+					value->setValue((float)(writes % 1000));
+					{
+						std::lock_guard<std::mutex> lock(referenceMutex);
+						referenceValue = UString::format("%g", (float)(writes % 1000));
+						referenceFloatValue = (float)(writes % 1000);
+					}
+					writes++;
+				}
+				numWrites = writes;
+			});
+		}
+
+		const char* names[3] = { "getFloat()", "ValueSnapshot", "mutex reference" };
+		for (int method = 0; method < 3; method++) {
+			std::atomic<double> checksum(0.0);
+			std::vector<std::thread> readers;
+
+			Timer timer;
+			timer.start();
+			for (int r = 0; r < numReaders; r++) {
+				readers.push_back(std::thread([&, method]() {
+					double sum = 0.0;
+					for (int i = 0; i < numReadsPerReader; i++) {
+						if (method == 0)
+							sum += value->getFloat();
+						else if (method == 1) {
+							ConVar::ValueSnapshot snapshot(value);
+							sum += snapshot.getFloat() + snapshot.getString().length();
+						}
+						else {
+							std::lock_guard<std::mutex> lock(referenceMutex);
+							sum += referenceFloatValue + referenceValue.length();
+						}
+					}
+
+					double expected = checksum.load();
+					while (!checksum.compare_exchange_weak(expected, expected + sum)) {
+						;
+					}
+				}));
+			}
+			for (size_t r = 0; r < readers.size(); r++) {
+				readers[r].join();
+			}
+			timer.update();
+
+			const double readsPerSecond = ((double)numReadsPerReader * numReaders) / std::max(timer.getElapsedTime(), 0.000001);
+			debugLog("ConVar: %s writer, %i readers, %-16s %.1f M reads/s (checksum %g)\n", withWriter ? "with" : "without", numReaders, names[method], readsPerSecond / 1000000.0, checksum.load());
+		}
+
+		done = true;
+		if (writer.joinable()) {
+			writer.join();
+			debugLog("ConVar: writer made %lld writes\n", numWrites.load());
+		}
+	}
+
+	value->setValue(0.0f);
+}
+
+ConVar _convar_stress_test_("convar_stress_test", "hammers convar_test_value with one writer and several reader threads, checks that every read is consistent", _convar_stress_test);
+ConVar _convar_benchmark_("convar_benchmark", "concurrent ConVar read throughput with and without a writer, compared to a mutex", _convar_benchmark);
+
+
+
+//****************//
+//	Registration //
+//****************//
+
+void _convar_registration_benchmark(void) {
+	const int numConVars = 1000;
+	const int numReads = 10000000;
+
+	// names must outlive the declarations (views)
+	std::vector<std::string> names;
+	for (int i = 0; i < numConVars; i++) {
+		names.push_back(std::string("convar_registration_benchmark_") + std::to_string(i));
+	}
+
+	// eager: what every global ConVar costs during static init
+	std::vector<ConVar*> convars(numConVars);
+	Timer timer;
+	timer.start();
+	for (int i = 0; i < numConVars; i++) {
+		convars[i] = new ConVar(UString(names[i].c_str()), 1.0f, "registration benchmark convar");
+	}
+	timer.update();
+	const double eagerTime = timer.getElapsedTime();
+
+	// lazy: what every global ConVarDecl costs during static init, and what is deferred to the first use
+	ConVarDecl* decls = (ConVarDecl*)::operator new(sizeof(ConVarDecl) * numConVars);
+	timer.start();
+	for (int i = 0; i < numConVars; i++) {
+		new (&decls[i]) ConVarDecl(names[i], 1.0f, "registration benchmark convar");
+	}
+	timer.update();
+	const double declTime = timer.getElapsedTime();
+
+	// (the eager ones have the same names, get rid of them first)
+	for (int i = 0; i < numConVars; i++) {
+		delete convars[i];
+	}
+
+	timer.start();
+	ConVarDecl::constructAll();
+	timer.update();
+	const double constructTime = timer.getElapsedTime();
+
+	debugLog("ConVar: registering %i convars: eager %.3f ms, declared %.3f ms (+ %.3f ms deferred to first use)\n", numConVars, eagerTime * 1000.0, declTime * 1000.0, constructTime * 1000.0);
+
+	// reads
+	ConVar* declared = decls[numConVars / 2].get();
+	const ConVarRef<float> floatRef(decls[numConVars / 2]);
+	const ConVarRef<int> intRef(decls[numConVars / 2]);
+
+	double sum = 0.0;
+	timer.start();
+	for (int i = 0; i < numReads; i++) {
+		sum += declared->getFloat();
+	}
+	timer.update();
+	const double getFloatTime = timer.getElapsedTime();
+
+	timer.start();
+	for (int i = 0; i < numReads; i++) {
+		sum += floatRef;
+	}
+	timer.update();
+	const double floatRefTime = timer.getElapsedTime();
+
+	timer.start();
+	for (int i = 0; i < numReads; i++) {
+		sum += intRef;
+	}
+	timer.update();
+	const double intRefTime = timer.getElapsedTime();
+
+	const int numLookups = numReads / 100;
+	const UString lookupName = UString(names[numConVars / 2].c_str());
+	timer.start();
+	for (int i = 0; i < numLookups; i++) {
+		sum += convar->getConVarByName(lookupName)->getFloat();
+	}
+	timer.update();
+	const double lookupTime = timer.getElapsedTime();
+
+	debugLog("ConVar: per read: getFloat() %.2f ns, ConVarRef<float> %.2f ns, ConVarRef<int> %.2f ns, getConVarByName() %.2f ns (checksum %g)\n",
+		getFloatTime * 1e9 / numReads, floatRefTime * 1e9 / numReads, intRefTime * 1e9 / numReads, lookupTime * 1e9 / numLookups, sum);
+
+	for (int i = 0; i < numConVars; i++) {
+		decls[i].~ConVarDecl();
+	}
+	::operator delete(decls);
+}
+
+ConVar _convar_registration_benchmark_("convar_registration_benchmark", "static init cost of ConVar vs ConVarDecl, and read cost of ConVar vs ConVarRef", _convar_registration_benchmark);
 
 
+
+//****************//
+//	Config Bench //
+//****************//
+
+static int g_iConfigBenchmarkCallbacks = 0;
+
+static void _onConfigBenchmarkChange(UString oldValue, UString newValue) {
+	g_iConfigBenchmarkCallbacks++;
+}
+
+void _convar_config_benchmark(void) {
+	const int numConVars = 50;
+	const int numLines = 5000;
+
+	std::vector<ConVar*> convars;
+	for (int i = 0; i < numConVars; i++) {
+		convars.push_back(new ConVar(UString::format("convar_config_benchmark_%i", i), 0.0f, "config benchmark convar", _onConfigBenchmarkChange));
+	}
+
+	// every convar is set many times, the last line of every convar sets it to its index
+	std::string config = "// convar_config_benchmark\n";
+	for (int i = 0; i < numLines; i++) {
+		const int index = i % numConVars;
+		const int value = (i + numConVars >= numLines ? index : i);
+		config.append("convar_config_benchmark_" + std::to_string(index) + " \"" + std::to_string(value) + "\"; // comment\n");
+	}
+
+	// unbatched: what setting every line directly costs
+	g_iConfigBenchmarkCallbacks = 0;
+	Timer timer;
+	timer.start();
+	for (int i = 0; i < numLines; i++) {
+		const int index = i % numConVars;
+		const int value = (i + numConVars >= numLines ? index : i);
+		convar->getConVarByName(UString::format("convar_config_benchmark_%i", index))->setValue(UString::format("%i", value));
+	}
+	timer.update();
+	const double directTime = timer.getElapsedTime();
+	const int directCallbacks = g_iConfigBenchmarkCallbacks;
+
+	for (int i = 0; i < numConVars; i++) {
+		convars[i]->setValue(0.0f);
+	}
+
+	// batched
+	g_iConfigBenchmarkCallbacks = 0;
+	timer.start();
+	const int numExecuted = convar->execConfig(config, "convar_config_benchmark");
+	timer.update();
+	const double batchedTime = timer.getElapsedTime();
+	const int batchedCallbacks = g_iConfigBenchmarkCallbacks;
+
+	bool correct = (numExecuted == numLines);
+	for (int i = 0; i < numConVars; i++) {
+		correct = (correct && convars[i]->getInt() == i);
+	}
+
+	debugLog("ConVar: %i lines, %i convars: setValue() %.3f ms, %i callbacks; execConfig() %.3f ms, %i callbacks (%s)\n", numLines, numConVars, directTime * 1000.0, directCallbacks, batchedTime * 1000.0, batchedCallbacks, correct ? "correct" : "WRONG VALUES");
+
+	for (int i = 0; i < numConVars; i++) {
+		delete convars[i];
+	}
+}
+
+ConVar _convar_config_benchmark_("convar_config_benchmark", "applies a generated config with and without batching, reports time and number of change callbacks", _convar_config_benchmark);
+
+
+
+//****************//
+//	Search Bench //
+//****************//
+
+void _convar_search_benchmark(void) {
+	const int numConVars = 5000;
+	const int numRepeats = 200;
+
+	// synthetic names in the usual style (prefix_word_word)
+	const char* prefixes[] = { "r", "snd", "osu", "ui", "mp", "debug", "cl", "sv", "fps", "mouse" };
+	const char* words[] = { "enable", "volume", "scale", "offset", "speed", "color", "alpha", "size", "mode", "threads", "limit", "delay", "draw", "skin", "cursor", "hud", "timing", "sync", "filter", "quality" };
+	std::vector<UString> names;
+	for (int i = 0; names.size() < numConVars; i++) {
+		names.push_back(UString::format("%s_%s_%s_%i", prefixes[i % 10], words[(i / 10) % 20], words[(i / 200) % 20], i / 4000));
+	}
+
+	Timer timer;
+	timer.start();
+	std::vector<ConVar*> convars;
+	for (size_t i = 0; i < names.size(); i++) {
+		convars.push_back(new ConVar(names[i], 0.0f));
 	}
-}
\ No newline at end of file
+	timer.update();
+	debugLog("ConVar: registered %i synthetic convars in %.3f ms (%i total)\n", numConVars, timer.getElapsedTime() * 1000.0, convar->getNumConVar());
+
+	// typing "osu_skin" key by key
+	const char* keystrokes[] = { "o", "os", "osu", "osu_", "osu_s", "osu_sk", "osu_ski", "osu_skin" };
+	for (int k = 0; k < 8; k++) {
+		const UString letters = keystrokes[k];
+		size_t numResults = 0;
+
+		timer.start();
+		for (int r = 0; r < numRepeats; r++) {
+			numResults = convar->getConVarByLetter(letters, 16).size();
+		}
+		timer.update();
+		const double trieTime = timer.getElapsedTime() / numRepeats;
+
+		size_t numAllResults = 0;
+		timer.start();
+		for (int r = 0; r < numRepeats; r++) {
+			numAllResults = convar->getConVarByLetter(letters).size();
+		}
+		timer.update();
+		const double trieAllTime = timer.getElapsedTime() / numRepeats;
+
+		// reference: scanning every convar
+		size_t numScanResults = 0;
+		timer.start();
+		for (int r = 0; r < numRepeats; r++) {
+			numScanResults = 0;
+			const std::vector<ConVar*>& all = convar->getConVarArray();
+			for (size_t i = 0; i < all.size(); i++) {
+				if (all[i]->getName().find(letters) == 0)
+					numScanResults++;
+			}
+		}
+		timer.update();
+		const double scanTime = timer.getElapsedTime() / numRepeats;
+
+		debugLog("ConVar: prefix \"%s\": top %i in %.2f us, all %i in %.2f us (scan: %i in %.2f us)\n", keystrokes[k], (int)numResults, trieTime * 1e6, (int)numAllResults, trieAllTime * 1e6, (int)numScanResults, scanTime * 1e6);
+	}
+
+	const char* patterns[] = { "oskn", "sndvol", "rthr", "mouse_spd", "dbgdraw" };
+	for (int p = 0; p < 5; p++) {
+		std::vector<ConVar*> results;
+
+		timer.start();
+		for (int r = 0; r < numRepeats; r++) {
+			results = convar->getConVarByFuzzyMatch(patterns[p], 16);
+		}
+		timer.update();
+
+		debugLog("ConVar: fuzzy \"%s\": %i in %.2f us, best: %s\n", patterns[p], (int)results.size(), timer.getElapsedTime() / numRepeats * 1e6, results.size() > 0 ? results[0]->getName().toUtf8() : "-");
+	}
+
+	for (size_t i = 0; i < convars.size(); i++) {
+		delete convars[i];
+	}
+}
+
+ConVar _convar_search_benchmark_("convar_search_benchmark", "prefix (trie) and fuzzy ConVar search over 5000 synthetic convars, compared to scanning every name", _convar_search_benchmark);
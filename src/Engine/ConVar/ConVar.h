@@ -3,7 +3,16 @@
 
 #include "cbase.h"
 
+class ConVarTransaction;
+
 class ConVar {
+private:
+	// immutable, every setValue() publishes a new one
+	struct VALUE {
+		float fValue;
+		UString sValue;
+	};
+
 public:
 	enum class CONVAR_TYPE {
 		CONVAR_TYPE_BOOL,
@@ -20,6 +29,25 @@ public:
 	typedef fastdelegate::FastDelegate1<UString> NativeConVarCallbackArgs;
 	typedef fastdelegate::FastDelegate2<UString, UString> NativeConVarChangeCallback;
 
+	// consistent (float and string from the same setValue()) and allocation free view of the value, usable from any thread
+	// the value it points to is kept alive (hazard pointer) until the snapshot is destroyed, so keep it short lived and on the stack
+	// wait-free for any number of threads and nested snapshots, only the first snapshot of a thread (or of a deeper nesting level than before) may allocate
+	class ValueSnapshot {
+	public:
+		explicit ValueSnapshot(const ConVar* convar);
+		~ValueSnapshot();
+
+		inline float getFloat() const { return m_value->fValue; }
+		inline const UString& getString() const { return m_value->sValue; }
+
+	private:
+		ValueSnapshot(const ValueSnapshot&) = delete;
+		ValueSnapshot& operator = (const ValueSnapshot&) = delete;
+
+		const VALUE* m_value;
+		void* m_hazardSlot; // which keeps m_value alive
+	};
+
 public:
 	static UString typeToString(CONVAR_TYPE type);
 
@@ -53,6 +81,7 @@ public:
 	explicit ConVar(UString name, const char* defaultValue, const char* helpString);
 	explicit ConVar(UString name, const char* defaultValue, const char* helpString, ConVarChangeCallback callback);
 
+	~ConVar();
 
 	void exec();
 	void execArgs(UString args);
@@ -72,10 +101,16 @@ public:
 	inline float getDefaultFloat() const { return m_fDefaultValue.load(); }
 	inline const UString getDefaultString() const { return m_sDefaultValue; }
 
-	inline bool getBool() const { return (m_fValue.load() > 0); }
-	inline float getFloat() const { return m_fValue.load(); }
-	inline int getInt() const { return (int)(m_fValue.load()); }
-	inline const UString getString() const { return m_sValue; }
+	// wait-free, any thread
+	inline bool getBool() const { return (m_fValue.load(std::memory_order_acquire) > 0); }
+	inline float getFloat() const { return m_fValue.load(std::memory_order_acquire); }
+	inline int getInt() const { return (int)(m_fValue.load(std::memory_order_acquire)); }
+
+	// same as getFloat() without any ordering, compiles to a plain load (used by ConVarRef)
+	inline float getFloatRelaxed() const { return m_fValue.load(std::memory_order_relaxed); }
+
+	// any thread, copies (use a ValueSnapshot to avoid the copy)
+	const UString getString() const;
 
 	inline const UString getHelpstring() const { return m_sHelpString; }
 	inline const UString getName() const { return m_sName; }
@@ -94,16 +129,25 @@ private:
 	void init(UString& name, float defaultValue, UString helpString, ConVarChangeCallback callback);
 	void init(UString& name, UString defaultValue, UString helpString, ConVarChangeCallback callback);
 
+	friend class ConVarTransaction;
+
+	void initValue(VALUE* value); // constructor only
+	void setValueInternal(VALUE* newValue, bool keepFloatValue);
+	void runCallbacks(const UString& oldValue, const UString& newValue);
+	VALUE* publishValue(VALUE* newValue);
+	static void retireValue(VALUE* oldValue);
+	static void freeRetiredValues(); // once the last ConVar is gone
+
 	bool						m_bHasValue;
 	CONVAR_TYPE					m_type;
 
 	UString						m_sName;
 	UString						m_sHelpString;
 
-	std::atomic<float>			m_fValue;
+	std::atomic<VALUE*>			m_value;
+	std::atomic<float>			m_fValue; // same as m_value->fValue, for the wait-free getters
 	std::atomic<float>			m_fDefaultValue;
 
-	UString						m_sValue;
 	UString						m_sDefaultValue;
 
 	NativeConVarCallback		m_callbackfunc;
@@ -117,11 +161,131 @@ public:
 	ConVarHandler();
 	~ConVarHandler();
 
-	const std::vector<ConVar*>& getConVarArray() const;
+	// lookups are guarded by the registry mutex, any thread (a ConVarDecl may register its convar on any thread)
+	std::vector<ConVar*> getConVarArray() const; // copy
 	int getNumConVar() const;
 
 	ConVar* getConVarByName(UString name, bool warnIfNotFound = true) const;
-	std::vector<ConVar*> getConVarByLetter(UString letters) const;
+	// console autocompletion, both constructs all pending ConVarDecls
+	std::vector<ConVar*> getConVarByLetter(UString letters, size_t maxResults = 0) const; // names starting with letters, shortest first (then alphabetical), 0 = all
+	std::vector<ConVar*> getConVarByFuzzyMatch(UString pattern, size_t maxResults = 16) const; // names containing the characters of pattern in order (case insensitive), best match first
+
+	// config files: one "name value" or "command args" per line (or separated by ';'), "//" comments, values may be quoted
+	// everything runs inside one ConVarTransaction, so every changed convar runs its callbacks once, with its final value
+	bool execConfigFile(UString filePath); // "cfg/" is prepended and ".cfg" appended if missing
+	int execConfig(std::string_view config, const char* sourceName = "config"); // returns the number of executed lines
+};
+
+
+
+// batches ConVar changes made on this thread
+// values are still published immediately (everyone reads the new values), but the callbacks are deferred until the outermost transaction ends
+// every changed convar then runs its callbacks exactly once, with its value from before the transaction and its final value,
+// convars which end up where they started run nothing (e.g. reapplying a config does not restart the output device)
+// callbacks which change other convars while the transaction commits run their callbacks immediately
+class ConVarTransaction {
+public:
+	ConVarTransaction();
+	~ConVarTransaction(); // commits, if this is the outermost transaction
+
+	static bool isActive(); // on the calling thread
+
+private:
+	friend class ConVar;
+
+	ConVarTransaction(const ConVarTransaction&) = delete;
+	ConVarTransaction& operator = (const ConVarTransaction&) = delete;
+
+	static void onValueChange(ConVar* convar, const UString& oldValue);
+};
+
+
+
+// static registration without any static-init work besides linking the declaration into a list (no UStrings, no allocations, no map insert)
+// the name and help string are views into the literals, the actual ConVar is only constructed on first use:
+// through get() or a ConVarRef, or when the ConVarHandler looks it up by name or enumerates all convars
+// usage: ConVarDecl _my_convar("my_convar", 1.0f, "help"); ConVarRef<float> my_convar(_my_convar);
+class ConVarDecl {
+public:
+	ConVarDecl(std::string_view name, float defaultValue, std::string_view helpString = std::string_view(), ConVar::ConVarChangeCallback callback = NULL);
+	ConVarDecl(std::string_view name, int defaultValue, std::string_view helpString = std::string_view(), ConVar::ConVarChangeCallback callback = NULL);
+	ConVarDecl(std::string_view name, bool defaultValue, std::string_view helpString = std::string_view(), ConVar::ConVarChangeCallback callback = NULL);
+	ConVarDecl(std::string_view name, const char* defaultValue, std::string_view helpString = std::string_view(), ConVar::ConVarChangeCallback callback = NULL);
+	~ConVarDecl();
+
+	// constructs and registers the ConVar on the first call, any thread
+	inline ConVar* get() {
+		ConVar* convar = m_convar.load(std::memory_order_acquire);
+		return (convar != NULL ? convar : construct());
+	}
+
+	inline std::string_view getName() const { return m_name; }
+	inline std::string_view getHelpString() const { return m_helpString; }
+	inline bool isConstructed() const { return (m_convar.load(std::memory_order_acquire) != NULL); }
+
+	static ConVar* find(std::string_view name); // declared or constructed convar, NULL if there is none
+	static ConVar* notFound(std::string_view name); // warns, returns the dummy convar
+	static void constructAll(); // all pending declarations
+	static int getNumPending();
+
+private:
+	ConVarDecl(const ConVarDecl&) = delete;
+	ConVarDecl& operator = (const ConVarDecl&) = delete;
+
+	void link();
+	void unlink();
+	ConVar* construct();
+
+	std::string_view m_name;
+	std::string_view m_helpString;
+	ConVar::CONVAR_TYPE m_type;
+	float m_fDefaultValue;
+	const char* m_sDefaultValue;
+	ConVar::ConVarChangeCallback m_callback;
+
+	std::atomic<ConVar*> m_convar;
+	ConVarDecl* m_next; // pending list
+};
+
+// typed, cached accessor for a declared or existing convar, resolves its ConVar once (no name lookup afterwards)
+// reads are relaxed loads of the float value (no ordering, no conversion through the string), strings go through a ValueSnapshot copy
+// usage: static ConVarRef<int> r_sw_threads("r_sw_threads"); if (r_sw_threads > 1) ...
+template <typename T>
+class ConVarRef {
+public:
+	constexpr explicit ConVarRef(std::string_view name) : m_name(name), m_decl(NULL), m_convar(NULL) { ; }
+	constexpr explicit ConVarRef(ConVarDecl& decl) : m_name(decl.getName()), m_decl(&decl), m_convar(NULL) { ; }
+
+	inline T get() const {
+		const ConVar* convar = getConVar();
+		if constexpr (std::is_same<T, bool>::value)
+			return (convar->getFloatRelaxed() > 0);
+		else if constexpr (std::is_same<T, UString>::value)
+			return convar->getString();
+		else
+			return (T)convar->getFloatRelaxed();
+	}
+	inline operator T() const { return get(); }
+
+	inline ConVar* getConVar() const {
+		ConVar* convar = m_convar.load(std::memory_order_acquire);
+		return (convar != NULL ? convar : resolve());
+	}
+	inline ConVar* operator -> () const { return getConVar(); }
+
+private:
+	ConVar* resolve() const {
+		ConVar* convar = (m_decl != NULL ? m_decl->get() : ConVarDecl::find(m_name));
+		if (convar == NULL)
+			return ConVarDecl::notFound(m_name); // not cached, the convar might just not be constructed yet (static init order)
+
+		m_convar.store(convar, std::memory_order_release);
+		return convar;
+	}
+
+	std::string_view m_name;
+	ConVarDecl* m_decl;
+	mutable std::atomic<ConVar*> m_convar;
 };
 
 extern ConVarHandler* convar;
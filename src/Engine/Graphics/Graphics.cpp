@@ -3,6 +3,9 @@
 #include "Engine.h"
 #include "ConVar/ConVar.h"
 #include "Camera/Camera.h"
+#include "Image/Image.h"
+#include "Timer/Timer.h"
+#include "VertexArrayObject/VertexArrayObject.h"
 
 ConVar r_3dscene_zn("r_3dscene_zn", 5.0f);
 ConVar r_3dscene_zf("r_3dscene_zf", 5000.0f);
@@ -23,44 +26,166 @@ ConVar* Graphics::r_debug_drawimage = &_r_debug_drawimage;
 
 Graphics::Graphics() {
 	m_bTransformUpToDate = false;
-	m_worldTransformStack.push(Matrix4());
+
+	m_iProjectionStackSize = 1;
+	m_projectionStack[0] = Matrix4();
+
+	m_iTransformStackSize = 1;
+	TRANSFORM& identity = m_transformStack[0];
+	identity.a = identity.d = 1.0f;
+	identity.b = identity.c = identity.tx = identity.ty = 0.0f;
+	identity.is2D = true;
+	identity.ownsProjection = true;
+	identity.projectionIndex = 0;
 
 	m_bIs3dScene = false;
 	m_3dSceneStack.push(false);
+
+	m_instanceFallbackVAO = NULL;
+	m_iInstanceFallbackCapacity = 0;
+}
+
+Graphics::~Graphics() {
+	SAFE_DELETE(m_instanceFallbackVAO);
+}
+
+void Graphics::drawImageInstanced(Image* image, const SPRITE_INSTANCE* instances, int numInstances) {
+	if (image == NULL || instances == NULL || numInstances < 1) return;
+
+	// generic fallback for renderers without instancing: expand on the cpu, but still submit everything as a single vao
+	// the vao is kept and only rewritten (dynamic vaos stream into the next segment of their buffer), it is only reallocated if it has to grow
+	if (m_instanceFallbackVAO == NULL)
+		m_instanceFallbackVAO = createVertexArrayObject(Graphics::PRIMITIVE::PRIMITIVE_TRIANGLES, Graphics::USAGE_TYPE::USAGE_DYNAMIC, true);
+
+	VertexArrayObject* vao = m_instanceFallbackVAO;
+	if (numInstances > m_iInstanceFallbackCapacity) {
+		m_iInstanceFallbackCapacity = std::max(numInstances, std::max(m_iInstanceFallbackCapacity * 2, 256));
+
+		vao->release();
+		for (int i = 0; i < m_iInstanceFallbackCapacity * 6; i++) {
+			vao->addVertex(0.0f, 0.0f);
+			vao->addTexcoord(0.0f, 0.0f);
+			vao->addColor(0);
+		}
+		vao->loadAsync();
+		vao->load();
+	}
+
+	const float corners[6][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+	for (int i = 0; i < numInstances; i++) {
+		const SPRITE_INSTANCE& instance = instances[i];
+		const float s = std::sin(instance.rotation);
+		const float c = std::cos(instance.rotation);
+
+		for (int v = 0; v < 6; v++) {
+			const float px = corners[v][0] * instance.width;
+			const float py = corners[v][1] * instance.height;
+			const float tx = corners[v][0] + 0.5f;
+			const float ty = corners[v][1] + 0.5f;
+
+			const int index = i * 6 + v;
+			vao->setVertex(index, instance.x + px * c - py * s, instance.y + px * s + py * c);
+			vao->setTexcoord(index, lerp<float>(instance.u0, instance.u1, tx) / 65535.0f, lerp<float>(instance.v0, instance.v1, ty) / 65535.0f);
+			vao->setColor(index, instance.color);
+		}
+	}
+	vao->setDrawRange(0, numInstances * 6);
+	vao->load(); // uploads the changes
+
+	image->bind();
+	{
+		drawVAO(vao);
+	}
+	image->unbind();
 }
 
 void Graphics::pushTransform() {
-	m_worldTransformStack.push(Matrix4(m_worldTransformStack.top()));
-	m_projectionTransformStack.push(Matrix4(m_projectionTransformStack.top()));
+	if (m_iTransformStackSize >= TRANSFORM_STACK_CAPACITY) {
+		engine->showMessageErrorFatal("World Transform Stack Overflow", "Too many push*()s!");
+		engine->shutdown();
+		return;
+	}
+
+	const TRANSFORM& parent = topTransform();
+	TRANSFORM& child = m_transformStack[m_iTransformStackSize++];
+
+	// only copy what is valid, the projection is shared until someone sets a new one
+	child.a = parent.a;
+	child.b = parent.b;
+	child.c = parent.c;
+	child.d = parent.d;
+	child.tx = parent.tx;
+	child.ty = parent.ty;
+	child.is2D = parent.is2D;
+	if (!parent.is2D)
+		child.world = parent.world;
+	child.ownsProjection = false;
+	child.projectionIndex = parent.projectionIndex;
 }
 
 void Graphics::popTransform() {
-	if (m_worldTransformStack.size() < 2) {
+	if (m_iTransformStackSize < 2) {
 		engine->showMessageErrorFatal("World Transform Stack Underflow", "Too many pop*()s!");
-	}
-	if (m_projectionTransformStack.size() < 2) {
-		engine->showMessageErrorFatal("Projection Transform Stack Underflow", "Too many pop*()s!");
 		engine->shutdown();
 		return;
 	}
 
-	m_worldTransformStack.pop();
-	m_projectionTransformStack.pop();
+	if (topTransform().ownsProjection)
+		m_iProjectionStackSize--;
+
+	m_iTransformStackSize--;
 	m_bTransformUpToDate = false;
 }
 
 void Graphics::translate(float x, float y, float z) {
-	m_worldTransformStack.top().translate(x, y, z);
+	TRANSFORM& t = topTransform();
+	if (t.is2D && z == 0.0f) {
+		t.tx += x;
+		t.ty += y;
+	}
+	else {
+		convertTopTransformTo4x4();
+		t.world.translate(x, y, z);
+	}
 	m_bTransformUpToDate = false;
 }
 
 void Graphics::rotate(float deg, float x, float y, float z) {
-	m_worldTransformStack.top().rotate(deg, x, y, z);
+	TRANSFORM& t = topTransform();
+	if (t.is2D && x == 0.0f && y == 0.0f && z == 1.0f) {
+		const float rad = deg2rad(deg);
+		const float cs = std::cos(rad);
+		const float sn = std::sin(rad);
+
+		const float a = t.a, c = t.c, tx = t.tx;
+		t.a = cs * a - sn * t.b;
+		t.c = cs * c - sn * t.d;
+		t.tx = cs * tx - sn * t.ty;
+		t.b = sn * a + cs * t.b;
+		t.d = sn * c + cs * t.d;
+		t.ty = sn * tx + cs * t.ty;
+	}
+	else {
+		convertTopTransformTo4x4();
+		t.world.rotate(deg, x, y, z);
+	}
 	m_bTransformUpToDate = false;
 }
 
 void Graphics::scale(float x, float y, float z) {
-	m_worldTransformStack.top().scale(x, y, z);
+	TRANSFORM& t = topTransform();
+	if (t.is2D && z == 1.0f) {
+		t.a *= x;
+		t.c *= x;
+		t.tx *= x;
+		t.b *= y;
+		t.d *= y;
+		t.ty *= y;
+	}
+	else {
+		convertTopTransformTo4x4();
+		t.world.scale(x, y, z);
+	}
 	m_bTransformUpToDate = false;
 }
 
@@ -77,28 +202,61 @@ void Graphics::rotate3D(float deg, float x, float y, float z) {
 }
 
 void Graphics::setWorldMatrix(Matrix4& worldMatrix) {
-	m_worldTransformStack.pop();
-	m_worldTransformStack.push(worldMatrix);
+	TRANSFORM& t = topTransform();
+	if (!matrix4ToAffine(worldMatrix, t)) {
+		t.is2D = false;
+		t.world = worldMatrix;
+	}
 	m_bTransformUpToDate = false;
 }
 
 void Graphics::setWorldMatrixMul(Matrix4& worldMatrix) {
-	m_worldTransformStack.top() *= worldMatrix;
+	convertTopTransformTo4x4();
+	topTransform().world *= worldMatrix;
 	m_bTransformUpToDate = false;
 }
 
 void Graphics::setProjectionMatrix(Matrix4& projectionMatrix) {
-	m_projectionTransformStack.pop();
-	m_projectionTransformStack.push(projectionMatrix);
+	TRANSFORM& t = topTransform();
+	if (!t.ownsProjection) {
+		// capacity can't be exceeded, there is at most one projection per transform level
+		t.ownsProjection = true;
+		t.projectionIndex = m_iProjectionStackSize++;
+	}
+	m_projectionStack[t.projectionIndex] = projectionMatrix;
 	m_bTransformUpToDate = false;
 }
 
 Matrix4 Graphics::getWorldMatrix() {
-	return m_worldTransformStack.top();
+	const TRANSFORM& t = topTransform();
+	return (t.is2D ? affineToMatrix4(t) : t.world);
 }
 
 Matrix4 Graphics::getProjectionMatrix() {
-	return m_projectionTransformStack.top();
+	return m_projectionStack[topTransform().projectionIndex];
+}
+
+bool Graphics::matrix4ToAffine(const Matrix4& m, TRANSFORM& t) {
+	const float* v = m.get();
+	if (v[2] != 0.0f || v[3] != 0.0f || v[6] != 0.0f || v[7] != 0.0f || v[8] != 0.0f || v[9] != 0.0f || v[10] != 1.0f || v[11] != 0.0f || v[14] != 0.0f || v[15] != 1.0f)
+		return false;
+
+	t.a = v[0];
+	t.b = v[1];
+	t.c = v[4];
+	t.d = v[5];
+	t.tx = v[12];
+	t.ty = v[13];
+	t.is2D = true;
+	return true;
+}
+
+void Graphics::convertTopTransformTo4x4() {
+	TRANSFORM& t = topTransform();
+	if (!t.is2D) return;
+
+	t.world = affineToMatrix4(t);
+	t.is2D = false;
 }
 
 void Graphics::push3DScene(Rects region) {
@@ -169,11 +327,12 @@ void Graphics::offset3DScene(float x, float y, float z) {
 
 void Graphics::updateTransform(bool force) {
 	if (!m_bTransformUpToDate || force) {
-		Matrix4 worldMatrixT = m_worldTransformStack.top();
-		Matrix4 projectionMatrixT = m_projectionTransformStack.top();
+		// the only place where 2d transforms get expanded to full matrices
+		Matrix4 worldMatrixT = getWorldMatrix();
+		Matrix4 projectionMatrixT = getProjectionMatrix();
 
 		if (m_bIs3dScene) {
-			worldMatrixT = m_3dSceneWorldMatrix * m_worldTransformStack.top();
+			worldMatrixT = m_3dSceneWorldMatrix * worldMatrixT;
 			projectionMatrixT = m_3dSceneProjectionMatrix;
 		}
 		onTransformUpdate(projectionMatrixT, worldMatrixT);
@@ -182,11 +341,11 @@ void Graphics::updateTransform(bool force) {
 }
 
 void Graphics::checkStackLeaks() {
-	if (m_worldTransformStack.size() > 1) {
+	if (m_iTransformStackSize > 1) {
 		engine->showMessageErrorFatal("World stack leak", "Push*() and Pop*() may not be equal");
 		engine->shutdown();
 	}
-	if (m_projectionTransformStack.size() > 1) {
+	if (m_iProjectionStackSize > 1) {
 		engine->showMessageErrorFatal("Projection stack leak", "Push*() and Pop*() may not be equal");
 		engine->shutdown();
 	}
@@ -210,4 +369,283 @@ void _mat_wireframe(UString oldValue, UString newValue) {
 }
 
 ConVar _mat_wireframe_("mat_wireframe", false, _mat_wireframe);
-ConVar _vsync_("vsync", false, _vsync);
\ No newline at end of file
+ConVar _vsync_("vsync", false, _vsync);
+
+void _r_instancing_benchmark(UString args) {
+	// cpu side only: fill the per-instance arrays for a typical dense map section and compare the upload size against expanded quads
+	const int numObjects = (args.length() > 0 ? std::max(args.toInt(), 1) : 5000);
+	const int numFrames = 100;
+
+	// hitcircle, hitcircleoverlay, approachcircle, default-x, followpoint
+	const int numSpriteTypes = 5;
+	std::vector<std::vector<Graphics::SPRITE_INSTANCE>> instances(numSpriteTypes);
+	for (int t = 0; t < numSpriteTypes; t++) {
+		instances[t].reserve(numObjects);
+	}
+
+	size_t bytesPerFrame = 0;
+	size_t numInstancesPerFrame = 0;
+	unsigned int checksum = 0;
+
+	Timer timer;
+	timer.start();
+	for (int frame = 0; frame < numFrames; frame++) {
+		for (int t = 0; t < numSpriteTypes; t++) {
+			instances[t].clear();
+		}
+
+		for (int i = 0; i < numObjects; i++) {
+			const float time = (float)(frame * 16 + i);
+			const Vector2 pos = Vector2(64.0f + (i * 37) % 512, 48.0f + (i * 91) % 384);
+			const float approachScale = 1.0f + 3.0f * (1.0f - (float)((i + frame) % 60) / 60.0f);
+			const Color color = COLOR(255, (i * 50) % 256, (i * 90) % 256, (i * 130) % 256);
+
+			instances[0].push_back(Graphics::makeSpriteInstance(pos, Vector2(128, 128), 0.0f, color));
+			instances[1].push_back(Graphics::makeSpriteInstance(pos, Vector2(128, 128), 0.0f, 0xffffffff));
+			instances[2].push_back(Graphics::makeSpriteInstance(pos, Vector2(128, 128) * approachScale, 0.0f, color));
+			instances[3].push_back(Graphics::makeSpriteInstance(pos, Vector2(40, 52), 0.0f, 0xffffffff, (i % 10) / 10.0f, 0.0f, (i % 10 + 1) / 10.0f, 1.0f)); // digits from an atlas
+			if (i % 2 == 0)
+				instances[4].push_back(Graphics::makeSpriteInstance(pos + Vector2(32, 0), Vector2(32, 32), std::fmod(time, 360.0f), 0xaaffffff));
+		}
+
+		bytesPerFrame = 0;
+		numInstancesPerFrame = 0;
+		for (int t = 0; t < numSpriteTypes; t++) {
+			bytesPerFrame += instances[t].size() * sizeof(Graphics::SPRITE_INSTANCE);
+			numInstancesPerFrame += instances[t].size();
+			checksum += (unsigned int)instances[t].back().x;
+		}
+	}
+	timer.update();
+
+	// 6 vertices * (position + texcoord + color) per sprite without instancing
+	const size_t expandedBytesPerFrame = numInstancesPerFrame * 6 * (sizeof(float) * 3 + sizeof(float) * 2 + sizeof(Color));
+
+	debugLog("r_instancing_benchmark: %i objects, %i sprite types = %i draw calls/frame, %i instances/frame (checksum %u)\n", numObjects, numSpriteTypes, numSpriteTypes, (int)numInstancesPerFrame, checksum);
+	debugLog("r_instancing_benchmark: fill = %.3f ms/frame, uploaded = %.1f KiB/frame (%i bytes/instance), expanded quads would be %.1f KiB/frame\n", timer.getElapsedTime() * 1000.0 / numFrames, bytesPerFrame / 1024.0, (int)sizeof(Graphics::SPRITE_INSTANCE), expandedBytesPerFrame / 1024.0);
+}
+
+ConVar _r_instancing_benchmark_("r_instancing_benchmark", "fills per-instance sprite arrays for <num objects> (default 5000) hit objects and prints the fill time and bytes uploaded per frame", _r_instancing_benchmark);
+
+void _r_transform_benchmark(UString args) {
+	if (engine->getGraphics() == NULL) return;
+	Graphics* g = engine->getGraphics();
+
+	const int numCycles = (args.length() > 0 ? std::max(args.toInt(), 1) : 1000000);
+
+	// what every ui widget does: push, offset to its position, draw (not measured here), pop
+	Timer timer;
+	timer.start();
+	for (int i = 0; i < numCycles; i++) {
+		g->pushTransform();
+		{
+			g->translate((float)(i & 0xff), (float)(i >> 8 & 0xff));
+		}
+		g->popTransform();
+	}
+	timer.update();
+	const double stackTime = timer.getElapsedTime();
+
+	// the same with nested scale/rotate, still on the 2d fast path
+	timer.start();
+	for (int i = 0; i < numCycles; i++) {
+		g->pushTransform();
+		{
+			g->scale(1.5f, 1.5f);
+			g->rotate((float)(i & 0xff));
+			g->translate((float)(i & 0xff), (float)(i >> 8 & 0xff));
+		}
+		g->popTransform();
+	}
+	timer.update();
+	const double stackTimeSRT = timer.getElapsedTime();
+
+	// reference: the previous std::stack<Matrix4> world + projection implementation
+	std::stack<Matrix4> worldStack;
+	std::stack<Matrix4> projectionStack;
+	worldStack.push(Matrix4());
+	projectionStack.push(Matrix4());
+	timer.start();
+	for (int i = 0; i < numCycles; i++) {
+		worldStack.push(Matrix4(worldStack.top()));
+		projectionStack.push(Matrix4(projectionStack.top()));
+		{
+			worldStack.top().translate((float)(i & 0xff), (float)(i >> 8 & 0xff), 0);
+		}
+		worldStack.pop();
+		projectionStack.pop();
+	}
+	timer.update();
+	const double referenceTime = timer.getElapsedTime();
+
+	debugLog("r_transform_benchmark: %i push/translate/pop cycles\n", numCycles);
+	debugLog("r_transform_benchmark: transform stack = %.2f ns/cycle (%.2f ns with scale+rotate), std::stack<Matrix4> = %.2f ns/cycle (checksum %g)\n", stackTime * 1e9 / numCycles, stackTimeSRT * 1e9 / numCycles, referenceTime * 1e9 / numCycles, worldStack.top()[12]);
+}
+
+ConVar _r_transform_benchmark_("r_transform_benchmark", "runs <num cycles> (default 1000000) push/translate/pop transform cycles and compares them against a std::stack<Matrix4> implementation", _r_transform_benchmark);
+
+
+void _math_simd_test() {
+	// compares every MatricesSIMD kernel against its scalar reference with random inputs
+	unsigned int seed = 1;
+	auto random = [&seed]() -> float {
+		seed = seed * 1664525u + 1013904223u;
+		return ((seed >> 8) / 16777216.0f) * 4.0f - 2.0f;
+	};
+
+	float maxError = 0.0f;
+	int numFailures = 0;
+	for (int n = 0; n < 10000; n++) {
+		float a[16], b[16], r1[16], r2[16];
+		for (int i = 0; i < 16; i++) {
+			a[i] = random();
+			b[i] = random();
+		}
+
+		MatricesSIMD::multiply(a, b, r1);
+		MatricesSIMD::multiplyScalar(a, b, r2);
+		for (int i = 0; i < 16; i++) {
+			maxError = std::max(maxError, std::abs(r1[i] - r2[i]));
+		}
+
+		MatricesSIMD::transpose(a, r1);
+		MatricesSIMD::transposeScalar(a, r2);
+		for (int i = 0; i < 16; i++) {
+			if (r1[i] != r2[i])
+				numFailures++;
+		}
+
+		// the inverse must actually invert, the two methods differ too much numerically for near singular matrices to compare them directly
+		if (MatricesSIMD::invert(a, r1) != MatricesSIMD::invertScalar(a, r2))
+			numFailures++;
+		else if (MatricesSIMD::invertScalar(a, r2)) {
+			MatricesSIMD::multiplyScalar(a, r1, r2);
+			for (int i = 0; i < 16; i++) {
+				if (std::abs(r2[i] - (i % 5 == 0 ? 1.0f : 0.0f)) > 0.01f && std::abs(r1[i]) < 1000.0f) {
+					numFailures++;
+					break;
+				}
+			}
+		}
+	}
+
+	float m[16];
+	for (int i = 0; i < 16; i++) {
+		m[i] = random();
+	}
+	const int counts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 17, 1001 };
+	for (int count : counts) {
+		std::vector<Vector2> in2(count), out2(count), ref2(count);
+		std::vector<Vector3> in3(count), out3(count), ref3(count);
+		std::vector<float> x(count), y(count), z(count), ox(count), oy(count), oz(count), rx(count), ry(count), rz(count);
+		for (int i = 0; i < count; i++) {
+			in2[i] = Vector2(random(), random());
+			in3[i] = Vector3(random(), random(), random());
+			x[i] = random();
+			y[i] = random();
+			z[i] = random();
+		}
+
+		MatricesSIMD::transformPoints(m, in2.data(), out2.data(), count);
+		MatricesSIMD::transformPointsScalar(m, in2.data(), ref2.data(), count);
+		MatricesSIMD::transformPoints(m, in3.data(), out3.data(), count);
+		MatricesSIMD::transformPointsScalar(m, in3.data(), ref3.data(), count);
+		for (int i = 0; i < count; i++) {
+			maxError = std::max(maxError, std::abs(out2[i].x - ref2[i].x) + std::abs(out2[i].y - ref2[i].y));
+			maxError = std::max(maxError, std::abs(out3[i].x - ref3[i].x) + std::abs(out3[i].y - ref3[i].y) + std::abs(out3[i].z - ref3[i].z));
+		}
+
+		MatricesSIMD::transformPoints(m, x.data(), y.data(), z.data(), ox.data(), oy.data(), oz.data(), count);
+		MatricesSIMD::transformPointsScalar(m, x.data(), y.data(), z.data(), rx.data(), ry.data(), rz.data(), count);
+		for (int i = 0; i < count; i++) {
+			maxError = std::max(maxError, std::abs(ox[i] - rx[i]) + std::abs(oy[i] - ry[i]) + std::abs(oz[i] - rz[i]));
+		}
+
+		MatricesSIMD::transformPoints(m, x.data(), y.data(), ox.data(), oy.data(), count);
+		MatricesSIMD::transformPointsScalar(m, x.data(), y.data(), rx.data(), ry.data(), count);
+		for (int i = 0; i < count; i++) {
+			maxError = std::max(maxError, std::abs(ox[i] - rx[i]) + std::abs(oy[i] - ry[i]));
+		}
+	}
+
+	const bool passed = (numFailures == 0 && maxError < 0.0001f);
+	debugLog("math_simd_test: %s (%s), max error = %g, %i failure(s)\n", (passed ? "PASSED" : "FAILED"), MatricesSIMD::getInstructionSet(), maxError, numFailures);
+}
+
+void _math_simd_benchmark(UString args) {
+	const int numPoints = (args.length() > 0 ? std::max(args.toInt(), 1) : 50000);
+	const int numIterations = 100;
+	const int numMatrixOps = 1000000;
+
+	Matrix4 matrix;
+	matrix.rotate(30.0f, 0.0f, 0.0f, 1.0f).scale(1.5f, 1.5f, 1.0f).translate(100.0f, 50.0f, 0.0f);
+	const float* m = matrix.get();
+
+	std::vector<Vector2> in2(numPoints), out2(numPoints);
+	std::vector<Vector3> in3(numPoints), out3(numPoints);
+	std::vector<float> x(numPoints), y(numPoints), ox(numPoints), oy(numPoints);
+	for (int i = 0; i < numPoints; i++) {
+		in2[i] = Vector2((float)(i % 640), (float)(i % 480));
+		in3[i] = Vector3((float)(i % 640), (float)(i % 480), (float)(i % 7));
+		x[i] = in2[i].x;
+		y[i] = in2[i].y;
+	}
+
+	Timer timer;
+	auto measure = [&](const std::function<void()>& func) -> double {
+		timer.start();
+		for (int i = 0; i < numIterations; i++) {
+			func();
+		}
+		timer.update();
+		return timer.getElapsedTime() * 1000.0 / numIterations;
+	};
+
+	const double aos2Scalar = measure([&]() { MatricesSIMD::transformPointsScalar(m, in2.data(), out2.data(), numPoints); });
+	const double aos2 = measure([&]() { MatricesSIMD::transformPoints(m, in2.data(), out2.data(), numPoints); });
+	const double aos3Scalar = measure([&]() { MatricesSIMD::transformPointsScalar(m, in3.data(), out3.data(), numPoints); });
+	const double aos3 = measure([&]() { MatricesSIMD::transformPoints(m, in3.data(), out3.data(), numPoints); });
+	const double soa2Scalar = measure([&]() { MatricesSIMD::transformPointsScalar(m, x.data(), y.data(), ox.data(), oy.data(), numPoints); });
+	const double soa2 = measure([&]() { MatricesSIMD::transformPoints(m, x.data(), y.data(), ox.data(), oy.data(), numPoints); });
+
+	float a[16], b[16];
+	std::memcpy(a, m, sizeof(a));
+	std::memcpy(b, m, sizeof(b));
+
+	timer.start();
+	for (int i = 0; i < numMatrixOps; i++) {
+		MatricesSIMD::multiplyScalar(a, b, a);
+		a[12] = (float)(i & 0xff); // keep it bounded
+	}
+	timer.update();
+	const double mulScalar = timer.getElapsedTime();
+
+	timer.start();
+	for (int i = 0; i < numMatrixOps; i++) {
+		MatricesSIMD::multiply(a, b, a);
+		a[12] = (float)(i & 0xff);
+	}
+	timer.update();
+	const double mul = timer.getElapsedTime();
+
+	timer.start();
+	for (int i = 0; i < numMatrixOps; i++) {
+		MatricesSIMD::invertScalar(b, a);
+	}
+	timer.update();
+	const double invScalar = timer.getElapsedTime();
+
+	timer.start();
+	for (int i = 0; i < numMatrixOps; i++) {
+		MatricesSIMD::invert(b, a);
+	}
+	timer.update();
+	const double inv = timer.getElapsedTime();
+
+	debugLog("math_simd_benchmark: %s, %i points (checksum %g)\n", MatricesSIMD::getInstructionSet(), numPoints, out2[numPoints - 1].x + out3[numPoints - 1].z + ox[numPoints - 1] + a[0]);
+	debugLog("math_simd_benchmark: Vector2 AoS %.3f ms (scalar %.3f ms), Vector3 AoS %.3f ms (scalar %.3f ms), Vector2 SoA %.3f ms (scalar %.3f ms)\n", aos2, aos2Scalar, aos3, aos3Scalar, soa2, soa2Scalar);
+	debugLog("math_simd_benchmark: Matrix4 multiply %.2f ns (scalar %.2f ns), invert %.2f ns (scalar %.2f ns)\n", mul * 1e9 / numMatrixOps, mulScalar * 1e9 / numMatrixOps, inv * 1e9 / numMatrixOps, invScalar * 1e9 / numMatrixOps);
+}
+
+ConVar _math_simd_test_("math_simd_test", "checks all simd Matrix4 and batch transform kernels against their scalar reference implementations", _math_simd_test);
+ConVar _math_simd_benchmark_("math_simd_benchmark", "transforms <num points> (default 50000) Vector2/Vector3 points with the simd and scalar paths, and times Matrix4 multiply/invert", _math_simd_benchmark);
@@ -67,9 +67,34 @@ public:
 		BLEND_MODE_PREMUL_COLOR,	// glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA)
 	};
 
+	// per-instance attributes for drawImageInstanced(), tightly packed (32 bytes)
+	struct SPRITE_INSTANCE {
+		float x, y;				// center, in the current world transform
+		float width, height;
+		float rotation;			// radians
+		unsigned short u0, v0;	// uv rect, normalized to 0-65535
+		unsigned short u1, v1;
+		Color color;
+	};
+
+	static inline SPRITE_INSTANCE makeSpriteInstance(Vector2 pos, Vector2 size, float rotationDeg, Color color, float u0 = 0.0f, float v0 = 0.0f, float u1 = 1.0f, float v1 = 1.0f) {
+		SPRITE_INSTANCE instance;
+		instance.x = pos.x;
+		instance.y = pos.y;
+		instance.width = size.x;
+		instance.height = size.y;
+		instance.rotation = rotationDeg * 0.01745329251994329576923690768489f;
+		instance.u0 = (unsigned short)(u0 * 65535.0f + 0.5f);
+		instance.v0 = (unsigned short)(v0 * 65535.0f + 0.5f);
+		instance.u1 = (unsigned short)(u1 * 65535.0f + 0.5f);
+		instance.v1 = (unsigned short)(v1 * 65535.0f + 0.5f);
+		instance.color = color;
+		return instance;
+	}
+
 public:
 	Graphics();
-	virtual ~Graphics() {}
+	virtual ~Graphics();
 
 	virtual void beginScene() = 0;
 	virtual void endScene() = 0;
@@ -94,6 +119,7 @@ public:
 	virtual void drawQuad(Vector2 topLeft, Vector2 topRight, Vector2 bottomRight, Vector2 bottomLeft, Color topLeftColor, Color topRightColor, Color bottomRightColor, Color bottomLeftColor) = 0;
 
 	virtual void drawImage(Image* image) = 0;
+	virtual void drawImageInstanced(Image* image, const SPRITE_INSTANCE* instances, int numInstances); // one draw call for all instances (if supported)
 	virtual void drawString(TacoFont* font, UString text) = 0;
 
 	virtual void drawVAO(VertexArrayObject* vao) = 0;
@@ -158,6 +184,7 @@ public:
 
 	Matrix4 getWorldMatrix();
 	Matrix4 getProjectionMatrix();
+	inline int getTransformDepth() const { return m_iTransformStackSize - 1; }
 
 	void push3DScene(Rects region);
 	void pop3DScene();
@@ -165,6 +192,25 @@ public:
 	void rotate3DScene(float rotx, float roty, float rotz);
 	void offset3DScene(float x, float y, float z = 0);
 
+protected:
+	// 2d affine world transform (x' = a*x + c*y + tx, y' = b*x + d*y + ty), only expanded to a full matrix when needed
+	struct TRANSFORM {
+		float a, b, c, d, tx, ty;
+		bool is2D;			// false: the full matrix in world is authoritative (3d rotations, z translations, setWorldMatrix())
+		bool ownsProjection;	// false: shares the projection of the level below
+		int projectionIndex;
+		Matrix4 world;		// only valid if !is2D
+	};
+
+	static const int TRANSFORM_STACK_CAPACITY = 64;
+
+	static inline Matrix4 affineToMatrix4(const TRANSFORM& t) { return Matrix4(t.a, t.b, 0, 0, t.c, t.d, 0, 0, 0, 0, 1, 0, t.tx, t.ty, 0, 1); }
+	static bool matrix4ToAffine(const Matrix4& m, TRANSFORM& t);
+
+	inline TRANSFORM& topTransform() { return m_transformStack[m_iTransformStackSize - 1]; }
+	inline const TRANSFORM& topTransform() const { return m_transformStack[m_iTransformStackSize - 1]; }
+	void convertTopTransformTo4x4();
+
 protected:
 	static ConVar* r_globaloffset_x;
 	static ConVar* r_globaloffset_y;
@@ -184,8 +230,10 @@ protected:
 	friend class Engine;
 
 	bool				m_bTransformUpToDate;
-	std::stack<Matrix4> m_worldTransformStack;
-	std::stack<Matrix4> m_projectionTransformStack;
+	TRANSFORM			m_transformStack[TRANSFORM_STACK_CAPACITY];
+	int					m_iTransformStackSize;
+	Matrix4				m_projectionStack[TRANSFORM_STACK_CAPACITY];
+	int					m_iProjectionStackSize;
 
 	bool				m_bIs3dScene;
 	std::stack<bool>	m_3dSceneStack;
@@ -194,6 +242,10 @@ protected:
 	Matrix4				m_3dSceneWorldMatrix;
 	Matrix4				m_3dSceneProjectionMatrix;
 
+	// drawImageInstanced() fallback, reused (grows only)
+	VertexArrayObject*	m_instanceFallbackVAO;
+	int					m_iInstanceFallbackCapacity; // in instances
+
 };
 
 #endif // !GRAPHICS_H
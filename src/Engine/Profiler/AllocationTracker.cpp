@@ -0,0 +1,241 @@
+#include "AllocationTracker.h"
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "Profiler.h"
+
+#include <new>
+
+std::atomic<bool> AllocationTracker::s_bEnabled(false);
+
+static std::atomic<unsigned long long> g_iNumUntrackedAllocations(0);
+
+bool AllocationTracker::isSupported() {
+#if VPROF_ALLOCATION_HOOK
+	return true;
+#else
+	return false;
+#endif
+}
+
+unsigned long long AllocationTracker::getNumUntrackedAllocations() {
+	return g_iNumUntrackedAllocations.load(std::memory_order_relaxed);
+}
+
+
+
+//**********************//
+//	operator new/delete  //
+//**********************//
+
+#if VPROF_ALLOCATION_HOOK
+
+// everything in here may run before main() and after the statics are gone, only constant initialized state is used
+
+static inline void _recordAllocation(size_t size) {
+	if (AllocationTracker::isEnabled() && !ProfilerProfile::recordAllocation(size))
+		g_iNumUntrackedAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+static inline void* _allocate(size_t size, size_t alignment) {
+	if (size < 1)
+		size = 1;
+
+	if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		return malloc(size);
+
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	void* ptr = NULL;
+	return (posix_memalign(&ptr, alignment, size) == 0 ? ptr : NULL);
+#endif
+}
+
+static inline void _free(void* ptr, [[maybe_unused]] size_t alignment) {
+#ifdef _WIN32
+	if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+		_aligned_free(ptr);
+		return;
+	}
+#endif
+	free(ptr);
+}
+
+static void* _new(size_t size, size_t alignment) {
+	// same as the default operator new: retry as long as there is a new handler
+	for (;;) {
+		void* ptr = _allocate(size, alignment);
+		if (ptr != NULL) {
+			_recordAllocation(size); // only once it succeeded, a failed/throwing new doesn't count
+			return ptr;
+		}
+
+		std::new_handler handler = std::get_new_handler();
+		if (handler == NULL)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+static void* _newNoThrow(size_t size, size_t alignment) noexcept {
+	try {
+		return _new(size, alignment);
+	}
+	catch (...) {
+		return NULL;
+	}
+}
+
+void* operator new(size_t size) { return _new(size, 0); }
+void* operator new[](size_t size) { return _new(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return _newNoThrow(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return _newNoThrow(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return _new(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return _new(size, (size_t)alignment); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return _newNoThrow(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return _newNoThrow(size, (size_t)alignment); }
+
+void operator delete(void* ptr) noexcept { _free(ptr, 0); }
+void operator delete[](void* ptr) noexcept { _free(ptr, 0); }
+void operator delete(void* ptr, size_t size) noexcept { _free(ptr, 0); }
+void operator delete[](void* ptr, size_t size) noexcept { _free(ptr, 0); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { _free(ptr, 0); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { _free(ptr, 0); }
+void operator delete(void* ptr, std::align_val_t alignment) noexcept { _free(ptr, (size_t)alignment); }
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept { _free(ptr, (size_t)alignment); }
+void operator delete(void* ptr, size_t size, std::align_val_t alignment) noexcept { _free(ptr, (size_t)alignment); }
+void operator delete[](void* ptr, size_t size, std::align_val_t alignment) noexcept { _free(ptr, (size_t)alignment); }
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept { _free(ptr, (size_t)alignment); }
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept { _free(ptr, (size_t)alignment); }
+
+#endif
+
+
+
+//***********************//
+//	AllocationTracker   //
+//***********************//
+
+ConVar _vprof_alloc_budget("vprof_alloc_budget", -1, "allocations per main thread frame, frames which exceed it are logged (with the scope which allocated the most) while vprof_alloc is on, -1 is off");
+
+static struct ALLOCATION_BUDGET {
+	int numFramesOverBudget; // since the last warning
+	long long lastWarningTicks;
+	int numWarningAllocations; // logging allocates too, that doesn't count against the next frame
+} g_allocationBudget;
+
+static void _findMostAllocations(const ProfilerNode* node, unsigned int frame, const ProfilerNode*& maxNode) {
+	for (const ProfilerNode* child = node->getChild(); child != NULL; child = child->getSibling()) {
+		if (maxNode == NULL || child->getAllocationsFrame(frame) > maxNode->getAllocationsFrame(frame))
+			maxNode = child;
+		_findMostAllocations(child, frame, maxNode);
+	}
+}
+
+void AllocationTracker::setEnabled(bool enabled) {
+	if (enabled && !isSupported()) {
+		debugLog("Profiler: built without the allocation hook (VPROF_ALLOCATION_HOOK)\n");
+		return;
+	}
+	if (enabled == isEnabled()) return;
+
+	// allocations are only attributed to scopes while profiling
+	if (enabled)
+		ProfilerProfile::start();
+	else
+		ProfilerProfile::stop();
+
+	g_allocationBudget.numFramesOverBudget = 0;
+	g_allocationBudget.lastWarningTicks = 0;
+	g_allocationBudget.numWarningAllocations = 0;
+	s_bEnabled = enabled;
+}
+
+void AllocationTracker::update() {
+	const int budget = _vprof_alloc_budget.getInt();
+	if (budget < 0) return;
+
+	// the frame which VPROF_MAIN() just published
+	const ProfilerProfile* profile = ProfilerProfile::get();
+	const int numAllocations = profile->getAllocationsLastFrame() - g_allocationBudget.numWarningAllocations;
+	g_allocationBudget.numWarningAllocations = 0;
+	if (numAllocations <= budget) return;
+
+	g_allocationBudget.numFramesOverBudget++;
+
+	// at most once per second
+	const long long now = ProfilerNode::getTicks();
+	if (g_allocationBudget.lastWarningTicks != 0 && ProfilerProfile::ticksToSeconds(now - g_allocationBudget.lastWarningTicks) < 1.0) return;
+
+	const unsigned int frame = profile->getFrame();
+	const ProfilerNode* maxNode = profile->getRoot();
+	_findMostAllocations(profile->getRoot(), frame, maxNode);
+
+	const unsigned long long numAllocationsBeforeWarning = profile->getNumAllocations();
+	debugLog("Profiler: %i allocations (%lli bytes) in a main thread frame, budget is %i, most in %s (%i), %i frames over budget since the last warning\n", numAllocations, profile->getAllocatedBytesLastFrame(), budget, maxNode->getName(), maxNode->getAllocationsFrame(frame), g_allocationBudget.numFramesOverBudget);
+	g_allocationBudget.numFramesOverBudget = 0;
+	g_allocationBudget.lastWarningTicks = now;
+	g_allocationBudget.numWarningAllocations = (int)(profile->getNumAllocations() - numAllocationsBeforeWarning);
+}
+
+
+
+//**************//
+//	Commands    //
+//**************//
+
+void _vprof_alloc_callback(UString oldValue, UString newValue) {
+	AllocationTracker::setEnabled(newValue.toFloat() > 0.0f);
+}
+
+ConVar _vprof_alloc("vprof_alloc", false, "counts the heap allocations (operator new) of every thread, and attributes them to the current VPROF scope (see vprof_alloc_dump and vprof_alloc_budget)", _vprof_alloc_callback);
+
+void _vprof_alloc_dump(void) {
+	if (!AllocationTracker::isEnabled()) {
+		debugLog("Profiler: allocation tracking is off, see vprof_alloc\n");
+		return;
+	}
+
+	std::vector<ProfilerProfile::NODE_SNAPSHOT> nodes;
+	std::vector<int> parents;
+	std::vector<int> inclusive;
+	for (const ProfilerProfile* profile = ProfilerProfile::getFirst(); profile != NULL; profile = profile->getNext()) {
+		if (profile->getNumAllocations() < 1) continue;
+
+		const char* threadName = (profile->getThreadName() != NULL ? profile->getThreadName() : "unnamed thread");
+		debugLog("Profiler: allocations of %s%s: %i in the last frame (%.1f KB), %llu since tracking (%.1f MB)\n", threadName, profile->isThreadExited() ? " (exited)" : "", profile->getAllocationsLastFrame(), profile->getAllocatedBytesLastFrame() / 1024.0, profile->getNumAllocations(), profile->getAllocatedBytes() / (1024.0 * 1024.0));
+
+		bool read = false;
+		for (int i = 0; i < 8 && !read; i++) {
+			read = profile->readLastFrame(nodes);
+		}
+		if (!read) continue;
+
+		// depth first, sum up the children into their parents for the inclusive counts
+		parents.assign(nodes.size(), -1);
+		inclusive.assign(nodes.size(), 0);
+		std::vector<int> stack;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			while ((int)stack.size() > nodes[i].depth) {
+				stack.pop_back();
+			}
+			parents[i] = (stack.size() > 0 ? stack.back() : -1);
+			stack.push_back((int)i);
+		}
+		for (int i = (int)nodes.size() - 1; i >= 0; i--) {
+			inclusive[i] += nodes[i].allocations;
+			if (parents[i] >= 0)
+				inclusive[parents[i]] += inclusive[i];
+		}
+
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (inclusive[i] < 1) continue;
+
+			debugLog("%*s%s: %i (%.1f KB), %i inclusive\n", (nodes[i].depth + 1) * 2, "", nodes[i].name, nodes[i].allocations, nodes[i].allocatedBytes / 1024.0, inclusive[i]);
+		}
+	}
+
+	debugLog("Profiler: %llu allocations of threads without a profile\n", AllocationTracker::getNumUntrackedAllocations());
+}
+
+ConVar _vprof_alloc_dump_("vprof_alloc_dump", "logs the allocations of every profiled scope in the last frame of its thread (self and inclusive), while vprof_alloc is on", _vprof_alloc_dump);
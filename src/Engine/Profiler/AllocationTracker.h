@@ -0,0 +1,32 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include "cbase.h"
+
+#define VPROF_ALLOCATION_HOOK 1 // replaces the global operator new/delete (AllocationTracker.cpp), 0 builds without allocation tracking
+
+// opt-in heap allocation tracking (vprof_alloc), for finding and keeping allocations out of hot paths
+// while enabled, every operator new is counted for the allocating thread and attributed to its current VPROF scope (per frame, like the times, see vprof_alloc_dump)
+// the allocations of a main thread frame can be held to a budget (vprof_alloc_budget, 0 for the gameplay loop)
+// benchmarks compare ProfilerProfile::getNumAllocations() before and after the measured code
+// malloc()/free() are not hooked, allocations of threads without a profile (no VPROF scope yet) are only counted in total
+class AllocationTracker {
+public:
+	static inline bool isEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+	static bool isSupported();
+	static void setEnabled(bool enabled);
+
+	static inline void onMainFrame() {
+		if (isEnabled())
+			update();
+	}
+
+	static unsigned long long getNumUntrackedAllocations(); // of threads without a profile
+
+private:
+	static void update();
+
+	static std::atomic<bool> s_bEnabled;
+};
+
+#endif // !ALLOCATIONTRACKER_H
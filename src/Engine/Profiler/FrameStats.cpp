@@ -0,0 +1,244 @@
+#include "FrameStats.h"
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "Profiler.h"
+
+//******************//
+//	HDRHistogram    //
+//******************//
+
+unsigned long long HDRHistogram::getBucketLowestValue(int bucket) {
+	if (bucket < 64)
+		return (unsigned long long)bucket;
+
+	const int shift = (bucket - 64) / 32 + 1;
+	return (unsigned long long)((bucket - 64) % 32 + 32) << shift;
+}
+
+unsigned long long HDRHistogram::getBucketHighestValue(int bucket) {
+	if (bucket < 64)
+		return (unsigned long long)bucket;
+
+	const int shift = (bucket - 64) / 32 + 1;
+	return getBucketLowestValue(bucket) + (1ULL << shift) - 1;
+}
+
+void HDRHistogram::reset() {
+	memset(m_counts, 0, sizeof(m_counts));
+	m_iCount = 0;
+	m_iSum = 0;
+	m_iMin = (unsigned long long)-1;
+	m_iMax = 0;
+}
+
+void HDRHistogram::add(const HDRHistogram& other) {
+	if (other.m_iCount < 1) return;
+
+	for (int i = 0; i < NUM_BUCKETS; i++) {
+		m_counts[i] += other.m_counts[i];
+	}
+	m_iCount += other.m_iCount;
+	m_iSum += other.m_iSum;
+	m_iMin = std::min(m_iMin, other.m_iMin);
+	m_iMax = std::max(m_iMax, other.m_iMax);
+}
+
+unsigned long long HDRHistogram::getPercentile(double percentile) const {
+	if (m_iCount < 1) return 0;
+
+	// rank of the value, 1 based
+	const double rank = std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * (double)m_iCount);
+	const unsigned long long target = std::max((unsigned long long)rank, 1ULL);
+
+	unsigned long long count = 0;
+	for (int i = 0; i < NUM_BUCKETS; i++) {
+		count += m_counts[i];
+		if (count >= target)
+			return std::min(getBucketHighestValue(i), m_iMax);
+	}
+	return m_iMax;
+}
+
+
+
+//****************//
+//	FrameStats    //
+//****************//
+
+std::atomic<bool> FrameStats::s_bEnabled(true);
+std::atomic<long long> FrameStats::s_iPendingInputTicks(0);
+
+static struct FRAME_STATS {
+	long long startTicks;
+	long long lastFrameTicks; // 0 until the first frame
+	long long currentSlice; // seconds since startTicks
+
+	// ring, the current slice is still being recorded
+	HDRHistogram slices[(int)FrameStats::STAT::COUNT][FRAMESTATS_NUM_SLICES + 1];
+} g_frameStats;
+
+void FrameStats::onInput() {
+	// only the oldest input which no frame has seen yet counts
+	if (s_iPendingInputTicks.load(std::memory_order_relaxed) != 0) return;
+
+	long long expected = 0;
+	s_iPendingInputTicks.compare_exchange_strong(expected, ProfilerNode::getTicks(), std::memory_order_relaxed);
+}
+
+void FrameStats::setEnabled(bool enabled) {
+	// the time in between is not a frame
+	g_frameStats.lastFrameTicks = 0;
+	s_bEnabled = enabled;
+}
+
+void FrameStats::reset() {
+	g_frameStats.lastFrameTicks = 0;
+	for (int s = 0; s < (int)STAT::COUNT; s++) {
+		for (int i = 0; i < FRAMESTATS_NUM_SLICES + 1; i++) {
+			g_frameStats.slices[s][i].reset();
+		}
+	}
+}
+
+void FrameStats::update() {
+	FRAME_STATS& stats = g_frameStats;
+
+	const long long now = ProfilerNode::getTicks();
+	const long long pendingInputTicks = s_iPendingInputTicks.exchange(0, std::memory_order_relaxed);
+	if (stats.lastFrameTicks == 0) {
+		if (stats.startTicks == 0) {
+			stats.startTicks = now;
+			stats.currentSlice = 0;
+		}
+		stats.lastFrameTicks = now;
+		return;
+	}
+
+	// move on to the slice of now, clearing every slice which is reused
+	static const long long ticksPerSecond = (long long)(1.0 / ProfilerProfile::ticksToSeconds(1));
+	const long long slice = (now - stats.startTicks) / ticksPerSecond;
+	for (long long i = std::max(stats.currentSlice + 1, slice - FRAMESTATS_NUM_SLICES); i <= slice; i++) {
+		for (int s = 0; s < (int)STAT::COUNT; s++) {
+			stats.slices[s][i % (FRAMESTATS_NUM_SLICES + 1)].reset();
+		}
+	}
+	stats.currentSlice = slice;
+
+	stats.slices[(int)STAT::FRAME_TIME][slice % (FRAMESTATS_NUM_SLICES + 1)].record((unsigned long long)(ProfilerProfile::ticksToSeconds(now - stats.lastFrameTicks) * 1000000.0));
+	if (pendingInputTicks != 0)
+		stats.slices[(int)STAT::INPUT_LATENCY][slice % (FRAMESTATS_NUM_SLICES + 1)].record((unsigned long long)(ProfilerProfile::ticksToSeconds(std::max(now - pendingInputTicks, 0LL)) * 1000000.0));
+
+	stats.lastFrameTicks = now;
+}
+
+void FrameStats::getHistogram(STAT stat, int seconds, HDRHistogram& histogram) {
+	histogram.reset();
+
+	// the current slice, plus the previous complete ones
+	seconds = std::clamp(seconds, 1, FRAMESTATS_NUM_SLICES);
+	for (int i = 0; i <= seconds && i <= g_frameStats.currentSlice; i++) {
+		histogram.add(g_frameStats.slices[(int)stat][(g_frameStats.currentSlice - i) % (FRAMESTATS_NUM_SLICES + 1)]);
+	}
+}
+
+FrameStats::SUMMARY FrameStats::getSummary(STAT stat, int seconds) {
+	static HDRHistogram histogram; // too big for the stack
+	getHistogram(stat, seconds, histogram);
+
+	SUMMARY summary;
+	summary.count = histogram.getCount();
+	summary.mean = histogram.getMean() / 1000.0;
+	summary.p50 = histogram.getPercentile(50.0) / 1000.0;
+	summary.p90 = histogram.getPercentile(90.0) / 1000.0;
+	summary.p99 = histogram.getPercentile(99.0) / 1000.0;
+	summary.p999 = histogram.getPercentile(99.9) / 1000.0;
+	summary.max = histogram.getMax() / 1000.0;
+	return summary;
+}
+
+
+
+//**************//
+//	Commands    //
+//**************//
+
+void _vprof_frame_stats_record_callback(UString oldValue, UString newValue) {
+	FrameStats::setEnabled(newValue.toFloat() > 0.0f);
+}
+
+ConVar _vprof_frame_stats_record("vprof_frame_stats_record", true, "records the frame time and input latency of every main thread frame (see vprof_frame_stats)", _vprof_frame_stats_record_callback);
+ConVar _vprof_frame_stats_window("vprof_frame_stats_window", 10, "default window of vprof_frame_stats in seconds (1 - 60)");
+ConVar _vprof_frame_stats_file("vprof_frame_stats_file", "vprof_frame_stats", "vprof_frame_stats_csv appends to <vprof_frame_stats_file>.csv and <vprof_frame_stats_file>_histogram.csv");
+
+static const char* s_frameStatNames[(int)FrameStats::STAT::COUNT] = {"frame_time", "input_latency"};
+
+void _vprof_frame_stats(UString args) {
+	const int seconds = std::clamp(args.length() > 0 ? args.toInt() : _vprof_frame_stats_window.getInt(), 1, FRAMESTATS_NUM_SLICES);
+
+	for (int s = 0; s < (int)FrameStats::STAT::COUNT; s++) {
+		const FrameStats::SUMMARY summary = FrameStats::getSummary((FrameStats::STAT)s, seconds);
+		debugLog("FrameStats: %s (last %i s, %llu samples): mean %.2f ms, p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, p99.9 %.2f ms, max %.2f ms\n", s_frameStatNames[s], seconds, summary.count, summary.mean, summary.p50, summary.p90, summary.p99, summary.p999, summary.max);
+	}
+}
+
+static bool _isFileEmpty(const std::string& filePath) {
+	std::ifstream file(filePath);
+	return (!file.good() || file.peek() == std::ifstream::traits_type::eof());
+}
+
+void _vprof_frame_stats_csv(UString args) {
+	// rows are appended, the label tells builds (or runs) apart
+	const std::string label = (args.length() > 0 ? std::string(args.toUtf8()) : std::string(__DATE__ " " __TIME__));
+	const std::string filePath = std::string(_vprof_frame_stats_file.getString().toUtf8()) + ".csv";
+	const std::string histogramFilePath = std::string(_vprof_frame_stats_file.getString().toUtf8()) + "_histogram.csv";
+	const int windows[] = {1, 10, FRAMESTATS_NUM_SLICES};
+
+	const bool writeHeader = _isFileEmpty(filePath);
+	std::ofstream out(filePath, std::ios::out | std::ios::app);
+	if (!out.good()) {
+		debugLog("FrameStats: can't write %s\n", filePath.c_str());
+		return;
+	}
+	if (writeHeader)
+		out << "label,stat,window_s,count,mean_ms,p50_ms,p90_ms,p99_ms,p99.9_ms,max_ms\n";
+
+	char buffer[512];
+	for (int s = 0; s < (int)FrameStats::STAT::COUNT; s++) {
+		for (int w = 0; w < (int)(sizeof(windows) / sizeof(windows[0])); w++) {
+			const FrameStats::SUMMARY summary = FrameStats::getSummary((FrameStats::STAT)s, windows[w]);
+			snprintf(buffer, sizeof(buffer), "\"%s\",%s,%i,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", label.c_str(), s_frameStatNames[s], windows[w], summary.count, summary.mean, summary.p50, summary.p90, summary.p99, summary.p999, summary.max);
+			out << buffer;
+		}
+	}
+
+	// the longest window, non empty buckets only
+	const bool writeHistogramHeader = _isFileEmpty(histogramFilePath);
+	std::ofstream histogramOut(histogramFilePath, std::ios::out | std::ios::app);
+	if (!histogramOut.good()) {
+		debugLog("FrameStats: can't write %s\n", histogramFilePath.c_str());
+		return;
+	}
+	if (writeHistogramHeader)
+		histogramOut << "label,stat,window_s,from_ms,to_ms,count\n";
+
+	static HDRHistogram histogram;
+	for (int s = 0; s < (int)FrameStats::STAT::COUNT; s++) {
+		FrameStats::getHistogram((FrameStats::STAT)s, FRAMESTATS_NUM_SLICES, histogram);
+		for (int b = 0; b < HDRHistogram::NUM_BUCKETS; b++) {
+			if (histogram.getBucketCount(b) < 1) continue;
+
+			snprintf(buffer, sizeof(buffer), "\"%s\",%s,%i,%.3f,%.3f,%u\n", label.c_str(), s_frameStatNames[s], FRAMESTATS_NUM_SLICES, HDRHistogram::getBucketLowestValue(b) / 1000.0, (HDRHistogram::getBucketHighestValue(b) + 1) / 1000.0, histogram.getBucketCount(b));
+			histogramOut << buffer;
+		}
+	}
+
+	debugLog("FrameStats: appended \"%s\" to %s and %s\n", label.c_str(), filePath.c_str(), histogramFilePath.c_str());
+}
+
+void _vprof_frame_stats_reset(void) {
+	FrameStats::reset();
+}
+
+ConVar _vprof_frame_stats_("vprof_frame_stats", "logs p50/p90/p99/p99.9/max of the frame time and input latency over the last n seconds (default vprof_frame_stats_window)", _vprof_frame_stats);
+ConVar _vprof_frame_stats_csv_("vprof_frame_stats_csv", "appends the stats of the last 1/10/60 seconds (and the 60 second histogram) to csv files, the argument labels the rows (default: build date)", _vprof_frame_stats_csv);
+ConVar _vprof_frame_stats_reset_("vprof_frame_stats_reset", "clears all recorded frame stats", _vprof_frame_stats_reset);
@@ -0,0 +1,107 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include "cbase.h"
+
+#include <bit>
+
+#define FRAMESTATS_NUM_SLICES	60 // one second each, the longest window
+
+// log-linear histogram of integer values (microseconds here), like HdrHistogram:
+// exact below 64, above that 32 linear sub buckets per power of two (~3% precision), values are clamped to 2^30 - 1
+// fixed size, recording never allocates
+class HDRHistogram {
+public:
+	static const int NUM_BUCKETS = 832;
+	static const unsigned long long MAX_VALUE = (1ULL << 30) - 1;
+
+	static inline int valueToBucket(unsigned long long value) {
+		if (value > MAX_VALUE)
+			value = MAX_VALUE;
+		if (value < 64)
+			return (int)value;
+
+		const int shift = (int)std::bit_width(value) - 6;
+		return 64 + (shift - 1) * 32 + (int)((value >> shift) - 32);
+	}
+	static unsigned long long getBucketLowestValue(int bucket);
+	static unsigned long long getBucketHighestValue(int bucket);
+
+public:
+	HDRHistogram() { reset(); }
+
+	void reset();
+
+	inline void record(unsigned long long value) {
+		m_counts[valueToBucket(value)]++;
+		m_iCount++;
+		m_iSum += value;
+		if (value < m_iMin)
+			m_iMin = value;
+		if (value > m_iMax)
+			m_iMax = value;
+	}
+
+	void add(const HDRHistogram& other);
+
+	unsigned long long getPercentile(double percentile) const; // percentile in [0, 100], highest value of the bucket (but at most the max)
+
+	inline unsigned int getBucketCount(int bucket) const { return m_counts[bucket]; }
+	inline unsigned long long getCount() const { return m_iCount; }
+	inline unsigned long long getMin() const { return (m_iCount > 0 ? m_iMin : 0); }
+	inline unsigned long long getMax() const { return m_iMax; }
+	inline double getMean() const { return (m_iCount > 0 ? (double)m_iSum / (double)m_iCount : 0.0); }
+
+private:
+	unsigned int m_counts[NUM_BUCKETS];
+	unsigned long long m_iCount;
+	unsigned long long m_iSum;
+	unsigned long long m_iMin;
+	unsigned long long m_iMax;
+};
+
+// rolling frame time and input latency distributions of the main thread, driven by VPROF_MAIN()
+// every frame is recorded into the histogram of the current one second slice, a window sums up the slices of its last n seconds
+// input latency is the time from the first input event which is not handled yet to the start of the next frame
+// see vprof_frame_stats and vprof_frame_stats_csv
+class FrameStats {
+public:
+	enum class STAT {
+		FRAME_TIME,
+		INPUT_LATENCY,
+		COUNT // not a stat
+	};
+
+	struct SUMMARY {
+		unsigned long long count;
+		double mean; // milliseconds
+		double p50;
+		double p90;
+		double p99;
+		double p999;
+		double max;
+	};
+
+	static inline void onMainFrame() {
+		if (s_bEnabled.load(std::memory_order_relaxed))
+			update();
+	}
+
+	// any thread, the input thread calls this for every input event
+	static void onInput();
+
+	static void setEnabled(bool enabled);
+	static void reset();
+
+	// main thread
+	static void getHistogram(STAT stat, int seconds, HDRHistogram& histogram);
+	static SUMMARY getSummary(STAT stat, int seconds);
+
+private:
+	static void update();
+
+	static std::atomic<bool> s_bEnabled;
+	static std::atomic<long long> s_iPendingInputTicks;
+};
+
+#endif // !FRAMESTATS_H
@@ -1 +1,1325 @@
 #include "Profiler.h"
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "Timer/Timer.h"
+
+#include <thread>
+#include <sstream>
+#include <cfloat>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#if defined(VPROF_RDTSC) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+bool ProfilerNode::hasInvariantTsc() {
+#ifdef VPROF_RDTSC
+	// CPUID 0x80000007 (advanced power management), EDX bit 8: invariant TSC
+	unsigned int regs[4] = {0, 0, 0, 0};
+#ifdef _MSC_VER
+	__cpuid((int*)regs, 0x80000000);
+	if (regs[0] < 0x80000007)
+		return false;
+	__cpuid((int*)regs, 0x80000007);
+#else
+	if (!__get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3]))
+		return false;
+#endif
+	return ((regs[3] & (1u << 8)) != 0);
+#else
+	return false;
+#endif
+}
+
+static double _calibrateSecondsPerTick() {
+#ifdef VPROF_RDTSC
+	if (ProfilerNode::isInvariantTsc()) {
+		// the counter runs at a constant rate, but which one is only known by comparing it with a real clock
+		const auto startTime = std::chrono::steady_clock::now();
+		const long long startTicks = ProfilerNode::getTicks();
+		auto endTime = startTime;
+		while (endTime - startTime < std::chrono::milliseconds(10)) {
+			endTime = std::chrono::steady_clock::now();
+		}
+		const long long endTicks = ProfilerNode::getTicks();
+
+		return std::chrono::duration<double>(endTime - startTime).count() / (double)std::max(endTicks - startTicks, 1LL);
+	}
+#endif
+	return (double)std::chrono::steady_clock::period::num / (double)std::chrono::steady_clock::period::den;
+}
+
+constinit thread_local ProfilerProfile* ProfilerProfile::s_currentProfile = NULL;
+std::atomic<ProfilerProfile*> ProfilerProfile::s_firstProfile(NULL);
+std::atomic<int> ProfilerProfile::s_iEnabled(0);
+std::atomic<int> ProfilerProfile::s_iTracing(0);
+std::atomic<unsigned int> ProfilerProfile::s_iCounterConfig(0);
+
+struct ProfilerProfile::THREAD_EXIT {
+	ProfilerProfile* profile;
+
+	THREAD_EXIT() : profile(NULL) { ; }
+	~THREAD_EXIT() {
+		// the profile itself stays alive, other threads may still be reading it
+		if (profile != NULL) {
+			profile->syncCounters(0);
+			profile->m_bThreadExited.store(true, std::memory_order_release);
+		}
+	}
+};
+
+thread_local ProfilerProfile::THREAD_EXIT ProfilerProfile::s_threadExit;
+
+
+
+//*****************//
+//	ProfilerNode  //
+//*****************//
+
+ProfilerNode::ProfilerNode() {
+	constructor(NULL, NULL, NULL);
+}
+
+ProfilerNode::ProfilerNode(const char* name, const char* group, ProfilerNode* parent) {
+	constructor(name, group, parent);
+}
+
+void ProfilerNode::constructor(const char* name, const char* group, ProfilerNode* parent) {
+	m_name = name;
+	m_group = group;
+	m_iGroupID = 0;
+
+	m_parent = parent;
+	m_child.store(NULL, std::memory_order_relaxed);
+	m_sibling.store(NULL, std::memory_order_relaxed);
+
+	m_iNumRecursions = 0;
+	m_iStartTicks = 0;
+	m_iTicksCurrentFrame = 0;
+	m_iCallsCurrentFrame = 0;
+	m_iAllocationsCurrentFrame = 0;
+	m_iAllocatedBytesCurrentFrame = 0;
+
+	for (int i = 0; i < 2; i++) {
+		m_fTimeFrame[i].store(0.0, std::memory_order_relaxed);
+		m_iCallsFrame[i].store(0, std::memory_order_relaxed);
+		m_iAllocationsFrame[i].store(0, std::memory_order_relaxed);
+		m_iAllocatedBytesFrame[i].store(0, std::memory_order_relaxed);
+	}
+
+	m_iCounterConfig.store(0, std::memory_order_relaxed);
+	m_bCounterStarted = false;
+	for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+		m_counterStart[i] = 0;
+		m_counterTotals[i].store(0, std::memory_order_relaxed);
+	}
+	m_iCounterCalls.store(0, std::memory_order_relaxed);
+}
+
+double ProfilerNode::getTimeCurrentFrame() const {
+	return ProfilerProfile::ticksToSeconds(m_iTicksCurrentFrame);
+}
+
+
+
+//********************//
+//	ProfilerProfile  //
+//********************//
+
+ProfilerProfile* ProfilerProfile::createForCurrentThread() {
+	ProfilerProfile* profile = new ProfilerProfile();
+	s_currentProfile = profile;
+	s_threadExit.profile = profile;
+
+	// publish (lock free push, profiles are never removed)
+	ProfilerProfile* first = s_firstProfile.load(std::memory_order_relaxed);
+	do {
+		profile->m_nextProfile = first;
+	} while (!s_firstProfile.compare_exchange_weak(first, profile, std::memory_order_release, std::memory_order_relaxed));
+
+	return profile;
+}
+
+void ProfilerProfile::start() {
+	s_iEnabled++;
+}
+
+void ProfilerProfile::stop() {
+	s_iEnabled--;
+}
+
+void ProfilerProfile::startTracing() {
+	s_iTracing++;
+}
+
+void ProfilerProfile::stopTracing() {
+	s_iTracing--;
+}
+
+double ProfilerProfile::ticksToSeconds(long long ticks) {
+	static const double secondsPerTick = _calibrateSecondsPerTick();
+	return ticks * secondsPerTick;
+}
+
+ProfilerProfile::ProfilerProfile(bool manualStartViaMain) : m_root(VPROF_BUDGETGROUP_ROOT, VPROF_BUDGETGROUP_ROOT, NULL) {
+	m_bManualStartViaMain = manualStartViaMain;
+	m_bEnabled = false;
+	m_bEnableScheduled = false;
+	m_curNode = &m_root;
+
+	m_groups.push_back(VPROF_BUDGETGROUP_ROOT);
+
+	m_iNumNodes = 0;
+	m_traceEvents = NULL;
+	m_iNumTraceEvents = 0;
+	m_iCounterConfig = 0;
+	for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+		m_counterFds[i] = -1;
+	}
+	m_iCounterGroupFd = -1;
+	m_iNumAllocations = 0;
+	m_iAllocatedBytes = 0;
+	for (int i = 0; i < 2; i++) {
+		m_iAllocationsFrame[i] = 0;
+		m_iAllocatedBytesFrame[i] = 0;
+	}
+	m_iFrame = 0;
+	m_threadName = NULL;
+	m_bThreadExited = false;
+	m_nextProfile = NULL;
+}
+
+ProfilerProfile::~ProfilerProfile() {
+	for (size_t i = 0; i < m_nodeBlocks.size(); i++) {
+		delete[] m_nodeBlocks[i];
+	}
+	m_nodeBlocks.clear();
+
+	delete[] m_traceEvents;
+	m_traceEvents = NULL;
+
+	syncCounters(0);
+}
+
+void ProfilerProfile::main() {
+	// threads which have frames start their root at a frame boundary, so that the root always covers whole frames
+	m_bManualStartViaMain = true;
+
+	if (m_curNode == &m_root)
+		syncEnabled();
+
+	// don't keep counters open after they were disabled
+	if (m_iCounterConfig != 0 && getCounterConfig() == 0)
+		syncCounters(0);
+
+	if (m_bEnableScheduled) {
+		m_bEnableScheduled = false;
+		m_root.enterScope(ProfilerNode::getTicks());
+		return;
+	}
+
+	if (!m_bEnabled)
+		return;
+
+	// the root measures the whole frame, restart it
+	if (m_root.m_iNumRecursions > 0) {
+		const long long now = ProfilerNode::getTicks();
+		m_root.m_iTicksCurrentFrame += now - m_root.m_iStartTicks;
+		m_root.m_iCallsCurrentFrame++;
+		m_root.m_iStartTicks = now;
+	}
+
+	publishFrame();
+}
+
+bool ProfilerProfile::syncEnabled() {
+	const bool enabled = isEnabled();
+	if (enabled != m_bEnabled) {
+		m_bEnabled = enabled;
+		if (enabled) {
+			if (m_bManualStartViaMain)
+				m_bEnableScheduled = true;
+			else
+				m_root.enterScope(ProfilerNode::getTicks());
+		}
+		else {
+			if (!m_bEnableScheduled && m_root.m_iNumRecursions > 0)
+				m_root.exitScope(ProfilerNode::getTicks());
+			m_bEnableScheduled = false;
+		}
+	}
+
+	return (m_bEnabled && !m_bEnableScheduled);
+}
+
+void ProfilerProfile::publishFrame() {
+	// write the finished frame into the slot which readers of the current frame are not using, then publish it
+	const unsigned int frame = m_iFrame.load(std::memory_order_relaxed) + 1;
+	const int slot = (frame & 1);
+
+	int numAllocations = 0;
+	long long allocatedBytes = 0;
+	const auto publishNode = [&](ProfilerNode& node) {
+		node.m_fTimeFrame[slot].store(ticksToSeconds(node.m_iTicksCurrentFrame), std::memory_order_relaxed);
+		node.m_iCallsFrame[slot].store(node.m_iCallsCurrentFrame, std::memory_order_relaxed);
+		node.m_iAllocationsFrame[slot].store(node.m_iAllocationsCurrentFrame, std::memory_order_relaxed);
+		node.m_iAllocatedBytesFrame[slot].store(node.m_iAllocatedBytesCurrentFrame, std::memory_order_relaxed);
+		numAllocations += node.m_iAllocationsCurrentFrame;
+		allocatedBytes += node.m_iAllocatedBytesCurrentFrame;
+		node.m_iTicksCurrentFrame = 0;
+		node.m_iCallsCurrentFrame = 0;
+		node.m_iAllocationsCurrentFrame = 0;
+		node.m_iAllocatedBytesCurrentFrame = 0;
+	};
+
+	publishNode(m_root);
+	const int numNodes = m_iNumNodes.load(std::memory_order_relaxed);
+	for (int i = 0; i < numNodes; i++) {
+		publishNode(m_nodeBlocks[i / VPROF_NODE_BLOCK_SIZE][i % VPROF_NODE_BLOCK_SIZE]);
+	}
+	m_iAllocationsFrame[slot].store(numAllocations, std::memory_order_relaxed);
+	m_iAllocatedBytesFrame[slot].store(allocatedBytes, std::memory_order_relaxed);
+
+	m_iFrame.store(frame, std::memory_order_release);
+}
+
+void ProfilerProfile::allocateTraceBuffer() {
+	TRACE_SLOT* traceEvents = new TRACE_SLOT[VPROF_TRACE_BUFFER_SIZE];
+	for (int i = 0; i < VPROF_TRACE_BUFFER_SIZE; i++) {
+		traceEvents[i].ticks.store(0, std::memory_order_relaxed);
+		traceEvents[i].name.store(NULL, std::memory_order_relaxed);
+		traceEvents[i].data.store(0, std::memory_order_relaxed);
+	}
+	m_traceEvents = traceEvents;
+}
+
+ProfilerNode* ProfilerProfile::getSubNode(ProfilerNode* parent, const char* name, const char* group) {
+	for (ProfilerNode* child = parent->m_child.load(std::memory_order_relaxed); child != NULL; child = child->m_sibling.load(std::memory_order_relaxed)) {
+		if (child->m_name == name)
+			return child;
+	}
+
+	// new node, fully constructed before it becomes reachable for readers
+	ProfilerNode* node = allocateNode();
+	node->constructor(name, group, parent);
+	node->m_iGroupID = groupNameToID(group);
+	node->m_sibling.store(parent->m_child.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	parent->m_child.store(node, std::memory_order_release);
+
+	return node;
+}
+
+ProfilerNode* ProfilerProfile::allocateNode() {
+	const int index = m_iNumNodes.load(std::memory_order_relaxed);
+	if (index % VPROF_NODE_BLOCK_SIZE == 0)
+		m_nodeBlocks.push_back(new ProfilerNode[VPROF_NODE_BLOCK_SIZE]);
+
+	m_iNumNodes.store(index + 1, std::memory_order_release);
+	return &m_nodeBlocks[index / VPROF_NODE_BLOCK_SIZE][index % VPROF_NODE_BLOCK_SIZE];
+}
+
+int ProfilerProfile::groupNameToID(const char* group) {
+	for (size_t i = 0; i < m_groups.size(); i++) {
+		if (m_groups[i] == group || strcmp(m_groups[i], group) == 0)
+			return (int)i;
+	}
+
+	m_groups.push_back(group);
+	return (int)m_groups.size() - 1;
+}
+
+double ProfilerProfile::sumTimes(int groupID) {
+	return sumTimes(m_root.getChild(), groupID);
+}
+
+double ProfilerProfile::sumTimes(ProfilerNode* node, int groupID) {
+	const unsigned int frame = getFrame();
+
+	double sum = 0.0;
+	for (ProfilerNode* sibling = node; sibling != NULL; sibling = sibling->getSibling()) {
+		if (sibling->m_iGroupID == groupID)
+			sum += sibling->getTimeFrame(frame);
+		else if (sibling->getChild() != NULL)
+			sum += sumTimes(sibling->getChild(), groupID);
+	}
+	return sum;
+}
+
+bool ProfilerProfile::readLastFrame(std::vector<NODE_SNAPSHOT>& nodes) const {
+	// seqlock style: read the slot of the published frame, then make sure that the owner did not start overwriting it in the meantime
+	// (it only does so after publishing the next frame)
+	const unsigned int frame = m_iFrame.load(std::memory_order_acquire);
+
+	nodes.clear();
+	std::vector<std::pair<const ProfilerNode*, int>> stack;
+	stack.push_back(std::pair<const ProfilerNode*, int>(&m_root, 0));
+	while (stack.size() > 0) {
+		const ProfilerNode* node = stack.back().first;
+		const int depth = stack.back().second;
+		stack.pop_back();
+
+		NODE_SNAPSHOT snapshot;
+		snapshot.name = node->m_name;
+		snapshot.group = node->m_group;
+		snapshot.depth = depth;
+		snapshot.calls = node->getCallsFrame(frame);
+		snapshot.time = node->getTimeFrame(frame);
+		snapshot.allocations = node->getAllocationsFrame(frame);
+		snapshot.allocatedBytes = node->getAllocatedBytesFrame(frame);
+		nodes.push_back(snapshot);
+
+		for (const ProfilerNode* child = node->getChild(); child != NULL; child = child->getSibling()) {
+			stack.push_back(std::pair<const ProfilerNode*, int>(child, depth + 1));
+		}
+	}
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return (m_iFrame.load(std::memory_order_relaxed) == frame);
+}
+
+void ProfilerProfile::readTraceEvents(std::vector<TRACE_EVENT>& events) const {
+	events.clear();
+
+	const unsigned long long numEvents = m_iNumTraceEvents.load(std::memory_order_acquire);
+	if (numEvents < 1)
+		return;
+
+	// m_traceEvents is set before the first count store
+	const TRACE_SLOT* traceEvents = m_traceEvents;
+	const unsigned long long first = (numEvents > VPROF_TRACE_BUFFER_SIZE ? numEvents - VPROF_TRACE_BUFFER_SIZE : 0);
+	events.reserve((size_t)(numEvents - first));
+	for (unsigned long long i = first; i < numEvents; i++) {
+		const TRACE_SLOT& slot = traceEvents[i & (VPROF_TRACE_BUFFER_SIZE - 1)];
+
+		TRACE_EVENT event;
+		event.ticks = slot.ticks.load(std::memory_order_relaxed);
+		event.name = slot.name.load(std::memory_order_relaxed);
+		const unsigned long long data = slot.data.load(std::memory_order_relaxed);
+		event.type = (TRACE_EVENT_TYPE)(data & 3);
+		event.id = (data >> 2);
+		events.push_back(event);
+	}
+
+	// slot i is only overwritten once the count has reached i + VPROF_TRACE_BUFFER_SIZE, drop everything the owner may have touched in the meantime
+	std::atomic_thread_fence(std::memory_order_acquire);
+	const unsigned long long numEventsAfter = m_iNumTraceEvents.load(std::memory_order_relaxed);
+	if (numEventsAfter + 1 > first + VPROF_TRACE_BUFFER_SIZE) {
+		const unsigned long long numOverwritten = std::min<unsigned long long>(numEventsAfter + 1 - (first + VPROF_TRACE_BUFFER_SIZE), events.size());
+		events.erase(events.begin(), events.begin() + (size_t)numOverwritten);
+	}
+}
+
+
+
+//*****************//
+//	Counters      //
+//*****************//
+
+static const char* s_counterNames[(int)PROFILER_COUNTER::COUNT] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branches", "branch_misses", "task_clock", "page_faults"};
+static std::atomic<unsigned int> s_iCounterSerial(0);
+
+#ifdef __linux__
+
+static int _openCounter(PROFILER_COUNTER counter, int groupFd) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	switch (counter) {
+	case PROFILER_COUNTER::CYCLES:
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case PROFILER_COUNTER::INSTRUCTIONS:
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case PROFILER_COUNTER::L1D_MISSES:
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	case PROFILER_COUNTER::LLC_MISSES:
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		break;
+	case PROFILER_COUNTER::BRANCHES:
+		attr.config = PERF_COUNT_HW_BRANCH_INSTRUCTIONS;
+		break;
+	case PROFILER_COUNTER::BRANCH_MISSES:
+		attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	case PROFILER_COUNTER::TASK_CLOCK:
+		attr.type = PERF_TYPE_SOFTWARE;
+		attr.config = PERF_COUNT_SW_TASK_CLOCK;
+		break;
+	case PROFILER_COUNTER::PAGE_FAULTS:
+		attr.type = PERF_TYPE_SOFTWARE;
+		attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+		break;
+	default:
+		return -1;
+	}
+	attr.read_format = PERF_FORMAT_GROUP;
+	attr.exclude_kernel = 1; // also what perf_event_paranoid 2 allows
+	attr.exclude_hv = 1;
+
+	// this thread, any cpu
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC);
+}
+
+static void _closeCounter(int fd) {
+	close(fd);
+}
+
+static bool _readCounterGroup(int groupFd, unsigned long long* values, int numValues) {
+	unsigned long long buffer[1 + (int)PROFILER_COUNTER::COUNT];
+	const ssize_t size = read(groupFd, buffer, sizeof(unsigned long long) * (1 + numValues));
+	if (size != (ssize_t)(sizeof(unsigned long long) * (1 + numValues)) || buffer[0] != (unsigned long long)numValues)
+		return false;
+
+	memcpy(values, buffer + 1, sizeof(unsigned long long) * numValues);
+	return true;
+}
+
+#else
+
+static int _openCounter(PROFILER_COUNTER counter, int groupFd) {
+	return -1;
+}
+
+static void _closeCounter(int fd) {
+	;
+}
+
+static bool _readCounterGroup(int groupFd, unsigned long long* values, int numValues) {
+	return false;
+}
+
+#endif
+
+bool ProfilerProfile::isCountersSupported() {
+#ifdef __linux__
+	return true;
+#else
+	return false;
+#endif
+}
+
+unsigned int ProfilerProfile::enableCounters(unsigned int counterMask) {
+	// probe every counter on the calling thread, threads then open only what works
+	unsigned int supportedMask = 0;
+	for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+		if (!(counterMask & (1u << i))) continue;
+
+		const int fd = _openCounter((PROFILER_COUNTER)i, -1);
+		if (fd >= 0) {
+			supportedMask |= (1u << i);
+			_closeCounter(fd);
+		}
+	}
+
+	// the serial makes every enable a new configuration, nodes reset their totals when they see one
+	s_iCounterConfig.store(supportedMask != 0 ? ((++s_iCounterSerial) << 8) | supportedMask : 0, std::memory_order_release);
+	return supportedMask;
+}
+
+void ProfilerProfile::disableCounters() {
+	s_iCounterConfig.store(0, std::memory_order_release);
+}
+
+const char* ProfilerProfile::getCounterName(PROFILER_COUNTER counter) {
+	return s_counterNames[(int)counter];
+}
+
+void ProfilerProfile::syncCounters(unsigned int config) {
+	for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+		if (m_counterFds[i] >= 0)
+			_closeCounter(m_counterFds[i]);
+		m_counterFds[i] = -1;
+	}
+	m_iCounterGroupFd = -1;
+	m_iCounterConfig = config;
+
+	for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+		if (!(config & (1u << i))) continue;
+
+		m_counterFds[i] = _openCounter((PROFILER_COUNTER)i, m_iCounterGroupFd);
+		if (m_counterFds[i] < 0) {
+			// all or nothing, partial groups would mix up the ratios
+			syncCounters(0);
+			m_iCounterConfig = config;
+			return;
+		}
+		if (m_iCounterGroupFd < 0)
+			m_iCounterGroupFd = m_counterFds[i];
+	}
+}
+
+bool ProfilerProfile::readCounters(unsigned long long* values) {
+	unsigned long long groupValues[(int)PROFILER_COUNTER::COUNT];
+	int numValues = 0;
+	for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+		if (m_counterFds[i] >= 0)
+			numValues++;
+	}
+	if (!_readCounterGroup(m_iCounterGroupFd, groupValues, numValues))
+		return false;
+
+	// group values are in the order the counters were opened
+	int value = 0;
+	for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+		if (m_counterFds[i] >= 0)
+			values[i] = groupValues[value++];
+	}
+	return true;
+}
+
+void ProfilerProfile::enterScopeCounters(ProfilerNode* node) {
+	const unsigned int config = getCounterConfig();
+	if (config != m_iCounterConfig)
+		syncCounters(config);
+	if (m_iCounterGroupFd < 0) return;
+
+	if (node->m_iCounterConfig.load(std::memory_order_relaxed) != config) {
+		for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+			node->m_counterTotals[i].store(0, std::memory_order_relaxed);
+		}
+		node->m_iCounterCalls.store(0, std::memory_order_relaxed);
+		node->m_iCounterConfig.store(config, std::memory_order_release);
+	}
+
+	node->m_bCounterStarted = readCounters(node->m_counterStart);
+}
+
+void ProfilerProfile::exitScopeCounters(ProfilerNode* node) {
+	if (!node->m_bCounterStarted) return;
+	node->m_bCounterStarted = false;
+
+	// the group may have been reopened (new configuration) since the scope was entered
+	if (m_iCounterGroupFd < 0 || node->m_iCounterConfig.load(std::memory_order_relaxed) != m_iCounterConfig) return;
+
+	unsigned long long values[(int)PROFILER_COUNTER::COUNT];
+	if (!readCounters(values)) return;
+
+	for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+		if (m_counterFds[i] >= 0)
+			node->m_counterTotals[i].store(node->m_counterTotals[i].load(std::memory_order_relaxed) + (values[i] - node->m_counterStart[i]), std::memory_order_relaxed);
+	}
+	node->m_iCounterCalls.store(node->m_iCounterCalls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+static bool g_bProfilerCounting = false;
+
+static void _appendCounter(std::string& line, const char* format, ...) {
+	char buffer[128];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	line += buffer;
+}
+
+static bool _hasCounters(const ProfilerNode* node, unsigned int config) {
+	for (const ProfilerNode* child = node->getChild(); child != NULL; child = child->getSibling()) {
+		if ((child->getCounterConfig() == config && child->getCounterCalls() > 0) || _hasCounters(child, config))
+			return true;
+	}
+	return false;
+}
+
+static void _dumpCounters(const ProfilerNode* node, int depth, unsigned int config) {
+	for (const ProfilerNode* child = node->getChild(); child != NULL; child = child->getSibling()) {
+		if (child->getCounterConfig() != config || child->getCounterCalls() < 1) {
+			_dumpCounters(child, depth + 1, config);
+			continue;
+		}
+
+		const auto has = [config](PROFILER_COUNTER counter) { return ((config & (1u << (int)counter)) != 0); };
+		const auto total = [child](PROFILER_COUNTER counter) { return (double)child->getCounterTotal(counter); };
+		const double calls = (double)child->getCounterCalls();
+		const double kiloInstructions = total(PROFILER_COUNTER::INSTRUCTIONS) / 1000.0;
+
+		std::string line;
+		_appendCounter(line, "%*s%s: %llu calls", depth * 2, "", child->getName(), child->getCounterCalls());
+		if (has(PROFILER_COUNTER::CYCLES)) {
+			_appendCounter(line, ", %.0f cycles/call", total(PROFILER_COUNTER::CYCLES) / calls);
+			if (has(PROFILER_COUNTER::INSTRUCTIONS) && total(PROFILER_COUNTER::CYCLES) > 0.0)
+				_appendCounter(line, ", ipc %.2f", total(PROFILER_COUNTER::INSTRUCTIONS) / total(PROFILER_COUNTER::CYCLES));
+		}
+		else if (has(PROFILER_COUNTER::INSTRUCTIONS))
+			_appendCounter(line, ", %.0f instructions/call", total(PROFILER_COUNTER::INSTRUCTIONS) / calls);
+
+		// misses per 1000 instructions if possible, per call otherwise
+		const PROFILER_COUNTER misses[] = {PROFILER_COUNTER::L1D_MISSES, PROFILER_COUNTER::LLC_MISSES};
+		for (int m = 0; m < 2; m++) {
+			if (!has(misses[m])) continue;
+			if (kiloInstructions > 0.0)
+				_appendCounter(line, ", %s %.2f mpki", ProfilerProfile::getCounterName(misses[m]), total(misses[m]) / kiloInstructions);
+			else
+				_appendCounter(line, ", %s %.1f/call", ProfilerProfile::getCounterName(misses[m]), total(misses[m]) / calls);
+		}
+		if (has(PROFILER_COUNTER::BRANCH_MISSES)) {
+			if (has(PROFILER_COUNTER::BRANCHES) && total(PROFILER_COUNTER::BRANCHES) > 0.0)
+				_appendCounter(line, ", branch misses %.2f%%", 100.0 * total(PROFILER_COUNTER::BRANCH_MISSES) / total(PROFILER_COUNTER::BRANCHES));
+			else if (kiloInstructions > 0.0)
+				_appendCounter(line, ", branch misses %.2f mpki", total(PROFILER_COUNTER::BRANCH_MISSES) / kiloInstructions);
+			else
+				_appendCounter(line, ", branch misses %.1f/call", total(PROFILER_COUNTER::BRANCH_MISSES) / calls);
+		}
+		else if (has(PROFILER_COUNTER::BRANCHES))
+			_appendCounter(line, ", %.0f branches/call", total(PROFILER_COUNTER::BRANCHES) / calls);
+		if (has(PROFILER_COUNTER::TASK_CLOCK))
+			_appendCounter(line, ", %.3f ms cpu/call", total(PROFILER_COUNTER::TASK_CLOCK) / calls / 1000000.0);
+		if (has(PROFILER_COUNTER::PAGE_FAULTS))
+			_appendCounter(line, ", %.2f page faults/call", total(PROFILER_COUNTER::PAGE_FAULTS) / calls);
+
+		debugLog("%s\n", line.c_str());
+		_dumpCounters(child, depth + 1, config);
+	}
+}
+
+void _vprof_counters(UString args) {
+	if (!ProfilerProfile::isCountersSupported()) {
+		debugLog("Profiler: performance counters are only available on linux\n");
+		return;
+	}
+
+	std::string counters(args.toUtf8());
+	std::replace(counters.begin(), counters.end(), ',', ' ');
+	std::istringstream stream(counters);
+	std::string counter;
+
+	unsigned int mask = 0;
+	bool off = false;
+	while (stream >> counter) {
+		if (counter == "off")
+			off = true;
+		else if (counter == "all")
+			mask = (1u << (int)PROFILER_COUNTER::COUNT) - 1;
+		else {
+			int i = 0;
+			while (i < (int)PROFILER_COUNTER::COUNT && counter != s_counterNames[i]) {
+				i++;
+			}
+			if (i < (int)PROFILER_COUNTER::COUNT)
+				mask |= (1u << i);
+			else
+				debugLog("Profiler: unknown counter \"%s\"\n", counter.c_str());
+		}
+	}
+
+	if (off || mask == 0) {
+		if (!off) {
+			std::string names;
+			for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+				names += (i > 0 ? ", " : "");
+				names += s_counterNames[i];
+			}
+			debugLog("Profiler: usage: vprof_counters <%s | all | off>\n", names.c_str());
+			return;
+		}
+
+		ProfilerProfile::disableCounters();
+		if (g_bProfilerCounting) {
+			g_bProfilerCounting = false;
+			ProfilerProfile::stop();
+		}
+		debugLog("Profiler: counters off\n");
+		return;
+	}
+
+	const unsigned int enabledMask = ProfilerProfile::enableCounters(mask);
+	std::string enabled;
+	std::string unsupported;
+	for (int i = 0; i < (int)PROFILER_COUNTER::COUNT; i++) {
+		std::string& names = ((enabledMask & (1u << i)) ? enabled : unsupported);
+		if ((mask & (1u << i))) {
+			names += (names.length() > 0 ? ", " : "");
+			names += s_counterNames[i];
+		}
+	}
+	if (unsupported.length() > 0)
+		debugLog("Profiler: not available (no pmu in vms/containers, or perf_event_paranoid): %s\n", unsupported.c_str());
+	if (enabledMask == 0) return;
+
+	// counters are attributed to profiled scopes only
+	if (!g_bProfilerCounting) {
+		g_bProfilerCounting = true;
+		ProfilerProfile::start();
+	}
+	debugLog("Profiler: counting %s, see vprof_counters_dump\n", enabled.c_str());
+}
+
+void _vprof_counters_dump(void) {
+	const unsigned int config = ProfilerProfile::getCounterConfig();
+	if (config == 0) {
+		debugLog("Profiler: counters are off, see vprof_counters\n");
+		return;
+	}
+
+	// inclusive per scope, since the counters were enabled
+	for (const ProfilerProfile* profile = ProfilerProfile::getFirst(); profile != NULL; profile = profile->getNext()) {
+		if (!_hasCounters(profile->getRoot(), config)) continue;
+
+		debugLog("Profiler: counters of %s%s:\n", profile->getThreadName() != NULL ? profile->getThreadName() : "unnamed thread", profile->isThreadExited() ? " (exited)" : "");
+		_dumpCounters(profile->getRoot(), 1, config);
+	}
+}
+
+ConVar _vprof_counters_("vprof_counters", "enables performance counters for all profiled scopes (linux, perf_event_open), e.g. vprof_counters cycles instructions l1d_misses, or all/off", _vprof_counters);
+ConVar _vprof_counters_dump_("vprof_counters_dump", "logs ipc, cache and branch miss rates per profiled scope since vprof_counters was enabled", _vprof_counters_dump);
+
+
+//****************//
+//	Trace        //
+//****************//
+
+static bool g_bProfilerTracing = false;
+
+void _vprof_trace_callback(UString oldValue, UString newValue) {
+	const bool tracing = (newValue.toFloat() > 0.0f);
+	if (tracing == g_bProfilerTracing) return;
+
+	g_bProfilerTracing = tracing;
+	if (tracing)
+		ProfilerProfile::startTracing();
+	else
+		ProfilerProfile::stopTracing();
+}
+
+ConVar _vprof_trace("vprof_trace", false, "records begin/end events of every VPROF scope into per-thread ring buffers (see vprof_trace_dump)", _vprof_trace_callback);
+ConVar _vprof_trace_file("vprof_trace_file", "vprof_trace.json", "file written by vprof_trace_dump");
+ConVar _vprof_trace_seconds("vprof_trace_seconds", 5.0f, "default time span of vprof_trace_dump");
+
+static void _writeTraceString(std::ofstream& out, const char* str) {
+	out << '"';
+	for (const char* c = (str != NULL ? str : "?"); *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\')
+			out << '\\';
+		if ((unsigned char)*c >= 0x20)
+			out << *c;
+	}
+	out << '"';
+}
+
+struct TRACE_THREAD {
+	const ProfilerProfile* profile;
+	const char* name;
+	bool exited;
+	std::vector<ProfilerProfile::TRACE_EVENT> events;
+};
+
+// copies the rings of all threads (lock free), returns the time of the copy
+static long long _collectTrace(std::vector<TRACE_THREAD>& threads) {
+	threads.clear();
+	for (const ProfilerProfile* profile = ProfilerProfile::getFirst(); profile != NULL; profile = profile->getNext()) {
+		threads.push_back(TRACE_THREAD());
+		threads.back().profile = profile;
+		threads.back().name = profile->getThreadName();
+		threads.back().exited = profile->isThreadExited();
+		profile->readTraceEvents(threads.back().events);
+	}
+	return ProfilerNode::getTicks();
+}
+
+// writes everything which ends in [cutoff, now], optionally with a marker on its own track, returns the number of events or -1
+static int _writeChromeTrace(const char* filePath, const std::vector<TRACE_THREAD>& threads, long long cutoff, long long now, const char* markerName = NULL, long long markerStart = 0, long long markerEnd = 0) {
+	long long base = now;
+	for (size_t t = 0; t < threads.size(); t++) {
+		if (threads[t].events.size() > 0)
+			base = std::min(base, threads[t].events[0].ticks);
+	}
+	base = std::max(base, cutoff); // scopes which started before the cutoff are clamped to it
+
+	std::ofstream out(filePath, std::ios::out | std::ios::trunc);
+	if (!out.good())
+		return -1;
+
+	const auto ts = [base](long long ticks) { return ProfilerProfile::ticksToSeconds(ticks - base) * 1000000.0; };
+
+	int numEvents = 0;
+	out << "{\"traceEvents\":[\n";
+	out << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"TacOsu\"}}";
+	char buffer[256];
+	std::vector<const ProfilerProfile::TRACE_EVENT*> stack;
+	for (size_t t = 0; t < threads.size(); t++) {
+		// the profile list is newest first, keep thread ids in creation order
+		const int tid = (int)(threads.size() - t);
+
+		out << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+		if (threads[t].name != NULL)
+			_writeTraceString(out, threads[t].name);
+		else {
+			snprintf(buffer, sizeof(buffer), "Thread %i%s", tid, threads[t].exited ? " (exited)" : "");
+			_writeTraceString(out, buffer);
+		}
+		out << "}}";
+
+		// scopes become complete events, ends without a begin (overwritten) are dropped, scopes which are still open end now
+		stack.clear();
+		const std::vector<ProfilerProfile::TRACE_EVENT>& events = threads[t].events;
+		for (size_t i = 0; i <= events.size(); i++) {
+			const ProfilerProfile::TRACE_EVENT* event = (i < events.size() ? &events[i] : NULL);
+			if (event != NULL && event->type == ProfilerProfile::TRACE_EVENT_TYPE::BEGIN) {
+				stack.push_back(event);
+				continue;
+			}
+
+			if (event == NULL || event->type == ProfilerProfile::TRACE_EVENT_TYPE::END) {
+				const long long end = (event != NULL ? event->ticks : now);
+				while (stack.size() > 0) {
+					const ProfilerProfile::TRACE_EVENT* begin = stack.back();
+					stack.pop_back();
+
+					if (end >= cutoff) {
+						const long long start = std::max(begin->ticks, base);
+						snprintf(buffer, sizeof(buffer), ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f,\"name\":", tid, ts(start), ts(end) - ts(start));
+						out << buffer;
+						_writeTraceString(out, begin->name);
+						out << "}";
+						numEvents++;
+					}
+
+					if (event != NULL)
+						break; // one end closes one scope
+				}
+				continue;
+			}
+
+			if (event->ticks >= cutoff) {
+				snprintf(buffer, sizeof(buffer), ",\n{\"ph\":\"%s\",\"cat\":\"async\",\"id\":\"0x%llx\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"name\":", event->type == ProfilerProfile::TRACE_EVENT_TYPE::ASYNC_BEGIN ? "b" : "e", event->id, tid, ts(event->ticks));
+				out << buffer;
+				_writeTraceString(out, event->name);
+				out << "}";
+				numEvents++;
+			}
+		}
+	}
+	if (markerName != NULL) {
+		out << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Markers\"}}";
+		snprintf(buffer, sizeof(buffer), ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"name\":", ts(markerStart), ts(markerEnd) - ts(markerStart));
+		out << buffer;
+		_writeTraceString(out, markerName);
+		out << "}";
+		numEvents++;
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	return numEvents;
+}
+
+void _vprof_trace_dump(UString args) {
+	const double seconds = (args.length() > 0 ? args.toDouble() : _vprof_trace_seconds.getFloat());
+	const UString filePath = _vprof_trace_file.getString();
+
+	if (!ProfilerProfile::isTracing())
+		debugLog("Profiler: vprof_trace is off, only events recorded while it was on can be dumped\n");
+
+	std::vector<TRACE_THREAD> threads;
+	const long long now = _collectTrace(threads);
+	const int numEvents = _writeChromeTrace(filePath.toUtf8(), threads, now - (long long)(seconds / ProfilerProfile::ticksToSeconds(1)), now);
+	if (numEvents < 0)
+		debugLog("Profiler: can't write %s\n", filePath.toUtf8());
+	else
+		debugLog("Profiler: wrote %i trace events of the last %g seconds to %s (open in ui.perfetto.dev or chrome://tracing)\n", numEvents, seconds, filePath.toUtf8());
+}
+
+ConVar _vprof_trace_dump_("vprof_trace_dump", "writes the recorded trace events of the last n seconds (default vprof_trace_seconds) as chrome trace event json to vprof_trace_file", _vprof_trace_dump);
+
+
+//********************//
+//	Hitch capture    //
+//********************//
+
+std::atomic<bool> ProfilerHitchCapture::s_bEnabled(false);
+
+void _vprof_hitch_capture_callback(UString oldValue, UString newValue) {
+	ProfilerHitchCapture::setEnabled(newValue.toFloat() > 0.0f);
+}
+
+ConVar _vprof_hitch_capture("vprof_hitch_capture", false, "keeps tracing on and saves the trace around frames which take much longer than the recent ones", _vprof_hitch_capture_callback);
+ConVar _vprof_hitch_threshold("vprof_hitch_threshold", 2.5f, "a frame is a hitch if it takes longer than this times the median of the recent frames");
+ConVar _vprof_hitch_min_ms("vprof_hitch_min_ms", 4.0f, "and if it takes at least this many milliseconds longer than the median");
+ConVar _vprof_hitch_window("vprof_hitch_window", 2.0f, "seconds before a hitch which are saved (limited by the size of the trace ring buffers)");
+ConVar _vprof_hitch_postroll("vprof_hitch_postroll", 0.5f, "seconds after a hitch which are saved");
+ConVar _vprof_hitch_file("vprof_hitch_file", "vprof_hitch", "hitch captures are saved as <vprof_hitch_file>_<n>.json");
+
+static struct HITCH_CAPTURE {
+	HITCH_CAPTURE() {
+		reset();
+		numCaptures = 0;
+		writing = false;
+	}
+	~HITCH_CAPTURE() {
+		if (writer.joinable())
+			writer.join();
+	}
+
+	void reset() {
+		lastFrameTicks = 0;
+		numFrameTimes = 0;
+		captureTicks = 0;
+	}
+
+	long long lastFrameTicks;
+	double frameTimes[VPROF_HITCH_NUM_FRAMES]; // ring
+	int numFrameTimes;
+
+	// pending capture, taken after the post roll
+	long long captureTicks;
+	long long hitchStart;
+	long long hitchEnd;
+	double hitchMedian;
+	const ProfilerProfile* mainProfile;
+
+	int numCaptures;
+	std::thread writer; // the file is written in the background
+	std::atomic<bool> writing; // until the writer is done, joining it before would block the main thread
+} g_hitchCapture;
+
+void ProfilerHitchCapture::setEnabled(bool enabled) {
+	if (enabled == s_bEnabled.load())
+		return;
+
+	g_hitchCapture.reset();
+	s_bEnabled = enabled;
+	if (enabled)
+		ProfilerProfile::startTracing();
+	else
+		ProfilerProfile::stopTracing();
+}
+
+void ProfilerHitchCapture::update() {
+	HITCH_CAPTURE& c = g_hitchCapture;
+
+	const long long now = ProfilerNode::getTicks();
+	const long long frameStart = c.lastFrameTicks;
+	c.lastFrameTicks = now;
+	if (frameStart == 0) return;
+
+	if (c.captureTicks != 0) {
+		if (now >= c.captureTicks) {
+			capture();
+			c.captureTicks = 0;
+			c.lastFrameTicks = ProfilerNode::getTicks(); // copying the rings is not part of the next frame
+		}
+		return;
+	}
+
+	const double frameTime = ProfilerProfile::ticksToSeconds(now - frameStart);
+
+	// everything before the ring is full is the warmup
+	if (c.numFrameTimes >= VPROF_HITCH_NUM_FRAMES) {
+		double sorted[VPROF_HITCH_NUM_FRAMES];
+		memcpy(sorted, c.frameTimes, sizeof(sorted));
+		std::nth_element(sorted, sorted + VPROF_HITCH_NUM_FRAMES / 2, sorted + VPROF_HITCH_NUM_FRAMES);
+		const double median = sorted[VPROF_HITCH_NUM_FRAMES / 2];
+
+		if (frameTime > median * _vprof_hitch_threshold.getFloat() && frameTime > median + _vprof_hitch_min_ms.getFloat() / 1000.0) {
+			// hitches are not added to the median
+			c.hitchStart = frameStart;
+			c.hitchEnd = now;
+			c.hitchMedian = median;
+			c.mainProfile = ProfilerProfile::get();
+			c.captureTicks = now + (long long)(std::max(_vprof_hitch_postroll.getFloat(), 0.0f) / ProfilerProfile::ticksToSeconds(1));
+			return;
+		}
+	}
+
+	c.frameTimes[c.numFrameTimes % VPROF_HITCH_NUM_FRAMES] = frameTime;
+	c.numFrameTimes++;
+}
+
+// the scope with the most exclusive time in [start, end]
+static const char* _findDominantScope(const std::vector<ProfilerProfile::TRACE_EVENT>& events, long long start, long long end, long long& dominantTicks) {
+	struct OPEN_SCOPE {
+		const char* name;
+		long long begin;
+		long long children;
+	};
+
+	const auto overlap = [start, end](long long scopeBegin, long long scopeEnd) { return std::max(std::min(scopeEnd, end) - std::max(scopeBegin, start), 0LL); };
+
+	std::vector<OPEN_SCOPE> stack;
+	std::vector<std::pair<const char*, long long>> exclusive;
+	for (size_t i = 0; i <= events.size(); i++) {
+		const ProfilerProfile::TRACE_EVENT* event = (i < events.size() ? &events[i] : NULL);
+		if (event != NULL && event->type == ProfilerProfile::TRACE_EVENT_TYPE::BEGIN) {
+			stack.push_back({event->name, event->ticks, 0});
+			continue;
+		}
+		if (event != NULL && event->type != ProfilerProfile::TRACE_EVENT_TYPE::END)
+			continue;
+
+		// scopes which are still open end with the hitch
+		while (stack.size() > 0) {
+			const OPEN_SCOPE scope = stack.back();
+			stack.pop_back();
+
+			const long long total = overlap(scope.begin, event != NULL ? event->ticks : end);
+			if (stack.size() > 0)
+				stack.back().children += total;
+
+			const long long self = total - scope.children;
+			if (self > 0) {
+				size_t e = 0;
+				while (e < exclusive.size() && strcmp(exclusive[e].first, scope.name) != 0) {
+					e++;
+				}
+				if (e < exclusive.size())
+					exclusive[e].second += self;
+				else
+					exclusive.push_back(std::make_pair(scope.name, self));
+			}
+
+			if (event != NULL)
+				break;
+		}
+	}
+
+	const char* dominant = NULL;
+	dominantTicks = 0;
+	for (size_t e = 0; e < exclusive.size(); e++) {
+		if (exclusive[e].second > dominantTicks) {
+			dominant = exclusive[e].first;
+			dominantTicks = exclusive[e].second;
+		}
+	}
+	return dominant;
+}
+
+void ProfilerHitchCapture::capture() {
+	HITCH_CAPTURE& c = g_hitchCapture;
+
+	// hitches in quick succession: the previous one is still being written
+	if (c.writing.load(std::memory_order_acquire)) {
+		debugLog("Profiler: hitch: the previous capture is still being written, skipped\n");
+		return;
+	}
+	if (c.writer.joinable())
+		c.writer.join(); // finished already
+
+	std::vector<TRACE_THREAD> threads;
+	const long long now = _collectTrace(threads);
+
+	long long dominantTicks = 0;
+	const char* dominant = NULL;
+	for (size_t t = 0; t < threads.size(); t++) {
+		if (threads[t].profile == c.mainProfile)
+			dominant = _findDominantScope(threads[t].events, c.hitchStart, c.hitchEnd, dominantTicks);
+	}
+
+	const double frameTime = ProfilerProfile::ticksToSeconds(c.hitchEnd - c.hitchStart);
+	char filePath[512];
+	snprintf(filePath, sizeof(filePath), "%s_%i.json", _vprof_hitch_file.getString().toUtf8(), ++c.numCaptures);
+	debugLog("Profiler: hitch: %.2f ms frame (median %.2f ms), dominant scope \"%s\" %.2f ms, saving %s\n", frameTime * 1000.0, c.hitchMedian * 1000.0, dominant != NULL ? dominant : "(none)", ProfilerProfile::ticksToSeconds(dominantTicks) * 1000.0, filePath);
+
+	char markerName[64];
+	snprintf(markerName, sizeof(markerName), "Hitch (%.2f ms)", frameTime * 1000.0);
+
+	const long long cutoff = c.hitchStart - (long long)(std::max(_vprof_hitch_window.getFloat(), 0.0f) / ProfilerProfile::ticksToSeconds(1));
+	c.writing = true;
+	c.writer = std::thread([&c, threads = std::move(threads), path = std::string(filePath), name = std::string(markerName), cutoff, now, hitchStart = c.hitchStart, hitchEnd = c.hitchEnd]() {
+		if (_writeChromeTrace(path.c_str(), threads, cutoff, now, name.c_str(), hitchStart, hitchEnd) < 0)
+			debugLog("Profiler: can't write %s\n", path.c_str());
+		c.writing.store(false, std::memory_order_release);
+	});
+}
+
+
+//****************//
+//	Benchmark    //
+//****************//
+
+void _vprof_benchmark(void) {
+	const int numScopes = 2000000;
+	const int numRounds = 8;
+	const int numThreads = 4;
+	const int numThreadFrames = 2000;
+
+	// on a fresh thread, so that the calling thread's profile and frame are not disturbed
+	double timeBaseline = 0.0;
+	double timeDisabled = 0.0;
+	double timeEnabled = 0.0;
+	double timeTracing = 0.0;
+	double timeTracingEnabled = 0.0;
+	double timeClock = 0.0;
+	double timeNew = 0.0;
+	double timeNewTracked = 0.0;
+	long long numScopeAllocations = -1;
+	std::thread benchmarkThread([&]() {
+		VPROF_THREAD_NAME("vprof_benchmark");
+		volatile int sink = 0;
+
+		const auto runBaseline = [&]() {
+			Timer baselineTimer;
+			baselineTimer.start();
+			for (int i = 0; i < numScopes; i++) {
+				sink = sink + i;
+			}
+			baselineTimer.update();
+			return baselineTimer.getElapsedTime();
+		};
+
+		// every enabled or traced scope reads the clock twice
+		const auto runClock = [&]() {
+			long long ticks = 0;
+			Timer clockTimer;
+			clockTimer.start();
+			for (int i = 0; i < numScopes; i++) {
+				ticks += ProfilerNode::getTicks();
+			}
+			clockTimer.update();
+			sink = sink + (int)ticks;
+			return clockTimer.getElapsedTime();
+		};
+
+		const auto runScopes = [&]() {
+			Timer scopeTimer;
+			scopeTimer.start();
+			for (int i = 0; i < numScopes / 2; i++) {
+				VPROF("vprof_benchmark_outer");
+				{
+					VPROF("vprof_benchmark_inner");
+					sink = sink + i;
+				}
+			}
+			scopeTimer.update();
+			return scopeTimer.getElapsedTime();
+		};
+
+		// the first event allocates the ring buffer, keep that out of the measurement
+		ProfilerProfile::startTracing();
+		{
+			VPROF("vprof_benchmark_warmup");
+		}
+		ProfilerProfile::stopTracing();
+
+		// best of several rounds, with every configuration in every round, so that a phase in which the machine is busy with something else doesn't decide the result of one of them
+		timeBaseline = timeClock = timeDisabled = timeEnabled = timeTracing = timeTracingEnabled = DBL_MAX;
+		for (int round = 0; round < numRounds; round++) {
+			timeBaseline = std::min(timeBaseline, runBaseline());
+			timeClock = std::min(timeClock, runClock());
+
+			timeDisabled = std::min(timeDisabled, runScopes());
+
+			ProfilerProfile::start();
+			timeEnabled = std::min(timeEnabled, runScopes());
+			ProfilerProfile::stop();
+
+			ProfilerProfile::startTracing();
+			timeTracing = std::min(timeTracing, runScopes());
+
+			ProfilerProfile::start();
+			timeTracingEnabled = std::min(timeTracingEnabled, runScopes());
+			ProfilerProfile::stop();
+			ProfilerProfile::stopTracing();
+		}
+
+		if (!AllocationTracker::isSupported())
+			return;
+
+		// the allocation hook, and scopes must never allocate once their nodes exist (the runs above built them)
+		const auto runNew = [&]() {
+			Timer newTimer;
+			newTimer.start();
+			for (int i = 0; i < numScopes / 16; i++) {
+				int* volatile value = new int(i);
+				sink = sink + *value;
+				delete value;
+			}
+			newTimer.update();
+			return newTimer.getElapsedTime();
+		};
+		const bool wasTracking = AllocationTracker::isEnabled();
+		AllocationTracker::setEnabled(false);
+		timeNew = runNew();
+
+		AllocationTracker::setEnabled(true);
+		ProfilerProfile::startTracing();
+		{
+			VPROF("vprof_benchmark_alloc");
+			timeNewTracked = runNew();
+		}
+		const unsigned long long numAllocations = ProfilerProfile::get()->getNumAllocations();
+		runScopes();
+		numScopeAllocations = (long long)(ProfilerProfile::get()->getNumAllocations() - numAllocations);
+		ProfilerProfile::stopTracing();
+		AllocationTracker::setEnabled(wasTracking);
+	});
+	benchmarkThread.join();
+
+	const auto perScope = [&](double time) { return (time - timeBaseline / 2) * 1e9 / numScopes; };
+	debugLog("Profiler: VPROF scope overhead: disabled %.2f ns, enabled %.2f ns, tracing %.2f ns, tracing + enabled %.2f ns (loop %.2f ns, clock %.2f ns at %.0f MHz, %s)\n", perScope(timeDisabled), perScope(timeEnabled), perScope(timeTracing), perScope(timeTracingEnabled), timeBaseline * 1e9 / numScopes, timeClock * 1e9 / numScopes, 1e-6 / ProfilerProfile::ticksToSeconds(1), (ProfilerNode::isInvariantTsc() ? "invariant tsc" : "steady_clock"));
+
+	// budget of a traced scope (begin + end event)
+	const double traceBudget = 50.0;
+	const bool isTraceWithinBudget = (perScope(timeTracing) <= traceBudget);
+	debugLog("Profiler: traced scope %.2f ns, budget %.0f ns: %s\n", perScope(timeTracing), traceBudget, (isTraceWithinBudget ? "ok" : "FAILED"));
+	if (!isTraceWithinBudget)
+		debugLog("Profiler: WARNING: tracing costs more than %.0f ns per scope (of which %.2f ns are the two clock reads)\n", traceBudget, 2.0 * timeClock * 1e9 / numScopes);
+	if (numScopeAllocations >= 0) {
+		debugLog("Profiler: new + delete %.2f ns, tracked %.2f ns, %lli allocations in %i tracked and traced scopes\n", timeNew * 1e9 / (numScopes / 16), timeNewTracked * 1e9 / (numScopes / 16), numScopeAllocations, numScopes);
+		if (numScopeAllocations > 0)
+			debugLog("Profiler: WARNING: VPROF scopes allocate, their budget is 0\n");
+	}
+
+	// threads with frames, read concurrently
+	ProfilerProfile::start();
+	std::atomic<int> numFinished(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < numThreads; t++) {
+		threads.push_back(std::thread([&]() {
+			VPROF_THREAD_NAME("vprof_benchmark_worker");
+			volatile int sink = 0;
+			for (int f = 0; f < numThreadFrames; f++) {
+				VPROF_THREAD_FRAME();
+				VPROF("vprof_benchmark_frame");
+				for (int i = 0; i < 64; i++) {
+					VPROF_BUDGET(((i & 1) ? "vprof_benchmark_odd" : "vprof_benchmark_even"), VPROF_BUDGETGROUP_UPDATE);
+					sink = sink + i;
+				}
+			}
+			numFinished++;
+		}));
+	}
+
+	int numReads = 0;
+	int numRetries = 0;
+	int numErrors = 0;
+	std::vector<ProfilerProfile::NODE_SNAPSHOT> nodes;
+	while (numFinished.load() < numThreads) {
+		for (const ProfilerProfile* profile = ProfilerProfile::getFirst(); profile != NULL; profile = profile->getNext()) {
+			const char* threadName = profile->getThreadName();
+			if (threadName == NULL || strcmp(threadName, "vprof_benchmark_worker") != 0 || profile->getFrame() < 2)
+				continue;
+
+			if (!profile->readLastFrame(nodes)) {
+				numRetries++;
+				continue;
+			}
+			numReads++;
+
+			// a published frame is complete: 64 scopes per frame, the root covers everything
+			int numCalls = 0;
+			for (size_t i = 0; i < nodes.size(); i++) {
+				if (nodes[i].depth == 2)
+					numCalls += nodes[i].calls;
+				if (nodes[i].time < 0.0 || nodes[i].time > nodes[0].time + 0.001)
+					numErrors++;
+			}
+			if (numCalls != 64)
+				numErrors++;
+		}
+	}
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+	ProfilerProfile::stop();
+
+	debugLog("Profiler: %i threads x %i frames, %i lock free frame reads (%i retries), %i errors\n", numThreads, numThreadFrames, numReads, numRetries, numErrors);
+}
+
+ConVar _vprof_benchmark_("vprof_benchmark", "measures the overhead of a VPROF scope, and reads the frames of profiled threads while they run", _vprof_benchmark);
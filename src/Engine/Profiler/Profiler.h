@@ -1,7 +1,23 @@
 #ifndef PROFILER_H
 #define PROFILER_H
 
-#define VPROF_MAIN() g_profCurrentProfile.main(); VPROF("Main")
+#include "cbase.h"
+#include "FrameStats.h"
+#include "AllocationTracker.h"
+
+#include <chrono>
+
+// scope timestamps come from the time stamp counter where there is one (see ProfilerNode::getTicks())
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VPROF_RDTSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+#define VPROF_MAIN() ProfilerProfile::get()->main(); FrameStats::onMainFrame(); ProfilerHitchCapture::onMainFrame(); AllocationTracker::onMainFrame(); VPROF("Main")
 
 #define VPROF(name)							VPROF_(name, VPROF_BUDGETGROUP_ROOT)
 #define VPROF_(name, group)					ProfilerScope Prof_(name, group);
@@ -11,8 +27,16 @@
 #define VPROF_SCOPE_BEGIN(name)				do { VPROF(name)
 #define VPROF_SCOPE_END()					} while (0)
 
-#define VPROF_ENTER_SCOPE(name)				g_profCurrentProfile.enterScope(name, VPROF_BUDGETGROUP_ROOT)
-#define VPROF_EXIT_SCOPE()					g_profCurrentProfile.exitScope()
+#define VPROF_ENTER_SCOPE(name)				ProfilerProfile::get()->enterScope(name, VPROF_BUDGETGROUP_ROOT)
+#define VPROF_EXIT_SCOPE()					ProfilerProfile::get()->exitScope()
+
+// for threads with their own loop (loader, audio, workers): marks the frame boundary of the calling thread
+#define VPROF_THREAD_FRAME()				ProfilerProfile::get()->main()
+#define VPROF_THREAD_NAME(name)				ProfilerProfile::get()->setThreadName(name)
+
+// trace only: operations which start and end at different places (or threads), get their own track per name, id identifies the operation
+#define VPROF_ASYNC_BEGIN(name, id)			do { if (ProfilerProfile::isTracing()) ProfilerProfile::get()->recordTraceEvent(ProfilerProfile::TRACE_EVENT_TYPE::ASYNC_BEGIN, name, (unsigned long long)(id)); } while (0)
+#define VPROF_ASYNC_END(name, id)			do { if (ProfilerProfile::isTracing()) ProfilerProfile::get()->recordTraceEvent(ProfilerProfile::TRACE_EVENT_TYPE::ASYNC_END, name, (unsigned long long)(id)); } while (0)
 
 #define VPROF_BUDGETGROUP_ROOT				"Root"
 #define VPROF_BUDGETGROUP_SLEEP				"Sleep"
@@ -21,8 +45,22 @@
 #define VPROF_BUDGETGROUP_DRAW				"Draw"
 #define VPROF_BUDGETGROUP_DRAW_SWAPBUFFERS	"SwapBuffers"
 
-#define VPROF_MAX_NUM_BUDGETGROUPS			32
-#define VPROF_MAX_NUM_NODES					32
+#define VPROF_NODE_BLOCK_SIZE				256
+#define VPROF_TRACE_BUFFER_SIZE				65536 // events per thread, power of two
+#define VPROF_HITCH_NUM_FRAMES				128 // rolling window of the median frame time
+
+// performance counters which can be attributed to scopes (vprof_counters), linux only (perf_event_open)
+enum class PROFILER_COUNTER {
+	CYCLES,
+	INSTRUCTIONS,
+	L1D_MISSES,		// l1 data cache read misses
+	LLC_MISSES,		// last level cache misses
+	BRANCHES,
+	BRANCH_MISSES,
+	TASK_CLOCK,		// software, nanoseconds on the cpu
+	PAGE_FAULTS,	// software
+	COUNT // not a counter
+};
 
 class ProfilerNode {
 	friend class ProfilerProfile;
@@ -31,134 +69,341 @@ public:
 	ProfilerNode();
 	ProfilerNode(const char* name, const char* group, ProfilerNode* parent);
 
-	void enterScope();
-	bool exitScope();
+	// the invariant time stamp counter: a few ns per read instead of the ~20 ns of steady_clock, which the two reads of every traced scope would pay
+	// the tick rate is calibrated against steady_clock once, convert with ProfilerProfile::ticksToSeconds()
+	// cpus without an invariant counter (the rate changes with power states, or it stops) use steady_clock
+	static inline long long getTicks() {
+#ifdef VPROF_RDTSC
+		if (s_bInvariantTsc)
+			return (long long)__rdtsc();
+#endif
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+	}
+	static inline bool isInvariantTsc() { return s_bInvariantTsc; }
+
+	inline void enterScope(long long now) {
+		if (m_iNumRecursions++ == 0)
+			m_iStartTicks = now;
+	}
+	inline bool exitScope(long long now) {
+		if (--m_iNumRecursions == 0) {
+			m_iTicksCurrentFrame += now - m_iStartTicks;
+			m_iCallsCurrentFrame++;
+		}
+		return (m_iNumRecursions == 0);
+	}
 
 	inline const char* getName() const { return m_name; }
+	inline const char* getGroup() const { return m_group; }
 	inline int getGroupID() const { return m_iGroupID; }
 
+	// the tree only ever grows, children are published atomically, so any thread may walk it
 	inline ProfilerNode* getParent() const { return m_parent; }
-	inline ProfilerNode* getChild() const { return m_child; }
-	inline ProfilerNode* getSibling() const { return m_sibling; }
+	inline ProfilerNode* getChild() const { return m_child.load(std::memory_order_acquire); }
+	inline ProfilerNode* getSibling() const { return m_sibling.load(std::memory_order_acquire); }
+
+	double getTimeCurrentFrame() const; // owner thread only
+	double getTimeFrame(unsigned int frame) const { return m_fTimeFrame[frame & 1].load(std::memory_order_relaxed); } // see ProfilerProfile::readLastFrame()
+	int getCallsFrame(unsigned int frame) const { return m_iCallsFrame[frame & 1].load(std::memory_order_relaxed); }
+	int getAllocationsFrame(unsigned int frame) const { return m_iAllocationsFrame[frame & 1].load(std::memory_order_relaxed); } // exclusive, see AllocationTracker
+	long long getAllocatedBytesFrame(unsigned int frame) const { return m_iAllocatedBytesFrame[frame & 1].load(std::memory_order_relaxed); }
 
-	inline double getTimeCurrentFrame() const { return m_fTimeCurrentFrame; }
-	inline double getTimeLastFrame() const { return m_fTimeLastFrame; }
+	// performance counters (any thread): inclusive totals since the counter configuration getCounterConfig() was enabled
+	inline unsigned int getCounterConfig() const { return m_iCounterConfig.load(std::memory_order_acquire); }
+	inline unsigned long long getCounterCalls() const { return m_iCounterCalls.load(std::memory_order_relaxed); }
+	inline unsigned long long getCounterTotal(PROFILER_COUNTER counter) const { return m_counterTotals[(int)counter].load(std::memory_order_relaxed); }
 
 private:
-	inline void constructor(const char* name, const char* group, ProfilerNode* parent);
+	static bool hasInvariantTsc(); // cpuid
 
-	ProfilerNode* getSubNode(const char* name, const char* group);
+	static inline const bool s_bInvariantTsc = hasInvariantTsc();
 
-	static int s_iNodeCounter;
+	void constructor(const char* name, const char* group, ProfilerNode* parent);
 
 	const char* m_name;
+	const char* m_group;
 	int m_iGroupID;
 
 	ProfilerNode* m_parent;
-	ProfilerNode* m_child;
-	ProfilerNode* m_sibling;
+	std::atomic<ProfilerNode*> m_child;
+	std::atomic<ProfilerNode*> m_sibling;
 
+	// owner thread
 	int m_iNumRecursions;
-	double m_fTime;
-	double m_fTimeCurrentFrame;
-	double m_fTimeLastFrame;
+	long long m_iStartTicks;
+	long long m_iTicksCurrentFrame;
+	int m_iCallsCurrentFrame;
+	int m_iAllocationsCurrentFrame;
+	long long m_iAllocatedBytesCurrentFrame;
+
+	// published at the frame boundary, double buffered by frame number
+	std::atomic<double> m_fTimeFrame[2];
+	std::atomic<int> m_iCallsFrame[2];
+	std::atomic<int> m_iAllocationsFrame[2];
+	std::atomic<long long> m_iAllocatedBytesFrame[2];
+
+	// performance counters, written by the owner thread only
+	std::atomic<unsigned int> m_iCounterConfig;
+	bool m_bCounterStarted;
+	unsigned long long m_counterStart[(int)PROFILER_COUNTER::COUNT];
+	std::atomic<unsigned long long> m_counterTotals[(int)PROFILER_COUNTER::COUNT];
+	std::atomic<unsigned long long> m_iCounterCalls;
 };
 
+// one profile (tree) per thread, created on the first VPROF of a thread, nodes come from a per-thread arena without any cap
+// only the owning thread modifies its tree, at its frame boundary (main()) the times of the finished frame are published with the frame number,
+// so the ui can read the last frame of every thread (readLastFrame()) without locks
+// enabling/disabling is global, a thread picks it up the next time it is at its root
+// independently of that, while tracing every scope also records a begin/end event into a per-thread ring buffer (see vprof_trace_dump)
 class ProfilerProfile {
 	friend class ProfilerNode;
 
 public:
-	ProfilerProfile(bool manualStartViaMain = false);
+	enum class TRACE_EVENT_TYPE {
+		BEGIN,
+		END,
+		ASYNC_BEGIN,
+		ASYNC_END
+	};
 
-	inline void main() {
-		if (m_bEnableScheduled) {
-			m_bEnableScheduled = false;
-			m_root.enterScope();
-		}
-		if (m_iEnabled > 0) {
-			for (int i = 0; i < m_iNumNodes; i++) {
-				m_nodes[i].m_fTimeLastFrame = m_nodes[i].m_fTimeCurrentFrame;
-			}
-		}
-	}
-	inline void start() {
-		if (++m_iEnabled == 1) {
-			if (m_bManualStartViaMain)
-				m_bEnableScheduled = true;
-			else
-				m_root.enterScope();
-		}
+	struct TRACE_EVENT {
+		long long ticks;
+		const char* name; // NULL for END
+		TRACE_EVENT_TYPE type;
+		unsigned long long id; // async events only
+	};
+
+	struct NODE_SNAPSHOT {
+		const char* name;
+		const char* group;
+		int depth; // 0 is the root
+		int calls;
+		double time;
+		int allocations; // exclusive, only while tracking allocations
+		long long allocatedBytes;
+	};
+
+	static inline ProfilerProfile* get() {
+		ProfilerProfile* profile = s_currentProfile;
+		return (profile != NULL ? profile : createForCurrentThread());
 	}
-	inline void stop() {
-		if (--m_iEnabled == 0) {
-			if (!m_bEnableScheduled)
-				m_root.exitScope();
-			m_bEnableScheduled = false;
+
+	// all profiles (including the ones of threads which have exited), any thread
+	static inline ProfilerProfile* getFirst() { return s_firstProfile.load(std::memory_order_acquire); }
+	inline ProfilerProfile* getNext() const { return m_nextProfile; }
+
+	static void start();
+	static void stop();
+	static inline bool isEnabled() { return (s_iEnabled.load(std::memory_order_relaxed) > 0); }
+
+	// performance counters: every profiled thread opens its own counter group, which is read on the first entry and the last exit of a scope
+	// the configuration is a bit mask of PROFILER_COUNTERs plus a serial number in the upper bits, 0 is off
+	static bool isCountersSupported();
+	static unsigned int enableCounters(unsigned int counterMask); // returns the mask of the counters which could be opened
+	static void disableCounters();
+	static inline bool isCounting() { return (s_iCounterConfig.load(std::memory_order_relaxed) != 0); }
+	static inline unsigned int getCounterConfig() { return s_iCounterConfig.load(std::memory_order_acquire); }
+	static const char* getCounterName(PROFILER_COUNTER counter);
+
+	// allocation tracking (see AllocationTracker), called by the allocator hook of the allocating thread
+	// attributes the allocation to the current scope while profiling, never creates a profile (returns false for threads without one)
+	static inline bool recordAllocation(size_t size) {
+		ProfilerProfile* profile = s_currentProfile;
+		if (profile == NULL)
+			return false;
+
+		profile->m_iNumAllocations.store(profile->m_iNumAllocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		profile->m_iAllocatedBytes.store(profile->m_iAllocatedBytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+		if (profile->m_root.m_iNumRecursions > 0) {
+			profile->m_curNode->m_iAllocationsCurrentFrame++;
+			profile->m_curNode->m_iAllocatedBytesCurrentFrame += (long long)size;
 		}
+		return true;
 	}
 
-	inline void enterScope(const char* name, const char* group) {
-		if ((m_iEnabled != 0 && !m_bEnableScheduled) || !m_bAtRoot) {
-			if (name != m_curNode->m_name)//pointer comparison either will break everything or will be very gangster
-				m_curNode = m_curNode->getSubNode(name, group);
-			m_curNode->enterScope();
+	static void startTracing();
+	static void stopTracing();
+	static inline bool isTracing() { return (s_iTracing.load(std::memory_order_relaxed) > 0); }
+	static double ticksToSeconds(long long ticks); // the first call calibrates the tick rate (10 ms)
 
-			m_bAtRoot = (m_curNode == &m_root);
-		}
+public:
+	ProfilerProfile(bool manualStartViaMain = false);
+	~ProfilerProfile();
+
+	void main(); // frame boundary of the owning thread
+
+	inline bool enterScope(const char* name, const char* group) {
+		const bool tracing = isTracing();
+		const bool profiling = (m_curNode != &m_root || syncEnabled());
+		if (!tracing && !profiling)
+			return false;
+
+		// one clock read for both
+		const long long now = ProfilerNode::getTicks();
+		if (tracing)
+			recordTraceEvent(now, TRACE_EVENT_TYPE::BEGIN, name, 0);
+		if (!profiling)
+			return false;
+
+		if (name != m_curNode->m_name) // pointer comparison, names are literals
+			m_curNode = getSubNode(m_curNode, name, group);
+		m_curNode->enterScope(now);
+		if (isCounting() && m_curNode->m_iNumRecursions == 1)
+			enterScopeCounters(m_curNode);
+		return true;
 	}
 	inline void exitScope() {
-		if (!m_bAtRoot || (m_iEnabled != 0 && !m_bEnableScheduled)) {
-			if (!m_bAtRoot && m_curNode->exitScope())
+		const bool tracing = isTracing();
+		if (!tracing && m_curNode == &m_root)
+			return;
+
+		const long long now = ProfilerNode::getTicks();
+		if (tracing)
+			recordTraceEvent(now, TRACE_EVENT_TYPE::END, NULL, 0);
+		if (m_curNode != &m_root) {
+			if (isCounting() && m_curNode->m_iNumRecursions == 1)
+				exitScopeCounters(m_curNode);
+			if (m_curNode->exitScope(now))
 				m_curNode = m_curNode->m_parent;
-
-			m_bAtRoot = (m_curNode == &m_root);
 		}
 	}
 
-	inline bool isEnabled() const { return (m_iEnabled != 0 || m_bEnableScheduled); }
-	inline bool isAtRoot() const { return m_bAtRoot; }
+	inline void recordTraceEvent(TRACE_EVENT_TYPE type, const char* name, unsigned long long id) { recordTraceEvent(ProfilerNode::getTicks(), type, name, id); }
+	inline void recordTraceEvent(long long ticks, TRACE_EVENT_TYPE type, const char* name, unsigned long long id) {
+		if (m_traceEvents == NULL)
+			allocateTraceBuffer();
+
+		// single producer ring, overwrites the oldest events
+		// the fence orders the previous count store before the slot writes, so that readers can detect slots which were overwritten while reading
+		const unsigned long long index = m_iNumTraceEvents.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		TRACE_SLOT& slot = m_traceEvents[index & (VPROF_TRACE_BUFFER_SIZE - 1)];
+		slot.ticks.store(ticks, std::memory_order_relaxed);
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.data.store((id << 2) | (unsigned long long)type, std::memory_order_relaxed);
+
+		m_iNumTraceEvents.store(index + 1, std::memory_order_release);
+	}
+
+	void setThreadName(const char* name) { m_threadName.store(name, std::memory_order_release); }
+
+	inline bool isAtRoot() const { return (m_curNode == &m_root); }
+	inline bool isThreadExited() const { return m_bThreadExited.load(std::memory_order_acquire); }
 
-	inline int getNumGroups() const { return m_iNumGroups; }
-	inline int getNumNodes() const { return m_iNumNodes; }
+	inline const char* getThreadName() const { return m_threadName.load(std::memory_order_acquire); }
+	inline unsigned int getFrame() const { return m_iFrame.load(std::memory_order_acquire); } // number of published frames
+	inline int getNumGroups() const { return (int)m_groups.size(); } // owner thread
+	inline int getNumNodes() const { return m_iNumNodes.load(std::memory_order_acquire); }
+
+	// allocations of the owning thread while tracking (any thread): in total, and in the last published frame (all scopes)
+	inline unsigned long long getNumAllocations() const { return m_iNumAllocations.load(std::memory_order_relaxed); }
+	inline unsigned long long getAllocatedBytes() const { return m_iAllocatedBytes.load(std::memory_order_relaxed); }
+	inline int getAllocationsLastFrame() const { return m_iAllocationsFrame[getFrame() & 1].load(std::memory_order_relaxed); }
+	inline long long getAllocatedBytesLastFrame() const { return m_iAllocatedBytesFrame[getFrame() & 1].load(std::memory_order_relaxed); }
 
 	inline const ProfilerNode* getRoot() const { return &m_root; }
 
-	inline const char* getGroupName(int groupID) {
-		return m_groups[groupID < 0 ? 0 : (groupID > m_iNumGroups - 1 ? m_iNumGroups - 1 : groupID)].name;
+	inline const char* getGroupName(int groupID) const { // owner thread
+		return m_groups[groupID < 0 ? 0 : (groupID > (int)m_groups.size() - 1 ? (int)m_groups.size() - 1 : groupID)];
 	}
 
 	double sumTimes(int groupID);//sometimes
 	double sumTimes(ProfilerNode* node, int groupID);// i had to
 
+	// any thread, lock free: flattens the last published frame (depth first), returns false if the owner published twice while reading (retry)
+	bool readLastFrame(std::vector<NODE_SNAPSHOT>& nodes) const;
+
+	// any thread, lock free: copies the recorded trace events (oldest first) which are still in the ring buffer and were not overwritten while reading
+	void readTraceEvents(std::vector<TRACE_EVENT>& events) const;
+
 private:
-	struct BUDGETGROUP
-	{
-		const char* name;
+	struct THREAD_EXIT; // thread_local, marks the profile of an exiting thread
+
+	struct TRACE_SLOT {
+		std::atomic<long long> ticks;
+		std::atomic<const char*> name;
+		std::atomic<unsigned long long> data; // id << 2 | type
 	};
 
+	static ProfilerProfile* createForCurrentThread();
+
+	static constinit thread_local ProfilerProfile* s_currentProfile;
+	static thread_local THREAD_EXIT s_threadExit;
+	static std::atomic<ProfilerProfile*> s_firstProfile;
+	static std::atomic<int> s_iEnabled;
+	static std::atomic<int> s_iTracing;
+	static std::atomic<unsigned int> s_iCounterConfig;
+
+	bool syncEnabled(); // at the root only
+	ProfilerNode* getSubNode(ProfilerNode* parent, const char* name, const char* group);
+	ProfilerNode* allocateNode();
+	void publishFrame();
+	void allocateTraceBuffer();
+	void syncCounters(unsigned int config);
+	bool readCounters(unsigned long long* values); // indexed by PROFILER_COUNTER
+	void enterScopeCounters(ProfilerNode* node);
+	void exitScopeCounters(ProfilerNode* node);
 	int groupNameToID(const char* group);
 
-	int m_iNumGroups;
-	BUDGETGROUP m_groups[VPROF_MAX_NUM_BUDGETGROUPS];
+	std::vector<const char*> m_groups;
 
 	bool m_bManualStartViaMain;
-
-	int m_iEnabled;
+	bool m_bEnabled;
 	bool m_bEnableScheduled;
-	bool m_bAtRoot;
 	ProfilerNode m_root;
 	ProfilerNode* m_curNode;
 
-	int m_iNumNodes;
-	ProfilerNode m_nodes[VPROF_MAX_NUM_NODES];
+	// arena
+	std::vector<ProfilerNode*> m_nodeBlocks;
+	std::atomic<int> m_iNumNodes;
+
+	// trace ring buffer, allocated on the first event
+	TRACE_SLOT* m_traceEvents;
+	std::atomic<unsigned long long> m_iNumTraceEvents;
+
+	// performance counter group of the owning thread
+	unsigned int m_iCounterConfig;
+	int m_counterFds[(int)PROFILER_COUNTER::COUNT]; // in PROFILER_COUNTER order, -1 if not enabled, the first open one leads the group
+	int m_iCounterGroupFd;
+
+	// allocation tracking, written by the owning thread only
+	std::atomic<unsigned long long> m_iNumAllocations;
+	std::atomic<unsigned long long> m_iAllocatedBytes;
+	std::atomic<int> m_iAllocationsFrame[2];
+	std::atomic<long long> m_iAllocatedBytesFrame[2];
+
+	std::atomic<unsigned int> m_iFrame;
+	std::atomic<const char*> m_threadName;
+	std::atomic<bool> m_bThreadExited;
+	ProfilerProfile* m_nextProfile;
 };
 
-extern ProfilerProfile g_profCurrentProfile;
+// vprof_hitch_capture: keeps tracing on, and whenever a frame of the main thread takes much longer than the median of the recent frames,
+// saves the trace around it (vprof_hitch_window before, vprof_hitch_postroll after) to disk and logs the scope which took the most time
+class ProfilerHitchCapture {
+public:
+	static inline void onMainFrame() {
+		if (s_bEnabled.load(std::memory_order_relaxed))
+			update();
+	}
+
+	static void setEnabled(bool enabled);
+
+private:
+	static void update();
+	static void capture();
+
+	static std::atomic<bool> s_bEnabled;
+};
 
 class ProfilerScope {
 public:
-	inline ProfilerScope(const char* name, const char* group) { g_profCurrentProfile.enterScope(name, group); }
-	inline ~ProfilerScope() { g_profCurrentProfile.exitScope(); }
+	inline ProfilerScope(const char* name, const char* group) : m_profile(ProfilerProfile::get()) { m_profile->enterScope(name, group); }
+	inline ~ProfilerScope() { m_profile->exitScope(); }
+
+private:
+	ProfilerProfile* m_profile;
 };
 
 #endif // !PROFILER_H
@@ -0,0 +1,405 @@
+#include "SamplingProfiler.h"
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+
+std::atomic<bool> SamplingProfiler::s_bRunning(false);
+
+#ifdef __linux__
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <ucontext.h>
+#include <sys/syscall.h>
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+// samples are variable length records in one flat buffer: [tid << 16 | depth] [depth addresses, leaf first]
+static uintptr_t* g_samples = NULL;
+static size_t g_iSampleCapacity = 0; // in words
+static std::atomic<size_t> g_iSampleCursor(0);
+static std::atomic<unsigned long long> g_iNumSamples(0);
+static std::atomic<unsigned long long> g_iNumDroppedSamples(0);
+static std::atomic<bool> g_bSampling(false);
+static std::atomic<int> g_iNumHandlersRunning(0);
+
+static bool g_bHandlerInstalled = false;
+static long long g_iIntervalNs = 0;
+
+// one timer per thread, on the cpu clock of that thread
+static std::mutex g_threadsMutex;
+static std::map<pid_t, timer_t> g_threadTimers;
+static std::map<pid_t, std::string> g_threadNames; // every thread which was sampled, for the output
+
+static std::thread g_scanThread;
+static std::mutex g_scanMutex;
+static std::condition_variable g_scanCondition;
+static bool g_bStopScan = false;
+
+static void _sigprofHandler(int signal, siginfo_t* info, void* context) {
+	// async signal safe only: no locks, no allocations (backtrace() was called once before the first signal)
+	const int savedErrno = errno;
+	g_iNumHandlersRunning++;
+
+	if (g_bSampling.load()) {
+		void* frames[VPROF_SAMPLE_MAX_DEPTH + 8];
+		const int numFrames = backtrace(frames, VPROF_SAMPLE_MAX_DEPTH + 8);
+
+		// skip this handler and the signal trampoline, the first frame is the interrupted instruction
+		int first = std::min(2, numFrames);
+#if defined(__x86_64__)
+		const uintptr_t pc = (uintptr_t)((ucontext_t*)context)->uc_mcontext.gregs[REG_RIP];
+		for (int i = 0; i < numFrames && i < 8; i++) {
+			if ((uintptr_t)frames[i] == pc) {
+				first = i;
+				break;
+			}
+		}
+#endif
+		const int depth = std::min(numFrames - first, VPROF_SAMPLE_MAX_DEPTH);
+		const size_t index = (depth > 0 ? g_iSampleCursor.fetch_add((size_t)depth + 1, std::memory_order_relaxed) : 0); // nothing is reserved for an empty stack
+		if (depth < 1 || index + depth + 1 > g_iSampleCapacity)
+			g_iNumDroppedSamples.fetch_add(1, std::memory_order_relaxed);
+		else {
+			g_samples[index] = ((uintptr_t)syscall(SYS_gettid) << 16) | (uintptr_t)depth;
+			for (int i = 0; i < depth; i++) {
+				g_samples[index + 1 + i] = (uintptr_t)frames[first + i];
+			}
+			g_iNumSamples.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	g_iNumHandlersRunning--;
+	errno = savedErrno;
+}
+
+static std::string _readThreadName(pid_t tid) {
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/self/task/%i/comm", (int)tid);
+
+	char name[64] = "";
+	FILE* file = fopen(path, "r");
+	if (file != NULL) {
+		if (fgets(name, sizeof(name), file) == NULL)
+			name[0] = '\0';
+		fclose(file);
+	}
+	name[strcspn(name, "\n")] = '\0';
+
+	if (name[0] == '\0')
+		snprintf(name, sizeof(name), "thread %i", (int)tid);
+	return name;
+}
+
+static bool _createThreadTimer(pid_t tid, timer_t& timer) {
+	struct sigevent event;
+	memset(&event, 0, sizeof(event));
+	event.sigev_notify = SIGEV_THREAD_ID;
+	event.sigev_signo = SIGPROF;
+	event.sigev_notify_thread_id = tid;
+
+	// MAKE_THREAD_CPUCLOCK(tid, CPUCLOCK_SCHED) from the kernel, the cpu clock of any thread of this process
+	const clockid_t clock = (clockid_t)((~(unsigned int)tid) << 3) | 6;
+	if (timer_create(clock, &event, &timer) != 0)
+		return false;
+
+	struct itimerspec spec;
+	spec.it_interval.tv_sec = (time_t)(g_iIntervalNs / 1000000000LL);
+	spec.it_interval.tv_nsec = (long)(g_iIntervalNs % 1000000000LL);
+	spec.it_value = spec.it_interval;
+	if (timer_settime(timer, 0, &spec, NULL) != 0) {
+		timer_delete(timer);
+		return false;
+	}
+	return true;
+}
+
+// g_threadsMutex must be locked
+static void _scanThreads() {
+	DIR* dir = opendir("/proc/self/task");
+	if (dir == NULL) return;
+
+	std::vector<pid_t> threads;
+	for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+		const pid_t tid = (pid_t)atoi(entry->d_name);
+		if (tid < 1) continue; // "." and ".."
+
+		threads.push_back(tid);
+		if (g_threadTimers.find(tid) != g_threadTimers.end()) continue;
+
+		timer_t timer;
+		if (_createThreadTimer(tid, timer)) {
+			g_threadTimers[tid] = timer;
+			g_threadNames[tid] = _readThreadName(tid);
+		}
+	}
+	closedir(dir);
+
+	for (auto it = g_threadTimers.begin(); it != g_threadTimers.end();) {
+		if (std::find(threads.begin(), threads.end(), it->first) == threads.end()) {
+			timer_delete(it->second);
+			it = g_threadTimers.erase(it);
+		}
+		else
+			it++;
+	}
+}
+
+static const std::string& _symbolize(std::unordered_map<uintptr_t, std::string>& symbols, uintptr_t address) {
+	auto it = symbols.find(address);
+	if (it != symbols.end())
+		return it->second;
+
+	std::string& symbol = symbols[address];
+	char buffer[512];
+	Dl_info info = {};
+	const bool found = (dladdr((void*)address, &info) != 0); // info is only valid if found
+	if (found && info.dli_sname != NULL) {
+		int status = 0;
+		char* demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+		symbol = (status == 0 && demangled != NULL ? demangled : info.dli_sname);
+		free(demangled);
+	}
+	else if (found && info.dli_fname != NULL) {
+		const char* module = strrchr(info.dli_fname, '/');
+		snprintf(buffer, sizeof(buffer), "%s+0x%zx", module != NULL ? module + 1 : info.dli_fname, (size_t)(address - (uintptr_t)info.dli_fbase));
+		symbol = buffer;
+	}
+	else {
+		snprintf(buffer, sizeof(buffer), "0x%zx", (size_t)address);
+		symbol = buffer;
+	}
+
+	// ';' separates frames in the folded format
+	std::replace(symbol.begin(), symbol.end(), ';', ':');
+	return symbol;
+}
+
+bool SamplingProfiler::isSupported() {
+	return true;
+}
+
+bool SamplingProfiler::start(int sampleRate, size_t bufferSize) {
+	if (isRunning()) return false;
+
+	// the buffer is only touched by the signal handler while sampling, and is kept for writeFoldedStacks() afterwards
+	const size_t capacity = std::max(bufferSize / sizeof(uintptr_t), (size_t)VPROF_SAMPLE_MAX_DEPTH + 1);
+	if (capacity != g_iSampleCapacity) {
+		delete[] g_samples;
+		g_samples = new uintptr_t[capacity];
+		g_iSampleCapacity = capacity;
+	}
+	memset(g_samples, 0, capacity * sizeof(uintptr_t)); // also faults in every page before the first signal
+	g_iSampleCursor = 0;
+	g_iNumSamples = 0;
+	g_iNumDroppedSamples = 0;
+	g_threadNames.clear();
+
+	// backtrace() loads libgcc on its first call, which must not happen inside of the signal handler
+	void* warmup[4];
+	backtrace(warmup, 4);
+
+	if (!g_bHandlerInstalled) {
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_sigaction = _sigprofHandler;
+		action.sa_flags = SA_SIGINFO | SA_RESTART;
+		sigemptyset(&action.sa_mask);
+		if (sigaction(SIGPROF, &action, NULL) != 0) {
+			debugLog("SamplingProfiler: sigaction() failed (%i)\n", errno);
+			return false;
+		}
+
+		// never uninstalled, a SIGPROF which is still pending after stop() would otherwise terminate the process
+		g_bHandlerInstalled = true;
+	}
+
+	g_iIntervalNs = 1000000000LL / std::clamp(sampleRate, 1, 10000);
+	g_bSampling = true;
+	s_bRunning = true;
+	{
+		std::lock_guard<std::mutex> lock(g_threadsMutex);
+		_scanThreads();
+	}
+
+	// picks up threads which are started (and drops the ones which exit) while sampling
+	g_bStopScan = false;
+	g_scanThread = std::thread([]() {
+		std::unique_lock<std::mutex> scanLock(g_scanMutex);
+		while (!g_bStopScan) {
+			g_scanCondition.wait_for(scanLock, std::chrono::milliseconds(50));
+			if (g_bStopScan) break;
+
+			std::lock_guard<std::mutex> lock(g_threadsMutex);
+			_scanThreads();
+		}
+	});
+
+	return true;
+}
+
+void SamplingProfiler::stop() {
+	if (!isRunning()) return;
+
+	g_bSampling = false;
+	{
+		std::lock_guard<std::mutex> lock(g_scanMutex);
+		g_bStopScan = true;
+	}
+	g_scanCondition.notify_all();
+	g_scanThread.join();
+
+	{
+		std::lock_guard<std::mutex> lock(g_threadsMutex);
+		for (auto it = g_threadTimers.begin(); it != g_threadTimers.end(); it++) {
+			timer_delete(it->second);
+		}
+		g_threadTimers.clear();
+	}
+
+	// handlers which saw g_bSampling before it was cleared may still be writing
+	while (g_iNumHandlersRunning.load() > 0) {
+		std::this_thread::yield();
+	}
+
+	s_bRunning = false;
+}
+
+int SamplingProfiler::writeFoldedStacks(const char* filePath) {
+	if (isRunning() || g_samples == NULL) return -1;
+
+	// symbolization happens here, outside of the signal handler
+	std::unordered_map<uintptr_t, std::string> symbols;
+	std::unordered_map<std::string, unsigned int> stacks;
+	std::string stack;
+
+	const size_t end = std::min(g_iSampleCursor.load(), g_iSampleCapacity);
+	int numSamples = 0;
+	for (size_t pos = 0; pos < end;) {
+		const uintptr_t header = g_samples[pos];
+		const int depth = (int)(header & 0xffff);
+		if (depth < 1) {
+			// never written (the sample didn't fit into the buffer anymore), the buffer was zeroed in start()
+			pos++;
+			continue;
+		}
+		if (pos + 1 + depth > end) break;
+
+		const pid_t tid = (pid_t)(header >> 16);
+		auto threadName = g_threadNames.find(tid);
+		stack = (threadName != g_threadNames.end() ? threadName->second : _readThreadName(tid));
+
+		// root first, return addresses point behind the call, so look up the call itself
+		for (int i = depth - 1; i >= 0; i--) {
+			const uintptr_t address = g_samples[pos + 1 + i];
+			stack += ';';
+			stack += _symbolize(symbols, i > 0 ? address - 1 : address);
+		}
+
+		stacks[stack]++;
+		numSamples++;
+		pos += 1 + depth;
+	}
+
+	std::vector<std::pair<std::string, unsigned int>> sortedStacks(stacks.begin(), stacks.end());
+	std::sort(sortedStacks.begin(), sortedStacks.end());
+
+	std::ofstream out(filePath, std::ios::out | std::ios::trunc);
+	if (!out.good())
+		return -1;
+
+	for (size_t i = 0; i < sortedStacks.size(); i++) {
+		out << sortedStacks[i].first << ' ' << sortedStacks[i].second << '\n';
+	}
+
+	return numSamples;
+}
+
+unsigned long long SamplingProfiler::getNumSamples() {
+	return g_iNumSamples.load();
+}
+
+unsigned long long SamplingProfiler::getNumDroppedSamples() {
+	return g_iNumDroppedSamples.load();
+}
+
+#else
+
+bool SamplingProfiler::isSupported() {
+	return false;
+}
+
+bool SamplingProfiler::start(int sampleRate, size_t bufferSize) {
+	return false;
+}
+
+void SamplingProfiler::stop() {
+	;
+}
+
+int SamplingProfiler::writeFoldedStacks(const char* filePath) {
+	return -1;
+}
+
+unsigned long long SamplingProfiler::getNumSamples() {
+	return 0;
+}
+
+unsigned long long SamplingProfiler::getNumDroppedSamples() {
+	return 0;
+}
+
+#endif
+
+
+
+//**************//
+//	Commands    //
+//**************//
+
+ConVar _vprof_sample_rate("vprof_sample_rate", 997, "samples per second of cpu time, per thread (prime, so that it does not beat with 1 ms timers)");
+ConVar _vprof_sample_buffer_mb("vprof_sample_buffer_mb", 64, "size of the sample buffer, allocated on vprof_sample_start, samples which don't fit are dropped");
+ConVar _vprof_sample_file("vprof_sample_file", "vprof_samples.folded", "folded stacks written by vprof_sample_stop");
+
+void _vprof_sample_start(UString args) {
+	if (!SamplingProfiler::isSupported()) {
+		debugLog("SamplingProfiler: only available on linux\n");
+		return;
+	}
+
+	const int sampleRate = (args.length() > 0 ? args.toInt() : _vprof_sample_rate.getInt());
+	if (SamplingProfiler::start(sampleRate, (size_t)std::max(_vprof_sample_buffer_mb.getInt(), 1) * 1024 * 1024))
+		debugLog("SamplingProfiler: sampling all threads at %i Hz, vprof_sample_stop to stop\n", sampleRate);
+	else
+		debugLog("SamplingProfiler: can't start (already running?)\n");
+}
+
+void _vprof_sample_stop(UString args) {
+	if (!SamplingProfiler::isRunning()) {
+		debugLog("SamplingProfiler: not running\n");
+		return;
+	}
+
+	SamplingProfiler::stop();
+
+	const UString filePath = (args.length() > 0 ? args : _vprof_sample_file.getString());
+	const int numSamples = SamplingProfiler::writeFoldedStacks(filePath.toUtf8());
+	if (numSamples < 0)
+		debugLog("SamplingProfiler: can't write %s\n", filePath.toUtf8());
+	else
+		debugLog("SamplingProfiler: wrote %i samples (%llu dropped) as folded stacks to %s\n", numSamples, SamplingProfiler::getNumDroppedSamples(), filePath.toUtf8());
+}
+
+ConVar _vprof_sample_start_("vprof_sample_start", "starts sampling the call stacks of all threads (linux only), the argument overrides vprof_sample_rate", _vprof_sample_start);
+ConVar _vprof_sample_stop_("vprof_sample_stop", "stops sampling and writes folded stacks (flamegraph.pl, speedscope) to vprof_sample_file or the given file", _vprof_sample_stop);
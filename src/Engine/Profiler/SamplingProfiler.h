@@ -0,0 +1,31 @@
+#ifndef SAMPLINGPROFILER_H
+#define SAMPLINGPROFILER_H
+
+#include "cbase.h"
+
+#define VPROF_SAMPLE_MAX_DEPTH 128
+
+// statistical profiler for code without VPROF scopes (linux only, see vprof_sample_start/vprof_sample_stop)
+// every thread of the process gets a timer on its own cpu clock which sends it SIGPROF, the handler unwinds the stack into a buffer which is
+// allocated up front, threads which are started while sampling are picked up by a background scan of /proc/self/task
+// symbolization only happens after stopping, the result is written as folded stacks (flamegraph.pl, speedscope, inferno)
+// link with -rdynamic to get names for non-exported functions, otherwise frames show up as module+offset (addr2line can resolve those)
+class SamplingProfiler {
+public:
+	static bool isSupported();
+
+	static bool start(int sampleRate, size_t bufferSize); // sampleRate in Hz per thread (of cpu time), bufferSize in bytes
+	static void stop();
+	static inline bool isRunning() { return s_bRunning.load(std::memory_order_relaxed); }
+
+	// after stop(), returns the number of samples written or -1
+	static int writeFoldedStacks(const char* filePath);
+
+	static unsigned long long getNumSamples();
+	static unsigned long long getNumDroppedSamples();
+
+private:
+	static std::atomic<bool> s_bRunning;
+};
+
+#endif // !SAMPLINGPROFILER_H
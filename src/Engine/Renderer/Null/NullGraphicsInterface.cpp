@@ -1 +1,265 @@
 #include "NullGraphicsInterface.h"
+
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "VertexArrayObject/VertexArrayObject.h"
+
+#include "NullImage.h"
+#include "NullRenderTarget.h"
+#include "NullShader.h"
+
+ConVar _r_null_stats_csv("r_null_stats_csv", "", "if set, NullGraphicsInterface appends one row of draw statistics per frame to this csv file");
+
+ConVar* NullGraphicsInterface::r_null_stats_csv = &_r_null_stats_csv;
+
+const char* NullGraphicsInterface::drawCallTypeToString(DRAWCALL_TYPE type) {
+	switch (type) {
+	case DRAWCALL_TYPE::DRAWCALL_PIXELS:
+		return "pixels";
+	case DRAWCALL_TYPE::DRAWCALL_PIXEL:
+		return "pixel";
+	case DRAWCALL_TYPE::DRAWCALL_LINE:
+		return "line";
+	case DRAWCALL_TYPE::DRAWCALL_RECT:
+		return "rect";
+	case DRAWCALL_TYPE::DRAWCALL_FILLRECT:
+		return "fillrect";
+	case DRAWCALL_TYPE::DRAWCALL_ROUNDEDRECT:
+		return "roundedrect";
+	case DRAWCALL_TYPE::DRAWCALL_GRADIENT:
+		return "gradient";
+	case DRAWCALL_TYPE::DRAWCALL_QUAD:
+		return "quad";
+	case DRAWCALL_TYPE::DRAWCALL_IMAGE:
+		return "image";
+	case DRAWCALL_TYPE::DRAWCALL_IMAGE_INSTANCED:
+		return "image_instanced";
+	case DRAWCALL_TYPE::DRAWCALL_STRING:
+		return "string";
+	case DRAWCALL_TYPE::DRAWCALL_VAO:
+		return "vao";
+	case DRAWCALL_TYPE::DRAWCALL_COUNT:
+		break;
+	}
+	return "unknown";
+}
+
+NullGraphicsInterface::NullGraphicsInterface() : Graphics() {
+	m_currentStats = DRAW_STATS();
+	m_lastFrameStats = DRAW_STATS();
+	m_iNumFrames = 0;
+
+	m_bBlending = true;
+	m_blendMode = BLEND_MODE::BLEND_MODE_ALPHA;
+	m_bClipping = false;
+}
+
+void NullGraphicsInterface::beginScene() {
+	m_currentStats = DRAW_STATS();
+	m_uniqueTextures.clear();
+}
+
+void NullGraphicsInterface::endScene() {
+	m_currentStats.numUniqueTextures = (unsigned int)m_uniqueTextures.size();
+	m_lastFrameStats = m_currentStats;
+	m_iNumFrames++;
+
+	writeCSV();
+}
+
+void NullGraphicsInterface::drawImage(Image* image) {
+	countDrawCall(DRAWCALL_TYPE::DRAWCALL_IMAGE);
+	if (image == NULL) return;
+
+	m_currentStats.numImages++;
+	onTextureBind(image);
+}
+
+void NullGraphicsInterface::drawImageInstanced(Image* image, const SPRITE_INSTANCE* instances, int numInstances) {
+	countDrawCall(DRAWCALL_TYPE::DRAWCALL_IMAGE_INSTANCED);
+	if (image == NULL || numInstances < 1) return;
+
+	m_currentStats.numInstances += (unsigned int)numInstances;
+	onTextureBind(image);
+}
+
+void NullGraphicsInterface::drawString(TacoFont* font, UString text) {
+	countDrawCall(DRAWCALL_TYPE::DRAWCALL_STRING);
+	m_currentStats.numStringCharacters += (unsigned int)text.length();
+}
+
+void NullGraphicsInterface::drawVAO(VertexArrayObject* vao) {
+	countDrawCall(DRAWCALL_TYPE::DRAWCALL_VAO);
+	if (vao == NULL) return;
+
+	m_currentStats.numVAOVertices += vao->getNumVerticies();
+}
+
+void NullGraphicsInterface::setBlending(bool enabled) {
+	if (enabled == m_bBlending) return;
+
+	m_bBlending = enabled;
+	m_currentStats.numBlendChanges++;
+}
+
+void NullGraphicsInterface::setBlendMode(BLEND_MODE blendMode) {
+	if (blendMode == m_blendMode) return;
+
+	m_blendMode = blendMode;
+	m_currentStats.numBlendChanges++;
+}
+
+void NullGraphicsInterface::setClipRect(Rects clipRect) {
+	// like the blend state, only what a real backend would have to change counts
+	const bool changed = (!m_bClipping || clipRect.getMinX() != m_clipRect.getMinX() || clipRect.getMinY() != m_clipRect.getMinY() || clipRect.getMaxX() != m_clipRect.getMaxX() || clipRect.getMaxY() != m_clipRect.getMaxY());
+
+	m_clipRect = clipRect;
+	m_bClipping = true;
+	if (changed)
+		m_currentStats.numClipChanges++;
+}
+
+void NullGraphicsInterface::pushClipRect(Rects clipRect) {
+	if (m_clipRectStack.size() > 0)
+		m_clipRectStack.push(m_clipRectStack.top().intersect(clipRect));
+	else
+		m_clipRectStack.push(clipRect);
+
+	setClipRect(m_clipRectStack.top());
+}
+
+void NullGraphicsInterface::popClipRect() {
+	if (m_clipRectStack.size() < 1) return;
+
+	m_clipRectStack.pop();
+
+	if (m_clipRectStack.size() > 0)
+		setClipRect(m_clipRectStack.top());
+	else
+		setClipping(false);
+}
+
+void NullGraphicsInterface::setClipping(bool enabled) {
+	if (enabled == m_bClipping) return;
+
+	m_bClipping = enabled;
+	m_currentStats.numClipChanges++;
+}
+
+UString NullGraphicsInterface::getVendor() {
+	return "NULL";
+}
+
+UString NullGraphicsInterface::getModel() {
+	return "NULL";
+}
+
+UString NullGraphicsInterface::getVersion() {
+	return "NULL";
+}
+
+Image* NullGraphicsInterface::createImage(UString filePath, bool mipmapped, bool keepInSystemMemory) {
+	return new NullImage(this, filePath, mipmapped, keepInSystemMemory);
+}
+
+Image* NullGraphicsInterface::createImage(int width, int height, bool mipmapped, bool keepInSystemMemory) {
+	return new NullImage(this, width, height, mipmapped, keepInSystemMemory);
+}
+
+RenderTarget* NullGraphicsInterface::createRenderTarget(int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType) {
+	return new NullRenderTarget(this, x, y, width, height, multiSampleType);
+}
+
+Shader* NullGraphicsInterface::createShaderFromFile(UString vertexShaderFilePath, UString fragmentShaderFilePath) {
+	return new NullShader(vertexShaderFilePath, fragmentShaderFilePath, false);
+}
+
+Shader* NullGraphicsInterface::createShaderFromSource(UString vertexShader, UString fragmentShader) {
+	return new NullShader(vertexShader, fragmentShader, true);
+}
+
+VertexArrayObject* NullGraphicsInterface::createVertexArrayObject(Graphics::PRIMITIVE primitive, Graphics::USAGE_TYPE usage, bool keepInSystemMemory) {
+	return new VertexArrayObject(primitive, usage, keepInSystemMemory);
+}
+
+void NullGraphicsInterface::onTextureBind(const void* texture) {
+	m_currentStats.numTextureBinds++;
+	m_uniqueTextures.insert(texture);
+}
+
+void NullGraphicsInterface::dumpDrawStats() {
+	const DRAW_STATS& stats = m_lastFrameStats;
+
+	debugLog("NullGraphicsInterface: frame %llu\n", m_iNumFrames);
+	debugLog("  draw calls = %u\n", stats.numDrawCalls);
+	for (int i = 0; i < (int)DRAWCALL_TYPE::DRAWCALL_COUNT; i++) {
+		if (stats.drawCalls[i] > 0)
+			debugLog("    %s = %u\n", drawCallTypeToString((DRAWCALL_TYPE)i), stats.drawCalls[i]);
+	}
+	debugLog("  images = %u, instances = %u, unique textures = %u, texture binds = %u\n", stats.numImages, stats.numInstances, stats.numUniqueTextures, stats.numTextureBinds);
+	debugLog("  state changes: blend = %u, clip = %u, stencil = %u\n", stats.numBlendChanges, stats.numClipChanges, stats.numStencilChanges);
+	debugLog("  vao vertices = %u, string characters = %u\n", stats.numVAOVertices, stats.numStringCharacters);
+	debugLog("  transform updates = %u, max transform depth = %u\n", stats.numTransformUpdates, stats.maxTransformDepth);
+}
+
+void NullGraphicsInterface::countDrawCall(DRAWCALL_TYPE type) {
+	m_currentStats.drawCalls[(int)type]++;
+	m_currentStats.numDrawCalls++;
+
+	// like the real renderers, so numTransformUpdates counts the distinct transforms used for drawing
+	updateTransform();
+
+	// the bottom of the stack is the identity, only count actual pushes
+	const unsigned int transformDepth = (unsigned int)getTransformDepth();
+	if (transformDepth > m_currentStats.maxTransformDepth)
+		m_currentStats.maxTransformDepth = transformDepth;
+}
+
+void NullGraphicsInterface::writeCSV() {
+	const UString filePath = r_null_stats_csv->getString();
+
+	// (re)open on change, the header is written once per file
+	if (filePath != m_sCSVFilePath) {
+		if (m_csv.is_open())
+			m_csv.close();
+
+		m_sCSVFilePath = filePath;
+		if (m_sCSVFilePath.length() < 1) return;
+
+		m_csv.open(m_sCSVFilePath.toUtf8(), std::ios::out | std::ios::trunc);
+		if (!m_csv.good()) {
+			debugLog("NullGraphicsInterface: Couldn't open %s for writing!\n", m_sCSVFilePath.toUtf8());
+			return;
+		}
+
+		m_csv << "frame,draw_calls";
+		for (int i = 0; i < (int)DRAWCALL_TYPE::DRAWCALL_COUNT; i++) {
+			m_csv << "," << drawCallTypeToString((DRAWCALL_TYPE)i);
+		}
+		m_csv << ",images,instances,unique_textures,texture_binds,blend_changes,clip_changes,stencil_changes,vao_vertices,string_characters,transform_updates,max_transform_depth\n";
+	}
+	if (!m_csv.is_open() || !m_csv.good()) return;
+
+	const DRAW_STATS& stats = m_lastFrameStats;
+	m_csv << m_iNumFrames << "," << stats.numDrawCalls;
+	for (int i = 0; i < (int)DRAWCALL_TYPE::DRAWCALL_COUNT; i++) {
+		m_csv << "," << stats.drawCalls[i];
+	}
+	m_csv << "," << stats.numImages << "," << stats.numInstances << "," << stats.numUniqueTextures << "," << stats.numTextureBinds
+		<< "," << stats.numBlendChanges << "," << stats.numClipChanges << "," << stats.numStencilChanges
+		<< "," << stats.numVAOVertices << "," << stats.numStringCharacters
+		<< "," << stats.numTransformUpdates << "," << stats.maxTransformDepth << "\n";
+	m_csv.flush();
+}
+
+void _r_null_stats_dump(void) {
+	NullGraphicsInterface* g = dynamic_cast<NullGraphicsInterface*>(engine->getGraphics());
+	if (g == NULL) {
+		debugLog("r_null_stats_dump: The null renderer is not active.\n");
+		return;
+	}
+
+	g->dumpDrawStats();
+}
+
+ConVar _r_null_stats_dump_("r_null_stats_dump", "prints the draw statistics of the last frame rendered by NullGraphicsInterface", _r_null_stats_dump);
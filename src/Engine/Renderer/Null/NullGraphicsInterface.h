@@ -1,51 +1,92 @@
 #ifndef NULLGRAPHICSINTERFACE_H
 #define NULLGRAPHICSINTERFACE_H
 
-#include "Graphics/Graphics.h"
+#include "cbase.h"
 
+// does not render anything, but counts per-frame draw statistics (gpu-free perf regression tracking)
 class NullGraphicsInterface : public Graphics {
 public:
-	NullGraphicsInterface() : Graphics() { ; }
+	enum class DRAWCALL_TYPE {
+		DRAWCALL_PIXELS,
+		DRAWCALL_PIXEL,
+		DRAWCALL_LINE,
+		DRAWCALL_RECT,
+		DRAWCALL_FILLRECT,
+		DRAWCALL_ROUNDEDRECT,
+		DRAWCALL_GRADIENT,
+		DRAWCALL_QUAD,
+		DRAWCALL_IMAGE,
+		DRAWCALL_IMAGE_INSTANCED,
+		DRAWCALL_STRING,
+		DRAWCALL_VAO,
+		DRAWCALL_COUNT // not a type
+	};
+
+	struct DRAW_STATS {
+		unsigned int drawCalls[(int)DRAWCALL_TYPE::DRAWCALL_COUNT];
+		unsigned int numDrawCalls;
+
+		unsigned int numImages;
+		unsigned int numInstances;
+		unsigned int numUniqueTextures;
+		unsigned int numTextureBinds;
+
+		unsigned int numBlendChanges;
+		unsigned int numClipChanges;
+		unsigned int numStencilChanges;
+
+		unsigned int numVAOVertices;
+		unsigned int numStringCharacters;
+
+		unsigned int numTransformUpdates;
+		unsigned int maxTransformDepth;
+	};
+
+	static const char* drawCallTypeToString(DRAWCALL_TYPE type);
+
+public:
+	NullGraphicsInterface();
 	virtual ~NullGraphicsInterface() { ; }
 
-	virtual void beginScene() { ; }
-	virtual void endScene() { ; }
+	virtual void beginScene();
+	virtual void endScene();
 
 	virtual void clearDepthBuffer() { ; }
 
 	virtual void setColor(Color color) { ; }
 	virtual void setAlpha(float alpha) { ; }
 
-	virtual void drawPixels(int x, int y, int width, int height, Graphics::DRAWPIXELS_TYPE type, const void* pixels) { ; }
-	virtual void drawPixel(int x, int y) { ; }
-	virtual void drawLine(int x1, int y1, int x2, int y2) { ; }
-	virtual void drawLine(Vector2 pos1, Vector2 pos2) { ; }
-	virtual void drawRect(int x, int y, int width, int height) { ; }
-	virtual void drawRect(int x, int y, int width, int height, Color top, Color right, Color bottom, Color left) { ; }
+	virtual void drawPixels(int x, int y, int width, int height, Graphics::DRAWPIXELS_TYPE type, const void* pixels) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_PIXELS); }
+	virtual void drawPixel(int x, int y) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_PIXEL); }
+	virtual void drawLine(int x1, int y1, int x2, int y2) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_LINE); }
+	virtual void drawLine(Vector2 pos1, Vector2 pos2) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_LINE); }
+	virtual void drawRect(int x, int y, int width, int height) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_RECT); }
+	virtual void drawRect(int x, int y, int width, int height, Color top, Color right, Color bottom, Color left) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_RECT); }
 
-	virtual void fillRect(int x, int y, int width, int height) { ; }
-	virtual void fillRoundedRect(int x, int y, int width, int height, int radius) { ; }
-	virtual void fillGradient(int x, int y, int width, int height, Color topLeftColor, Color topRightColor, Color bottomLeftColor, Color bottomRightColor) { ; }
+	virtual void fillRect(int x, int y, int width, int height) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_FILLRECT); }
+	virtual void fillRoundedRect(int x, int y, int width, int height, int radius) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_ROUNDEDRECT); }
+	virtual void fillGradient(int x, int y, int width, int height, Color topLeftColor, Color topRightColor, Color bottomLeftColor, Color bottomRightColor) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_GRADIENT); }
 
-	virtual void drawQuad(int x, int y, int width, int height) { ; }
-	virtual void drawQuad(Vector2 topLeft, Vector2 topRight, Vector2 bottomRight, Vector2 bottomLeft, Color topLeftColor, Color topRightColor, Color bottomRightColor, Color bottomLeftColor) { ; }
+	virtual void drawQuad(int x, int y, int width, int height) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_QUAD); }
+	virtual void drawQuad(Vector2 topLeft, Vector2 topRight, Vector2 bottomRight, Vector2 bottomLeft, Color topLeftColor, Color topRightColor, Color bottomRightColor, Color bottomLeftColor) { countDrawCall(DRAWCALL_TYPE::DRAWCALL_QUAD); }
 
-	virtual void drawImage(Image* image) { ; }
+	virtual void drawImage(Image* image);
+	virtual void drawImageInstanced(Image* image, const SPRITE_INSTANCE* instances, int numInstances);
 	virtual void drawString(TacoFont* font, UString text);
 
-	virtual void drawVAO(VertexArrayObject* vao) { ; }
+	virtual void drawVAO(VertexArrayObject* vao);
 
-	virtual void setClipRect(Rects clipRect) { ; }
-	virtual void pushClipRect(Rects clipRect) { ; }
-	virtual void popClipRect() { ; }
+	virtual void setClipRect(Rects clipRect);
+	virtual void pushClipRect(Rects clipRect);
+	virtual void popClipRect();
 
-	virtual void pushStencil() { ; }
-	virtual void fillStencil(bool inside) { ; }
-	virtual void popStencil() { ; }
+	virtual void pushStencil() { m_currentStats.numStencilChanges++; }
+	virtual void fillStencil(bool inside) { m_currentStats.numStencilChanges++; }
+	virtual void popStencil() { m_currentStats.numStencilChanges++; }
 
-	virtual void setClipping(bool enabled) { ; }
-	virtual void setBlending(bool enabled) { ; }
-	virtual void setBlendMode(BLEND_MODE blendMode) { ; }
+	virtual void setClipping(bool enabled);
+	virtual void setBlending(bool enabled);
+	virtual void setBlendMode(BLEND_MODE blendMode);
 	virtual void setDepthBuffer(bool enabled) { ; }
 	virtual void setCulling(bool culling) { ; }
 	virtual void setVSync(bool vsync) { ; }
@@ -71,12 +112,39 @@ public:
 	virtual Shader* createShaderFromSource(UString vertexShader, UString fragmentShader);
 	virtual VertexArrayObject* createVertexArrayObject(Graphics::PRIMITIVE primitive, Graphics::USAGE_TYPE usage, bool keepInSystemMemory);
 
+	// stats
+	void onTextureBind(const void* texture); // called by NullImage/NullRenderTarget
+	void dumpDrawStats();
+	inline const DRAW_STATS& getDrawStats() const { return m_lastFrameStats; } // last completed frame
+	inline unsigned long long getNumFrames() const { return m_iNumFrames; }
+
 protected:
 	virtual void init() { ; }
-	virtual void onTransformUpdate(Matrix4& projectionMatrix, Matrix4& worldMatrix) { ; }
+	virtual void onTransformUpdate(Matrix4& projectionMatrix, Matrix4& worldMatrix) { m_currentStats.numTransformUpdates++; }
 
 private:
+	static ConVar* r_null_stats_csv;
+
+	void countDrawCall(DRAWCALL_TYPE type);
+	void writeCSV();
+
 	Vector2 m_vResolution;
+
+	// stats
+	DRAW_STATS m_currentStats;
+	DRAW_STATS m_lastFrameStats;
+	std::unordered_set<const void*> m_uniqueTextures;
+	unsigned long long m_iNumFrames;
+
+	bool m_bBlending;
+	BLEND_MODE m_blendMode;
+
+	bool m_bClipping;
+	Rects m_clipRect;
+	std::stack<Rects> m_clipRectStack;
+
+	UString m_sCSVFilePath;
+	std::ofstream m_csv;
 };
 
 #endif // !NULLGRAPHICSINTERFACE_H
@@ -1 +1,8 @@
 #include "NullImage.h"
+
+#include "NullGraphicsInterface.h"
+
+void NullImage::bind(unsigned int textureUnit) {
+	if (m_graphics != NULL)
+		m_graphics->onTextureBind(this);
+}
@@ -3,14 +3,16 @@
 
 #include "Image/Image.h"
 
+class NullGraphicsInterface;
+
 class NullImage : public Image
 {
 public:
-	NullImage(UString filePath, bool mipmapped = false, bool keepInSystemMemory = false) : Image(filePath, mipmapped, keepInSystemMemory) { ; }
-	NullImage(int width, int height, bool mipmapped = false, bool keepInSystemMemory = false) : Image(width, height, mipmapped, keepInSystemMemory) { ; }
+	NullImage(NullGraphicsInterface* graphics, UString filePath, bool mipmapped = false, bool keepInSystemMemory = false) : Image(filePath, mipmapped, keepInSystemMemory) { m_graphics = graphics; }
+	NullImage(NullGraphicsInterface* graphics, int width, int height, bool mipmapped = false, bool keepInSystemMemory = false) : Image(width, height, mipmapped, keepInSystemMemory) { m_graphics = graphics; }
 	virtual ~NullImage() { destroy(); }
 
-	virtual void bind(unsigned int textureUnit = 0) { ; }
+	virtual void bind(unsigned int textureUnit = 0);
 	virtual void unbind() { ; }
 
 	virtual void setFilterMode(Graphics::FILTER_MODE filterMode) { ; }
@@ -20,6 +22,8 @@ private:
 	virtual void init() { m_bReady = true; }
 	virtual void initAsync() { m_bAsyncReady = true; }
 	virtual void destroy() { ; }
+
+	NullGraphicsInterface* m_graphics; // the creator, which counts the binds
 };
 
 #endif
\ No newline at end of file
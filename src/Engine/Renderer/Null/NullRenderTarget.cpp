@@ -1 +1,8 @@
 #include "NullRenderTarget.h"
+
+#include "NullGraphicsInterface.h"
+
+void NullRenderTarget::bind(unsigned int textureUnit) {
+	if (m_graphics != NULL)
+		m_graphics->onTextureBind(this);
+}
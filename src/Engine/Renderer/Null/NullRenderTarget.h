@@ -3,22 +3,26 @@
 
 #include "RenderTarget/RenderTarget.h"
 
+class NullGraphicsInterface;
+
 class NullRenderTarget : public RenderTarget
 {
 public:
-	NullRenderTarget(int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType) : RenderTarget(x, y, width, height, multiSampleType) { ; }
+	NullRenderTarget(NullGraphicsInterface* graphics, int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType) : RenderTarget(x, y, width, height, multiSampleType) { m_graphics = graphics; }
 	virtual ~NullRenderTarget() { destroy(); }
 
 	virtual void enable() { ; }
 	virtual void disable() { ; }
 
-	virtual void bind(unsigned int textureUnit = 0) { ; }
+	virtual void bind(unsigned int textureUnit = 0);
 	virtual void unbind() { ; }
 
 private:
 	virtual void init() { m_bReady = true; }
 	virtual void initAsync() { m_bAsyncReady = true; }
 	virtual void destroy() { ; }
+
+	NullGraphicsInterface* m_graphics; // the creator, which counts the binds
 };
 
 #endif
\ No newline at end of file
@@ -12,16 +12,24 @@ public:
 	virtual void enable() { ; }
 	virtual void disable() { ; }
 
-	virtual void setUniform1f(UString name, float value) { ; }
-	virtual void setUniform1fv(UString name, int count, float* values) { ; }
-	virtual void setUniform1i(UString name, int value) { ; }
-	virtual void setUniform2f(UString name, float x, float y) { ; }
-	virtual void setUniform2fv(UString name, int count, float* vectors) { ; }
-	virtual void setUniform3f(UString name, float x, float y, float z) { ; }
-	virtual void setUniform3fv(UString name, int count, float* vectors) { ; }
-	virtual void setUniform4f(UString name, float x, float y, float z, float w) { ; }
-	virtual void setUniformMatrix4fv(UString name, Matrix4& matrix) { ; }
-	virtual void setUniformMatrix4fv(UString name, float* v) { ; }
+	virtual void setUniform1f(const UString& name, float value) { ; }
+	virtual void setUniform1fv(const UString& name, int count, float* values) { ; }
+	virtual void setUniform1i(const UString& name, int value) { ; }
+	virtual void setUniform2f(const UString& name, float x, float y) { ; }
+	virtual void setUniform2fv(const UString& name, int count, float* vectors) { ; }
+	virtual void setUniform3f(const UString& name, float x, float y, float z) { ; }
+	virtual void setUniform3fv(const UString& name, int count, float* vectors) { ; }
+	virtual void setUniform4f(const UString& name, float x, float y, float z, float w) { ; }
+	virtual void setUniformMatrix4fv(const UString& name, Matrix4& matrix) { ; }
+	virtual void setUniformMatrix4fv(const UString& name, float* v) { ; }
+
+	virtual void set(int handle, float value) { ; }
+	virtual void set(int handle, int value) { ; }
+	virtual void set(int handle, Vector2 value) { ; }
+	virtual void set(int handle, Vector3 value) { ; }
+	virtual void set(int handle, float x, float y, float z, float w) { ; }
+	virtual void set(int handle, const Matrix4& matrix) { ; }
+	virtual void set(int handle, int count, const float* values) { ; }
 
 private:
 	virtual void init() { m_bReady = true; }
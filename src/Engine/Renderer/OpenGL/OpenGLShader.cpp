@@ -1,6 +1,7 @@
 #include "OpenGLShader.h"
 #include "Engine.h"
 #include "ConVar/ConVar.h"
+#include "ResourceManager/ResourceManager.h"
 #include "Platform/OpenGLHeaders.h"
 
 OpenGLShader::OpenGLShader(UString vertexShader, UString fragmentShader, bool source) : Shader()
@@ -12,20 +13,95 @@ OpenGLShader::OpenGLShader(UString vertexShader, UString fragmentShader, bool so
 	m_iProgram = 0;
 	m_iVertexShader = 0;
 	m_iFragmentShader = 0;
+	m_bCompilePending = false;
 
 	m_iProgramBackup = 0;
 }
 
 void OpenGLShader::init()
 {
-	m_bReady = compile(m_sVsh, m_sFsh, m_bSource);
+	if (!m_bAsyncReady) return;
+
+	m_bCompilePending = issueCompile(m_sVshProcessed, m_sFshProcessed);
+
+	// the preprocessed sources are only needed once
+	m_sVshProcessed = std::string();
+	m_sFshProcessed = std::string();
+
+	if (!m_bCompilePending) return;
+
+	// precompiled variants don't wait for the driver here, see ResourceManager::update()
+	if (m_bFinalizeAsync)
+	{
+		engine->getResourceManager()->addPendingShader(this);
+		return;
+	}
+
+	finalize();
+}
+
+bool OpenGLShader::isCompileDone()
+{
+	if (!m_bCompilePending) return true;
+
+	// without parallel compile the driver may still be compiling, but there's no way to ask, finalize() just blocks
+	if (!GLEW_KHR_parallel_shader_compile && !GLEW_ARB_parallel_shader_compile) return true;
+
+	// the link can only complete after both shaders compiled
+	int completionStatus = GL_TRUE;
+	glGetProgramiv(m_iProgram, GL_COMPLETION_STATUS_KHR, &completionStatus);
+	return (completionStatus == GL_TRUE);
+}
+
+void OpenGLShader::finalize()
+{
+	if (!m_bCompilePending) return;
+	m_bCompilePending = false;
+
+	m_bReady = (checkCompileStatus(m_iVertexShader) && checkCompileStatus(m_iFragmentShader) && checkLinkStatus());
+	if (m_bReady)
+		resolveUniformHandles();
 }
 
 void OpenGLShader::initAsync()
 {
+	// file io and preprocessing don't need the gl context, so they run on the loader threads
+	if (!preprocess(m_sVsh, m_sVshProcessed) || !preprocess(m_sFsh, m_sFshProcessed))
+		return;
+
 	m_bAsyncReady = true;
 }
 
+bool OpenGLShader::preprocess(const UString& shader, std::string& out)
+{
+	std::string source;
+	std::string folder;
+	if (m_bSource)
+	{
+		source.assign(shader.toUtf8(), shader.lengthUtf8());
+		folder = ResourceManager::PATH_DEFAULT_SHADERS;
+	}
+	else
+	{
+		const std::string filePath(shader.toUtf8(), shader.lengthUtf8());
+		if (!ShaderPreprocessor::readFile(filePath, source))
+		{
+			engine->showMessageError("OpenGLShader Error", shader);
+			return false;
+		}
+		folder = ShaderPreprocessor::getFolder(filePath);
+	}
+
+	std::string error;
+	if (!ShaderPreprocessor::process(source, folder, m_defines, out, error))
+	{
+		debugLog("OpenGLShader Error: %s: %s\n", (m_bSource ? "source" : shader.toUtf8()), error.c_str());
+		return false;
+	}
+
+	return true;
+}
+
 void OpenGLShader::destroy()
 {
 	if (m_iProgram != 0)
@@ -38,10 +114,11 @@ void OpenGLShader::destroy()
 	m_iProgram = 0;
 	m_iFragmentShader = 0;
 	m_iVertexShader = 0;
+	m_bCompilePending = false;
 
 	m_iProgramBackup = 0;
 
-	m_uniformLocationCache.clear();
+	clearUniformLocationCache();
 }
 
 void OpenGLShader::enable()
@@ -59,7 +136,7 @@ void OpenGLShader::disable()
 	glUseProgramObjectARB(m_iProgramBackup); // restore
 }
 
-void OpenGLShader::setUniform1f(UString name, float value)
+void OpenGLShader::setUniform1f(const UString& name, float value)
 {
 	if (!m_bReady) return;
 
@@ -70,7 +147,7 @@ void OpenGLShader::setUniform1f(UString name, float value)
 		debugLog("OpenGLShader Warning: Can't find uniform %s\n", name.toUtf8());
 }
 
-void OpenGLShader::setUniform1fv(UString name, int count, float* values)
+void OpenGLShader::setUniform1fv(const UString& name, int count, float* values)
 {
 	if (!m_bReady) return;
 
@@ -81,7 +158,7 @@ void OpenGLShader::setUniform1fv(UString name, int count, float* values)
 		debugLog("OpenGLShader Warning: Can't find uniform %s\n", name.toUtf8());
 }
 
-void OpenGLShader::setUniform1i(UString name, int value)
+void OpenGLShader::setUniform1i(const UString& name, int value)
 {
 	if (!m_bReady) return;
 
@@ -92,7 +169,7 @@ void OpenGLShader::setUniform1i(UString name, int value)
 		debugLog("OpenGLShader Warning: Can't find uniform %s\n", name.toUtf8());
 }
 
-void OpenGLShader::setUniform2f(UString name, float value1, float value2)
+void OpenGLShader::setUniform2f(const UString& name, float value1, float value2)
 {
 	if (!m_bReady) return;
 
@@ -103,7 +180,7 @@ void OpenGLShader::setUniform2f(UString name, float value1, float value2)
 		debugLog("OpenGLShader Warning: Can't find uniform %s\n", name.toUtf8());
 }
 
-void OpenGLShader::setUniform2fv(UString name, int count, float* vectors)
+void OpenGLShader::setUniform2fv(const UString& name, int count, float* vectors)
 {
 	if (!m_bReady) return;
 
@@ -114,7 +191,7 @@ void OpenGLShader::setUniform2fv(UString name, int count, float* vectors)
 		debugLog("OpenGLShader Warning: Can't find uniform %s\n", name.toUtf8());
 }
 
-void OpenGLShader::setUniform3f(UString name, float x, float y, float z)
+void OpenGLShader::setUniform3f(const UString& name, float x, float y, float z)
 {
 	if (!m_bReady) return;
 
@@ -125,7 +202,7 @@ void OpenGLShader::setUniform3f(UString name, float x, float y, float z)
 		debugLog("OpenGLShader Warning: Can't find uniform %s\n", name.toUtf8());
 }
 
-void OpenGLShader::setUniform3fv(UString name, int count, float* vectors)
+void OpenGLShader::setUniform3fv(const UString& name, int count, float* vectors)
 {
 	if (!m_bReady) return;
 
@@ -136,7 +213,7 @@ void OpenGLShader::setUniform3fv(UString name, int count, float* vectors)
 		debugLog("OpenGLShader Warning: Can't find uniform %s\n", name.toUtf8());
 }
 
-void OpenGLShader::setUniform4f(UString name, float x, float y, float z, float w)
+void OpenGLShader::setUniform4f(const UString& name, float x, float y, float z, float w)
 {
 	if (!m_bReady) return;
 
@@ -147,7 +224,7 @@ void OpenGLShader::setUniform4f(UString name, float x, float y, float z, float w
 		debugLog("OpenGLShader Warning: Can't find uniform %s\n", name.toUtf8());
 }
 
-void OpenGLShader::setUniformMatrix4fv(UString name, Matrix4& matrix)
+void OpenGLShader::setUniformMatrix4fv(const UString& name, Matrix4& matrix)
 {
 	if (!m_bReady) return;
 
@@ -158,7 +235,7 @@ void OpenGLShader::setUniformMatrix4fv(UString name, Matrix4& matrix)
 		debugLog("OpenGLShader Warning: Can't find uniform %s\n", name.toUtf8());
 }
 
-void OpenGLShader::setUniformMatrix4fv(UString name, float* v)
+void OpenGLShader::setUniformMatrix4fv(const UString& name, float* v)
 {
 	if (!m_bReady) return;
 
@@ -169,38 +246,115 @@ void OpenGLShader::setUniformMatrix4fv(UString name, float* v)
 		debugLog("OpenGLShader Warning: Can't find uniform %s\n", name.toUtf8());
 }
 
-int OpenGLShader::getAttribLocation(UString name)
+int OpenGLShader::getAttribLocation(const UString& name)
 {
 	if (!m_bReady) return -1;
 
 	return glGetAttribLocation(m_iProgram, name.toUtf8());
 }
 
-int OpenGLShader::getAndCacheUniformLocation(const UString& name)
+int OpenGLShader::resolveUniformLocation(const char* name)
 {
-	if (!m_bReady) return -1;
+	return glGetUniformLocationARB(m_iProgram, name);
+}
+
+void OpenGLShader::set(int handle, float value)
+{
+	if (!m_bReady) return;
+
+	const int id = getUniformLocation(handle);
+	if (id != -1)
+		glUniform1fARB(id, value);
+}
+
+void OpenGLShader::set(int handle, int value)
+{
+	if (!m_bReady) return;
+
+	const int id = getUniformLocation(handle);
+	if (id != -1)
+		glUniform1iARB(id, value);
+}
+
+void OpenGLShader::set(int handle, Vector2 value)
+{
+	if (!m_bReady) return;
+
+	const int id = getUniformLocation(handle);
+	if (id != -1)
+		glUniform2fARB(id, value.x, value.y);
+}
+
+void OpenGLShader::set(int handle, Vector3 value)
+{
+	if (!m_bReady) return;
+
+	const int id = getUniformLocation(handle);
+	if (id != -1)
+		glUniform3fARB(id, value.x, value.y, value.z);
+}
+
+void OpenGLShader::set(int handle, float x, float y, float z, float w)
+{
+	if (!m_bReady) return;
+
+	const int id = getUniformLocation(handle);
+	if (id != -1)
+		glUniform4fARB(id, x, y, z, w);
+}
 
-	m_sTempStringBuffer.reserve(name.lengthUtf8());
-	m_sTempStringBuffer.assign(name.toUtf8(), name.lengthUtf8());
+void OpenGLShader::set(int handle, const Matrix4& matrix)
+{
+	if (!m_bReady) return;
 
-	const auto cachedValue = m_uniformLocationCache.find(m_sTempStringBuffer);
-	const bool cached = (cachedValue != m_uniformLocationCache.end());
+	const int id = getUniformLocation(handle);
+	if (id != -1)
+		glUniformMatrix4fv(id, 1, GL_FALSE, matrix.get());
+}
 
-	const int id = (cached ? cachedValue->second : glGetUniformLocationARB(m_iProgram, name.toUtf8()));
-	if (!cached && id != -1)
-		m_uniformLocationCache[m_sTempStringBuffer] = id;
+void OpenGLShader::set(int handle, int count, const float* values)
+{
+	if (!m_bReady) return;
 
-	return id;
+	const int id = getUniformLocation(handle);
+	if (id != -1)
+		glUniform1fvARB(id, count, values);
 }
 
-bool OpenGLShader::compile(UString vertexShader, UString fragmentShader, bool source)
+bool OpenGLShader::setUniformBlockBinding(const UString& blockName, unsigned int bindingPoint)
 {
-	// load & compile shaders
-	debugLog("OpenGLShader: Compiling %s ...\n", (source ? "vertex source" : vertexShader.toUtf8()));
-	m_iVertexShader = source ? createShaderFromString(vertexShader, GL_VERTEX_SHADER_ARB) : createShaderFromFile(vertexShader, GL_VERTEX_SHADER_ARB);
-	debugLog("OpenGLShader: Compiling %s ...\n", (source ? "fragment source" : fragmentShader.toUtf8()));
-	m_iFragmentShader = source ? createShaderFromString(fragmentShader, GL_FRAGMENT_SHADER_ARB) : createShaderFromFile(fragmentShader, GL_FRAGMENT_SHADER_ARB);
+	if (!m_bReady) return false;
+	if (!GLEW_VERSION_3_1 && !GLEW_ARB_uniform_buffer_object) return false;
+
+	const GLuint blockIndex = glGetUniformBlockIndex(m_iProgram, blockName.toUtf8());
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		if (debug_shaders->getBool())
+			debugLog("OpenGLShader Warning: Can't find uniform block %s\n", blockName.toUtf8());
+		return false;
+	}
 
+	glUniformBlockBinding(m_iProgram, blockIndex, bindingPoint);
+	return true;
+}
+
+bool OpenGLShader::issueCompile(const std::string& vertexShader, const std::string& fragmentShader)
+{
+	// let the driver use its own compiler threads (if supported)
+	static bool parallelCompileInitialized = false;
+	if (!parallelCompileInitialized)
+	{
+		parallelCompileInitialized = true;
+		if (GLEW_KHR_parallel_shader_compile)
+			glMaxShaderCompilerThreadsKHR(0xffffffff);
+		else if (GLEW_ARB_parallel_shader_compile)
+			glMaxShaderCompilerThreadsARB(0xffffffff);
+	}
+
+	// compile shaders, nothing here queries a status (which would wait for the driver), that happens in finalize()
+	debugLog("OpenGLShader: Compiling %s [%s] ...\n", (m_bSource ? "source" : m_sVsh.toUtf8()), m_defines.getKey().c_str());
+	m_iVertexShader = createShaderFromString(vertexShader, GL_VERTEX_SHADER_ARB);
+	m_iFragmentShader = createShaderFromString(fragmentShader, GL_FRAGMENT_SHADER_ARB);
 	if (m_iVertexShader == 0 || m_iFragmentShader == 0)
 	{
 		engine->showMessageError("OpenGLShader Error", "Couldn't createShader()");
@@ -222,28 +376,10 @@ bool OpenGLShader::compile(UString vertexShader, UString fragmentShader, bool so
 	// link
 	glLinkProgramARB(m_iProgram);
 
-	int returnValue = GL_TRUE;
-	glGetObjectParameterivARB(m_iProgram, GL_OBJECT_LINK_STATUS_ARB, &returnValue);
-	if (returnValue == GL_FALSE)
-	{
-		engine->showMessageError("OpenGLShader Error", "Couldn't glLinkProgramARB()");
-		return false;
-	}
-
-	// validate
-	glValidateProgramARB(m_iProgram);
-	returnValue = GL_TRUE;
-	glGetObjectParameterivARB(m_iProgram, GL_OBJECT_VALIDATE_STATUS_ARB, &returnValue);
-	if (returnValue == GL_FALSE)
-	{
-		engine->showMessageError("OpenGLShader Error", "Couldn't glValidateProgramARB()");
-		return false;
-	}
-
 	return true;
 }
 
-int OpenGLShader::createShaderFromString(UString shaderSource, int shaderType)
+int OpenGLShader::createShaderFromString(const std::string& shaderSource, int shaderType)
 {
 	const int shader = glCreateShaderObjectARB(shaderType);
 
@@ -254,10 +390,15 @@ int OpenGLShader::createShaderFromString(UString shaderSource, int shaderType)
 	}
 
 	// compile shader
-	const char* shaderSourceChar = shaderSource.toUtf8();
+	const char* shaderSourceChar = shaderSource.c_str();
 	glShaderSourceARB(shader, 1, &shaderSourceChar, NULL);
 	glCompileShaderARB(shader);
 
+	return shader;
+}
+
+bool OpenGLShader::checkCompileStatus(int shader)
+{
 	int returnValue = GL_TRUE;
 	glGetObjectParameterivARB(shader, GL_OBJECT_COMPILE_STATUS_ARB, &returnValue);
 
@@ -276,34 +417,31 @@ int OpenGLShader::createShaderFromString(UString shaderSource, int shaderType)
 		debugLog("--------------------------------------------------------------\n");
 
 		engine->showMessageError("OpenGLShader Error", "Couldn't glShaderSourceARB() or glCompileShaderARB()");
-		return 0;
+		return false;
 	}
 
-	return shader;
+	return true;
 }
 
-int OpenGLShader::createShaderFromFile(UString fileName, int shaderType)
+bool OpenGLShader::checkLinkStatus()
 {
-	// load file
-	std::ifstream inFile(fileName.toUtf8());
-	if (!inFile)
+	int returnValue = GL_TRUE;
+	glGetObjectParameterivARB(m_iProgram, GL_OBJECT_LINK_STATUS_ARB, &returnValue);
+	if (returnValue == GL_FALSE)
 	{
-		engine->showMessageError("OpenGLShader Error", fileName);
-		return 0;
+		engine->showMessageError("OpenGLShader Error", "Couldn't glLinkProgramARB()");
+		return false;
 	}
-	std::string line;
-	std::string shaderSource;
-	int linecount = 0;
-	while (inFile.good())
+
+	// validate
+	glValidateProgramARB(m_iProgram);
+	returnValue = GL_TRUE;
+	glGetObjectParameterivARB(m_iProgram, GL_OBJECT_VALIDATE_STATUS_ARB, &returnValue);
+	if (returnValue == GL_FALSE)
 	{
-		std::getline(inFile, line);
-		shaderSource += line + "\n\0";
-		linecount++;
+		engine->showMessageError("OpenGLShader Error", "Couldn't glValidateProgramARB()");
+		return false;
 	}
-	shaderSource += "\n\0";
-	inFile.close();
-
-	UString shaderSourcePtr = UString(shaderSource.c_str());
 
-	return createShaderFromString(shaderSourcePtr, shaderType);
-}
\ No newline at end of file
+	return true;
+}
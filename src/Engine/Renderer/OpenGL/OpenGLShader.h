@@ -11,41 +11,57 @@ public:
 	virtual void enable();
 	virtual void disable();
 
-	virtual void setUniform1f(UString name, float value);
-	virtual void setUniform1fv(UString name, int count, float* values);
-	virtual void setUniform1i(UString name, int value);
-	virtual void setUniform2f(UString name, float x, float y);
-	virtual void setUniform2fv(UString name, int count, float* vectors);
-	virtual void setUniform3f(UString name, float x, float y, float z);
-	virtual void setUniform3fv(UString name, int count, float* vectors);
-	virtual void setUniform4f(UString name, float x, float y, float z, float w);
-	virtual void setUniformMatrix4fv(UString name, Matrix4& matrix);
-	virtual void setUniformMatrix4fv(UString name, float* v);
+	virtual void setUniform1f(const UString& name, float value);
+	virtual void setUniform1fv(const UString& name, int count, float* values);
+	virtual void setUniform1i(const UString& name, int value);
+	virtual void setUniform2f(const UString& name, float x, float y);
+	virtual void setUniform2fv(const UString& name, int count, float* vectors);
+	virtual void setUniform3f(const UString& name, float x, float y, float z);
+	virtual void setUniform3fv(const UString& name, int count, float* vectors);
+	virtual void setUniform4f(const UString& name, float x, float y, float z, float w);
+	virtual void setUniformMatrix4fv(const UString& name, Matrix4& matrix);
+	virtual void setUniformMatrix4fv(const UString& name, float* v);
+
+	virtual void set(int handle, float value);
+	virtual void set(int handle, int value);
+	virtual void set(int handle, Vector2 value);
+	virtual void set(int handle, Vector3 value);
+	virtual void set(int handle, float x, float y, float z, float w);
+	virtual void set(int handle, const Matrix4& matrix);
+	virtual void set(int handle, int count, const float* values);
+
+	virtual bool setUniformBlockBinding(const UString& blockName, unsigned int bindingPoint);
+
+	virtual bool isFinalizePending() const { return m_bCompilePending; }
+	virtual bool isCompileDone();
+	virtual void finalize();
 
 	// ILLEGAL:
-	int getAttribLocation(UString name);
-	int getAndCacheUniformLocation(const UString& name);
+	int getAttribLocation(const UString& name);
 
 private:
 	virtual void init();
 	virtual void initAsync();
 	virtual void destroy();
 
-	bool compile(UString vertexShader, UString fragmentShader, bool source);
-	int createShaderFromString(UString shaderSource, int shaderType);
-	int createShaderFromFile(UString fileName, int shaderType);
+	virtual int resolveUniformLocation(const char* name);
+
+	bool preprocess(const UString& shader, std::string& out);
+	bool issueCompile(const std::string& vertexShader, const std::string& fragmentShader);
+	int createShaderFromString(const std::string& shaderSource, int shaderType);
+	bool checkCompileStatus(int shader);
+	bool checkLinkStatus();
 
 	UString m_sVsh, m_sFsh;
+	std::string m_sVshProcessed, m_sFshProcessed;
 
 	bool m_bSource;
 	int m_iVertexShader;
 	int m_iFragmentShader;
 	int m_iProgram;
+	bool m_bCompilePending; // issued, but the status wasn't checked yet
 
 	int m_iProgramBackup;
-
-	std::unordered_map<std::string, int> m_uniformLocationCache;
-	std::string m_sTempStringBuffer;
 };
 
 #endif // !OPENGLSHADER_H
@@ -0,0 +1,63 @@
+#include "OpenGLUniformBuffer.h"
+#include "Engine.h"
+#include "Platform/OpenGLHeaders.h"
+
+bool OpenGLUniformBuffer::isSupported() {
+	return (GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object);
+}
+
+OpenGLUniformBuffer::OpenGLUniformBuffer(size_t size) : Resource() {
+	m_iSize = size;
+	m_iBuffer = 0;
+	m_iNumUpdates = 0;
+}
+
+void OpenGLUniformBuffer::init() {
+	if (m_iBuffer != 0 || !m_bAsyncReady) return;
+
+	if (!isSupported()) {
+		debugLog("OpenGLUniformBuffer: Uniform buffers are not supported!\n");
+		return;
+	}
+
+	glGenBuffers(1, &m_iBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_iBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, m_iSize, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_bReady = true;
+}
+
+void OpenGLUniformBuffer::initAsync() {
+	m_bAsyncReady = true;
+}
+
+void OpenGLUniformBuffer::destroy() {
+	if (m_iBuffer != 0)
+		glDeleteBuffers(1, &m_iBuffer);
+
+	m_iBuffer = 0;
+}
+
+void OpenGLUniformBuffer::update(const void* data, size_t size) {
+	if (!m_bReady || data == NULL) return;
+
+	if (size > m_iSize) {
+		debugLog("OpenGLUniformBuffer Warning: update() with %i bytes, but the buffer only has %i!\n", (int)size, (int)m_iSize);
+		size = m_iSize;
+	}
+
+	// orphan, so that an update doesn't stall on draws of the previous frame still using the old contents
+	glBindBuffer(GL_UNIFORM_BUFFER, m_iBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, m_iSize, NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_iNumUpdates++;
+}
+
+void OpenGLUniformBuffer::bind(unsigned int bindingPoint) {
+	if (!m_bReady) return;
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_iBuffer);
+}
@@ -0,0 +1,33 @@
+#ifndef OPENGLUNIFORMBUFFER_H
+#define OPENGLUNIFORMBUFFER_H
+
+#include "Resource/Resource.h"
+
+// uniform buffer object for constants shared by many shaders (per-frame matrices, time, resolution)
+// upload once per frame with update(), bind to a binding point, and connect shaders via Shader::setUniformBlockBinding()
+// the layout of the data must match the std140 block declared in the shaders
+class OpenGLUniformBuffer : public Resource {
+public:
+	static bool isSupported();
+
+public:
+	OpenGLUniformBuffer(size_t size);
+	virtual ~OpenGLUniformBuffer() { destroy(); }
+
+	void update(const void* data, size_t size);
+	void bind(unsigned int bindingPoint);
+
+	inline size_t getSize() const { return m_iSize; }
+	inline unsigned int getNumUpdates() const { return m_iNumUpdates; }
+
+private:
+	virtual void init();
+	virtual void initAsync();
+	virtual void destroy();
+
+	size_t m_iSize;
+	unsigned int m_iBuffer;
+	unsigned int m_iNumUpdates;
+};
+
+#endif // !OPENGLUNIFORMBUFFER_H
@@ -1,14 +1,26 @@
 #include "OpenGLVertexArrayObject.h"
 #include "Engine.h"
+#include "ConVar/ConVar.h"
 #include "Platform/OpenGLHeaders.h"
 
+ConVar r_vao_persistent_mapping("r_vao_persistent_mapping", true, "use persistently mapped ring buffers for dynamic/stream vaos (if supported by the driver), orphaning otherwise");
+
 OpenGLVertexArrayObject::OpenGLVertexArrayObject(Graphics::PRIMITIVE primitive, Graphics::USAGE_TYPE usage, bool keepInSystemMemory) : VertexArrayObject(primitive, usage, keepInSystemMemory) {
+	m_iVAO = 0;
 	m_iVertexBuffer = 0;
-	m_iTexcoordBuffer = 0;
-	m_iColorBuffer = 0;
-
-	m_iNumTexcoords = 0;
-	m_iNumColors = 0;
+	m_iCapacity = 0;
+
+	m_bHasTexcoords = false;
+	m_bHasColors = false;
+	m_bBGRAColors = false;
+
+	m_bPersistent = false;
+	m_mappedRing = NULL;
+	m_iRingSegment = 0;
+	m_bRingSegmentDrawn = false;
+	for (int i = 0; i < NUM_RING_SEGMENTS; i++) {
+		m_ringFences[i] = NULL;
+	}
 }
 
 void OpenGLVertexArrayObject::init() {
@@ -17,51 +29,13 @@ void OpenGLVertexArrayObject::init() {
 	// handle partial reloads
 
 	if (m_bReady) {
-		// update vertex buffer
-		if (m_partialUpdateVertexIndices.size() > 0) {
-			glBindBuffer(GL_ARRAY_BUFFER, m_iVertexBuffer);
-			for (size_t i = 0; i < m_partialUpdateVertexIndices.size(); i++) {
-				const int offsetIndex = m_partialUpdateVertexIndices[i];
-
-				// group by continuous chunks to reduce calls
-				int numContinuousIndices = 1;
-				while ((i + 1) < m_partialUpdateVertexIndices.size()) {
-					if ((m_partialUpdateVertexIndices[i + 1] - m_partialUpdateVertexIndices[i]) == 1) {
-						numContinuousIndices++;
-						i++;
-					}
-					else
-						break;
-				}
-
-				glBufferSubData(GL_ARRAY_BUFFER, sizeof(Vector3) * offsetIndex, sizeof(Vector3) * numContinuousIndices, &(m_verticies[offsetIndex]));
-			}
-			m_partialUpdateVertexIndices.clear();
-		}
-
-		// update color buffer
-		if (m_partialUpdateColorIndices.size() > 0) {
-			glBindBuffer(GL_ARRAY_BUFFER, m_iColorBuffer);
-			for (size_t i = 0; i < m_partialUpdateColorIndices.size(); i++) {
-				const int offsetIndex = m_partialUpdateColorIndices[i];
-
-				m_colors[offsetIndex] = ARGBtoABGR(m_colors[offsetIndex]);
+		if (m_partialUpdateVertexIndices.size() > 0 || m_partialUpdateColorIndices.size() > 0) {
+			if (m_usage == Graphics::USAGE_TYPE::USAGE_STATIC)
+				updateStatic();
+			else
+				updateDynamic();
 
-				// group by continuous chunks to reduce calls
-				int numContinuousIndices = 1;
-				while ((i + 1) < m_partialUpdateColorIndices.size()) {
-					if ((m_partialUpdateColorIndices[i + 1] - m_partialUpdateColorIndices[i]) == 1) {
-						numContinuousIndices++;
-						i++;
-
-						m_colors[m_partialUpdateColorIndices[i]] = ARGBtoABGR(m_colors[m_partialUpdateColorIndices[i]]);
-					}
-					else
-						break;
-				}
-
-				glBufferSubData(GL_ARRAY_BUFFER, sizeof(Color) * offsetIndex, sizeof(Color) * numContinuousIndices, &(m_colors[offsetIndex]));
-			}
+			m_partialUpdateVertexIndices.clear();
 			m_partialUpdateColorIndices.clear();
 		}
 	}
@@ -70,32 +44,49 @@ void OpenGLVertexArrayObject::init() {
 
 	// handle full loads
 
-	// build and fill vertex buffer
-	glGenBuffers(1, &m_iVertexBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, m_iVertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(Vector3) * m_verticies.size(), &(m_verticies[0]), usageToOpenGL(m_usage));
+	m_iCapacity = m_verticies.size();
+	m_bHasTexcoords = (m_texcoords.size() > 0 && m_texcoords[0].size() > 0);
+	m_bHasColors = (m_colors.size() > 0);
 
-	// build and fill texcoord buffer
-	if (m_texcoords.size() > 0 && m_texcoords[0].size() > 0) {
-		m_iNumTexcoords = m_texcoords[0].size();
-
-		glGenBuffers(1, &m_iTexcoordBuffer);
-		glBindBuffer(GL_ARRAY_BUFFER, m_iTexcoordBuffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(Vector2) * m_texcoords[0].size(), &(m_texcoords[0][0]), usageToOpenGL(m_usage));
-	}
+	// colors can be read directly in our native ARGB memory layout, no swizzling required
+	m_bBGRAColors = (GLEW_VERSION_3_2 || GLEW_ARB_vertex_array_bgra);
 
-	// build and fill color buffer
-	if (m_colors.size() > 0) {
-		m_iNumColors = m_colors.size();
+	// build and fill the interleaved vertex buffer
+	glGenBuffers(1, &m_iVertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_iVertexBuffer);
 
-		for (size_t i = 0; i < m_colors.size(); i++)
-		{
-			m_colors[i] = ARGBtoABGR(m_colors[i]);
+	m_bPersistent = (m_usage != Graphics::USAGE_TYPE::USAGE_STATIC && r_vao_persistent_mapping.getBool() && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage));
+	if (m_bPersistent) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		const GLsizeiptr size = sizeof(VERTEX) * m_iCapacity * NUM_RING_SEGMENTS;
+
+		glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+		m_mappedRing = (VERTEX*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+		if (m_mappedRing != NULL) {
+			m_iRingSegment = 0;
+			m_bRingSegmentDrawn = false;
+			fillVertices(m_mappedRing, 0, m_iCapacity);
+		} else {
+			// immutable storage can't be respecified, start over with a normal buffer
+			debugLog("OpenGLVertexArrayObject: glMapBufferRange() failed, falling back to orphaning\n");
+			glDeleteBuffers(1, &m_iVertexBuffer);
+			glGenBuffers(1, &m_iVertexBuffer);
+			glBindBuffer(GL_ARRAY_BUFFER, m_iVertexBuffer);
+			m_bPersistent = false;
 		}
+	}
+	if (!m_bPersistent) {
+		std::vector<VERTEX> vertices(m_iCapacity);
+		fillVertices(&vertices[0], 0, m_iCapacity);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(VERTEX) * m_iCapacity, &vertices[0], usageToOpenGL(m_usage));
+	}
 
-		glGenBuffers(1, &m_iColorBuffer);
-		glBindBuffer(GL_ARRAY_BUFFER, m_iColorBuffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(Color) * m_colors.size(), &(m_colors[0]), usageToOpenGL(m_usage));
+	// record the vertex format once
+	if (GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object) {
+		glGenVertexArrays(1, &m_iVAO);
+		glBindVertexArray(m_iVAO);
+		enableVertexArrays();
+		glBindVertexArray(0);
 	}
 
 	// free memory
@@ -112,18 +103,28 @@ void OpenGLVertexArrayObject::initAsync() {
 void OpenGLVertexArrayObject::destroy() {
 	VertexArrayObject::destroy();
 
-	if (m_iVertexBuffer > 0)
-		glDeleteBuffers(1, &m_iVertexBuffer);
+	for (int i = 0; i < NUM_RING_SEGMENTS; i++) {
+		if (m_ringFences[i] != NULL)
+			glDeleteSync((GLsync)m_ringFences[i]);
+		m_ringFences[i] = NULL;
+	}
 
-	if (m_iTexcoordBuffer > 0)
-		glDeleteBuffers(1, &m_iTexcoordBuffer);
+	if (m_mappedRing != NULL) {
+		glBindBuffer(GL_ARRAY_BUFFER, m_iVertexBuffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		m_mappedRing = NULL;
+	}
 
-	if (m_iColorBuffer > 0)
-		glDeleteBuffers(1, &m_iColorBuffer);
+	if (m_iVAO > 0)
+		glDeleteVertexArrays(1, &m_iVAO);
 
+	if (m_iVertexBuffer > 0)
+		glDeleteBuffers(1, &m_iVertexBuffer);
+
+	m_iVAO = 0;
 	m_iVertexBuffer = 0;
-	m_iTexcoordBuffer = 0;
-	m_iColorBuffer = 0;
+	m_iCapacity = 0;
+	m_bPersistent = false;
 }
 
 void OpenGLVertexArrayObject::draw() {
@@ -137,34 +138,132 @@ void OpenGLVertexArrayObject::draw() {
 
 	if (start > end || std::abs(end - start) == 0) return;
 
-	// set vertices
-	glEnableClientState(GL_VERTEX_ARRAY);
+	if (m_iVAO != 0)
+		glBindVertexArray(m_iVAO);
+	else
+		enableVertexArrays();
+
+	// the vertex pointers stay at the start of the buffer, the ring segment is selected via the first vertex
+	const int first = (m_bPersistent ? m_iRingSegment * (int)m_iCapacity : 0) + start;
+
+	// render it
+	glDrawArrays(primitiveToOpenGL(m_primitive), first, end - start);
+
+	// the segment gets fenced once it is left (see updateDynamic()), not per draw
+	if (m_bPersistent)
+		m_bRingSegmentDrawn = true;
+
+	if (m_iVAO != 0)
+		glBindVertexArray(0);
+	else
+		disableVertexArrays();
+}
+
+void OpenGLVertexArrayObject::fillVertices(VERTEX* dst, int fromIndex, int count) const {
+	const bool hasTexcoords = (m_texcoords.size() > 0 && m_texcoords[0].size() > 0);
+	const size_t numTexcoords = (hasTexcoords ? m_texcoords[0].size() : 0);
+	const size_t numColors = m_colors.size();
+
+	for (int i = 0; i < count; i++) {
+		const int index = fromIndex + i;
+
+		dst[i].pos = m_verticies[index];
+		dst[i].texcoord = ((size_t)index < numTexcoords ? m_texcoords[0][index] : Vector2(0, 0));
+
+		const Color color = ((size_t)index < numColors ? m_colors[index] : 0xffffffff);
+		dst[i].color = (m_bBGRAColors ? color : ARGBtoABGR(color));
+	}
+}
+
+void OpenGLVertexArrayObject::updateStatic() {
+	// merge vertex and color indices, since both live in the same interleaved vertex
+	std::vector<int> indices = m_partialUpdateVertexIndices;
+	indices.insert(indices.end(), m_partialUpdateColorIndices.begin(), m_partialUpdateColorIndices.end());
+	std::sort(indices.begin(), indices.end());
+
 	glBindBuffer(GL_ARRAY_BUFFER, m_iVertexBuffer);
-	glVertexPointer(3, GL_FLOAT, 0, (char*)NULL); // set vertex pointer to vertex buffer
 
-	// set texture0
-	if (m_iNumTexcoords > 0) {
+	std::vector<VERTEX> chunk;
+	for (size_t i = 0; i < indices.size(); i++) {
+		const int offsetIndex = indices[i];
+		if (offsetIndex < 0 || offsetIndex >= (int)m_iCapacity || offsetIndex >= (int)m_verticies.size()) continue;
+
+		// group by continuous chunks to reduce calls
+		int numContinuousIndices = 1;
+		while ((i + 1) < indices.size() && (indices[i + 1] - indices[i]) <= 1 && indices[i + 1] < (int)m_iCapacity && indices[i + 1] < (int)m_verticies.size()) {
+			if (indices[i + 1] != indices[i])
+				numContinuousIndices++;
+			i++;
+		}
+
+		chunk.resize(numContinuousIndices);
+		fillVertices(&chunk[0], offsetIndex, numContinuousIndices);
+		glBufferSubData(GL_ARRAY_BUFFER, sizeof(VERTEX) * offsetIndex, sizeof(VERTEX) * numContinuousIndices, &chunk[0]);
+	}
+}
+
+void OpenGLVertexArrayObject::updateDynamic() {
+	const int count = (int)std::min((size_t)m_iCapacity, m_verticies.size());
+
+	if (m_bPersistent) {
+		// protect the current segment until the gpu is done with all draws from it, a single fence covers all of them
+		if (m_bRingSegmentDrawn) {
+			if (m_ringFences[m_iRingSegment] != NULL)
+				glDeleteSync((GLsync)m_ringFences[m_iRingSegment]);
+			m_ringFences[m_iRingSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_bRingSegmentDrawn = false;
+		}
+
+		// write the whole vertex set into the next segment, once the gpu has stopped reading from it
+		m_iRingSegment = (m_iRingSegment + 1) % NUM_RING_SEGMENTS;
+		if (m_ringFences[m_iRingSegment] != NULL) {
+			GLsync fence = (GLsync)m_ringFences[m_iRingSegment];
+			GLenum result = glClientWaitSync(fence, 0, 0);
+			while (result == GL_TIMEOUT_EXPIRED) {
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+			}
+			glDeleteSync(fence);
+			m_ringFences[m_iRingSegment] = NULL;
+		}
+
+		fillVertices(m_mappedRing + m_iRingSegment * m_iCapacity, 0, count);
+	} else {
+		// orphan the old storage, so that the driver doesn't have to stall on in-flight draws
+		glBindBuffer(GL_ARRAY_BUFFER, m_iVertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(VERTEX) * m_iCapacity, NULL, usageToOpenGL(m_usage));
+
+		VERTEX* mapped = (VERTEX*)glMapBufferRange(GL_ARRAY_BUFFER, 0, sizeof(VERTEX) * count, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (mapped != NULL) {
+			fillVertices(mapped, 0, count);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+	}
+}
+
+void OpenGLVertexArrayObject::enableVertexArrays() {
+	glBindBuffer(GL_ARRAY_BUFFER, m_iVertexBuffer);
+
+	// the legacy interface renders with the fixed function pipeline, so these are the conventional arrays (recorded in the vao)
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(VERTEX), (char*)NULL + offsetof(VERTEX, pos));
+
+	if (m_bHasTexcoords) {
 		glClientActiveTexture(GL_TEXTURE0);
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glBindBuffer(GL_ARRAY_BUFFER, m_iTexcoordBuffer);
-		glTexCoordPointer(2, GL_FLOAT, 0, (char*)NULL); // set first texcoord pointer to texcoord buffer
+		glTexCoordPointer(2, GL_FLOAT, sizeof(VERTEX), (char*)NULL + offsetof(VERTEX, texcoord));
 	}
 
-	// set colors
-	if (m_iNumColors > 0) {
+	if (m_bHasColors) {
 		glEnableClientState(GL_COLOR_ARRAY);
-		glBindBuffer(GL_ARRAY_BUFFER, m_iColorBuffer);
-		glColorPointer(4, GL_UNSIGNED_BYTE, 0, (char*)NULL); // set color pointer to color buffer
+		glColorPointer(m_bBGRAColors ? GL_BGRA : 4, GL_UNSIGNED_BYTE, sizeof(VERTEX), (char*)NULL + offsetof(VERTEX, color));
 	}
+}
 
-	// render it
-	glDrawArrays(primitiveToOpenGL(m_primitive), start, end - start);
-
-	// disable everything
-	if (m_iNumColors > 0)
+void OpenGLVertexArrayObject::disableVertexArrays() {
+	if (m_bHasColors)
 		glDisableClientState(GL_COLOR_ARRAY);
 
-	if (m_iNumTexcoords > 0)
+	if (m_bHasTexcoords)
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 
 	glDisableClientState(GL_VERTEX_ARRAY);
@@ -11,6 +11,16 @@ public:
 	void draw();
 
 private:
+	// interleaved, 24 bytes per vertex
+	struct VERTEX {
+		Vector3 pos;
+		Vector2 texcoord;
+		Color color; // ARGB (read as GL_BGRA) if supported, ABGR otherwise
+	};
+
+	// dynamic/stream vaos write into the next segment of a persistently mapped buffer on every update
+	static const int NUM_RING_SEGMENTS = 3;
+
 	static int primitiveToOpenGL(Graphics::PRIMITIVE primitive);
 	static unsigned int usageToOpenGL(Graphics::USAGE_TYPE usage);
 
@@ -20,12 +30,26 @@ private:
 
 	static inline Color ARGBtoABGR(Color color) { return ((color & 0xff000000) >> 0) | ((color & 0x00ff0000) >> 16) | ((color & 0x0000ff00) << 0) | ((color & 0x000000ff) << 16); }
 
-	unsigned int m_iVertexBuffer;
-	unsigned int m_iTexcoordBuffer;
-	unsigned int m_iColorBuffer;
+	void fillVertices(VERTEX* dst, int fromIndex, int count) const;
+	void updateStatic();
+	void updateDynamic();
+	void enableVertexArrays();
+	void disableVertexArrays();
 
-	unsigned int m_iNumTexcoords;
-	unsigned int m_iNumColors;
+	unsigned int m_iVAO;
+	unsigned int m_iVertexBuffer;
+	unsigned int m_iCapacity; // in vertices (per ring segment)
+
+	bool m_bHasTexcoords;
+	bool m_bHasColors;
+	bool m_bBGRAColors;
+
+	// persistent ring buffer
+	bool m_bPersistent;
+	VERTEX* m_mappedRing;
+	int m_iRingSegment;
+	bool m_bRingSegmentDrawn; // since the last fence
+	void* m_ringFences[NUM_RING_SEGMENTS]; // GLsync
 };
 
 #endif // !OPENGLVERTEXARRAYOBJECT_H
@@ -1 +1,153 @@
 #include "OpenGL3Interface.h"
+
+#include "Engine.h"
+#include "Image/Image.h"
+#include "OpenGL/OpenGLShader.h"
+
+#include "Platform/OpenGLHeaders.h"
+
+OpenGL3Interface::~OpenGL3Interface() {
+	destroyInstancing();
+}
+
+void OpenGL3Interface::drawImageInstanced(Image* image, const SPRITE_INSTANCE* instances, int numInstances) {
+	if (image == NULL || instances == NULL || numInstances < 1) return;
+	if (!image->isReady()) return;
+
+	if (!initInstancing()) {
+		Graphics::drawImageInstanced(image, instances, numInstances);
+		return;
+	}
+
+	updateTransform();
+
+	// upload, orphaning the previous contents
+	const size_t size = sizeof(SPRITE_INSTANCE) * (size_t)numInstances;
+	glBindBuffer(GL_ARRAY_BUFFER, m_iInstanceVBO);
+	if (size > m_iInstanceVBOSize)
+		m_iInstanceVBOSize = std::max(size, m_iInstanceVBOSize * 2);
+	glBufferData(GL_ARRAY_BUFFER, m_iInstanceVBOSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances);
+
+	// draw
+	m_shaderInstanced->enable();
+	m_shaderInstanced->set(m_iInstanceMVPHandle, m_MP);
+	m_shaderInstanced->set(m_iInstanceTexHandle, 0);
+
+	image->bind();
+	{
+		glBindVertexArray(m_iInstanceVA);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, numInstances);
+	}
+	image->unbind();
+
+	// restore the generic state
+	glBindVertexArray(m_iVA);
+	m_shaderInstanced->disable();
+	if (m_shaderTexturedGeneric != NULL)
+		m_shaderTexturedGeneric->enable();
+}
+
+bool OpenGL3Interface::initInstancing() {
+	if (m_bInstancingInitialized) return m_bInstancingSupported;
+
+	m_bInstancingInitialized = true;
+
+	if (!GLEW_VERSION_3_3 && !(GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced)) {
+		debugLog("OpenGL3Interface: Instancing is not supported, using the fallback path\n");
+		return false;
+	}
+
+	const char* vertexShader =
+		"#version 330\n"
+		"uniform mat4 mvp;\n"
+		"layout(location = 0) in vec2 corner;\n"
+		"layout(location = 1) in vec4 posSize;\n"
+		"layout(location = 2) in float rotation;\n"
+		"layout(location = 3) in vec4 uvRect;\n"
+		"layout(location = 4) in vec4 color;\n"
+		"out vec2 texcoord;\n"
+		"out vec4 vcolor;\n"
+		"void main() {\n"
+		"	float s = sin(rotation);\n"
+		"	float c = cos(rotation);\n"
+		"	vec2 p = corner * posSize.zw;\n"
+		"	p = vec2(p.x * c - p.y * s, p.x * s + p.y * c) + posSize.xy;\n"
+		"	texcoord = mix(uvRect.xy, uvRect.zw, corner + 0.5);\n"
+		"	vcolor = color;\n"
+		"	gl_Position = mvp * vec4(p, 0.0, 1.0);\n"
+		"}\n";
+	const char* fragmentShader =
+		"#version 330\n"
+		"uniform sampler2D tex;\n"
+		"in vec2 texcoord;\n"
+		"in vec4 vcolor;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	fragColor = texture(tex, texcoord) * vcolor;\n"
+		"}\n";
+
+	m_shaderInstanced = new OpenGLShader(vertexShader, fragmentShader, true);
+	m_shaderInstanced->loadAsync();
+	m_shaderInstanced->load();
+	if (!m_shaderInstanced->isReady()) {
+		debugLog("OpenGL3Interface: Couldn't compile the instancing shader, using the fallback path\n");
+		destroyInstancing();
+		return false;
+	}
+	m_iInstanceMVPHandle = m_shaderInstanced->getUniformHandle("mvp");
+	m_iInstanceTexHandle = m_shaderInstanced->getUniformHandle("tex");
+
+	// unit quad as a triangle strip, shared by all instances
+	const float corners[] = { -0.5f, -0.5f, 0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f };
+
+	glGenVertexArrays(1, &m_iInstanceVA);
+	glBindVertexArray(m_iInstanceVA);
+
+	glGenBuffers(1, &m_iInstanceVBOQuad);
+	glBindBuffer(GL_ARRAY_BUFFER, m_iInstanceVBOQuad);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (char*)NULL);
+
+	m_iInstanceVBOSize = sizeof(SPRITE_INSTANCE) * 1024;
+	glGenBuffers(1, &m_iInstanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_iInstanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, m_iInstanceVBOSize, NULL, GL_STREAM_DRAW);
+
+	const GLsizei stride = sizeof(SPRITE_INSTANCE);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (char*)NULL + offsetof(SPRITE_INSTANCE, x));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (char*)NULL + offsetof(SPRITE_INSTANCE, rotation));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (char*)NULL + offsetof(SPRITE_INSTANCE, u0));
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, GL_BGRA, GL_UNSIGNED_BYTE, GL_TRUE, stride, (char*)NULL + offsetof(SPRITE_INSTANCE, color)); // ARGB in memory
+	for (int i = 1; i < 5; i++) {
+		glVertexAttribDivisor(i, 1);
+	}
+
+	glBindVertexArray(m_iVA);
+
+	m_bInstancingSupported = true;
+	return true;
+}
+
+void OpenGL3Interface::destroyInstancing() {
+	// m_bInstancingInitialized stays set, initInstancing() doesn't retry
+	SAFE_DELETE(m_shaderInstanced);
+
+	if (m_iInstanceVA != 0)
+		glDeleteVertexArrays(1, &m_iInstanceVA);
+	if (m_iInstanceVBOQuad != 0)
+		glDeleteBuffers(1, &m_iInstanceVBOQuad);
+	if (m_iInstanceVBO != 0)
+		glDeleteBuffers(1, &m_iInstanceVBO);
+
+	m_iInstanceVA = 0;
+	m_iInstanceVBOQuad = 0;
+	m_iInstanceVBO = 0;
+	m_iInstanceVBOSize = 0;
+	m_bInstancingSupported = false;
+}
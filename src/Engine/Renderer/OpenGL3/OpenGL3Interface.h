@@ -38,6 +38,7 @@ public:
 
 	// 2d resource drawing
 	virtual void drawImage(Image* image);
+	virtual void drawImageInstanced(Image* image, const SPRITE_INSTANCE* instances, int numInstances);
 	virtual void drawString(TacoFont* font, UString text);
 
 	// 3d type drawing
@@ -98,6 +99,9 @@ private:
 
 	static int primitiveToOpenGL(Graphics::PRIMITIVE primitive);
 
+	bool initInstancing();
+	void destroyInstancing();
+
 	// renderer
 	bool m_bInScene;
 	Vector2 m_vResolution;
@@ -116,6 +120,17 @@ private:
 	unsigned int m_iVBOTexcoords;
 	unsigned int m_iVBOTexcolors;
 
+	// instancing (lazily initialized on first use)
+	bool m_bInstancingInitialized = false;
+	bool m_bInstancingSupported = false;
+	OpenGLShader* m_shaderInstanced = NULL;
+	int m_iInstanceMVPHandle = -1;
+	int m_iInstanceTexHandle = -1;
+	unsigned int m_iInstanceVA = 0;
+	unsigned int m_iInstanceVBOQuad = 0;
+	unsigned int m_iInstanceVBO = 0;
+	size_t m_iInstanceVBOSize = 0;
+
 	// persistent vars
 	Color m_color;
 
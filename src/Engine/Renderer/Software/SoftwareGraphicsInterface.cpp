@@ -0,0 +1,614 @@
+#include "SoftwareGraphicsInterface.h"
+
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "Camera/Camera.h"
+#include "Font/Font.h"
+#include "Timer/Timer.h"
+#include "Null/NullShader.h"
+
+#include "SoftwareImage.h"
+#include "SoftwareRenderTarget.h"
+#include "SoftwareVertexArrayObject.h"
+
+void _r_sw_threads_callback(UString oldValue, UString newValue) {
+	SoftwareGraphicsInterface* g = dynamic_cast<SoftwareGraphicsInterface*>(engine->getGraphics());
+	if (g != NULL)
+		g->getRasterizer()->setNumThreads(newValue.toInt());
+}
+
+void _r_sw_tile_size_callback(UString oldValue, UString newValue) {
+	SoftwareGraphicsInterface* g = dynamic_cast<SoftwareGraphicsInterface*>(engine->getGraphics());
+	if (g != NULL)
+		g->getRasterizer()->setTileSize(newValue.toInt());
+}
+
+ConVar _r_sw_threads("r_sw_threads", 0, "number of software rasterizer threads (including the main thread), 0 = number of hardware threads", _r_sw_threads_callback);
+ConVar _r_sw_tile_size("r_sw_tile_size", 64, "size in pixels of the square tiles the software rasterizer distributes across its threads", _r_sw_tile_size_callback);
+
+ConVar* SoftwareGraphicsInterface::r_sw_threads = &_r_sw_threads;
+ConVar* SoftwareGraphicsInterface::r_sw_tile_size = &_r_sw_tile_size;
+
+SoftwareGraphicsInterface::SoftwareGraphicsInterface() : Graphics() {
+	m_bInScene = false;
+	m_vResolution = engine->getScreenSize();
+	m_renderTarget = NULL;
+
+	m_color = 0xffffffff;
+	m_bTextureBound = false;
+	m_bTexturing = false;
+
+	m_state.hasTexture = false;
+	m_state.texture.texels = NULL;
+	m_state.texture.width = 0;
+	m_state.texture.height = 0;
+	m_state.texture.linear = true;
+	m_state.texture.repeat = false;
+	m_state.texture.flipY = false;
+	m_state.blending = true;
+	m_state.blendMode = Graphics::BLEND_MODE::BLEND_MODE_ALPHA;
+	m_state.stencilMode = SoftwareRasterizer::STENCIL_MODE::STENCIL_MODE_NONE;
+
+	m_bClipping = false;
+
+	onResolutionChange(m_vResolution);
+}
+
+SoftwareGraphicsInterface::~SoftwareGraphicsInterface() {
+	m_rasterizer.flush();
+}
+
+void SoftwareGraphicsInterface::init() {
+	m_rasterizer.setTileSize(r_sw_tile_size->getInt());
+	m_rasterizer.setNumThreads(r_sw_threads->getInt());
+
+	debugLog("SoftwareGraphicsInterface: Using %i thread(s)\n", m_rasterizer.getNumThreads());
+}
+
+void SoftwareGraphicsInterface::beginScene() {
+	m_bInScene = true;
+
+	setRenderTarget(NULL);
+
+	Matrix4 defaultProjectionMatrix = Camera::buildMatrixOrtho2D(0, m_vResolution.x, m_vResolution.y, 0, -1.0f, 1.0f);
+	pushTransform();
+	setProjectionMatrix(defaultProjectionMatrix);
+	translate(r_globaloffset_x->getFloat(), r_globaloffset_y->getFloat());
+	updateTransform();
+
+	m_rasterizer.clear(0x00000000);
+	m_rasterizer.clearStencil();
+}
+
+void SoftwareGraphicsInterface::endScene() {
+	popTransform();
+
+	m_rasterizer.flush();
+
+	checkStackLeaks();
+
+	if (m_clipRectStack.size() > 0) {
+		engine->showMessageErrorFatal("ClipRect Stack Leak", "Make sure all push*() have a pop*()!");
+		engine->shutdown();
+	}
+
+	m_bInScene = false;
+}
+
+void SoftwareGraphicsInterface::setColor(Color color) {
+	m_color = color;
+}
+
+void SoftwareGraphicsInterface::setAlpha(float alpha) {
+	m_color &= 0x00ffffff;
+	m_color |= ((int)(255.0f * clamp<float>(alpha, 0.0f, 1.0f))) << 24;
+}
+
+void SoftwareGraphicsInterface::drawPixels(int x, int y, int width, int height, Graphics::DRAWPIXELS_TYPE type, const void* pixels) {
+	if (pixels == NULL) return;
+
+	// like glDrawPixels(), rows are bottom-up and (x, y) is the bottom left corner in window coordinates
+	m_rasterizer.flush();
+
+	const SoftwareRasterizer::SURFACE& surface = m_rasterizer.getSurface();
+	if (surface.pixels == NULL) return;
+
+	for (int row = 0; row < height; row++) {
+		const int dstY = surface.height - 1 - (y + row);
+		if (dstY < 0 || dstY >= surface.height) continue;
+
+		for (int col = 0; col < width; col++) {
+			const int dstX = x + col;
+			if (dstX < 0 || dstX >= surface.width) continue;
+
+			const size_t src = ((size_t)row * (size_t)width + (size_t)col) * 4;
+			Color color;
+			if (type == Graphics::DRAWPIXELS_TYPE::DRAWPIXELS_FLOAT) {
+				const float* rgba = (const float*)pixels + src;
+				color = COLORf(rgba[3], rgba[0], rgba[1], rgba[2]);
+			} else {
+				const unsigned char* rgba = (const unsigned char*)pixels + src;
+				color = COLOR(rgba[3], rgba[0], rgba[1], rgba[2]);
+			}
+			surface.pixels[(size_t)dstY * (size_t)surface.width + dstX] = color;
+		}
+	}
+}
+
+void SoftwareGraphicsInterface::drawPixel(int x, int y) {
+	fillRect(x, y, 1, 1);
+}
+
+void SoftwareGraphicsInterface::drawLine(int x1, int y1, int x2, int y2) {
+	drawLine(Vector2(x1, y1), Vector2(x2, y2));
+}
+
+void SoftwareGraphicsInterface::drawLine(Vector2 pos1, Vector2 pos2) {
+	updateTransform();
+	setTexturing(false);
+
+	addLine(Vector3(pos1.x + 0.5f, pos1.y + 0.5f, 0), Vector3(pos2.x + 0.5f, pos2.y + 0.5f, 0), m_color, m_color);
+}
+
+void SoftwareGraphicsInterface::drawRect(int x, int y, int width, int height) {
+	drawLine(x, y, x + width, y);
+	drawLine(x, y, x, y + height);
+	drawLine(x, y + height, x + width + 1, y + height);
+	drawLine(x + width, y, x + width, y + height);
+}
+
+void SoftwareGraphicsInterface::drawRect(int x, int y, int width, int height, Color top, Color right, Color bottom, Color left) {
+	const Color backup = m_color;
+
+	setColor(top);
+	drawLine(x, y, x + width, y);
+	setColor(left);
+	drawLine(x, y, x, y + height);
+	setColor(bottom);
+	drawLine(x, y + height, x + width + 1, y + height);
+	setColor(right);
+	drawLine(x + width, y, x + width, y + height);
+
+	setColor(backup);
+}
+
+void SoftwareGraphicsInterface::fillRect(int x, int y, int width, int height) {
+	updateTransform();
+	setTexturing(false);
+
+	submitQuad(Vector3(x, y, 0), Vector3(x + width, y, 0), Vector3(x + width, y + height, 0), Vector3(x, y + height, 0),
+		Vector2(), Vector2(), Vector2(), Vector2(),
+		m_color, m_color, m_color, m_color);
+}
+
+void SoftwareGraphicsInterface::fillRoundedRect(int x, int y, int width, int height, int radius) {
+	updateTransform();
+	setTexturing(false);
+
+	radius = clamp<int>(radius, 0, std::min(width, height) / 2);
+	if (radius < 1) {
+		fillRect(x, y, width, height);
+		return;
+	}
+
+	// triangle fan around the center, one arc per corner
+	const int numSegments = clamp<int>(radius / 2, 4, 16);
+	const Vector3 center(x + width / 2.0f, y + height / 2.0f, 0);
+	const Vector2 corners[4] = {
+		Vector2(x + width - radius, y + radius),			// top right
+		Vector2(x + radius, y + radius),					// top left
+		Vector2(x + radius, y + height - radius),			// bottom left
+		Vector2(x + width - radius, y + height - radius)	// bottom right
+	};
+
+	std::vector<Vector3>& outline = m_roundedRectOutline;
+	outline.clear();
+	for (int c = 0; c < 4; c++) {
+		for (int s = 0; s <= numSegments; s++) {
+			const float angle = (float)(c * (PI / 2.0) + s * (PI / 2.0) / numSegments);
+			outline.push_back(Vector3(corners[c].x + std::cos(angle) * radius, corners[c].y - std::sin(angle) * radius, 0));
+		}
+	}
+
+	for (size_t i = 0; i < outline.size(); i++) {
+		addTriangle(center, outline[i], outline[(i + 1) % outline.size()], Vector2(), Vector2(), Vector2(), m_color, m_color, m_color);
+	}
+}
+
+void SoftwareGraphicsInterface::fillGradient(int x, int y, int width, int height, Color topLeftColor, Color topRightColor, Color bottomLeftColor, Color bottomRightColor) {
+	updateTransform();
+	setTexturing(false);
+
+	submitQuad(Vector3(x, y, 0), Vector3(x + width, y, 0), Vector3(x + width, y + height, 0), Vector3(x, y + height, 0),
+		Vector2(), Vector2(), Vector2(), Vector2(),
+		topLeftColor, topRightColor, bottomRightColor, bottomLeftColor);
+}
+
+void SoftwareGraphicsInterface::drawQuad(int x, int y, int width, int height) {
+	updateTransform();
+	setTexturing(true);
+
+	// flipped texcoords, same as the opengl interfaces (mostly used for drawing rendertargets)
+	submitQuad(Vector3(x, y, 0), Vector3(x + width, y, 0), Vector3(x + width, y + height, 0), Vector3(x, y + height, 0),
+		Vector2(0, 1), Vector2(1, 1), Vector2(1, 0), Vector2(0, 0),
+		m_color, m_color, m_color, m_color);
+}
+
+void SoftwareGraphicsInterface::drawQuad(Vector2 topLeft, Vector2 topRight, Vector2 bottomRight, Vector2 bottomLeft, Color topLeftColor, Color topRightColor, Color bottomRightColor, Color bottomLeftColor) {
+	updateTransform();
+	setTexturing(true);
+
+	submitQuad(Vector3(topLeft.x, topLeft.y, 0), Vector3(topRight.x, topRight.y, 0), Vector3(bottomRight.x, bottomRight.y, 0), Vector3(bottomLeft.x, bottomLeft.y, 0),
+		Vector2(0, 0), Vector2(1, 0), Vector2(1, 1), Vector2(0, 1),
+		topLeftColor, topRightColor, bottomRightColor, bottomLeftColor);
+}
+
+void SoftwareGraphicsInterface::drawImage(Image* image) {
+	if (image == NULL) {
+		debugLog("WARNING: Tried to draw image with NULL texture!\n");
+		return;
+	}
+	if (!image->isReady()) return;
+
+	updateTransform();
+
+	const float width = image->getWidth();
+	const float height = image->getHeight();
+	const float x = -width / 2;
+	const float y = -height / 2;
+
+	image->bind();
+	setTexturing(true);
+	{
+		submitQuad(Vector3(x, y, 0), Vector3(x + width, y, 0), Vector3(x + width, y + height, 0), Vector3(x, y + height, 0),
+			Vector2(0, 0), Vector2(1, 0), Vector2(1, 1), Vector2(0, 1),
+			m_color, m_color, m_color, m_color);
+	}
+	image->unbind();
+
+	if (r_debug_drawimage->getBool()) {
+		setColor(0xbbff00ff);
+		drawRect(x, y, width, height);
+	}
+}
+
+void SoftwareGraphicsInterface::drawString(TacoFont* font, UString text) {
+	if (font == NULL || text.length() < 1 || !font->isReady()) return;
+
+	updateTransform();
+
+	font->drawString(this, text);
+}
+
+void SoftwareGraphicsInterface::drawVAO(VertexArrayObject* vao) {
+	if (vao == NULL) return;
+
+	updateTransform();
+
+	((SoftwareVertexArrayObject*)vao)->draw();
+}
+
+void SoftwareGraphicsInterface::setClipRect(Rects clipRect) {
+	if (r_debug_disable_cliprect->getBool()) return;
+
+	m_clipRect = clipRect;
+	m_bClipping = true;
+	updateClipRect();
+}
+
+void SoftwareGraphicsInterface::pushClipRect(Rects clipRect) {
+	if (m_clipRectStack.size() > 0)
+		m_clipRectStack.push(m_clipRectStack.top().intersect(clipRect));
+	else
+		m_clipRectStack.push(clipRect);
+
+	setClipRect(m_clipRectStack.top());
+}
+
+void SoftwareGraphicsInterface::popClipRect() {
+	m_clipRectStack.pop();
+
+	if (m_clipRectStack.size() > 0)
+		setClipRect(m_clipRectStack.top());
+	else
+		setClipping(false);
+}
+
+void SoftwareGraphicsInterface::pushStencil() {
+	// draw everything into the stencil buffer only, until fillStencil() is called
+	m_rasterizer.clearStencil();
+
+	m_state.stencilMode = SoftwareRasterizer::STENCIL_MODE::STENCIL_MODE_WRITE;
+	updateState();
+}
+
+void SoftwareGraphicsInterface::fillStencil(bool inside) {
+	m_state.stencilMode = (inside ? SoftwareRasterizer::STENCIL_MODE::STENCIL_MODE_TEST_INSIDE : SoftwareRasterizer::STENCIL_MODE::STENCIL_MODE_TEST_OUTSIDE);
+	updateState();
+}
+
+void SoftwareGraphicsInterface::popStencil() {
+	m_state.stencilMode = SoftwareRasterizer::STENCIL_MODE::STENCIL_MODE_NONE;
+	updateState();
+}
+
+void SoftwareGraphicsInterface::setClipping(bool enabled) {
+	m_bClipping = enabled;
+	updateClipRect();
+}
+
+void SoftwareGraphicsInterface::setBlending(bool enabled) {
+	m_state.blending = enabled;
+	updateState();
+}
+
+void SoftwareGraphicsInterface::setBlendMode(BLEND_MODE blendMode) {
+	m_state.blendMode = blendMode;
+	updateState();
+}
+
+void SoftwareGraphicsInterface::flush() {
+	m_rasterizer.flush();
+}
+
+std::vector<unsigned char> SoftwareGraphicsInterface::getScreenshot() {
+	m_rasterizer.flush();
+
+	// top-down rgb, same as the opengl interfaces
+	const int width = (int)m_vResolution.x;
+	const int height = (int)m_vResolution.y;
+
+	std::vector<unsigned char> result;
+	result.resize((size_t)width * (size_t)height * 3);
+	for (size_t i = 0; i < m_backBuffer.size() && i * 3 + 2 < result.size(); i++) {
+		const Color color = m_backBuffer[i];
+		result[i * 3 + 0] = COLOR_GET_Ri(color);
+		result[i * 3 + 1] = COLOR_GET_Gi(color);
+		result[i * 3 + 2] = COLOR_GET_Bi(color);
+	}
+	return result;
+}
+
+UString SoftwareGraphicsInterface::getVendor() {
+	return "Software";
+}
+
+UString SoftwareGraphicsInterface::getModel() {
+	return "SoftwareRasterizer";
+}
+
+UString SoftwareGraphicsInterface::getVersion() {
+	return UString::format("%i thread(s), %i px tiles", m_rasterizer.getNumThreads(), r_sw_tile_size->getInt());
+}
+
+void SoftwareGraphicsInterface::onResolutionChange(Vector2 newResolution) {
+	m_rasterizer.flush();
+
+	m_vResolution = newResolution;
+
+	const size_t numPixels = (size_t)std::max((int)m_vResolution.x, 0) * (size_t)std::max((int)m_vResolution.y, 0);
+	m_backBuffer.assign(numPixels, 0x00000000);
+	m_backBufferStencil.assign(numPixels, 0);
+
+	setRenderTarget(m_renderTarget);
+}
+
+Image* SoftwareGraphicsInterface::createImage(UString filePath, bool mipmapped, bool keepInSystemMemory) {
+	return new SoftwareImage(filePath, mipmapped, keepInSystemMemory);
+}
+
+Image* SoftwareGraphicsInterface::createImage(int width, int height, bool mipmapped, bool keepInSystemMemory) {
+	return new SoftwareImage(width, height, mipmapped, keepInSystemMemory);
+}
+
+RenderTarget* SoftwareGraphicsInterface::createRenderTarget(int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType) {
+	return new SoftwareRenderTarget(x, y, width, height, multiSampleType);
+}
+
+Shader* SoftwareGraphicsInterface::createShaderFromFile(UString vertexShaderFilePath, UString fragmentShaderFilePath) {
+	return new NullShader(vertexShaderFilePath, fragmentShaderFilePath, false);
+}
+
+Shader* SoftwareGraphicsInterface::createShaderFromSource(UString vertexShader, UString fragmentShader) {
+	return new NullShader(vertexShader, fragmentShader, true);
+}
+
+VertexArrayObject* SoftwareGraphicsInterface::createVertexArrayObject(Graphics::PRIMITIVE primitive, Graphics::USAGE_TYPE usage, bool keepInSystemMemory) {
+	return new SoftwareVertexArrayObject(primitive, usage, keepInSystemMemory);
+}
+
+void SoftwareGraphicsInterface::bindTexture(const SoftwareRasterizer::TEXTURE& texture) {
+	m_state.texture = texture;
+	m_bTextureBound = (texture.texels != NULL && texture.width > 0 && texture.height > 0);
+	setTexturing(m_bTexturing);
+}
+
+void SoftwareGraphicsInterface::unbindTexture() {
+	m_bTextureBound = false;
+	m_state.texture.texels = NULL;
+	setTexturing(m_bTexturing);
+}
+
+void SoftwareGraphicsInterface::setTexturing(bool enabled) {
+	m_bTexturing = enabled;
+	if (m_state.hasTexture == (m_bTexturing && m_bTextureBound)) return;
+
+	m_state.hasTexture = (m_bTexturing && m_bTextureBound);
+	updateState();
+}
+
+void SoftwareGraphicsInterface::setRenderTarget(SoftwareRenderTarget* rt) {
+	m_rasterizer.flush();
+
+	m_renderTarget = rt;
+
+	SoftwareRasterizer::SURFACE surface;
+	if (m_renderTarget != NULL) {
+		surface = m_renderTarget->getSurface();
+
+		// the viewport stays at screen size and is shifted, so that rendertargets can be drawn into with screen coordinates
+		m_vViewportOffset = -m_renderTarget->getPos();
+	} else {
+		surface.pixels = (m_backBuffer.size() > 0 ? &m_backBuffer[0] : NULL);
+		surface.stencil = (m_backBufferStencil.size() > 0 ? &m_backBufferStencil[0] : NULL);
+		surface.width = (int)m_vResolution.x;
+		surface.height = (int)m_vResolution.y;
+
+		m_vViewportOffset = Vector2(0, 0);
+	}
+	m_rasterizer.setSurface(surface);
+
+	updateClipRect();
+}
+
+void SoftwareGraphicsInterface::addTriangle(Vector3 p0, Vector3 p1, Vector3 p2, Vector2 uv0, Vector2 uv1, Vector2 uv2, Color c0, Color c1, Color c2) {
+	m_rasterizer.addTriangle(transformVertex(p0, uv0, c0), transformVertex(p1, uv1, c1), transformVertex(p2, uv2, c2));
+}
+
+void SoftwareGraphicsInterface::addLine(Vector3 p0, Vector3 p1, Color c0, Color c1) {
+	m_rasterizer.addLine(transformVertex(p0, Vector2(), c0), transformVertex(p1, Vector2(), c1));
+}
+
+void SoftwareGraphicsInterface::onTransformUpdate(Matrix4& projectionMatrix, Matrix4& worldMatrix) {
+	m_MP = projectionMatrix * worldMatrix;
+}
+
+SoftwareRasterizer::VERTEX SoftwareGraphicsInterface::transformVertex(Vector3 pos, Vector2 uv, Color color) {
+	const float* m = m_MP.get();
+
+	const float clipX = m[0] * pos.x + m[4] * pos.y + m[8] * pos.z + m[12];
+	const float clipY = m[1] * pos.x + m[5] * pos.y + m[9] * pos.z + m[13];
+	const float clipW = m[3] * pos.x + m[7] * pos.y + m[11] * pos.z + m[15];
+
+	SoftwareRasterizer::VERTEX v;
+	if (clipW > 1e-6f) {
+		v.x = (clipX / clipW + 1.0f) * 0.5f * m_vResolution.x + m_vViewportOffset.x;
+		v.y = (1.0f - clipY / clipW) * 0.5f * m_vResolution.y + m_vViewportOffset.y;
+	} else {
+		// behind the camera, no near plane clipping, the rasterizer rejects the whole triangle
+		v.x = v.y = std::numeric_limits<float>::quiet_NaN();
+	}
+	v.u = uv.x;
+	v.v = uv.y;
+	v.r = COLOR_GET_Rf(color);
+	v.g = COLOR_GET_Gf(color);
+	v.b = COLOR_GET_Bf(color);
+	v.a = COLOR_GET_Af(color);
+	return v;
+}
+
+void SoftwareGraphicsInterface::updateState() {
+	m_rasterizer.setState(m_state);
+}
+
+void SoftwareGraphicsInterface::submitQuad(Vector3 p0, Vector3 p1, Vector3 p2, Vector3 p3, Vector2 uv0, Vector2 uv1, Vector2 uv2, Vector2 uv3, Color c0, Color c1, Color c2, Color c3) {
+	const SoftwareRasterizer::VERTEX v0 = transformVertex(p0, uv0, c0);
+	const SoftwareRasterizer::VERTEX v1 = transformVertex(p1, uv1, c1);
+	const SoftwareRasterizer::VERTEX v2 = transformVertex(p2, uv2, c2);
+	const SoftwareRasterizer::VERTEX v3 = transformVertex(p3, uv3, c3);
+
+	m_rasterizer.addTriangle(v0, v1, v2);
+	m_rasterizer.addTriangle(v0, v2, v3);
+}
+
+void SoftwareGraphicsInterface::updateClipRect() {
+	const SoftwareRasterizer::SURFACE& surface = m_rasterizer.getSurface();
+	if (m_bClipping) {
+		m_state.clipMinX = (int)(m_clipRect.getMinX() + m_vViewportOffset.x);
+		m_state.clipMinY = (int)(m_clipRect.getMinY() + m_vViewportOffset.y);
+		m_state.clipMaxX = (int)(m_clipRect.getMaxX() + m_vViewportOffset.x);
+		m_state.clipMaxY = (int)(m_clipRect.getMaxY() + m_vViewportOffset.y);
+	} else {
+		m_state.clipMinX = 0;
+		m_state.clipMinY = 0;
+		m_state.clipMaxX = surface.width;
+		m_state.clipMaxY = surface.height;
+	}
+	updateState();
+}
+
+
+
+//**************//
+//	Benchmarks  //
+//**************//
+
+void _sw_benchmark(UString args) {
+	SoftwareGraphicsInterface* g = dynamic_cast<SoftwareGraphicsInterface*>(engine->getGraphics());
+	if (g == NULL) {
+		debugLog("sw_benchmark: The software renderer is not active.\n");
+		return;
+	}
+
+	const int numFrames = (args.length() > 0 ? std::max(args.toInt(), 1) : 100);
+
+	// synthetic ui frame: full screen background, gradients, a few hundred alpha blended sprites/rects and some clipped rounded rects
+	SoftwareImage sprite(64, 64);
+	for (int y = 0; y < 64; y++) {
+		for (int x = 0; x < 64; x++) {
+			sprite.setPixel(x, y, COLOR((x + y) * 2, x * 4, y * 4, 255 - x * 2));
+		}
+	}
+	sprite.load();
+
+	const Vector2 res = g->getResolution();
+	const unsigned long long numTrianglesBefore = g->getRasterizer()->getNumTrianglesTotal();
+
+	Timer timer;
+	timer.start();
+	for (int frame = 0; frame < numFrames; frame++) {
+		g->beginScene();
+		{
+			g->fillGradient(0, 0, res.x, res.y, 0xff202040, 0xff202040, 0xff402020, 0xff402020);
+
+			for (int i = 0; i < 400; i++) {
+				g->pushTransform();
+				{
+					g->rotate((float)((i * 37 + frame) % 360));
+					g->translate((i * 53) % (int)std::max(res.x, 1.0f), (i * 97) % (int)std::max(res.y, 1.0f));
+					g->setColor(0xccffffff);
+					g->drawImage(&sprite);
+				}
+				g->popTransform();
+			}
+
+			g->setBlendMode(Graphics::BLEND_MODE::BLEND_MODE_ADDITIVE);
+			for (int i = 0; i < 100; i++) {
+				g->setColor(COLOR(64, i * 2, 128, 255 - i * 2));
+				g->fillRect((i * 31) % (int)std::max(res.x, 1.0f), (i * 17) % (int)std::max(res.y, 1.0f), 120, 40);
+			}
+			g->setBlendMode(Graphics::BLEND_MODE::BLEND_MODE_ALPHA);
+
+			g->pushClipRect(Rects(res.x * 0.25f, res.y * 0.25f, res.x * 0.5f, res.y * 0.5f));
+			for (int i = 0; i < 20; i++) {
+				g->setColor(0x88000000);
+				g->fillRoundedRect(i * 40, i * 20, 300, 80, 12);
+			}
+			g->popClipRect();
+		}
+		g->endScene();
+	}
+	timer.update();
+
+	const double totalMS = timer.getElapsedTime() * 1000.0;
+	const unsigned long long numTriangles = g->getRasterizer()->getNumTrianglesTotal() - numTrianglesBefore;
+	debugLog("sw_benchmark: %i frames at %ix%i with %i thread(s): %.3f ms/frame, %llu triangles/frame\n", numFrames, (int)res.x, (int)res.y, g->getRasterizer()->getNumThreads(), totalMS / numFrames, numTriangles / numFrames);
+}
+
+void _sw_screenshot(UString args) {
+	Graphics* g = engine->getGraphics();
+	if (dynamic_cast<SoftwareGraphicsInterface*>(g) == NULL) {
+		debugLog("sw_screenshot: The software renderer is not active.\n");
+		return;
+	}
+
+	const UString filePath = (args.length() > 0 ? args : UString("sw_screenshot.png"));
+	std::vector<unsigned char> pixels = g->getScreenshot();
+	if (pixels.size() < 1) return;
+
+	Image::saveToImage(&pixels[0], (unsigned int)g->getResolution().x, (unsigned int)g->getResolution().y, filePath);
+	debugLog("sw_screenshot: Saved %s\n", filePath.toUtf8());
+}
+
+ConVar _sw_benchmark_("sw_benchmark", "renders <num frames> (default 100) synthetic ui frames with the software renderer and prints the average frame time", _sw_benchmark);
+ConVar _sw_screenshot_("sw_screenshot", "saves the current software back buffer as a golden image to <file> (default sw_screenshot.png)", _sw_screenshot);
@@ -0,0 +1,147 @@
+#ifndef SOFTWAREGRAPHICSINTERFACE_H
+#define SOFTWAREGRAPHICSINTERFACE_H
+
+#include "cbase.h"
+
+#include "SoftwareRasterizer.h"
+
+class Image;
+class SoftwareRenderTarget;
+
+// cpu renderer, usable without any gpu/driver (headless servers, ci golden image tests, frame time benchmarks)
+// no depth buffer, attributes are interpolated affinely in screen space, shaders are not supported (NullShader)
+class SoftwareGraphicsInterface : public Graphics {
+public:
+	SoftwareGraphicsInterface();
+	virtual ~SoftwareGraphicsInterface();
+
+	// scene
+	virtual void beginScene();
+	virtual void endScene();
+
+	// depth buffer
+	virtual void clearDepthBuffer() { ; }
+
+	// color
+	virtual void setColor(Color color);
+	virtual void setAlpha(float alpha);
+
+	// 2d primitive drawing
+	virtual void drawPixels(int x, int y, int width, int height, Graphics::DRAWPIXELS_TYPE type, const void* pixels);
+	virtual void drawPixel(int x, int y);
+	virtual void drawLine(int x1, int y1, int x2, int y2);
+	virtual void drawLine(Vector2 pos1, Vector2 pos2);
+	virtual void drawRect(int x, int y, int width, int height);
+	virtual void drawRect(int x, int y, int width, int height, Color top, Color right, Color bottom, Color left);
+
+	virtual void fillRect(int x, int y, int width, int height);
+	virtual void fillRoundedRect(int x, int y, int width, int height, int radius);
+	virtual void fillGradient(int x, int y, int width, int height, Color topLeftColor, Color topRightColor, Color bottomLeftColor, Color bottomRightColor);
+
+	virtual void drawQuad(int x, int y, int width, int height);
+	virtual void drawQuad(Vector2 topLeft, Vector2 topRight, Vector2 bottomRight, Vector2 bottomLeft, Color topLeftColor, Color topRightColor, Color bottomRightColor, Color bottomLeftColor);
+
+	// 2d resource drawing
+	virtual void drawImage(Image* image);
+	virtual void drawString(TacoFont* font, UString text);
+
+	// 3d type drawing
+	virtual void drawVAO(VertexArrayObject* vao);
+
+	// DEPRECATED: 2d clipping
+	virtual void setClipRect(Rects clipRect);
+	virtual void pushClipRect(Rects clipRect);
+	virtual void popClipRect();
+
+	// stencil
+	virtual void pushStencil();
+	virtual void fillStencil(bool inside);
+	virtual void popStencil();
+
+	// renderer settings
+	virtual void setClipping(bool enabled);
+	virtual void setBlending(bool enabled);
+	virtual void setBlendMode(BLEND_MODE blendMode);
+	virtual void setDepthBuffer(bool enabled) { ; }
+	virtual void setCulling(bool culling) { ; }
+	virtual void setVSync(bool vsync) { ; }
+	virtual void setAntialiasing(bool aa) { ; }
+	virtual void setWireframe(bool enabled) { ; }
+
+	// renderer actions
+	virtual void flush();
+	virtual std::vector<unsigned char> getScreenshot();
+
+	// renderer info
+	virtual Vector2 getResolution() const { return m_vResolution; }
+	virtual UString getVendor();
+	virtual UString getModel();
+	virtual UString getVersion();
+	virtual int getVRAMTotal() { return -1; }
+	virtual int getVRAMRemaining() { return -1; }
+
+	// callbacks
+	virtual void onResolutionChange(Vector2 newResolution);
+
+	// factory
+	virtual Image* createImage(UString filePath, bool mipmapped, bool keepInSystemMemory);
+	virtual Image* createImage(int width, int height, bool mipmapped, bool keepInSystemMemory);
+	virtual RenderTarget* createRenderTarget(int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType);
+	virtual Shader* createShaderFromFile(UString vertexShaderFilePath, UString fragmentShaderFilePath);
+	virtual Shader* createShaderFromSource(UString vertexShader, UString fragmentShader);
+	virtual VertexArrayObject* createVertexArrayObject(Graphics::PRIMITIVE primitive, Graphics::USAGE_TYPE usage, bool keepInSystemMemory);
+
+	// ILLEGAL:
+	void bindTexture(const SoftwareRasterizer::TEXTURE& texture);
+	void unbindTexture();
+	void setTexturing(bool enabled); // primitives without texcoords always disable texturing
+	void setRenderTarget(SoftwareRenderTarget* rt); // NULL = back buffer
+	inline SoftwareRenderTarget* getRenderTarget() const { return m_renderTarget; }
+	void addTriangle(Vector3 p0, Vector3 p1, Vector3 p2, Vector2 uv0, Vector2 uv1, Vector2 uv2, Color c0, Color c1, Color c2);
+	void addLine(Vector3 p0, Vector3 p1, Color c0, Color c1);
+	inline bool hasBoundTexture() const { return m_bTextureBound; }
+	inline Color getColor() const { return m_color; }
+	inline SoftwareRasterizer* getRasterizer() { return &m_rasterizer; }
+
+protected:
+	virtual void init();
+	virtual void onTransformUpdate(Matrix4& projectionMatrix, Matrix4& worldMatrix);
+
+private:
+	static ConVar* r_sw_threads;
+	static ConVar* r_sw_tile_size;
+
+	SoftwareRasterizer::VERTEX transformVertex(Vector3 pos, Vector2 uv, Color color);
+	void updateState();
+	void submitQuad(Vector3 p0, Vector3 p1, Vector3 p2, Vector3 p3, Vector2 uv0, Vector2 uv1, Vector2 uv2, Vector2 uv3, Color c0, Color c1, Color c2, Color c3);
+	void updateClipRect();
+
+	// renderer
+	SoftwareRasterizer m_rasterizer;
+	bool m_bInScene;
+	Vector2 m_vResolution;
+
+	std::vector<Color> m_backBuffer;
+	std::vector<unsigned char> m_backBufferStencil;
+	SoftwareRenderTarget* m_renderTarget;
+	Vector2 m_vViewportOffset;
+
+	// transform
+	Matrix4 m_MP;
+
+	// persistent vars
+	Color m_color;
+	bool m_bTextureBound;
+	bool m_bTexturing;
+	SoftwareRasterizer::STATE m_state;
+
+	// clipping
+	bool m_bClipping;
+	Rects m_clipRect;
+	std::stack<Rects> m_clipRectStack;
+
+	// scratch
+	std::vector<Vector3> m_roundedRectOutline;
+};
+
+#endif // !SOFTWAREGRAPHICSINTERFACE_H
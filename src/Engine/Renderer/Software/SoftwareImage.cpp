@@ -0,0 +1,98 @@
+#include "SoftwareImage.h"
+
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "ResourceManager/ResourceManager.h"
+#include "SoftwareGraphicsInterface.h"
+
+SoftwareImage::SoftwareImage(UString filePath, bool mipmapped, bool keepInSystemMemory) : Image(filePath, mipmapped, keepInSystemMemory) {
+	m_filterMode = Graphics::FILTER_MODE::FILTER_MODE_LINEAR;
+	m_wrapMode = Graphics::WRAP_MODE::WRAP_MODE_CLAMP;
+}
+
+SoftwareImage::SoftwareImage(int width, int height, bool mipmapped, bool keepInSystemMemory) : Image(width, height, mipmapped, keepInSystemMemory) {
+	m_filterMode = Graphics::FILTER_MODE::FILTER_MODE_LINEAR;
+	m_wrapMode = Graphics::WRAP_MODE::WRAP_MODE_CLAMP;
+}
+
+void SoftwareImage::init() {
+	if ((m_texels.size() > 0 && !m_bKeepInSystemMemory) || !m_bAsyncReady) return; // only load if we are not already loaded
+
+	const size_t numPixels = (size_t)m_iWidth * (size_t)m_iHeight;
+	if (numPixels < 1 || m_iNumChannels < 1 || m_rawImage.size() < numPixels * (size_t)m_iNumChannels) {
+		debugLog("Software Image Error: Invalid image data on file %s!\n", m_sFilePath.toUtf8());
+		return;
+	}
+
+	// convert to ARGB
+	m_texels.resize(numPixels);
+	const unsigned char* src = &m_rawImage[0];
+	for (size_t i = 0; i < numPixels; i++, src += m_iNumChannels) {
+		switch (m_iNumChannels) {
+		case 1:
+			m_texels[i] = COLOR(255, src[0], src[0], src[0]);
+			break;
+		case 3:
+			m_texels[i] = COLOR(255, src[0], src[1], src[2]);
+			break;
+		default:
+			m_texels[i] = COLOR(src[3], src[0], src[1], src[2]);
+			break;
+		}
+	}
+
+	// free memory
+	if (!m_bKeepInSystemMemory)
+		m_rawImage = std::vector<unsigned char>();
+
+	m_bReady = true;
+}
+
+void SoftwareImage::initAsync() {
+	if (m_texels.size() > 0) return; // only load if we are not already loaded
+
+	if (!m_bCreatedImage) {
+		if (ResourceManager::debug_rm->getBool())
+			debugLog("Resource Manager: Loading %s\n", m_sFilePath.toUtf8());
+
+		m_bAsyncReady = loadRawImage();
+	} else
+		m_bAsyncReady = true;
+}
+
+void SoftwareImage::destroy() {
+	// the rasterizer may still reference our texels in queued triangles
+	if (m_texels.size() > 0 && engine->getGraphics() != NULL)
+		engine->getGraphics()->flush();
+
+	m_texels = std::vector<Color>();
+	m_rawImage = std::vector<unsigned char>();
+}
+
+void SoftwareImage::bind(unsigned int textureUnit) {
+	if (!m_bReady || textureUnit != 0 || m_texels.size() < 1) return;
+
+	SoftwareRasterizer::TEXTURE texture;
+	texture.texels = &m_texels[0];
+	texture.width = m_iWidth;
+	texture.height = m_iHeight;
+	texture.linear = (m_filterMode != Graphics::FILTER_MODE::FILTER_MODE_NONE);
+	texture.repeat = (m_wrapMode == Graphics::WRAP_MODE::WRAP_MODE_REPEAT);
+	texture.flipY = false;
+
+	((SoftwareGraphicsInterface*)engine->getGraphics())->bindTexture(texture);
+}
+
+void SoftwareImage::unbind() {
+	if (!m_bReady) return;
+
+	((SoftwareGraphicsInterface*)engine->getGraphics())->unbindTexture();
+}
+
+void SoftwareImage::setFilterMode(Graphics::FILTER_MODE filterMode) {
+	m_filterMode = filterMode;
+}
+
+void SoftwareImage::setWrapMode(Graphics::WRAP_MODE wrapMode) {
+	m_wrapMode = wrapMode;
+}
@@ -0,0 +1,28 @@
+#ifndef SOFTWAREIMAGE_H
+#define SOFTWAREIMAGE_H
+
+#include "Image/Image.h"
+
+class SoftwareImage : public Image {
+public:
+	SoftwareImage(UString filePath, bool mipmapped = false, bool keepInSystemMemory = false);
+	SoftwareImage(int width, int height, bool mipmapped = false, bool keepInSystemMemory = false);
+	virtual ~SoftwareImage() { destroy(); }
+
+	virtual void bind(unsigned int textureUnit = 0);
+	virtual void unbind();
+
+	virtual void setFilterMode(Graphics::FILTER_MODE filterMode);
+	virtual void setWrapMode(Graphics::WRAP_MODE wrapMode);
+
+private:
+	virtual void init();
+	virtual void initAsync();
+	virtual void destroy();
+
+	std::vector<Color> m_texels; // converted to the native framebuffer format once on load
+	Graphics::FILTER_MODE m_filterMode;
+	Graphics::WRAP_MODE m_wrapMode;
+};
+
+#endif // !SOFTWAREIMAGE_H
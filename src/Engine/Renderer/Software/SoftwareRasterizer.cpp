@@ -0,0 +1,631 @@
+#include "SoftwareRasterizer.h"
+
+#include "Engine.h"
+#include "Thread/Thread.h"
+#include "Profiler/Profiler.h"
+
+#include <thread>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARERASTERIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+// minimum number of triangles per flush before the worker threads are woken up
+#define SOFTWARERASTERIZER_MIN_TRIANGLES_PER_THREAD 16
+
+
+
+//*****************//
+//	Pixel Helpers  //
+//*****************//
+
+// 4 floats in memory pixel order (b, g, r, a), scalar fallback for non-sse2 targets (e.g. arm)
+#ifdef SOFTWARERASTERIZER_SSE2
+
+struct F4 {
+	__m128 v;
+};
+
+static inline F4 f4(float b, float g, float r, float a) { F4 o; o.v = _mm_set_ps(a, r, g, b); return o; }
+static inline F4 f4splat(float x) { F4 o; o.v = _mm_set1_ps(x); return o; }
+static inline F4 f4add(F4 x, F4 y) { F4 o; o.v = _mm_add_ps(x.v, y.v); return o; }
+static inline F4 f4mul(F4 x, F4 y) { F4 o; o.v = _mm_mul_ps(x.v, y.v); return o; }
+static inline F4 f4lerp(F4 x, F4 y, float t) { F4 o; o.v = _mm_add_ps(x.v, _mm_mul_ps(_mm_sub_ps(y.v, x.v), _mm_set1_ps(t))); return o; }
+static inline F4 f4saturate(F4 x) { F4 o; o.v = _mm_min_ps(_mm_max_ps(x.v, _mm_setzero_ps()), _mm_set1_ps(1.0f)); return o; }
+static inline float f4alpha(F4 x) { return _mm_cvtss_f32(_mm_shuffle_ps(x.v, x.v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+static inline F4 f4load(Color c) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i px = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)c), zero), zero);
+	F4 o;
+	o.v = _mm_mul_ps(_mm_cvtepi32_ps(px), _mm_set1_ps(1.0f / 255.0f));
+	return o;
+}
+
+static inline Color f4store(F4 x) {
+	const __m128i px = _mm_cvtps_epi32(_mm_mul_ps(f4saturate(x).v, _mm_set1_ps(255.0f)));
+	const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(px, px), px);
+	return (Color)_mm_cvtsi128_si32(packed);
+}
+
+#else
+
+struct F4 {
+	float v[4];
+};
+
+static inline F4 f4(float b, float g, float r, float a) { F4 o; o.v[0] = b; o.v[1] = g; o.v[2] = r; o.v[3] = a; return o; }
+static inline F4 f4splat(float x) { return f4(x, x, x, x); }
+static inline F4 f4add(F4 x, F4 y) { return f4(x.v[0] + y.v[0], x.v[1] + y.v[1], x.v[2] + y.v[2], x.v[3] + y.v[3]); }
+static inline F4 f4mul(F4 x, F4 y) { return f4(x.v[0] * y.v[0], x.v[1] * y.v[1], x.v[2] * y.v[2], x.v[3] * y.v[3]); }
+static inline F4 f4lerp(F4 x, F4 y, float t) { return f4(x.v[0] + (y.v[0] - x.v[0]) * t, x.v[1] + (y.v[1] - x.v[1]) * t, x.v[2] + (y.v[2] - x.v[2]) * t, x.v[3] + (y.v[3] - x.v[3]) * t); }
+static inline F4 f4saturate(F4 x) { return f4(clamp<float>(x.v[0], 0.0f, 1.0f), clamp<float>(x.v[1], 0.0f, 1.0f), clamp<float>(x.v[2], 0.0f, 1.0f), clamp<float>(x.v[3], 0.0f, 1.0f)); }
+static inline float f4alpha(F4 x) { return x.v[3]; }
+
+static inline F4 f4load(Color c) {
+	return f4((c & 0xff) / 255.0f, ((c >> 8) & 0xff) / 255.0f, ((c >> 16) & 0xff) / 255.0f, ((c >> 24) & 0xff) / 255.0f);
+}
+
+static inline Color f4store(F4 x) {
+	x = f4saturate(x);
+	return (Color)((int)(x.v[0] * 255.0f + 0.5f) | ((int)(x.v[1] * 255.0f + 0.5f) << 8) | ((int)(x.v[2] * 255.0f + 0.5f) << 16) | ((int)(x.v[3] * 255.0f + 0.5f) << 24));
+}
+
+#endif
+
+static inline int wrapTexel(int i, int size, bool repeat) {
+	if (repeat) {
+		i %= size;
+		return (i < 0 ? i + size : i);
+	}
+	return (i < 0 ? 0 : (i >= size ? size - 1 : i));
+}
+
+static inline Color fetchTexel(const SoftwareRasterizer::TEXTURE& tex, int x, int y) {
+	x = wrapTexel(x, tex.width, tex.repeat);
+	y = wrapTexel(y, tex.height, tex.repeat);
+	if (tex.flipY)
+		y = tex.height - 1 - y;
+	return tex.texels[y * tex.width + x];
+}
+
+static inline F4 sampleTexture(const SoftwareRasterizer::TEXTURE& tex, float u, float v) {
+	const float fu = u * tex.width;
+	const float fv = v * tex.height;
+
+	if (!tex.linear)
+		return f4load(fetchTexel(tex, (int)std::floor(fu), (int)std::floor(fv)));
+
+	const float su = fu - 0.5f;
+	const float sv = fv - 0.5f;
+	const float fx = std::floor(su);
+	const float fy = std::floor(sv);
+	const int x = (int)fx;
+	const int y = (int)fy;
+	const float tx = su - fx;
+	const float ty = sv - fy;
+
+	const F4 top = f4lerp(f4load(fetchTexel(tex, x, y)), f4load(fetchTexel(tex, x + 1, y)), tx);
+	const F4 bottom = f4lerp(f4load(fetchTexel(tex, x, y + 1)), f4load(fetchTexel(tex, x + 1, y + 1)), tx);
+	return f4lerp(top, bottom, ty);
+}
+
+static inline F4 blendPixel(F4 src, F4 dst, bool blending, Graphics::BLEND_MODE blendMode) {
+	if (!blending)
+		return src;
+
+	const float sa = f4alpha(src);
+	switch (blendMode) {
+	case Graphics::BLEND_MODE::BLEND_MODE_ALPHA:
+		return f4add(f4mul(src, f4splat(sa)), f4mul(dst, f4splat(1.0f - sa)));
+	case Graphics::BLEND_MODE::BLEND_MODE_ADDITIVE:
+		return f4add(f4mul(src, f4splat(sa)), dst);
+	case Graphics::BLEND_MODE::BLEND_MODE_PREMUL_ALPHA:
+		return f4add(f4mul(src, f4(sa, sa, sa, 1.0f)), f4mul(dst, f4splat(1.0f - sa)));
+	case Graphics::BLEND_MODE::BLEND_MODE_PREMUL_COLOR:
+		return f4add(src, f4mul(dst, f4splat(1.0f - sa)));
+	}
+	return src;
+}
+
+// opaque constant color span
+static inline void fillSpanSolid(Color* dst, int count, Color color) {
+	int i = 0;
+#ifdef SOFTWARERASTERIZER_SSE2
+	const __m128i c = _mm_set1_epi32((int)color);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_si128((__m128i*)(dst + i), c);
+	}
+#endif
+	for (; i < count; i++) {
+		dst[i] = color;
+	}
+}
+
+// BLEND_MODE_ALPHA constant color span, dst = (src * sa + dst * (255 - sa)) / 255 on all four channels
+static inline void fillSpanBlendAlpha(Color* dst, int count, Color color) {
+	const unsigned int sa = (color >> 24) & 0xff;
+	const unsigned int invSa = 255 - sa;
+
+	int i = 0;
+#ifdef SOFTWARERASTERIZER_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i srcMul = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero), _mm_set1_epi16((short)sa));
+	const __m128i invAlpha = _mm_set1_epi16((short)invSa);
+	const __m128i bias = _mm_set1_epi16(128);
+	for (; i + 4 <= count; i += 4) {
+		const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+
+		__m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), invAlpha), srcMul), bias);
+		__m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), invAlpha), srcMul), bias);
+
+		// exact division by 255
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+#endif
+	for (; i < count; i++) {
+		const Color d = dst[i];
+		Color out = 0;
+		for (int shift = 0; shift < 32; shift += 8) {
+			unsigned int x = ((color >> shift) & 0xff) * sa + ((d >> shift) & 0xff) * invSa + 128;
+			x = (x + (x >> 8)) >> 8;
+			out |= (x << shift);
+		}
+		dst[i] = out;
+	}
+}
+
+
+
+//*********************//
+//	SoftwareRasterizer  //
+//*********************//
+
+SoftwareRasterizer::SoftwareRasterizer() {
+	m_surface.pixels = NULL;
+	m_surface.stencil = NULL;
+	m_surface.width = 0;
+	m_surface.height = 0;
+
+	m_bStateDirty = true;
+	m_pendingState.hasTexture = false;
+	m_pendingState.texture.texels = NULL;
+	m_pendingState.texture.width = 0;
+	m_pendingState.texture.height = 0;
+	m_pendingState.texture.linear = false;
+	m_pendingState.texture.repeat = false;
+	m_pendingState.texture.flipY = false;
+	m_pendingState.blending = true;
+	m_pendingState.blendMode = Graphics::BLEND_MODE::BLEND_MODE_ALPHA;
+	m_pendingState.stencilMode = STENCIL_MODE::STENCIL_MODE_NONE;
+	m_pendingState.clipMinX = 0;
+	m_pendingState.clipMinY = 0;
+	m_pendingState.clipMaxX = 0;
+	m_pendingState.clipMaxY = 0;
+
+	m_iTileSize = 64;
+	m_iNumTilesX = 0;
+	m_iNumTilesY = 0;
+	m_iNextTile = 0;
+
+	m_iNumThreadsRequested = 1;
+	m_iWorkGeneration = 0;
+	m_iNumBusyWorkers = 0;
+	m_bWorkersRunning = false;
+
+	m_iNumTrianglesTotal = 0;
+
+	m_triangles.reserve(4096);
+	m_states.reserve(256);
+}
+
+SoftwareRasterizer::~SoftwareRasterizer() {
+	stopWorkers();
+}
+
+void SoftwareRasterizer::setSurface(const SURFACE& surface) {
+	flush();
+	m_surface = surface;
+}
+
+void SoftwareRasterizer::setState(const STATE& state) {
+	if (!m_bStateDirty && isSameState(state, m_pendingState)) return;
+
+	m_pendingState = state;
+	m_bStateDirty = true;
+}
+
+void SoftwareRasterizer::addTriangle(const VERTEX& v0, const VERTEX& v1, const VERTEX& v2) {
+	if (m_surface.pixels == NULL) return;
+
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	if (!(std::abs(area) > 1e-8f)) return; // also rejects NaNs
+
+	// orient counter clockwise (in y-down screen space), so that the inside of all edges is positive
+	const VERTEX* p[3] = { &v0, &v1, &v2 };
+	if (area < 0.0f) {
+		std::swap(p[1], p[2]);
+		area = -area;
+	}
+
+	const STATE& state = m_pendingState;
+
+	// clipped bounds
+	const int clipMinX = std::max(state.clipMinX, 0);
+	const int clipMinY = std::max(state.clipMinY, 0);
+	const int clipMaxX = std::min(state.clipMaxX, m_surface.width);
+	const int clipMaxY = std::min(state.clipMaxY, m_surface.height);
+
+	const float minX = std::max(std::min(p[0]->x, std::min(p[1]->x, p[2]->x)), (float)clipMinX);
+	const float minY = std::max(std::min(p[0]->y, std::min(p[1]->y, p[2]->y)), (float)clipMinY);
+	const float maxX = std::min(std::max(p[0]->x, std::max(p[1]->x, p[2]->x)), (float)clipMaxX);
+	const float maxY = std::min(std::max(p[0]->y, std::max(p[1]->y, p[2]->y)), (float)clipMaxY);
+
+	TRIANGLE tri;
+	tri.minX = (int)std::floor(minX);
+	tri.minY = (int)std::floor(minY);
+	tri.maxX = std::min((int)std::ceil(maxX), clipMaxX) - 1;
+	tri.maxY = std::min((int)std::ceil(maxY), clipMaxY) - 1;
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY) return;
+
+	// edge i is opposite of vertex i, so E_i / area is the barycentric weight of vertex i
+	const float invArea = 1.0f / area;
+	for (int i = 0; i < 3; i++) {
+		const VERTEX* a = p[(i + 1) % 3];
+		const VERTEX* b = p[(i + 2) % 3];
+
+		tri.edgeA[i] = a->y - b->y;
+		tri.edgeB[i] = b->x - a->x;
+		tri.edgeC[i] = a->x * b->y - b->x * a->y;
+
+		// top-left rule: a shared edge has negated coefficients in the neighbouring triangle, so exactly one of them owns it
+		tri.edgeInclusive[i] = (tri.edgeA[i] > 0.0f || (tri.edgeA[i] == 0.0f && tri.edgeB[i] > 0.0f));
+	}
+
+	const float attributes[6][3] = {
+		{ p[0]->b, p[1]->b, p[2]->b },
+		{ p[0]->g, p[1]->g, p[2]->g },
+		{ p[0]->r, p[1]->r, p[2]->r },
+		{ p[0]->a, p[1]->a, p[2]->a },
+		{ p[0]->u, p[1]->u, p[2]->u },
+		{ p[0]->v, p[1]->v, p[2]->v }
+	};
+	PLANE planes[6];
+	for (int a = 0; a < 6; a++) {
+		planes[a].dx = (tri.edgeA[0] * attributes[a][0] + tri.edgeA[1] * attributes[a][1] + tri.edgeA[2] * attributes[a][2]) * invArea;
+		planes[a].dy = (tri.edgeB[0] * attributes[a][0] + tri.edgeB[1] * attributes[a][1] + tri.edgeB[2] * attributes[a][2]) * invArea;
+		planes[a].c = (tri.edgeC[0] * attributes[a][0] + tri.edgeC[1] * attributes[a][1] + tri.edgeC[2] * attributes[a][2]) * invArea;
+	}
+	for (int c = 0; c < 4; c++) {
+		tri.color[c] = planes[c];
+	}
+	tri.u = planes[4];
+	tri.v = planes[5];
+
+	tri.constantColor = (p[0]->r == p[1]->r && p[1]->r == p[2]->r
+		&& p[0]->g == p[1]->g && p[1]->g == p[2]->g
+		&& p[0]->b == p[1]->b && p[1]->b == p[2]->b
+		&& p[0]->a == p[1]->a && p[1]->a == p[2]->a);
+	if (tri.constantColor) {
+		const float constant[4] = { p[0]->b, p[0]->g, p[0]->r, p[0]->a };
+		for (int c = 0; c < 4; c++) {
+			tri.color[c].dx = 0.0f;
+			tri.color[c].dy = 0.0f;
+			tri.color[c].c = constant[c];
+		}
+	}
+
+	if (m_bStateDirty) {
+		m_states.push_back(m_pendingState);
+		m_bStateDirty = false;
+	}
+	tri.stateIndex = (int)m_states.size() - 1;
+
+	m_triangles.push_back(tri);
+	m_iNumTrianglesTotal++;
+}
+
+void SoftwareRasterizer::addLine(const VERTEX& v0, const VERTEX& v1) {
+	// 1 pixel wide quad along the line
+	const float dx = v1.x - v0.x;
+	const float dy = v1.y - v0.y;
+	const float length = std::sqrt(dx * dx + dy * dy);
+	if (length < 1e-6f) return;
+
+	const float nx = -dy / length * 0.5f;
+	const float ny = dx / length * 0.5f;
+
+	VERTEX a = v0, b = v0, c = v1, d = v1;
+	a.x += nx; a.y += ny;
+	b.x -= nx; b.y -= ny;
+	c.x -= nx; c.y -= ny;
+	d.x += nx; d.y += ny;
+
+	addTriangle(a, b, c);
+	addTriangle(a, c, d);
+}
+
+void SoftwareRasterizer::flush() {
+	VPROF_BUDGET("SoftwareRasterizer::flush", VPROF_BUDGETGROUP_DRAW);
+
+	if (m_triangles.size() < 1 || m_surface.pixels == NULL) {
+		m_triangles.clear();
+		m_states.clear();
+		m_bStateDirty = true;
+		return;
+	}
+
+	// bin
+	m_iNumTilesX = (m_surface.width + m_iTileSize - 1) / m_iTileSize;
+	m_iNumTilesY = (m_surface.height + m_iTileSize - 1) / m_iTileSize;
+	const size_t numTiles = (size_t)(m_iNumTilesX * m_iNumTilesY);
+	if (m_tileBins.size() < numTiles)
+		m_tileBins.resize(numTiles);
+	for (size_t i = 0; i < numTiles; i++) {
+		m_tileBins[i].clear();
+	}
+
+	for (size_t i = 0; i < m_triangles.size(); i++) {
+		const TRIANGLE& tri = m_triangles[i];
+		const int tx0 = tri.minX / m_iTileSize;
+		const int ty0 = tri.minY / m_iTileSize;
+		const int tx1 = tri.maxX / m_iTileSize;
+		const int ty1 = tri.maxY / m_iTileSize;
+		for (int ty = ty0; ty <= ty1; ty++) {
+			for (int tx = tx0; tx <= tx1; tx++) {
+				m_tileBins[ty * m_iNumTilesX + tx].push_back((int)i);
+			}
+		}
+	}
+
+	// rasterize
+	m_iNextTile = 0;
+	if (m_threads.size() < 1 || m_triangles.size() < SOFTWARERASTERIZER_MIN_TRIANGLES_PER_THREAD)
+		processTiles();
+	else {
+		{
+			std::lock_guard<std::mutex> lock(m_workMutex);
+			m_iNumBusyWorkers = (int)m_threads.size();
+			m_iWorkGeneration++;
+		}
+		m_workCondition.notify_all();
+
+		// the calling thread helps out
+		processTiles();
+
+		std::unique_lock<std::mutex> lock(m_workMutex);
+		m_doneCondition.wait(lock, [this] { return m_iNumBusyWorkers == 0; });
+	}
+
+	m_triangles.clear();
+	m_states.clear();
+	m_bStateDirty = true;
+}
+
+void SoftwareRasterizer::clear(Color color) {
+	flush();
+	if (m_surface.pixels == NULL) return;
+
+	fillSpanSolid(m_surface.pixels, m_surface.width * m_surface.height, color);
+}
+
+void SoftwareRasterizer::clearStencil() {
+	flush();
+	if (m_surface.stencil == NULL) return;
+
+	std::memset(m_surface.stencil, 0, (size_t)m_surface.width * (size_t)m_surface.height);
+}
+
+void SoftwareRasterizer::setNumThreads(int numThreads) {
+	if (numThreads < 1)
+		numThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+	if (numThreads == m_iNumThreadsRequested) return;
+
+	flush();
+	stopWorkers();
+	m_iNumThreadsRequested = numThreads;
+	startWorkers();
+}
+
+void SoftwareRasterizer::setTileSize(int tileSize) {
+	flush();
+	m_iTileSize = clamp<int>(tileSize, 8, 1024);
+}
+
+bool SoftwareRasterizer::isSameState(const STATE& a, const STATE& b) {
+	return (a.hasTexture == b.hasTexture
+		&& (!a.hasTexture || (a.texture.texels == b.texture.texels && a.texture.width == b.texture.width && a.texture.height == b.texture.height && a.texture.linear == b.texture.linear && a.texture.repeat == b.texture.repeat && a.texture.flipY == b.texture.flipY))
+		&& a.blending == b.blending
+		&& a.blendMode == b.blendMode
+		&& a.stencilMode == b.stencilMode
+		&& a.clipMinX == b.clipMinX && a.clipMinY == b.clipMinY && a.clipMaxX == b.clipMaxX && a.clipMaxY == b.clipMaxY);
+}
+
+void SoftwareRasterizer::processTiles() {
+	const int numTiles = m_iNumTilesX * m_iNumTilesY;
+	while (true) {
+		const int tileIndex = m_iNextTile.fetch_add(1);
+		if (tileIndex >= numTiles) break;
+
+		rasterizeTile(tileIndex);
+	}
+}
+
+void SoftwareRasterizer::rasterizeTile(int tileIndex) {
+	const std::vector<int>& bin = m_tileBins[tileIndex];
+	if (bin.size() < 1) return;
+
+	const int tileMinX = (tileIndex % m_iNumTilesX) * m_iTileSize;
+	const int tileMinY = (tileIndex / m_iNumTilesX) * m_iTileSize;
+	const int tileMaxX = std::min(tileMinX + m_iTileSize, m_surface.width) - 1;
+	const int tileMaxY = std::min(tileMinY + m_iTileSize, m_surface.height) - 1;
+
+	for (size_t i = 0; i < bin.size(); i++) {
+		const TRIANGLE& tri = m_triangles[bin[i]];
+		rasterizeTriangle(tri, m_states[tri.stateIndex], tileMinX, tileMinY, tileMaxX, tileMaxY);
+	}
+}
+
+void SoftwareRasterizer::rasterizeTriangle(const TRIANGLE& tri, const STATE& state, int tileMinX, int tileMinY, int tileMaxX, int tileMaxY) {
+	const int y0 = std::max(tri.minY, tileMinY);
+	const int y1 = std::min(tri.maxY, tileMaxY);
+	const int x0 = std::max(tri.minX, tileMinX);
+	const int x1 = std::min(tri.maxX, tileMaxX);
+	if (x0 > x1 || y0 > y1) return;
+
+	// pick the span filler once per triangle
+	const bool stencilWrite = (state.stencilMode == STENCIL_MODE::STENCIL_MODE_WRITE);
+	const bool stencilTest = (state.stencilMode == STENCIL_MODE::STENCIL_MODE_TEST_INSIDE || state.stencilMode == STENCIL_MODE::STENCIL_MODE_TEST_OUTSIDE);
+	const unsigned char stencilPass = (state.stencilMode == STENCIL_MODE::STENCIL_MODE_TEST_INSIDE ? 1 : 0);
+
+	Color constantColor = 0;
+	bool solidFill = false;
+	bool alphaFill = false;
+	if (tri.constantColor && !state.hasTexture && !stencilWrite && !stencilTest) {
+		const F4 color = f4(tri.color[0].c, tri.color[1].c, tri.color[2].c, tri.color[3].c);
+		constantColor = f4store(color);
+
+		const float alpha = clamp<float>(tri.color[3].c, 0.0f, 1.0f);
+		solidFill = (!state.blending || (state.blendMode != Graphics::BLEND_MODE::BLEND_MODE_ADDITIVE && alpha >= 1.0f));
+		alphaFill = (!solidFill && state.blendMode == Graphics::BLEND_MODE::BLEND_MODE_ALPHA);
+	}
+
+	for (int y = y0; y <= y1; y++) {
+		const float yc = (float)y + 0.5f;
+
+		// intersect the row with all three half spaces
+		int left = x0;
+		int right = x1;
+		bool empty = false;
+		for (int e = 0; e < 3; e++) {
+			const float a = tri.edgeA[e];
+			const float value = tri.edgeB[e] * yc + tri.edgeC[e];
+			if (a == 0.0f) {
+				if (value < 0.0f || (value == 0.0f && !tri.edgeInclusive[e])) {
+					empty = true;
+					break;
+				}
+				continue;
+			}
+
+			const float xs = clamp<float>(-value / a - 0.5f, (float)x0 - 2.0f, (float)x1 + 2.0f);
+			if (a > 0.0f)
+				left = std::max(left, tri.edgeInclusive[e] ? (int)std::ceil(xs) : (int)std::floor(xs) + 1);
+			else
+				right = std::min(right, tri.edgeInclusive[e] ? (int)std::floor(xs) : (int)std::ceil(xs) - 1);
+		}
+		if (empty || left > right) continue;
+
+		const int count = right - left + 1;
+		Color* dst = m_surface.pixels + (size_t)y * (size_t)m_surface.width + left;
+
+		if (stencilWrite) {
+			if (m_surface.stencil != NULL)
+				std::memset(m_surface.stencil + (size_t)y * (size_t)m_surface.width + left, 1, (size_t)count);
+			continue;
+		}
+		if (solidFill) {
+			fillSpanSolid(dst, count, constantColor);
+			continue;
+		}
+		if (alphaFill) {
+			fillSpanBlendAlpha(dst, count, constantColor);
+			continue;
+		}
+
+		// generic per pixel path
+		const float xc = (float)left + 0.5f;
+		F4 color = f4(tri.color[0].dx * xc + tri.color[0].dy * yc + tri.color[0].c,
+			tri.color[1].dx * xc + tri.color[1].dy * yc + tri.color[1].c,
+			tri.color[2].dx * xc + tri.color[2].dy * yc + tri.color[2].c,
+			tri.color[3].dx * xc + tri.color[3].dy * yc + tri.color[3].c);
+		const F4 colorStep = f4(tri.color[0].dx, tri.color[1].dx, tri.color[2].dx, tri.color[3].dx);
+
+		float u = tri.u.dx * xc + tri.u.dy * yc + tri.u.c;
+		float v = tri.v.dx * xc + tri.v.dy * yc + tri.v.c;
+
+		const unsigned char* stencil = (m_surface.stencil != NULL ? m_surface.stencil + (size_t)y * (size_t)m_surface.width + left : NULL);
+
+		for (int i = 0; i < count; i++) {
+			if (!stencilTest || stencil == NULL || ((stencil[i] != 0 ? 1 : 0) == stencilPass)) {
+				F4 src = f4saturate(color);
+				if (state.hasTexture)
+					src = f4mul(src, sampleTexture(state.texture, u, v));
+
+				dst[i] = f4store(blendPixel(src, f4load(dst[i]), state.blending, state.blendMode));
+			}
+
+			color = f4add(color, colorStep);
+			u += tri.u.dx;
+			v += tri.v.dx;
+		}
+	}
+}
+
+void *SoftwareRasterizer::workerThread(void *data) {
+	SoftwareRasterizer* self = (SoftwareRasterizer*)data;
+
+	unsigned long long seenGeneration = 0; // workers are only (re)started while the generation is 0
+	VPROF_THREAD_NAME("SoftwareRasterizer");
+	while (true) {
+		VPROF_THREAD_FRAME();
+
+		{
+			std::unique_lock<std::mutex> lock(self->m_workMutex);
+			self->m_workCondition.wait(lock, [self, seenGeneration] { return !self->m_bWorkersRunning || self->m_iWorkGeneration != seenGeneration; });
+			if (!self->m_bWorkersRunning) break;
+
+			seenGeneration = self->m_iWorkGeneration;
+		}
+
+		{
+			VPROF_BUDGET("SoftwareRasterizer::processTiles", VPROF_BUDGETGROUP_DRAW);
+			self->processTiles();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(self->m_workMutex);
+			if (--self->m_iNumBusyWorkers == 0)
+				self->m_doneCondition.notify_all();
+		}
+	}
+
+	return NULL;
+}
+
+void SoftwareRasterizer::startWorkers() {
+	{
+		std::lock_guard<std::mutex> lock(m_workMutex);
+		m_bWorkersRunning = true;
+		m_iWorkGeneration = 0;
+		m_iNumBusyWorkers = 0;
+	}
+
+	for (int i = 0; i < m_iNumThreadsRequested - 1; i++) {
+		TacoThread* thread = new TacoThread(SoftwareRasterizer::workerThread, (void*)this);
+		if (!thread->isReady()) {
+			debugLog("SoftwareRasterizer: Couldn't create worker thread #%i!\n", i);
+			delete thread;
+			break;
+		}
+		m_threads.push_back(thread);
+	}
+}
+
+void SoftwareRasterizer::stopWorkers() {
+	{
+		std::lock_guard<std::mutex> lock(m_workMutex);
+		m_bWorkersRunning = false;
+	}
+	m_workCondition.notify_all();
+
+	for (size_t i = 0; i < m_threads.size(); i++) {
+		delete m_threads[i]; // joins
+	}
+	m_threads.clear();
+}
@@ -0,0 +1,144 @@
+#ifndef SOFTWARERASTERIZER_H
+#define SOFTWARERASTERIZER_H
+
+#include "cbase.h"
+
+#include <mutex>
+#include <condition_variable>
+
+class TacoThread;
+
+// tile based cpu triangle rasterizer used by SoftwareGraphicsInterface
+// triangles are set up immediately, binned into tiles on flush(), and the tiles are then filled in parallel
+// every tile walks its triangles in submission order, so the output is deterministic regardless of the thread count
+class SoftwareRasterizer {
+public:
+	enum class STENCIL_MODE {
+		STENCIL_MODE_NONE,
+		STENCIL_MODE_WRITE,			// write 1 into the stencil buffer, no color output
+		STENCIL_MODE_TEST_INSIDE,	// only draw where the stencil buffer is set
+		STENCIL_MODE_TEST_OUTSIDE	// only draw where the stencil buffer is not set
+	};
+
+	struct SURFACE {
+		Color* pixels;
+		unsigned char* stencil;
+		int width;
+		int height;
+	};
+
+	struct TEXTURE {
+		const Color* texels;
+		int width;
+		int height;
+		bool linear;
+		bool repeat;
+		bool flipY; // rendertargets are stored top-down, but sampled like opengl framebuffers (bottom-up)
+	};
+
+	struct STATE {
+		bool hasTexture;
+		TEXTURE texture;
+
+		bool blending;
+		Graphics::BLEND_MODE blendMode;
+		STENCIL_MODE stencilMode;
+
+		// inclusive min, exclusive max
+		int clipMinX;
+		int clipMinY;
+		int clipMaxX;
+		int clipMaxY;
+	};
+
+	// screen space vertex, colors are 0-1 floats
+	struct VERTEX {
+		float x, y;
+		float u, v;
+		float r, g, b, a;
+	};
+
+public:
+	SoftwareRasterizer();
+	~SoftwareRasterizer();
+
+	void setSurface(const SURFACE& surface);
+	void setState(const STATE& state);
+
+	void addTriangle(const VERTEX& v0, const VERTEX& v1, const VERTEX& v2);
+	void addLine(const VERTEX& v0, const VERTEX& v1);
+
+	void flush();
+	void clear(Color color);
+	void clearStencil();
+
+	void setNumThreads(int numThreads);
+	void setTileSize(int tileSize);
+
+	inline const SURFACE& getSurface() const { return m_surface; }
+	inline int getNumThreads() const { return (int)m_threads.size() + 1; }
+	inline size_t getNumPendingTriangles() const { return m_triangles.size(); }
+	inline unsigned long long getNumTrianglesTotal() const { return m_iNumTrianglesTotal; }
+
+private:
+	// attribute plane equations, value(x, y) = dx * x + dy * y + c
+	struct PLANE {
+		float dx, dy, c;
+	};
+
+	struct TRIANGLE {
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		bool edgeInclusive[3];
+
+		PLANE color[4]; // b, g, r, a (same order as the pixels in memory)
+		PLANE u;
+		PLANE v;
+
+		bool constantColor;
+
+		int minX, minY, maxX, maxY; // inclusive pixel bounds, already clipped
+		int stateIndex;
+	};
+
+	static void *workerThread(void *data);
+
+	static bool isSameState(const STATE& a, const STATE& b);
+
+	void processTiles();
+	void rasterizeTile(int tileIndex);
+	void rasterizeTriangle(const TRIANGLE& tri, const STATE& state, int tileMinX, int tileMinY, int tileMaxX, int tileMaxY);
+
+	void startWorkers();
+	void stopWorkers();
+
+	SURFACE m_surface;
+
+	std::vector<STATE> m_states;
+	std::vector<TRIANGLE> m_triangles;
+	bool m_bStateDirty;
+	STATE m_pendingState;
+
+	// binning
+	int m_iTileSize;
+	int m_iNumTilesX;
+	int m_iNumTilesY;
+	std::vector<std::vector<int>> m_tileBins;
+	std::atomic<int> m_iNextTile;
+
+	// workers
+	int m_iNumThreadsRequested;
+	std::vector<TacoThread*> m_threads;
+	std::mutex m_workMutex;
+	std::condition_variable m_workCondition;
+	std::condition_variable m_doneCondition;
+	unsigned long long m_iWorkGeneration;
+	int m_iNumBusyWorkers;
+	bool m_bWorkersRunning;
+
+	// stats
+	unsigned long long m_iNumTrianglesTotal;
+};
+
+#endif // !SOFTWARERASTERIZER_H
@@ -0,0 +1,88 @@
+#include "SoftwareRenderTarget.h"
+
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "SoftwareGraphicsInterface.h"
+
+SoftwareRenderTarget::SoftwareRenderTarget(int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType) : RenderTarget(x, y, width, height, multiSampleType) {
+	m_renderTargetBackup = NULL;
+}
+
+void SoftwareRenderTarget::init() {
+	debugLog("Building SoftwareRenderTarget (%ix%i) ...\n", (int)m_vSize.x, (int)m_vSize.y);
+
+	// no multisampling, the multisample type is only kept for the resource name/rebuild logic
+	const size_t numPixels = (size_t)std::max((int)m_vSize.x, 0) * (size_t)std::max((int)m_vSize.y, 0);
+	m_pixels.assign(numPixels, 0x00000000);
+	m_stencil.assign(numPixels, 0);
+
+	m_bReady = true;
+}
+
+void SoftwareRenderTarget::initAsync() {
+	m_bAsyncReady = true;
+}
+
+void SoftwareRenderTarget::destroy() {
+	SoftwareGraphicsInterface* g = dynamic_cast<SoftwareGraphicsInterface*>(engine->getGraphics());
+	if (g != NULL) {
+		if (g->getRenderTarget() == this)
+			g->setRenderTarget(m_renderTargetBackup);
+		else
+			g->flush(); // queued triangles may still sample from us
+	}
+
+	m_pixels = std::vector<Color>();
+	m_stencil = std::vector<unsigned char>();
+}
+
+void SoftwareRenderTarget::enable() {
+	if (!m_bReady) return;
+
+	SoftwareGraphicsInterface* g = (SoftwareGraphicsInterface*)engine->getGraphics();
+
+	// backup previous rendertarget (so that nested rendering works)
+	m_renderTargetBackup = g->getRenderTarget();
+	g->setRenderTarget(this);
+
+	if (m_bClearColorOnDraw) {
+		g->getRasterizer()->clear(m_clearColor);
+		g->getRasterizer()->clearStencil();
+	}
+}
+
+void SoftwareRenderTarget::disable() {
+	if (!m_bReady) return;
+
+	((SoftwareGraphicsInterface*)engine->getGraphics())->setRenderTarget(m_renderTargetBackup);
+	m_renderTargetBackup = NULL;
+}
+
+void SoftwareRenderTarget::bind(unsigned int textureUnit) {
+	if (!m_bReady || textureUnit != 0 || m_pixels.size() < 1) return;
+
+	SoftwareRasterizer::TEXTURE texture;
+	texture.texels = &m_pixels[0];
+	texture.width = (int)m_vSize.x;
+	texture.height = (int)m_vSize.y;
+	texture.linear = true;
+	texture.repeat = false;
+	texture.flipY = true;
+
+	((SoftwareGraphicsInterface*)engine->getGraphics())->bindTexture(texture);
+}
+
+void SoftwareRenderTarget::unbind() {
+	if (!m_bReady) return;
+
+	((SoftwareGraphicsInterface*)engine->getGraphics())->unbindTexture();
+}
+
+SoftwareRasterizer::SURFACE SoftwareRenderTarget::getSurface() {
+	SoftwareRasterizer::SURFACE surface;
+	surface.pixels = (m_pixels.size() > 0 ? &m_pixels[0] : NULL);
+	surface.stencil = (m_stencil.size() > 0 ? &m_stencil[0] : NULL);
+	surface.width = (int)m_vSize.x;
+	surface.height = (int)m_vSize.y;
+	return surface;
+}
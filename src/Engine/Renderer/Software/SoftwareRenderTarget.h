@@ -0,0 +1,32 @@
+#ifndef SOFTWARERENDERTARGET_H
+#define SOFTWARERENDERTARGET_H
+
+#include "RenderTarget/RenderTarget.h"
+#include "SoftwareRasterizer.h"
+
+class SoftwareRenderTarget : public RenderTarget {
+public:
+	SoftwareRenderTarget(int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType = Graphics::MULTISAMPLE_TYPE::MULTISAMPLE_0X);
+	virtual ~SoftwareRenderTarget() { destroy(); }
+
+	virtual void enable();
+	virtual void disable();
+
+	virtual void bind(unsigned int textureUnit = 0);
+	virtual void unbind();
+
+	// ILLEGAL:
+	SoftwareRasterizer::SURFACE getSurface();
+
+private:
+	virtual void init();
+	virtual void initAsync();
+	virtual void destroy();
+
+	std::vector<Color> m_pixels;
+	std::vector<unsigned char> m_stencil;
+
+	SoftwareRenderTarget* m_renderTargetBackup;
+};
+
+#endif // !SOFTWARERENDERTARGET_H
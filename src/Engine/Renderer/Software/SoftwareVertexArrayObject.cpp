@@ -0,0 +1,92 @@
+#include "SoftwareVertexArrayObject.h"
+
+#include "Engine.h"
+#include "SoftwareGraphicsInterface.h"
+
+SoftwareVertexArrayObject::SoftwareVertexArrayObject(Graphics::PRIMITIVE primitive, Graphics::USAGE_TYPE usage, bool keepInSystemMemory) : VertexArrayObject(primitive, usage, keepInSystemMemory) {
+}
+
+void SoftwareVertexArrayObject::init() {
+	if (!m_bAsyncReady) return;
+
+	// nothing to upload, the vertex data always stays in system memory
+	m_partialUpdateVertexIndices.clear();
+	m_partialUpdateColorIndices.clear();
+	m_bReady = true;
+}
+
+void SoftwareVertexArrayObject::initAsync() {
+	m_bAsyncReady = true;
+}
+
+void SoftwareVertexArrayObject::destroy() {
+	VertexArrayObject::destroy();
+}
+
+void SoftwareVertexArrayObject::draw() {
+	if (!m_bReady) {
+		debugLog("WARNING: SoftwareVertexArrayObject::draw() called, but was not ready!\n");
+		return;
+	}
+
+	const int start = clamp<int>(m_iDrawRangeFromIndex > -1 ? m_iDrawRangeFromIndex : nearestMultipleUp((int)(m_iNumVerticies * m_fDrawPercentFromPercent), m_iDrawPercentNearestMultiple), 0, m_iNumVerticies);
+	const int end = clamp<int>(m_iDrawRangeToIndex > -1 ? m_iDrawRangeToIndex : nearestMultipleDown((int)(m_iNumVerticies * m_fDrawPercentToPercent), m_iDrawPercentNearestMultiple), 0, m_iNumVerticies);
+
+	if (start > end || std::abs(end - start) == 0) return;
+
+	SoftwareGraphicsInterface* g = (SoftwareGraphicsInterface*)engine->getGraphics();
+
+	const bool hasTexcoords = (m_texcoords.size() > 0 && m_texcoords[0].size() >= (size_t)end);
+	const bool hasColors = (m_colors.size() >= (size_t)end);
+
+	// without a color array, the current color is used for all vertices (same as glColor() + glDrawArrays())
+	const Color currentColor = g->getColor();
+
+	g->setTexturing(hasTexcoords);
+
+	auto triangle = [&](int i0, int i1, int i2) {
+		g->addTriangle(m_verticies[i0], m_verticies[i1], m_verticies[i2],
+			hasTexcoords ? m_texcoords[0][i0] : Vector2(), hasTexcoords ? m_texcoords[0][i1] : Vector2(), hasTexcoords ? m_texcoords[0][i2] : Vector2(),
+			hasColors ? m_colors[i0] : currentColor, hasColors ? m_colors[i1] : currentColor, hasColors ? m_colors[i2] : currentColor);
+	};
+	auto line = [&](int i0, int i1) {
+		g->addLine(m_verticies[i0], m_verticies[i1], hasColors ? m_colors[i0] : currentColor, hasColors ? m_colors[i1] : currentColor);
+	};
+
+	switch (m_primitive) {
+	case Graphics::PRIMITIVE::PRIMITIVE_TRIANGLES:
+		for (int i = start; i + 2 < end; i += 3) {
+			triangle(i, i + 1, i + 2);
+		}
+		break;
+	case Graphics::PRIMITIVE::PRIMITIVE_TRIANGLE_STRIP:
+		for (int i = start; i + 2 < end; i++) {
+			if ((i - start) % 2 == 0)
+				triangle(i, i + 1, i + 2);
+			else
+				triangle(i + 1, i, i + 2);
+		}
+		break;
+	case Graphics::PRIMITIVE::PRIMITIVE_TRIANGLE_FAN:
+		for (int i = start + 1; i + 1 < end; i++) {
+			triangle(start, i, i + 1);
+		}
+		break;
+	case Graphics::PRIMITIVE::PRIMITIVE_QUADS:
+		for (int i = start; i + 3 < end; i += 4) {
+			triangle(i, i + 1, i + 2);
+			triangle(i, i + 2, i + 3);
+		}
+		break;
+	case Graphics::PRIMITIVE::PRIMITIVE_LINES:
+		for (int i = start; i + 1 < end; i += 2) {
+			line(i, i + 1);
+		}
+		break;
+	case Graphics::PRIMITIVE::PRIMITIVE_LINE_STRIP:
+		for (int i = start; i + 1 < end; i++) {
+			line(i, i + 1);
+		}
+		break;
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef SOFTWAREVERTEXARRAYOBJECT_H
+#define SOFTWAREVERTEXARRAYOBJECT_H
+
+#include "VertexArrayObject/VertexArrayObject.h"
+
+class SoftwareVertexArrayObject : public VertexArrayObject {
+public:
+	SoftwareVertexArrayObject(Graphics::PRIMITIVE primitive = Graphics::PRIMITIVE::PRIMITIVE_TRIANGLES, Graphics::USAGE_TYPE usage = Graphics::USAGE_TYPE::USAGE_STATIC, bool keepInSystemMemory = false);
+	virtual ~SoftwareVertexArrayObject() { destroy(); }
+
+	void draw();
+
+private:
+	virtual void init();
+	virtual void initAsync();
+	virtual void destroy();
+};
+
+#endif // !SOFTWAREVERTEXARRAYOBJECT_H
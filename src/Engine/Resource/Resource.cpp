@@ -30,6 +30,14 @@ void Resource::loadAsync() {
 	initAsync();
 }
 
+Task<void> Resource::loadTask() {
+	co_await TaskScheduler::resumeOnIOThread();
+	loadAsync();
+
+	co_await TaskScheduler::resumeOnMainThread();
+	load();
+}
+
 void Resource::reload() {
 	release();
 	loadAsync();
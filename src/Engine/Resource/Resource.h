@@ -3,6 +3,8 @@
 
 #include "cbase.h"
 
+#include "Thread/Task.h"
+
 class Resource {
 public:
 	Resource();
@@ -16,6 +18,10 @@ public:
 
 	void interruptLoad();
 
+	// loadAsync() on an i/o thread, then load() on the main thread (rm_tasks)
+	// resources can override it to split reading and decoding, see Task.h
+	virtual Task<void> loadTask();
+
 	void setName(UString name) { m_sName = name; }
 
 	inline UString getName() const { return m_sName; }
@@ -4,6 +4,9 @@
 #include "ConVar/ConVar.h"
 #include "Timer/Timer.h"
 #include "Thread/Thread.h"
+#include "Profiler/Profiler.h"
+#include "Thread/Task.h"
+#include "Thread/JobSystem.h"
 
 #include <mutex>
 #include <thread>
@@ -27,7 +30,20 @@ ConVar rm_numthreads("rm_numthreads", 3, "how many parallel resource loader thre
 ConVar rm_warnings("rm_warnings", false);
 ConVar rm_debug_async_delay("rm_debug_async_delay", 0.0f);
 ConVar rm_interrupt_on_destroy("rm_interrupt_on_destroy", true);
+ConVar rm_tasks("rm_tasks", false, "loads async resources with coroutine tasks (Resource::loadTask(), see task_benchmark) instead of the loader threads");
 ConVar debug_rm_("debug_rm", false);
+ConVar rm_rendertarget_pool_trim_frames("rm_rendertarget_pool_trim_frames", 300, "pooled rendertargets which have not been acquired for this many frames are destroyed (0 = never trim)");
+
+void _rm_rendertarget_pool_stats() {
+	if (engine->getResourceManager() == NULL) return;
+	const ResourceManager* rm = engine->getResourceManager();
+
+	const unsigned long long numAcquires = rm->getNumRenderTargetPoolAcquires();
+	const unsigned long long numReuses = rm->getNumRenderTargetPoolReuses();
+
+	debugLog("RenderTarget pool: %i target(s), %i in use, %llu acquire(s), %llu reuse(s) (%.1f%%), %llu trimmed\n", (int)rm->getRenderTargetPoolSize(), (int)rm->getNumRenderTargetPoolInUse(), numAcquires, numReuses, (numAcquires > 0 ? 100.0 * (double)numReuses / (double)numAcquires : 0.0), rm->getNumRenderTargetPoolTrims());
+}
+ConVar _rm_rendertarget_pool_stats_("rm_rendertarget_pool_stats", "prints the size of the rendertarget pool and how often pooled rendertargets were reused", _rm_rendertarget_pool_stats);
 
 ConVar* ResourceManager::debug_rm = &debug_rm_;
 
@@ -39,6 +55,10 @@ const char* ResourceManager::PATH_DEFAULT_SHADERS = "shaders/";
 ResourceManager::ResourceManager() {
 	m_bNextLoadAsync = false;
 
+	m_iNumRenderTargetPoolAcquires = 0;
+	m_iNumRenderTargetPoolReuses = 0;
+	m_iNumRenderTargetPoolTrims = 0;
+
 	m_loadingWork.reserve(32);
 
 	for (int i = 0; i < rm_numthreads.getInt(); i++) {
@@ -61,6 +81,7 @@ ResourceManager::ResourceManager() {
 };
 
 ResourceManager::~ResourceManager() {
+	destroyRenderTargetPool();
 	destroyResources();
 
 	for (size_t i = 0; i < m_threads.size(); i++) {
@@ -84,6 +105,13 @@ ResourceManager::~ResourceManager() {
 	}
 	m_threads.clear();
 
+	// tasks can't be joined, their main thread part runs in here
+	while (m_loadingTasks.size() > 0) {
+		TaskScheduler::get()->update();
+		updateLoadingTasks();
+		std::this_thread::yield();
+	}
+
 	for (size_t i = 0; i < m_loadingWorkAsyncDestroy.size(); i++) {
 		delete m_loadingWorkAsyncDestroy[i];
 	}
@@ -91,6 +119,21 @@ ResourceManager::~ResourceManager() {
 }
 
 void ResourceManager::update() {
+	VPROF_BUDGET("ResourceManager::update", VPROF_BUDGETGROUP_UPDATE);
+
+	// continues the tasks which wait for the main thread, which includes the load() of resources (rm_tasks)
+	// the scheduler (and its i/o threads) only exists once something used tasks
+	TaskScheduler* taskScheduler = TaskScheduler::getIfCreated();
+	if (taskScheduler != NULL) {
+		taskScheduler->update();
+		updateLoadingTasks();
+	}
+
+	// applies a changed job_threads once no job is running
+	JobSystem* jobSystem = JobSystem::getIfCreated();
+	if (jobSystem != NULL)
+		jobSystem->update();
+
 	bool reLock = false;
 	g_resourceManagerMutex.lock();
 	{
@@ -123,7 +166,11 @@ void ResourceManager::update() {
 				g_resourceManagerMutex.unlock();
 
 				reLock = true;
-				rs->load();
+				VPROF_ASYNC_END("ResourceLoad", rs);
+				{
+					VPROF_BUDGET("Resource::load", VPROF_BUDGETGROUP_UPDATE);
+					rs->load();
+				}
 				break;
 			}
 		}
@@ -131,7 +178,7 @@ void ResourceManager::update() {
 			g_resourceManagerMutex.lock();
 		}
 
-		for (size_t i = 0; 0 < m_loadingWorkAsyncDestroy.size(); i++) {
+		for (size_t i = 0; i < m_loadingWorkAsyncDestroy.size(); i++) {
 			bool canBeDestroyed = true;
 			for (size_t w = 0; w < m_loadingWork.size(); w++) {
 				if (debug_rm->getBool())
@@ -139,9 +186,14 @@ void ResourceManager::update() {
 				canBeDestroyed = false;
 				break;
 			}
+			for (size_t t = 0; t < m_loadingTasks.size() && canBeDestroyed; t++) {
+				if (m_loadingTasks[t].resource == m_loadingWorkAsyncDestroy[i])
+					canBeDestroyed = false;
+			}
 			if (canBeDestroyed) {
 				if (debug_rm->getBool())
 					debugLog("Resource Manager: Async destroy of #%i\n", i);
+				VPROF_BUDGET("Resource::destroy", VPROF_BUDGETGROUP_UPDATE);
 				delete m_loadingWorkAsyncDestroy[i];
 				m_loadingWorkAsyncDestroy.erase(m_loadingWorkAsyncDestroy.begin() + i);
 				i--;
@@ -149,6 +201,38 @@ void ResourceManager::update() {
 		}
 	}
 	g_resourceManagerMutex.unlock();
+
+	updatePendingShaders();
+	trimRenderTargetPool();
+}
+
+void ResourceManager::updateLoadingTasks() {
+	for (size_t i = 0; i < m_loadingTasks.size(); i++) {
+		if (m_loadingTasks[i].task.isDone()) {
+			if (debug_rm->getBool())
+				debugLog("Resource Manager: Task of %s finished.\n", m_loadingTasks[i].resource->getName().toUtf8());
+			VPROF_ASYNC_END("ResourceLoad", m_loadingTasks[i].resource);
+			m_loadingTasks.erase(m_loadingTasks.begin() + i);
+			i--;
+		}
+	}
+}
+
+void ResourceManager::updatePendingShaders() {
+	// polling doesn't block, only finished compiles get their (blocking) status checks
+	for (size_t i = 0; i < m_pendingShaders.size(); i++) {
+		Shader* shader = m_pendingShaders[i];
+		if (shader->isFinalizePending()) {
+			if (!shader->isCompileDone()) continue;
+
+			VPROF_BUDGET("Shader::finalize", VPROF_BUDGETGROUP_UPDATE);
+			shader->finalize();
+		}
+
+		// otherwise it was finalized in the meantime (ShaderVariants::getVariant()) or released
+		m_pendingShaders.erase(m_pendingShaders.begin() + i);
+		i--;
+	}
 }
 
 void ResourceManager::destroyResources() {
@@ -177,24 +261,31 @@ void ResourceManager::destroyResource(Resource* rs) {
 				break;
 			}
 		}
-		for (size_t w = 0; w < m_loadingWork.size(); w++) {
-			if (m_loadingWork[w].resource.atomic.load() == rs) {
-				if (debug_rm->getBool())
-					debugLog("Resource Manager: Scheduled async destroy of %s\n", rs->getName().toUtf8());
-				if (rm_interrupt_on_destroy.getBool())
-					rs->interruptLoad();
-				m_loadingWorkAsyncDestroy.push_back(rs);
-				if (isManagedResource)
-					m_vResources.erase(m_vResources.begin() + managedResourceIndex);
-				g_resourceManagerMutex.unlock();
-				return;
-			}
+		if (isLoadingResource(rs)) {
+			if (debug_rm->getBool())
+				debugLog("Resource Manager: Scheduled async destroy of %s\n", rs->getName().toUtf8());
+			if (rm_interrupt_on_destroy.getBool())
+				rs->interruptLoad();
+			m_loadingWorkAsyncDestroy.push_back(rs);
+			if (isManagedResource)
+				m_vResources.erase(m_vResources.begin() + managedResourceIndex);
+			g_resourceManagerMutex.unlock();
+			return;
 		}
-		SAFE_DELETE(rs);
 		if (isManagedResource)
 			m_vResources.erase(m_vResources.begin() + managedResourceIndex);
 	}
 	g_resourceManagerMutex.unlock();
+
+	for (size_t i = 0; i < m_pendingShaders.size(); i++) {
+		if (m_pendingShaders[i] == rs) {
+			m_pendingShaders.erase(m_pendingShaders.begin() + i);
+			break;
+		}
+	}
+
+	// outside of the lock, since resources may own other resources (ShaderVariants)
+	SAFE_DELETE(rs);
 }
 
 void ResourceManager::reloadResources() {
@@ -405,6 +496,45 @@ Shader* ResourceManager::createShader(UString vertexShader, UString fragmentShad
 	return shader;
 }
 
+ShaderVariants* ResourceManager::loadShaderVariants(UString vertexShaderFilePath, UString fragmentShaderFilePath, UString resourceName) {
+	if (resourceName.length() > 0) {
+		Resource* temp = checkIfExistsAndHandle(resourceName);
+		if (temp != NULL)
+			return dynamic_cast<ShaderVariants*>(temp);
+	}
+
+	vertexShaderFilePath.insert(0, PATH_DEFAULT_SHADERS);
+	fragmentShaderFilePath.insert(0, PATH_DEFAULT_SHADERS);
+	ShaderVariants* variants = new ShaderVariants(vertexShaderFilePath, fragmentShaderFilePath, false);
+	variants->setName(resourceName);
+
+	loadResource(variants, true);
+
+	return variants;
+}
+
+ShaderVariants* ResourceManager::createShaderVariants(UString vertexShader, UString fragmentShader, UString resourceName) {
+	if (resourceName.length() > 0) {
+		Resource* temp = checkIfExistsAndHandle(resourceName);
+		if (temp != NULL)
+			return dynamic_cast<ShaderVariants*>(temp);
+	}
+
+	ShaderVariants* variants = new ShaderVariants(vertexShader, fragmentShader, true);
+	variants->setName(resourceName);
+
+	loadResource(variants, true);
+
+	return variants;
+}
+
+void ResourceManager::addPendingShader(Shader* shader) {
+	for (size_t i = 0; i < m_pendingShaders.size(); i++) {
+		if (m_pendingShaders[i] == shader) return;
+	}
+	m_pendingShaders.push_back(shader);
+}
+
 RenderTarget* ResourceManager::createRenderTarget(int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType) {
 	RenderTarget* rt = engine->getGraphics()->createRenderTarget(x, y, width, height, multiSampleType);
 	rt->setName(UString::format("_RT_%ix%i", width, height));
@@ -418,6 +548,105 @@ RenderTarget* ResourceManager::createRenderTarget(int width, int height, Graphic
 	return createRenderTarget(0, 0, width, height, multiSampleType);
 }
 
+RenderTarget* ResourceManager::acquireRenderTarget(int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType) {
+	m_iNumRenderTargetPoolAcquires++;
+
+	for (size_t i = 0; i < m_renderTargetPool.size(); i++) {
+		RENDERTARGET_POOL_ENTRY& entry = m_renderTargetPool[i];
+		if (!entry.inUse && entry.width == width && entry.height == height && entry.multiSampleType == multiSampleType) {
+			entry.inUse = true;
+			entry.idleFrames = 0;
+			m_iNumRenderTargetPoolReuses++;
+
+			// the previous user may have moved it around
+			entry.rt->setPos(0, 0);
+
+			return entry.rt;
+		}
+	}
+
+	// no free matching target, create a new one (owned by the pool, not by m_vResources)
+	requestNextLoadUnmanaged();
+	RenderTarget* rt = createRenderTarget(0, 0, width, height, multiSampleType);
+	rt->setName(UString::format("_RT_POOL_%ix%i", width, height));
+
+	RENDERTARGET_POOL_ENTRY entry;
+	entry.rt = rt;
+	entry.width = width;
+	entry.height = height;
+	entry.multiSampleType = multiSampleType;
+	entry.inUse = true;
+	entry.idleFrames = 0;
+	m_renderTargetPool.push_back(entry);
+
+	if (debug_rm->getBool())
+		debugLog("ResourceManager: RenderTarget pool grew to %i (%ix%i)\n", (int)m_renderTargetPool.size(), width, height);
+
+	return rt;
+}
+
+void ResourceManager::releaseRenderTarget(RenderTarget* rt) {
+	if (rt == NULL) return;
+
+	for (size_t i = 0; i < m_renderTargetPool.size(); i++) {
+		if (m_renderTargetPool[i].rt == rt) {
+			if (!m_renderTargetPool[i].inUse && rm_warnings.getBool())
+				debugLog("RESOURCE MANAGER Warning: releaseRenderTarget() called twice for %s!\n", rt->getName().toUtf8());
+
+			m_renderTargetPool[i].inUse = false;
+			m_renderTargetPool[i].idleFrames = 0;
+			return;
+		}
+	}
+
+	if (rm_warnings.getBool())
+		debugLog("RESOURCE MANAGER Warning: releaseRenderTarget() called with non-pooled %s!\n", rt->getName().toUtf8());
+}
+
+void ResourceManager::destroyRenderTargetPool() {
+	for (size_t i = 0; i < m_renderTargetPool.size(); i++) {
+		SAFE_DELETE(m_renderTargetPool[i].rt);
+	}
+	m_renderTargetPool.clear();
+}
+
+size_t ResourceManager::getNumRenderTargetPoolInUse() const {
+	size_t numInUse = 0;
+	for (size_t i = 0; i < m_renderTargetPool.size(); i++) {
+		if (m_renderTargetPool[i].inUse)
+			numInUse++;
+	}
+	return numInUse;
+}
+
+void ResourceManager::trimRenderTargetPool() {
+	const int trimFrames = rm_rendertarget_pool_trim_frames.getInt();
+	if (trimFrames < 1) return;
+
+	for (size_t i = 0; i < m_renderTargetPool.size(); i++) {
+		RENDERTARGET_POOL_ENTRY& entry = m_renderTargetPool[i];
+		if (entry.inUse) continue;
+
+		entry.idleFrames++;
+		if (entry.idleFrames > (unsigned int)trimFrames) {
+			if (debug_rm->getBool())
+				debugLog("ResourceManager: Trimming pooled RenderTarget %ix%i after %u idle frames\n", entry.width, entry.height, entry.idleFrames);
+
+			{
+				VPROF_BUDGET("RenderTarget::destroy", VPROF_BUDGETGROUP_UPDATE);
+				SAFE_DELETE(entry.rt);
+			}
+
+			// order doesn't matter, swap-remove
+			m_renderTargetPool[i] = m_renderTargetPool.back();
+			m_renderTargetPool.pop_back();
+			i--;
+
+			m_iNumRenderTargetPoolTrims++;
+		}
+	}
+}
+
 TextureAtlas* ResourceManager::createTextureAtlas(int width, int height) {
 	TextureAtlas* ta = new TextureAtlas(width, height);
 	ta->setName(UString::format("_TA_%ix%i", width, height));
@@ -471,8 +700,17 @@ Shader* ResourceManager::getShader(UString resourceName) const {
 	return NULL;
 }
 
+ShaderVariants* ResourceManager::getShaderVariants(UString resourceName) const {
+	for (size_t i = 0; i < m_vResources.size(); i++) {
+		if (m_vResources[i]->getName() == resourceName)
+			return dynamic_cast<ShaderVariants*>(m_vResources[i]);
+	}
+	doesntExistWarning(resourceName);
+	return NULL;
+}
+
 bool ResourceManager::isLoading() const {
-	return(m_loadingWork.size() > 0);
+	return(m_loadingWork.size() > 0 || m_loadingTasks.size() > 0);
 }
 
 bool ResourceManager::isLoadingResource(Resource* rs) const {
@@ -480,6 +718,10 @@ bool ResourceManager::isLoadingResource(Resource* rs) const {
 		if (m_loadingWork[i].resource.atomic.load() == rs)
 			return true;
 	}
+	for (size_t i = 0; i < m_loadingTasks.size(); i++) {
+		if (m_loadingTasks[i].resource == rs)
+			return true;
+	}
 	return false;
 }
 
@@ -497,6 +739,16 @@ void ResourceManager::loadResource(Resource* res, bool load) {
 		res->loadAsync();
 		res->load();
 	}
+	else if (rm_tasks.getBool()) {
+		VPROF_ASYNC_BEGIN("ResourceLoad", res);
+
+		// runs up to its first await right here, which moves it to another thread
+		LOADING_TASK loadingTask;
+		loadingTask.resource = res;
+		loadingTask.task = res->loadTask();
+		loadingTask.task.start();
+		m_loadingTasks.push_back(std::move(loadingTask));
+	}
 	else {
 		if (rm_numthreads.getInt() > 0) {
 			g_resourceManagerMutex.lock();
@@ -504,6 +756,8 @@ void ResourceManager::loadResource(Resource* res, bool load) {
 				static size_t threadIndexCounter = 0;
 				const size_t threadIndex = threadIndexCounter;
 
+				VPROF_ASYNC_BEGIN("ResourceLoad", res);
+
 				LOADING_WORK work;
 
 				work.resource = MobileAtomicResource(res);
@@ -571,7 +825,10 @@ static void* _resourceLoaderThread(void* data) {
 
 	const size_t threadIndex = self->threadIndex.load();
 
+	VPROF_THREAD_NAME("ResourceLoader");
 	while (self->running.load()) {
+		VPROF_THREAD_FRAME();
+
 		self->loadingMutex.lock();
 		self->loadingMutex.unlock();
 
@@ -591,7 +848,10 @@ static void* _resourceLoaderThread(void* data) {
 			if (rm_debug_async_delay.getFloat() > 0.0f)
 				env->sleep(rm_debug_async_delay.getFloat() * 1000 * 1000);
 
-			resourceToLoad->loadAsync();
+			{
+				VPROF_BUDGET("Resource::loadAsync", VPROF_BUDGETGROUP_UPDATE);
+				resourceToLoad->loadAsync();
+			}
 
 			g_resourceManagerLoadingWorkMutex.lock();
 			{
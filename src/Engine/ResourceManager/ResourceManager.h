@@ -7,6 +7,7 @@
 #include "Font/Font.h"
 #include "Sound/Sound.h"
 #include "Shader/Shader.h"
+#include "Shader/ShaderVariants.h"
 #include "RenderTarget/RenderTarget.h"
 #include "TextureAtlas/TextureAtlas.h"
 #include "VertexArrayObject/VertexArrayObject.h"
@@ -52,6 +53,20 @@ public:
 		MobileAtomicBool done;
 	};
 
+	struct LOADING_TASK {
+		Resource* resource;
+		Task<void> task; // Resource::loadTask()
+	};
+
+	struct RENDERTARGET_POOL_ENTRY {
+		RenderTarget* rt;
+		int width;
+		int height;
+		Graphics::MULTISAMPLE_TYPE multiSampleType;
+		bool inUse;
+		unsigned int idleFrames;
+	};
+
 public:
 	ResourceManager();
 	~ResourceManager();
@@ -86,11 +101,19 @@ public:
 	Shader* loadShader(UString vertexShaderFilePath, UString fragmentShaderFilePath);
 	Shader* createShader(UString vertexShader, UString fragmentShader, UString resourceName);
 	Shader* createShader(UString vertexShader, UString fragmentShader);
+	ShaderVariants* loadShaderVariants(UString vertexShaderFilePath, UString fragmentShaderFilePath, UString resourceName);
+	ShaderVariants* createShaderVariants(UString vertexShader, UString fragmentShader, UString resourceName);
+	void addPendingShader(Shader* shader); // its driver compile is still running (Shader::setFinalizeAsync()), update() finalizes it once done
 
 	// rendertargets
 	RenderTarget* createRenderTarget(int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType = Graphics::MULTISAMPLE_TYPE::MULTISAMPLE_0X);
 	RenderTarget* createRenderTarget(int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType = Graphics::MULTISAMPLE_TYPE::MULTISAMPLE_0X);
 
+	// pooled rendertargets (temporary, per-frame), owned by the pool: always give them back via releaseRenderTarget() instead of destroyResource()
+	RenderTarget* acquireRenderTarget(int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType = Graphics::MULTISAMPLE_TYPE::MULTISAMPLE_0X);
+	void releaseRenderTarget(RenderTarget* rt);
+	void destroyRenderTargetPool();
+
 	// texture atlas
 	TextureAtlas* createTextureAtlas(int width, int height);
 
@@ -102,12 +125,20 @@ public:
 	TacoFont* getFont(UString resourceName) const;
 	Sound* getSound(UString resourceName) const;
 	Shader* getShader(UString resourceName) const;
+	ShaderVariants* getShaderVariants(UString resourceName) const;
 
 	inline const std::vector<Resource*>& getResources() const { return m_vResources; }
 	inline size_t getNumThreads() const { return m_threads.size(); }
 	inline size_t getNumLoadingWork() const { return m_loadingWork.size(); }
+	inline size_t getNumLoadingTasks() const { return m_loadingTasks.size(); }
 	inline size_t getNumLoadingWorkAsyncDestroy() const { return m_loadingWorkAsyncDestroy.size(); }
 
+	inline size_t getRenderTargetPoolSize() const { return m_renderTargetPool.size(); }
+	size_t getNumRenderTargetPoolInUse() const;
+	inline unsigned long long getNumRenderTargetPoolAcquires() const { return m_iNumRenderTargetPoolAcquires; }
+	inline unsigned long long getNumRenderTargetPoolReuses() const { return m_iNumRenderTargetPoolReuses; }
+	inline unsigned long long getNumRenderTargetPoolTrims() const { return m_iNumRenderTargetPoolTrims; }
+
 	bool isLoading() const;
 	bool isLoadingResource(Resource* rs) const;
 
@@ -118,6 +149,9 @@ private:
 	Resource* checkIfExistsAndHandle(UString resourceName);
 
 	void resetFlags();
+	void updateLoadingTasks();
+	void updatePendingShaders();
+	void trimRenderTargetPool();
 
 	// content
 	std::vector<Resource*> m_vResources;
@@ -130,6 +164,14 @@ private:
 	std::vector<ResourceManagerLoaderThread*> m_threads;
 	std::vector<LOADING_WORK> m_loadingWork;
 	std::vector<Resource*> m_loadingWorkAsyncDestroy;
+	std::vector<LOADING_TASK> m_loadingTasks; // main thread only
+	std::vector<Shader*> m_pendingShaders; // main thread only
+
+	// rendertarget pool
+	std::vector<RENDERTARGET_POOL_ENTRY> m_renderTargetPool;
+	unsigned long long m_iNumRenderTargetPoolAcquires;
+	unsigned long long m_iNumRenderTargetPoolReuses;
+	unsigned long long m_iNumRenderTargetPoolTrims;
 };
 
 #endif // !RESOURCEMANAGER_H
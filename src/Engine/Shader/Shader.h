@@ -2,6 +2,7 @@
 #define SHADER_H
 
 #include "Resource/Resource.h"
+#include "Shader/ShaderPreprocessor.h"
 
 class ConVar;
 
@@ -10,27 +11,76 @@ public:
 	static ConVar* debug_shaders;
 
 public:
-	Shader() : Resource() { ; }
+	Shader() : Resource() { m_bFinalizeAsync = false; }
 	virtual ~Shader() { ; }
 
 	virtual void enable() = 0;
 	virtual void disable() = 0;
 
-	virtual void setUniform1f(UString name, float value) = 0;
-	virtual void setUniform1fv(UString name, int count, float* values) = 0;
-	virtual void setUniform1i(UString name, int value) = 0;
-	virtual void setUniform2f(UString name, float x, float y) = 0;
-	virtual void setUniform2fv(UString name, int count, float* vectors) = 0;
-	virtual void setUniform3f(UString name, float x, float y, float z) = 0;
-	virtual void setUniform3fv(UString name, int count, float* vectors) = 0;
-	virtual void setUniform4f(UString name, float x, float y, float z, float w) = 0;
-	virtual void setUniformMatrix4fv(UString name, Matrix4& matrix) = 0;
-	virtual void setUniformMatrix4fv(UString name, float* v) = 0;
+	// compile-time permutation (#define NAME VALUE lines injected by the ShaderPreprocessor), must be set before loading
+	void setDefines(const ShaderDefines& defines) { m_defines = defines; }
+	inline const ShaderDefines& getDefines() const { return m_defines; }
+
+	// async compile (precompiled variants): init() only issues the driver compile, which runs on the driver's own threads (KHR_parallel_shader_compile)
+	// ResourceManager::update() calls finalize() (status checks, uniform handles) once isCompileDone(), the shader isn't ready before that
+	void setFinalizeAsync(bool finalizeAsync) { m_bFinalizeAsync = finalizeAsync; }
+	virtual bool isFinalizePending() const { return false; }
+	virtual bool isCompileDone() { return true; } // doesn't block
+	virtual void finalize() { ; } // blocks until the driver is done, if it isn't yet
+
+	virtual void setUniform1f(const UString& name, float value) = 0;
+	virtual void setUniform1fv(const UString& name, int count, float* values) = 0;
+	virtual void setUniform1i(const UString& name, int value) = 0;
+	virtual void setUniform2f(const UString& name, float x, float y) = 0;
+	virtual void setUniform2fv(const UString& name, int count, float* vectors) = 0;
+	virtual void setUniform3f(const UString& name, float x, float y, float z) = 0;
+	virtual void setUniform3fv(const UString& name, int count, float* vectors) = 0;
+	virtual void setUniform4f(const UString& name, float x, float y, float z, float w) = 0;
+	virtual void setUniformMatrix4fv(const UString& name, Matrix4& matrix) = 0;
+	virtual void setUniformMatrix4fv(const UString& name, float* v) = 0;
+
+	// uniform handles: resolve the name once (e.g. after loading), then set by handle without any string conversion or hashing
+	// handles are indices into a per-shader table and stay valid across reload(), the locations behind them are re-resolved
+	int getUniformHandle(const UString& name);
+
+	virtual void set(int handle, float value) = 0;
+	virtual void set(int handle, int value) = 0;
+	virtual void set(int handle, Vector2 value) = 0;
+	virtual void set(int handle, Vector3 value) = 0;
+	virtual void set(int handle, float x, float y, float z, float w) = 0;
+	virtual void set(int handle, const Matrix4& matrix) = 0;
+	virtual void set(int handle, int count, const float* values) = 0; // float[count]
+
+	// uniform blocks (per-frame constants etc.), bindingPoint matches the one the buffer is bound to
+	virtual bool setUniformBlockBinding(const UString& blockName, unsigned int bindingPoint) { return false; }
+
+	int getAndCacheUniformLocation(const UString& name);
+	inline int getUniformLocation(int handle) const { return (handle >= 0 && handle < (int)m_uniformHandles.size() ? m_uniformHandles[handle].location : -1); }
+	inline int getNumUniformHandles() const { return (int)m_uniformHandles.size(); }
 
 protected:
 	virtual void init() = 0;
 	virtual void initAsync() = 0;
 	virtual void destroy() = 0;
+
+	// backend lookup, only called on cache misses and when (re)resolving handles
+	virtual int resolveUniformLocation(const char* name) { return -1; }
+
+	void resolveUniformHandles(); // call after a successful (re)compile
+	void clearUniformLocationCache(); // call on destroy, keeps the handles themselves
+
+	ShaderDefines m_defines;
+	bool m_bFinalizeAsync;
+
+private:
+	struct UNIFORM_HANDLE {
+		std::string name;
+		int location;
+	};
+
+	std::vector<UNIFORM_HANDLE> m_uniformHandles;
+	std::unordered_map<std::string, int> m_uniformLocationCache;
+	std::string m_sTempStringBuffer;
 };
 
 #endif // !SHADER_H
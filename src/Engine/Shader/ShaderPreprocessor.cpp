@@ -0,0 +1,176 @@
+#include "ShaderPreprocessor.h"
+#include "ResourceManager/ResourceManager.h"
+
+#include <sstream>
+
+static const int SHADER_PREPROCESSOR_MAX_INCLUDE_DEPTH = 16;
+
+ShaderDefines& ShaderDefines::set(const char* name, const char* value) {
+	const std::string defineName = name;
+
+	auto it = std::lower_bound(m_defines.begin(), m_defines.end(), defineName, [](const std::pair<std::string, std::string>& define, const std::string& n) {
+		return define.first < n;
+	});
+	if (it != m_defines.end() && it->first == defineName)
+		it->second = value;
+	else
+		m_defines.insert(it, std::make_pair(defineName, std::string(value)));
+
+	updateKey();
+	return *this;
+}
+
+ShaderDefines& ShaderDefines::set(const char* name, int value) {
+	return set(name, std::to_string(value).c_str());
+}
+
+ShaderDefines& ShaderDefines::remove(const char* name) {
+	for (size_t i = 0; i < m_defines.size(); i++) {
+		if (m_defines[i].first == name) {
+			m_defines.erase(m_defines.begin() + i);
+			break;
+		}
+	}
+
+	updateKey();
+	return *this;
+}
+
+std::string ShaderDefines::toSource() const {
+	std::string source;
+	for (size_t i = 0; i < m_defines.size(); i++) {
+		source += "#define ";
+		source += m_defines[i].first;
+		source += " ";
+		source += m_defines[i].second;
+		source += "\n";
+	}
+	return source;
+}
+
+void ShaderDefines::updateKey() {
+	m_sKey.clear();
+	for (size_t i = 0; i < m_defines.size(); i++) {
+		if (i > 0)
+			m_sKey += ";";
+
+		m_sKey += m_defines[i].first;
+		if (m_defines[i].second != "1") {
+			m_sKey += "=";
+			m_sKey += m_defines[i].second;
+		}
+	}
+}
+
+
+
+bool ShaderPreprocessor::process(const std::string& source, const std::string& sourceFolder, const ShaderDefines& defines, std::string& out, std::string& error) {
+	out.clear();
+	error.clear();
+
+	std::vector<std::string> includedFiles;
+	std::string body;
+	if (!processRecursive(source, sourceFolder, includedFiles, 0, body, error))
+		return false;
+
+	// #version must stay the first statement, everything else goes after it
+	size_t versionEnd = 0;
+	int versionLines = 0;
+	const size_t versionPos = body.find("#version");
+	if (versionPos != std::string::npos && body.find_first_not_of(" \t\r\n", 0) == versionPos) {
+		versionEnd = body.find('\n', versionPos);
+		versionEnd = (versionEnd == std::string::npos ? body.length() : versionEnd + 1);
+		versionLines = (int)std::count(body.begin(), body.begin() + versionEnd, '\n');
+	}
+
+	out.reserve(body.length() + 256);
+	out.append(body, 0, versionEnd);
+	out += defines.toSource();
+	if (!defines.isEmpty())
+		out += "#line " + std::to_string(versionLines + 1) + " 0\n";
+	out.append(body, versionEnd, std::string::npos);
+
+	return true;
+}
+
+bool ShaderPreprocessor::processRecursive(const std::string& source, const std::string& sourceFolder, std::vector<std::string>& includedFiles, int depth, std::string& out, std::string& error) {
+	if (depth > SHADER_PREPROCESSOR_MAX_INCLUDE_DEPTH) {
+		error = "#include nested too deeply (recursive include?)";
+		return false;
+	}
+
+	// source string number for #line, 0 is the root file
+	const int sourceIndex = (depth > 0 ? (int)includedFiles.size() : 0);
+
+	std::istringstream stream(source);
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(stream, line)) {
+		lineNumber++;
+
+		std::string includeFileName;
+		if (!parseInclude(line, includeFileName)) {
+			out += line;
+			out += "\n";
+			continue;
+		}
+
+		// relative to the including file first, then relative to the shader folder
+		std::string includePath = sourceFolder + includeFileName;
+		std::string includeSource;
+		if (!readFile(includePath, includeSource)) {
+			includePath = std::string(ResourceManager::PATH_DEFAULT_SHADERS) + includeFileName;
+			if (!readFile(includePath, includeSource)) {
+				error = "can't open #include \"" + includeFileName + "\" (line " + std::to_string(lineNumber) + ")";
+				return false;
+			}
+		}
+
+		if (std::find(includedFiles.begin(), includedFiles.end(), includePath) != includedFiles.end()) {
+			out += "\n"; // already included, keep the line count
+			continue;
+		}
+		includedFiles.push_back(includePath);
+
+		out += "#line 1 " + std::to_string(includedFiles.size()) + "\n";
+		if (!processRecursive(includeSource, getFolder(includePath), includedFiles, depth + 1, out, error))
+			return false;
+		out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceIndex) + "\n";
+	}
+
+	return true;
+}
+
+bool ShaderPreprocessor::parseInclude(const std::string& line, std::string& fileName) {
+	const size_t start = line.find_first_not_of(" \t");
+	if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+		return false;
+
+	const size_t open = line.find_first_of("\"<", start + 8);
+	if (open == std::string::npos)
+		return false;
+
+	const size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+	if (close == std::string::npos || close == open + 1)
+		return false;
+
+	fileName = line.substr(open + 1, close - open - 1);
+	return true;
+}
+
+bool ShaderPreprocessor::readFile(const std::string& filePath, std::string& out) {
+	std::ifstream file(filePath.c_str(), std::ios::in | std::ios::binary);
+	if (!file.good())
+		return false;
+
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	out = contents.str();
+
+	return true;
+}
+
+std::string ShaderPreprocessor::getFolder(const std::string& filePath) {
+	const size_t slash = filePath.find_last_of("/\\");
+	return (slash == std::string::npos ? std::string() : filePath.substr(0, slash + 1));
+}
@@ -0,0 +1,41 @@
+#ifndef SHADERPREPROCESSOR_H
+#define SHADERPREPROCESSOR_H
+
+#include "cbase.h"
+
+// permutation key: a sorted set of defines, identical sets always produce the identical key
+class ShaderDefines {
+public:
+	ShaderDefines() { ; }
+
+	ShaderDefines& set(const char* name, const char* value = "1");
+	ShaderDefines& set(const char* name, int value);
+	ShaderDefines& remove(const char* name);
+
+	inline bool isEmpty() const { return m_defines.size() < 1; }
+	inline const std::string& getKey() const { return m_sKey; } // e.g. "PREMULTIPLIED;SLIDER_STYLE=2;TEXTURED"
+
+	std::string toSource() const; // "#define NAME VALUE\n" lines
+
+private:
+	void updateKey();
+
+	std::vector<std::pair<std::string, std::string>> m_defines; // sorted by name
+	std::string m_sKey;
+};
+
+// expands #include "file" (relative to the including file, then to the shader base folder), each file is only included once per shader
+// injects the defines after the #version line, and emits #line directives so that driver errors point at the right file and line
+// only does string and file work, so it is safe to run on the resource loader threads
+class ShaderPreprocessor {
+public:
+	static bool process(const std::string& source, const std::string& sourceFolder, const ShaderDefines& defines, std::string& out, std::string& error);
+	static bool readFile(const std::string& filePath, std::string& out);
+	static std::string getFolder(const std::string& filePath);
+
+private:
+	static bool processRecursive(const std::string& source, const std::string& sourceFolder, std::vector<std::string>& includedFiles, int depth, std::string& out, std::string& error);
+	static bool parseInclude(const std::string& line, std::string& fileName);
+};
+
+#endif // !SHADERPREPROCESSOR_H
@@ -0,0 +1,83 @@
+#include "ShaderVariants.h"
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "ResourceManager/ResourceManager.h"
+
+ShaderVariants::ShaderVariants(UString vertexShader, UString fragmentShader, bool source) : Resource() {
+	m_sVsh = vertexShader;
+	m_sFsh = fragmentShader;
+	m_bSource = source;
+}
+
+void ShaderVariants::init() {
+	m_bReady = true;
+}
+
+void ShaderVariants::initAsync() {
+	m_bAsyncReady = true;
+}
+
+void ShaderVariants::destroy() {
+	for (auto& variant : m_variants) {
+		engine->getResourceManager()->destroyResource(variant.second);
+	}
+	m_variants.clear();
+
+	for (auto& variant : m_pendingVariants) {
+		engine->getResourceManager()->destroyResource(variant.second);
+	}
+	m_pendingVariants.clear();
+}
+
+Shader* ShaderVariants::getVariant(const ShaderDefines& defines) {
+	const auto it = m_variants.find(defines.getKey());
+	if (it != m_variants.end())
+		return it->second;
+
+	const auto pending = m_pendingVariants.find(defines.getKey());
+	if (pending != m_pendingVariants.end()) {
+		Shader* shader = pending->second;
+		m_pendingVariants.erase(pending);
+
+		// needed right now, so wait for the driver instead of ResourceManager::update()
+		if (shader->isFinalizePending())
+			shader->finalize();
+
+		if (shader->isReady()) {
+			m_variants[defines.getKey()] = shader;
+			return shader;
+		}
+
+		// still being preprocessed on a loader thread (or failed), compiled again synchronously
+		engine->getResourceManager()->destroyResource(shader);
+	}
+
+	Shader* shader = createVariant(defines, false);
+	m_variants[defines.getKey()] = shader;
+	return shader;
+}
+
+void ShaderVariants::precompileVariant(const ShaderDefines& defines) {
+	if (m_variants.find(defines.getKey()) != m_variants.end() || m_pendingVariants.find(defines.getKey()) != m_pendingVariants.end()) return;
+
+	m_pendingVariants[defines.getKey()] = createVariant(defines, true);
+}
+
+Shader* ShaderVariants::createVariant(const ShaderDefines& defines, bool async) {
+	if (Shader::debug_shaders->getBool())
+		debugLog("ShaderVariants: %s variant [%s] of %s\n", (async ? "Precompiling" : "Compiling"), defines.getKey().c_str(), m_sName.toUtf8());
+
+	Shader* shader = (m_bSource ? engine->getGraphics()->createShaderFromSource(m_sVsh, m_sFsh) : engine->getGraphics()->createShaderFromFile(m_sVsh, m_sFsh));
+	shader->setName(UString::format("%s[%s]", m_sName.toUtf8(), defines.getKey().c_str()));
+	shader->setDefines(defines);
+
+	// preprocessing runs on a loader thread, the driver compile is issued in ResourceManager::update() and finalized once it is done
+	if (async) {
+		shader->setFinalizeAsync(true);
+		engine->getResourceManager()->requestNextLoadAsync();
+	}
+
+	engine->getResourceManager()->loadResource(shader); // unmanaged, owned by us
+
+	return shader;
+}
@@ -0,0 +1,34 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include "Shader/Shader.h"
+
+// one shader source, compiled into specialized (branch-free) variants per set of defines
+// getVariant() compiles missing variants lazily on first use, precompileVariant() queues the ones which are known in advance on the loader threads
+// precompiled variants are only handed out once finalized (see Shader::setFinalizeAsync()), until then they are kept separately
+// variants are owned by this resource, reload() recompiles them lazily again
+class ShaderVariants : public Resource {
+public:
+	ShaderVariants(UString vertexShader, UString fragmentShader, bool source);
+	virtual ~ShaderVariants() { destroy(); }
+
+	Shader* getVariant(const ShaderDefines& defines); // waits for the driver if a precompiled variant isn't finalized yet
+	void precompileVariant(const ShaderDefines& defines);
+
+	inline size_t getNumVariants() const { return m_variants.size() + m_pendingVariants.size(); }
+
+private:
+	virtual void init();
+	virtual void initAsync();
+	virtual void destroy();
+
+	Shader* createVariant(const ShaderDefines& defines, bool async);
+
+	UString m_sVsh, m_sFsh;
+	bool m_bSource;
+
+	std::unordered_map<std::string, Shader*> m_variants; // finalized
+	std::unordered_map<std::string, Shader*> m_pendingVariants; // precompiled, still loading or compiling
+};
+
+#endif // !SHADERVARIANTS_H
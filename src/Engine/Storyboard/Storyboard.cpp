@@ -0,0 +1,1268 @@
+#include "Storyboard.h"
+
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "Timer/Timer.h"
+#include "ResourceManager/ResourceManager.h"
+#include "Image/Image.h"
+
+#include <cfloat>
+#include <cstring>
+#include <sstream>
+#include <bit>
+
+// osu! storyboard space
+#define STORYBOARD_WIDESCREEN_MIN_X -107.0f
+#define STORYBOARD_WIDESCREEN_MAX_X 747.0f
+#define STORYBOARD_HEIGHT 480.0f
+
+Storyboard::Storyboard() {
+	m_bLoaded = false;
+
+	m_fStartTime = 0.0f;
+	m_fEndTime = 0.0f;
+	m_iNumSkippedTriggers = 0;
+
+	m_iCurrentSprite = -1;
+	m_bInLoop = false;
+	m_bInTrigger = false;
+	m_fLoopStartTime = 0.0f;
+	m_iLoopCount = 0;
+	m_iRawKeyframeCounter = 0;
+
+	m_easingCurves = getEasingCurves();
+	m_iNextSprite = 0;
+	m_fActiveTime = FLT_MAX; // rebuilt on the first update()
+	m_bActivePassing = true;
+
+	m_bPassing = true;
+	m_visibleRect = Rects(STORYBOARD_WIDESCREEN_MIN_X, 0.0f, STORYBOARD_WIDESCREEN_MAX_X - STORYBOARD_WIDESCREEN_MIN_X, STORYBOARD_HEIGHT);
+	m_vPlaceholderImageSize = Vector2(64, 64);
+	m_stats = STATS();
+}
+
+Storyboard::~Storyboard() {
+	unload();
+}
+
+bool Storyboard::load(UString filePath) {
+	std::ifstream file(filePath.toUtf8(), std::ios::in | std::ios::binary);
+	if (!file.good()) {
+		debugLog("Storyboard: can't open %s\n", filePath.toUtf8());
+		return false;
+	}
+
+	std::ostringstream contents;
+	contents << file.rdbuf();
+
+	std::string folder = filePath.toUtf8();
+	std::replace(folder.begin(), folder.end(), '\\', '/');
+	const size_t lastSlash = folder.find_last_of('/');
+	folder = (lastSlash != std::string::npos ? folder.substr(0, lastSlash + 1) : std::string());
+
+	return loadFromString(contents.str(), folder);
+}
+
+bool Storyboard::loadFromString(const std::string& source, const std::string& folder) {
+	unload();
+
+	m_sFolder = folder;
+
+	std::vector<RAW_KEYFRAME> rawKeyframes;
+	std::string section;
+	std::string line;
+
+	size_t pos = 0;
+	while (pos < source.size()) {
+		size_t end = source.find('\n', pos);
+		if (end == std::string::npos)
+			end = source.size();
+
+		line.assign(source, pos, end - pos);
+		pos = end + 1;
+
+		if (line.size() > 0 && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+
+		if (line.size() < 1 || (line.size() > 1 && line[0] == '/' && line[1] == '/'))
+			continue;
+
+		if (line[0] == '[') {
+			flushGroup(rawKeyframes);
+			m_iCurrentSprite = -1;
+
+			const size_t close = line.find(']');
+			section = line.substr(1, close != std::string::npos ? close - 1 : std::string::npos);
+			continue;
+		}
+
+		if (section == "Variables") {
+			const size_t equals = line.find('=');
+			if (line[0] == '$' && equals != std::string::npos) {
+				m_variables.push_back(std::make_pair(line.substr(0, equals), line.substr(equals + 1)));
+
+				// longest names first, so that $a never replaces the beginning of $ab
+				std::stable_sort(m_variables.begin(), m_variables.end(), [](const std::pair<std::string, std::string>& a, const std::pair<std::string, std::string>& b) {
+					return a.first.size() > b.first.size();
+				});
+			}
+		}
+		else if (section == "Events") {
+			if (m_variables.size() > 0 && line.find('$') != std::string::npos) {
+				for (size_t v = 0; v < m_variables.size(); v++) {
+					size_t found = 0;
+					while ((found = line.find(m_variables[v].first, found)) != std::string::npos) {
+						line.replace(found, m_variables[v].first.size(), m_variables[v].second);
+						found += m_variables[v].second.size();
+					}
+				}
+			}
+
+			int depth = 0;
+			while (depth < (int)line.size() && (line[depth] == ' ' || line[depth] == '_')) {
+				depth++;
+			}
+
+			if (depth < (int)line.size())
+				parseEventLine(line, depth, rawKeyframes);
+		}
+	}
+
+	flushGroup(rawKeyframes);
+	compile(rawKeyframes);
+
+	// trigger groups (hitsounds, passing/failing) are not played, their sprites only show their normal commands
+	if (m_iNumSkippedTriggers > 0)
+		debugLog("Storyboard: WARNING: %i trigger groups are not supported and were skipped\n", m_iNumSkippedTriggers);
+
+	m_bLoaded = true;
+	return true;
+}
+
+void Storyboard::loadImages() {
+	m_images.resize(m_imagePaths.size(), NULL);
+	for (size_t i = 0; i < m_imagePaths.size(); i++) {
+		if (m_images[i] != NULL) continue;
+
+		std::string filePath = m_sFolder + m_imagePaths[i];
+		std::replace(filePath.begin(), filePath.end(), '\\', '/');
+
+		m_images[i] = engine->getResourceManager()->loadImageAbsUnnamed(UString(filePath.c_str()));
+		if (m_images[i] != NULL && m_images[i]->getWidth() > 0)
+			m_imageSizes[i] = m_images[i]->getSize();
+	}
+}
+
+void Storyboard::unload() {
+	for (size_t i = 0; i < m_images.size(); i++) {
+		if (m_images[i] != NULL)
+			engine->getResourceManager()->destroyResource(m_images[i]);
+	}
+	m_images.clear();
+
+	m_bLoaded = false;
+	m_sFolder.clear();
+
+	m_sprites.clear();
+	m_tracks.clear();
+	m_trackStates.clear();
+	m_keyframes.clear();
+	m_imagePaths.clear();
+	m_imagePathIndices.clear();
+	m_imageSizes.clear();
+	m_fStartTime = 0.0f;
+	m_fEndTime = 0.0f;
+	m_iNumSkippedTriggers = 0;
+
+	m_variables.clear();
+	m_iCurrentSprite = -1;
+	m_bInLoop = false;
+	m_bInTrigger = false;
+	m_groupCommands.clear();
+	m_iRawKeyframeCounter = 0;
+
+	m_spriteFirstTracks.clear();
+	m_spriteTrackMasks.clear();
+	m_spriteFollowerMasks.clear();
+	m_spriteEndTimes.clear();
+	m_spritePositions.clear();
+	m_spriteCenterOffsets.clear();
+	m_spriteImages.clear();
+	m_spriteFrameCounts.clear();
+	m_spriteRotations.clear();
+	m_spriteRotationSinCos.clear();
+	m_spritesByStartTime.clear();
+	m_activeSprites.clear();
+	m_iNextSprite = 0;
+	m_fActiveTime = FLT_MAX;
+
+	m_instances.clear();
+	m_batches.clear();
+	m_stats = STATS();
+}
+
+
+
+//************//
+//	Parsing  //
+//************//
+
+int Storyboard::tokenize(const std::string& line, size_t start, std::vector<std::string>& tokens) {
+	// comma separated, quotes are stripped (and protect commas in file paths)
+	// the vector is never shrunk, so that the strings keep their capacity between lines
+	int numTokens = 0;
+	bool inQuotes = false;
+	for (size_t i = start; i <= line.size(); i++) {
+		if (i == start) {
+			if ((int)tokens.size() <= numTokens)
+				tokens.push_back(std::string());
+			tokens[numTokens++].clear();
+		}
+		if (i == line.size()) break;
+
+		const char c = line[i];
+		if (c == '"')
+			inQuotes = !inQuotes;
+		else if (c == ',' && !inQuotes) {
+			if ((int)tokens.size() <= numTokens)
+				tokens.push_back(std::string());
+			tokens[numTokens++].clear();
+		}
+		else
+			tokens[numTokens - 1] += c;
+	}
+
+	return numTokens;
+}
+
+bool Storyboard::parseOrigin(const std::string& origin, float& originX, float& originY) {
+	static const struct {
+		const char* name;
+		const char* id;
+		float x, y;
+	} origins[] = {
+		{ "TopLeft", "0", 0.0f, 0.0f },
+		{ "Centre", "1", 0.5f, 0.5f },
+		{ "CentreLeft", "2", 0.0f, 0.5f },
+		{ "TopRight", "3", 1.0f, 0.0f },
+		{ "BottomCentre", "4", 0.5f, 1.0f },
+		{ "TopCentre", "5", 0.5f, 0.0f },
+		{ "Custom", "6", 0.0f, 0.0f },
+		{ "CentreRight", "7", 1.0f, 0.5f },
+		{ "BottomLeft", "8", 0.0f, 1.0f },
+		{ "BottomRight", "9", 1.0f, 1.0f },
+	};
+
+	for (size_t i = 0; i < sizeof(origins) / sizeof(origins[0]); i++) {
+		if (origin == origins[i].name || origin == origins[i].id) {
+			originX = origins[i].x;
+			originY = origins[i].y;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Storyboard::parseLayer(const std::string& layer, LAYER& out) {
+	if (layer == "Background" || layer == "0")
+		out = LAYER::LAYER_BACKGROUND;
+	else if (layer == "Fail" || layer == "1")
+		out = LAYER::LAYER_FAIL;
+	else if (layer == "Pass" || layer == "2")
+		out = LAYER::LAYER_PASS;
+	else if (layer == "Foreground" || layer == "3")
+		out = LAYER::LAYER_FOREGROUND;
+	else if (layer == "Overlay" || layer == "4")
+		out = LAYER::LAYER_OVERLAY;
+	else
+		return false;
+
+	return true;
+}
+
+void Storyboard::parseEventLine(const std::string& line, int depth, std::vector<RAW_KEYFRAME>& keyframes) {
+	std::vector<std::string>& tokens = m_tokens;
+	const int numTokens = tokenize(line, depth, tokens);
+	if (numTokens < 1) return;
+
+	if (depth == 0) {
+		flushGroup(keyframes);
+		m_iCurrentSprite = -1;
+
+		const bool isSprite = (tokens[0] == "Sprite" || tokens[0] == "4");
+		const bool isAnimation = (tokens[0] == "Animation" || tokens[0] == "6");
+		if (!(isSprite && numTokens >= 6) && !(isAnimation && numTokens >= 8))
+			return; // backgrounds, videos, samples, breaks
+
+		SPRITE sprite;
+		std::memset(&sprite, 0, sizeof(SPRITE));
+		if (!parseLayer(tokens[1], sprite.layer) || !parseOrigin(tokens[2], sprite.originX, sprite.originY)) {
+			debugLog("Storyboard: invalid sprite \"%s\"\n", line.c_str());
+			return;
+		}
+		sprite.x = (float)std::atof(tokens[4].c_str());
+		sprite.y = (float)std::atof(tokens[5].c_str());
+		sprite.frameCount = 1;
+		sprite.loopForever = true;
+
+		if (isAnimation) {
+			sprite.frameCount = std::max(std::atoi(tokens[6].c_str()), 1);
+			sprite.frameDelay = (float)std::atof(tokens[7].c_str());
+			sprite.loopForever = !(numTokens > 8 && (tokens[8] == "LoopOnce" || tokens[8] == "1"));
+
+			// "sb/star.png" = "sb/star0.png", "sb/star1.png", ...
+			const size_t dot = tokens[3].find_last_of('.');
+			const std::string name = tokens[3].substr(0, dot);
+			const std::string extension = (dot != std::string::npos ? tokens[3].substr(dot) : std::string());
+
+			// frames must be consecutive in m_imagePaths, so they are not deduplicated
+			sprite.image = (int)m_imagePaths.size();
+			for (int f = 0; f < sprite.frameCount; f++) {
+				m_imagePaths.push_back(name + std::to_string(f) + extension);
+				m_imageSizes.push_back(Vector2(0, 0));
+			}
+		}
+		else
+			sprite.image = addImagePath(tokens[3]);
+
+		m_iCurrentSprite = (int)m_sprites.size();
+		m_sprites.push_back(sprite);
+		return;
+	}
+
+	if (m_iCurrentSprite < 0) return;
+
+	if (depth == 1) {
+		flushGroup(keyframes);
+
+		if (tokens[0] == "L") {
+			if (numTokens >= 3) {
+				m_bInLoop = true;
+				m_fLoopStartTime = (float)std::atof(tokens[1].c_str());
+				m_iLoopCount = std::atoi(tokens[2].c_str());
+			}
+			return;
+		}
+		else if (tokens[0] == "T") {
+			m_bInTrigger = true;
+			m_iNumSkippedTriggers++;
+			return;
+		}
+	}
+	else if (m_bInLoop) {
+		parseCommand(tokens, numTokens, m_groupCommands);
+		return;
+	}
+	else if (m_bInTrigger)
+		return;
+
+	m_commands.clear();
+	parseCommand(tokens, numTokens, m_commands);
+	for (size_t i = 0; i < m_commands.size(); i++) {
+		addRawKeyframe(keyframes, m_commands[i].property, m_commands[i].keyframe);
+	}
+}
+
+void Storyboard::parseCommand(const std::vector<std::string>& tokens, int numTokens, std::vector<RAW_COMMAND>& commands) {
+	if (numTokens < 5) return;
+
+	const std::string& type = tokens[0];
+	const int easing = std::atoi(tokens[1].c_str());
+	const float startTime = (float)std::atof(tokens[2].c_str());
+	const float endTime = (tokens[3].size() > 0 ? (float)std::atof(tokens[3].c_str()) : startTime);
+
+	RAW_COMMAND command;
+	command.keyframe.easing = easing;
+
+	// parameters are only active for their duration, or forever if it is empty
+	if (type == "P") {
+		if (tokens[4] == "H")
+			command.property = PROPERTY::FLIP_H;
+		else if (tokens[4] == "V")
+			command.property = PROPERTY::FLIP_V;
+		else if (tokens[4] == "A")
+			command.property = PROPERTY::ADDITIVE;
+		else
+			return;
+
+		command.keyframe.startTime = startTime;
+		command.keyframe.endTime = (endTime > startTime ? endTime : FLT_MAX);
+		command.keyframe.startValue = 1.0f;
+		command.keyframe.endValue = 1.0f;
+		commands.push_back(command);
+		return;
+	}
+
+	// which properties a value set of this command writes, and which component of the value set goes where
+	PROPERTY properties[3];
+	int components[3] = { 0, 1, 2 };
+	int numProperties = 1;
+	int valueSize = 1;
+	float valueScale = 1.0f;
+
+	if (type == "F")
+		properties[0] = PROPERTY::ALPHA;
+	else if (type == "M") {
+		properties[0] = PROPERTY::X;
+		properties[1] = PROPERTY::Y;
+		numProperties = valueSize = 2;
+	}
+	else if (type == "MX")
+		properties[0] = PROPERTY::X;
+	else if (type == "MY")
+		properties[0] = PROPERTY::Y;
+	else if (type == "S") {
+		properties[0] = PROPERTY::SCALE_X;
+		properties[1] = PROPERTY::SCALE_Y;
+		components[1] = 0;
+		numProperties = 2;
+	}
+	else if (type == "V") {
+		properties[0] = PROPERTY::SCALE_X;
+		properties[1] = PROPERTY::SCALE_Y;
+		numProperties = valueSize = 2;
+	}
+	else if (type == "R")
+		properties[0] = PROPERTY::ROTATION;
+	else if (type == "C") {
+		properties[0] = PROPERTY::COLOR_R;
+		properties[1] = PROPERTY::COLOR_G;
+		properties[2] = PROPERTY::COLOR_B;
+		numProperties = valueSize = 3;
+		valueScale = 1.0f / 255.0f;
+	}
+	else
+		return;
+
+	// "F,0,1000,2000,0,1,0" is 0 -> 1 from 1000 to 2000, then 1 -> 0 from 2000 to 3000
+	const int numValueSets = (numTokens - 4) / valueSize;
+	if (numValueSets < 1) return;
+
+	const float duration = endTime - startTime;
+	const int numSegments = std::max(numValueSets - 1, 1);
+	for (int s = 0; s < numSegments; s++) {
+		const int from = s;
+		const int to = (numValueSets > 1 ? s + 1 : s);
+
+		command.keyframe.startTime = startTime + duration * s;
+		command.keyframe.endTime = endTime + duration * s;
+
+		for (int p = 0; p < numProperties; p++) {
+			command.property = properties[p];
+			command.keyframe.startValue = (float)std::atof(tokens[4 + from * valueSize + components[p]].c_str()) * valueScale;
+			command.keyframe.endValue = (float)std::atof(tokens[4 + to * valueSize + components[p]].c_str()) * valueScale;
+			commands.push_back(command);
+		}
+	}
+}
+
+void Storyboard::flushGroup(std::vector<RAW_KEYFRAME>& keyframes) {
+	if (m_bInLoop && m_groupCommands.size() > 0) {
+		// unroll, every iteration takes as long as the span of the commands in it
+		float commandsStartTime = FLT_MAX;
+		float commandsEndTime = -FLT_MAX;
+		for (size_t i = 0; i < m_groupCommands.size(); i++) {
+			const KEYFRAME& keyframe = m_groupCommands[i].keyframe;
+			commandsStartTime = std::min(commandsStartTime, keyframe.startTime);
+			commandsEndTime = std::max(commandsEndTime, (keyframe.endTime != FLT_MAX ? keyframe.endTime : keyframe.startTime));
+		}
+		const float iterationDuration = commandsEndTime - commandsStartTime;
+
+		const int numIterations = std::max(m_iLoopCount, 1);
+		for (int iteration = 0; iteration < numIterations; iteration++) {
+			const float offset = m_fLoopStartTime + iterationDuration * iteration;
+			for (size_t i = 0; i < m_groupCommands.size(); i++) {
+				KEYFRAME keyframe = m_groupCommands[i].keyframe;
+				keyframe.startTime += offset;
+				if (keyframe.endTime != FLT_MAX)
+					keyframe.endTime += offset;
+
+				addRawKeyframe(keyframes, m_groupCommands[i].property, keyframe);
+			}
+		}
+	}
+
+	m_bInLoop = false;
+	m_bInTrigger = false;
+	m_groupCommands.clear();
+}
+
+void Storyboard::addRawKeyframe(std::vector<RAW_KEYFRAME>& keyframes, PROPERTY property, const KEYFRAME& keyframe) {
+	RAW_KEYFRAME rawKeyframe;
+	rawKeyframe.sprite = (unsigned int)m_iCurrentSprite;
+	rawKeyframe.property = property;
+	rawKeyframe.order = m_iRawKeyframeCounter++;
+	rawKeyframe.keyframe = keyframe;
+	keyframes.push_back(rawKeyframe);
+}
+
+void Storyboard::compile(std::vector<RAW_KEYFRAME>& keyframes) {
+	// draw order is layer first, declaration order second
+	std::vector<unsigned int> drawOrder(m_sprites.size());
+	for (size_t i = 0; i < drawOrder.size(); i++) {
+		drawOrder[i] = (unsigned int)i;
+	}
+	std::stable_sort(drawOrder.begin(), drawOrder.end(), [this](unsigned int a, unsigned int b) {
+		return m_sprites[a].layer < m_sprites[b].layer;
+	});
+
+	std::vector<SPRITE> sprites(m_sprites.size());
+	std::vector<unsigned int> spriteIndices(m_sprites.size());
+	for (size_t i = 0; i < drawOrder.size(); i++) {
+		sprites[i] = m_sprites[drawOrder[i]];
+		spriteIndices[drawOrder[i]] = (unsigned int)i;
+	}
+	m_sprites.swap(sprites);
+
+	for (size_t i = 0; i < keyframes.size(); i++) {
+		keyframes[i].sprite = spriteIndices[keyframes[i].sprite];
+	}
+
+	std::sort(keyframes.begin(), keyframes.end(), [](const RAW_KEYFRAME& a, const RAW_KEYFRAME& b) {
+		if (a.sprite != b.sprite) return a.sprite < b.sprite;
+		if (a.property != b.property) return a.property < b.property;
+		if (a.keyframe.startTime != b.keyframe.startTime) return a.keyframe.startTime < b.keyframe.startTime;
+		return a.order < b.order;
+	});
+
+	for (size_t i = 0; i < m_sprites.size(); i++) {
+		m_sprites[i].startTime = FLT_MAX;
+		m_sprites[i].endTime = -FLT_MAX;
+		m_sprites[i].firstTrack = 0;
+		m_sprites[i].trackMask = 0;
+		m_sprites[i].followerMask = 0;
+	}
+
+	m_keyframes.resize(keyframes.size());
+	m_tracks.clear();
+	m_trackStates.clear();
+	for (size_t i = 0; i < keyframes.size(); i++) {
+		const RAW_KEYFRAME& rawKeyframe = keyframes[i];
+		m_keyframes[i] = rawKeyframe.keyframe;
+
+		SPRITE& sprite = m_sprites[rawKeyframe.sprite];
+		const bool isFirstKeyframeOfSprite = (i == 0 || keyframes[i - 1].sprite != rawKeyframe.sprite);
+		if (isFirstKeyframeOfSprite || keyframes[i - 1].property != rawKeyframe.property) {
+			if (isFirstKeyframeOfSprite)
+				sprite.firstTrack = (unsigned int)m_tracks.size();
+			sprite.trackMask |= (unsigned short)(1 << (int)rawKeyframe.property);
+
+			TRACK track;
+			std::memset(&track, 0, sizeof(TRACK));
+			track.first = (unsigned int)i;
+			track.property = rawKeyframe.property;
+			m_tracks.push_back(track);
+
+			TRACK_STATE state;
+			std::memset(&state, 0, sizeof(TRACK_STATE));
+			state.startTime = FLT_MAX; // nothing active yet
+			state.validUntil = -FLT_MAX;
+			m_trackStates.push_back(state);
+		}
+		m_tracks.back().count++;
+
+		// lifetime, permanent parameters don't extend it
+		sprite.startTime = std::min(sprite.startTime, rawKeyframe.keyframe.startTime);
+		sprite.endTime = std::max(sprite.endTime, (rawKeyframe.keyframe.endTime != FLT_MAX ? rawKeyframe.keyframe.endTime : rawKeyframe.keyframe.startTime));
+	}
+
+	// Y after X, SCALE_Y after SCALE_X, COLOR_G/B after COLOR_R usually come from the same M, S/V or C commands, with the same keyframe times and easings
+	for (size_t i = 1; i < m_tracks.size(); i++) {
+		const PROPERTY property = m_tracks[i].property;
+		if (property != PROPERTY::Y && property != PROPERTY::SCALE_Y && property != PROPERTY::COLOR_G && property != PROPERTY::COLOR_B) continue;
+
+		const TRACK& previous = m_tracks[i - 1];
+		const TRACK& track = m_tracks[i];
+		if (keyframes[previous.first].sprite != keyframes[track.first].sprite || (int)previous.property != (int)property - 1 || previous.count != track.count) continue;
+
+		bool isSameTiming = true;
+		for (unsigned int k = 0; k < track.count && isSameTiming; k++) {
+			const KEYFRAME& a = m_keyframes[previous.first + k];
+			const KEYFRAME& b = m_keyframes[track.first + k];
+			isSameTiming = (a.startTime == b.startTime && a.endTime == b.endTime && a.easing == b.easing);
+		}
+		if (!isSameTiming) continue;
+
+		unsigned int leader = (unsigned int)i - 1;
+		while (m_tracks[leader].numFollowers < 0) {
+			leader--;
+		}
+		m_tracks[leader].numFollowers++;
+		m_tracks[i].numFollowers = -1;
+		m_sprites[keyframes[track.first].sprite].followerMask |= (unsigned short)(1 << (int)property);
+	}
+
+	m_fStartTime = FLT_MAX;
+	m_fEndTime = -FLT_MAX;
+	for (size_t i = 0; i < m_sprites.size(); i++) {
+		if (m_sprites[i].startTime > m_sprites[i].endTime) continue; // no commands, never visible
+
+		m_fStartTime = std::min(m_fStartTime, m_sprites[i].startTime);
+		m_fEndTime = std::max(m_fEndTime, m_sprites[i].endTime);
+	}
+	if (m_fStartTime > m_fEndTime) {
+		m_fStartTime = 0.0f;
+		m_fEndTime = 0.0f;
+	}
+
+	m_spriteFirstTracks.resize(m_sprites.size());
+	m_spriteTrackMasks.resize(m_sprites.size());
+	m_spriteFollowerMasks.resize(m_sprites.size());
+	m_spriteEndTimes.resize(m_sprites.size());
+	m_spritePositions.resize(m_sprites.size());
+	m_spriteCenterOffsets.resize(m_sprites.size());
+	m_spriteImages.resize(m_sprites.size());
+	m_spriteFrameCounts.resize(m_sprites.size());
+	m_spriteRotations.assign(m_sprites.size(), 0.0f);
+	m_spriteRotationSinCos.assign(m_sprites.size(), Vector2(0.0f, 1.0f));
+	m_spritesByStartTime.clear();
+	for (size_t i = 0; i < m_sprites.size(); i++) {
+		const SPRITE& sprite = m_sprites[i];
+		m_spriteFirstTracks[i] = sprite.firstTrack;
+		m_spriteTrackMasks[i] = sprite.trackMask;
+		m_spriteFollowerMasks[i] = sprite.followerMask;
+		m_spriteEndTimes[i] = sprite.endTime;
+		m_spritePositions[i] = Vector2(sprite.x, sprite.y);
+		m_spriteCenterOffsets[i] = Vector2(0.5f - sprite.originX, 0.5f - sprite.originY);
+		m_spriteImages[i] = sprite.image;
+		m_spriteFrameCounts[i] = sprite.frameCount;
+
+		if (sprite.startTime <= sprite.endTime)
+			m_spritesByStartTime.push_back((unsigned int)i);
+	}
+	std::stable_sort(m_spritesByStartTime.begin(), m_spritesByStartTime.end(), [this](unsigned int a, unsigned int b) {
+		return m_sprites[a].startTime < m_sprites[b].startTime;
+	});
+	m_activeSprites.clear();
+	m_iNextSprite = 0;
+	m_fActiveTime = FLT_MAX;
+
+	// the raw keyframes are not needed anymore
+	std::vector<RAW_KEYFRAME>().swap(keyframes);
+	std::vector<std::pair<std::string, std::string>>().swap(m_variables);
+}
+
+int Storyboard::addImagePath(const std::string& path) {
+	const auto it = m_imagePathIndices.find(path);
+	if (it != m_imagePathIndices.end())
+		return it->second;
+
+	const int index = (int)m_imagePaths.size();
+	m_imagePaths.push_back(path);
+	m_imageSizes.push_back(Vector2(0, 0));
+	m_imagePathIndices[path] = index;
+	return index;
+}
+
+
+
+//***************//
+//	Evaluation  //
+//***************//
+
+const Storyboard::KEYFRAME* Storyboard::findKeyframe(TRACK& track, float time) const {
+	// the last keyframe which has started, or NULL if none has
+	// playback moves forward by at most a keyframe or two per frame, so the cached cursor (and the one after it) almost always hits
+	const KEYFRAME* keyframes = &m_keyframes[track.first];
+	const unsigned int cursor = track.cursor;
+	if (keyframes[cursor].startTime <= time) {
+		if (cursor + 1 >= track.count || keyframes[cursor + 1].startTime > time)
+			return &keyframes[cursor];
+		if (cursor + 2 >= track.count || keyframes[cursor + 2].startTime > time) {
+			track.cursor = cursor + 1;
+			return &keyframes[cursor + 1];
+		}
+	}
+
+	// seek
+	const KEYFRAME* upper = std::upper_bound(keyframes, keyframes + track.count, time, [](float t, const KEYFRAME& keyframe) {
+		return t < keyframe.startTime;
+	});
+
+	if (upper == keyframes) {
+		track.cursor = 0;
+		return NULL;
+	}
+
+	track.cursor = (unsigned int)(upper - keyframes) - 1;
+	return upper - 1;
+}
+
+void Storyboard::activateKeyframe(unsigned int trackIndex, float time) {
+	TRACK& track = m_tracks[trackIndex];
+	const KEYFRAME* keyframe = findKeyframe(track, time);
+	prepareTrackState(trackIndex, keyframe);
+
+	// followers are on the same keyframe
+	for (int i = 1; i <= track.numFollowers; i++) {
+		TRACK& follower = m_tracks[trackIndex + i];
+		follower.cursor = track.cursor;
+		prepareTrackState(trackIndex + i, keyframe != NULL ? &m_keyframes[follower.first + follower.cursor] : NULL);
+	}
+}
+
+void Storyboard::prepareTrackState(unsigned int trackIndex, const KEYFRAME* keyframe) {
+	const TRACK& track = m_tracks[trackIndex];
+	TRACK_STATE& state = m_trackStates[trackIndex];
+	const bool isBoolean = (track.property >= PROPERTY::FLIP_H);
+
+	if (keyframe == NULL) {
+		// before the first command, the first command's start value holds (booleans are off)
+		const KEYFRAME& first = m_keyframes[track.first];
+		state.startTime = -FLT_MAX;
+		state.validUntil = first.startTime;
+		state.invDuration = 0.0f;
+		state.startValue = (isBoolean ? 0.0f : first.startValue);
+		state.delta = 0.0f;
+		state.easingCurve = 0;
+		return;
+	}
+
+	state.startTime = keyframe->startTime;
+	state.validUntil = (track.cursor + 1 < track.count ? keyframe[1].startTime : FLT_MAX);
+
+	// expo, circ and bounce have jumps, kinks or vertical tangents which the sampled curves would round off (by up to 1%), they are evaluated exactly
+	const int easing = (keyframe->easing > 0 && keyframe->easing < NUM_EASINGS ? keyframe->easing : 0); // unknown ones are linear
+	const bool isSampled = (easing < 18 || (easing > 23 && easing < 32));
+	state.easingCurve = (isSampled ? easing * (EASING_CURVE_SAMPLES + 1) : -easing);
+	if (isBoolean) {
+		// parameters without an end are active forever, instant ones never
+		state.invDuration = (keyframe->endTime != FLT_MAX && keyframe->endTime > keyframe->startTime ? 1.0f / (keyframe->endTime - keyframe->startTime) : 0.0f);
+		state.startValue = (keyframe->endTime > keyframe->startTime ? 1.0f : 0.0f);
+		state.delta = (state.invDuration > 0.0f ? -1.0f : 0.0f);
+		state.easingCurve = 0;
+	}
+	else if (keyframe->endTime > keyframe->startTime) {
+		state.invDuration = 1.0f / (keyframe->endTime - keyframe->startTime);
+		state.startValue = keyframe->startValue;
+		state.delta = keyframe->endValue - keyframe->startValue;
+	}
+	else {
+		state.invDuration = 0.0f;
+		state.startValue = keyframe->endValue;
+		state.delta = 0.0f;
+	}
+}
+
+float Storyboard::evaluateFactor(unsigned int track, float time) {
+	const TRACK_STATE& state = m_trackStates[track];
+	if (!(time >= state.startTime && time < state.validUntil))
+		activateKeyframe(track, time);
+
+	// finished keyframes end exactly on their end value (elastic and back don't reach it by themselves)
+	const float percent = (time - state.startTime) * state.invDuration;
+	if (percent >= 1.0f)
+		return 1.0f;
+	if (state.easingCurve == 0)
+		return percent;
+	if (state.easingCurve < 0)
+		return ease(-state.easingCurve, percent);
+
+	const float sample = percent * (float)EASING_CURVE_SAMPLES;
+	const int index = (int)sample;
+	const float* curve = m_easingCurves + state.easingCurve + index;
+	return curve[0] + (curve[1] - curve[0]) * (sample - (float)index);
+}
+
+void Storyboard::updateActiveSprites(float time) {
+	// seeking backwards (or switching between fail and pass) starts over
+	if (time < m_fActiveTime || m_bPassing != m_bActivePassing) {
+		m_activeSprites.clear();
+		m_iNextSprite = 0;
+	}
+	m_fActiveTime = time;
+	m_bActivePassing = m_bPassing;
+
+	// the ones which started since the last frame, sprites which end before this frame are skipped, ended sprites are removed in update()
+	const size_t numPreviouslyActive = m_activeSprites.size();
+	while (m_iNextSprite < m_spritesByStartTime.size()) {
+		const unsigned int sprite = m_spritesByStartTime[m_iNextSprite];
+		if (m_sprites[sprite].startTime > time) break;
+
+		m_iNextSprite++;
+		const LAYER layer = m_sprites[sprite].layer;
+		if (m_spriteEndTimes[sprite] < time || (layer == LAYER::LAYER_FAIL && m_bPassing) || (layer == LAYER::LAYER_PASS && !m_bPassing)) continue;
+
+		m_activeSprites.push_back(sprite);
+	}
+
+	if (m_activeSprites.size() == numPreviouslyActive) return;
+
+	// back into draw order, the new ones are merged in without allocating
+	std::sort(m_activeSprites.begin() + numPreviouslyActive, m_activeSprites.end());
+	if (numPreviouslyActive > 0) {
+		m_activeSpritesScratch.resize(m_activeSprites.size());
+		std::merge(m_activeSprites.begin(), m_activeSprites.begin() + numPreviouslyActive, m_activeSprites.begin() + numPreviouslyActive, m_activeSprites.end(), m_activeSpritesScratch.begin());
+		m_activeSprites.swap(m_activeSpritesScratch);
+	}
+}
+
+void Storyboard::update(float time) {
+	m_batches.clear();
+
+	m_stats = STATS();
+	m_stats.numSprites = (int)m_sprites.size();
+
+	updateActiveSprites(time);
+
+	const float minX = m_visibleRect.getMinX();
+	const float maxX = m_visibleRect.getMaxX();
+	const float minY = m_visibleRect.getMinY();
+	const float maxY = m_visibleRect.getMaxY();
+
+	// the loop only works on locals, the instances are written through a pointer (at most one per alive sprite, shrunk to the visible ones afterwards)
+	m_instances.resize(m_activeSprites.size());
+	Graphics::SPRITE_INSTANCE* instances = m_instances.data();
+	int numInstances = 0;
+	int numCulledAlpha = 0;
+	int numCulledOffscreen = 0;
+	BATCH batch;
+	batch.image = -1;
+	batch.additive = false;
+	batch.first = 0;
+	batch.count = 0;
+
+	unsigned int* activeSprites = m_activeSprites.data();
+	const float* endTimes = m_spriteEndTimes.data();
+	const unsigned int* firstTracks = m_spriteFirstTracks.data();
+	const unsigned short* trackMasks = m_spriteTrackMasks.data();
+	const Vector2* positions = m_spritePositions.data();
+	const Vector2* centerOffsets = m_spriteCenterOffsets.data();
+	const int* images = m_spriteImages.data();
+	const int* frameCounts = m_spriteFrameCounts.data();
+	const Vector2* imageSizes = m_imageSizes.data();
+	float* rotations = m_spriteRotations.data();
+	Vector2* rotationSinCos = m_spriteRotationSinCos.data();
+
+	// a sprite's tracks are sorted by property, walking its mask evaluates them in one pass over m_trackStates (followers reuse the factor of the track before them)
+	const TRACK_STATE* trackStates = m_trackStates.data();
+	const unsigned short* followerMasks = m_spriteFollowerMasks.data();
+	float values[(int)PROPERTY::COUNT];
+	const float defaultValues[(int)PROPERTY::COUNT] = {0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f};
+
+	const size_t numAlive = m_activeSprites.size();
+	size_t numActive = 0;
+	for (size_t i = 0; i < numAlive; i++) {
+		const unsigned int sprite = activeSprites[i];
+		if (endTimes[sprite] < time) continue; // ended, removed
+
+		activeSprites[numActive++] = sprite;
+
+		std::memcpy(values, defaultValues, sizeof(values));
+		values[(int)PROPERTY::X] = positions[sprite].x;
+		values[(int)PROPERTY::Y] = positions[sprite].y;
+
+		unsigned int track = firstTracks[sprite];
+		const unsigned int followerMask = followerMasks[sprite];
+		float factor = 0.0f;
+		for (unsigned int trackMask = trackMasks[sprite]; trackMask != 0; trackMask &= trackMask - 1) {
+			const int property = std::countr_zero(trackMask);
+			if (!(followerMask & (1 << property)))
+				factor = evaluateFactor(track, time);
+			values[property] = trackStates[track].startValue + factor * trackStates[track].delta;
+			track++;
+		}
+
+		const float alpha = values[(int)PROPERTY::ALPHA];
+		if (alpha <= 0.0f) {
+			numCulledAlpha++;
+			continue;
+		}
+
+		const float x = values[(int)PROPERTY::X];
+		const float y = values[(int)PROPERTY::Y];
+		const float scaleX = values[(int)PROPERTY::SCALE_X];
+		const float scaleY = values[(int)PROPERTY::SCALE_Y];
+		const float rotation = values[(int)PROPERTY::ROTATION];
+
+		int image = images[sprite];
+		if (frameCounts[sprite] > 1) {
+			const SPRITE& animation = m_sprites[sprite];
+			if (animation.frameDelay > 0.0f) {
+				const int frame = (int)((time - animation.startTime) / animation.frameDelay);
+				image += (animation.loopForever ? frame % animation.frameCount : std::min(frame, animation.frameCount - 1));
+			}
+		}
+
+		const Vector2& imageSize = (imageSizes[image].x > 0.0f ? imageSizes[image] : m_vPlaceholderImageSize);
+		const float width = imageSize.x * scaleX;
+		const float height = imageSize.y * scaleY;
+
+		// instances are centered, sprites rotate around their origin (no sine/cosine for centered sprites, and only when the rotation changed)
+		float centerX = centerOffsets[sprite].x * width;
+		float centerY = centerOffsets[sprite].y * height;
+		if (rotation != 0.0f && (centerX != 0.0f || centerY != 0.0f)) {
+			if (rotation != rotations[sprite]) {
+				rotations[sprite] = rotation;
+				rotationSinCos[sprite] = Vector2(std::sin(rotation), std::cos(rotation));
+			}
+			const float s = rotationSinCos[sprite].x;
+			const float c = rotationSinCos[sprite].y;
+			const float rotatedX = centerX * c - centerY * s;
+			centerY = centerX * s + centerY * c;
+			centerX = rotatedX;
+		}
+		centerX += x;
+		centerY += y;
+
+		// bounding circle against the visible rect
+		const float radius = 0.5f * std::sqrt(width * width + height * height);
+		if (centerX + radius < minX || centerX - radius > maxX || centerY + radius < minY || centerY - radius > maxY) {
+			numCulledOffscreen++;
+			continue;
+		}
+
+		const bool flipH = (values[(int)PROPERTY::FLIP_H] > 0.0f) != (width < 0.0f);
+		const bool flipV = (values[(int)PROPERTY::FLIP_V] > 0.0f) != (height < 0.0f);
+		const bool additive = (values[(int)PROPERTY::ADDITIVE] > 0.0f);
+
+		Graphics::SPRITE_INSTANCE& instance = instances[numInstances];
+		instance.x = centerX;
+		instance.y = centerY;
+		instance.width = std::abs(width);
+		instance.height = std::abs(height);
+		instance.rotation = rotation;
+		instance.u0 = (flipH ? 65535 : 0);
+		instance.u1 = (flipH ? 0 : 65535);
+		instance.v0 = (flipV ? 65535 : 0);
+		instance.v1 = (flipV ? 0 : 65535);
+		instance.color = COLORf(alpha, values[(int)PROPERTY::COLOR_R], values[(int)PROPERTY::COLOR_G], values[(int)PROPERTY::COLOR_B]);
+
+		if (batch.image != image || batch.additive != additive) {
+			if (batch.count > 0)
+				m_batches.push_back(batch);
+			batch.image = image;
+			batch.additive = additive;
+			batch.first = numInstances;
+			batch.count = 0;
+		}
+		batch.count++;
+		numInstances++;
+	}
+	if (batch.count > 0)
+		m_batches.push_back(batch);
+
+	m_activeSprites.resize(numActive);
+	m_instances.resize(numInstances);
+	m_stats.numCulledAlpha = numCulledAlpha;
+	m_stats.numCulledOffscreen = numCulledOffscreen;
+	m_stats.numCulledTime = m_stats.numSprites - (int)numActive;
+	m_stats.numVisible = numInstances;
+	m_stats.numBatches = (int)m_batches.size();
+}
+
+void Storyboard::draw(Graphics* g) {
+	bool additive = false;
+	for (size_t i = 0; i < m_batches.size(); i++) {
+		const BATCH& batch = m_batches[i];
+		Image* image = (batch.image < (int)m_images.size() ? m_images[batch.image] : NULL);
+		if (image == NULL) continue;
+
+		if (batch.additive != additive) {
+			additive = batch.additive;
+			g->setBlendMode(additive ? Graphics::BLEND_MODE::BLEND_MODE_ADDITIVE : Graphics::BLEND_MODE::BLEND_MODE_ALPHA);
+		}
+
+		g->drawImageInstanced(image, &m_instances[batch.first], batch.count);
+	}
+
+	if (additive)
+		g->setBlendMode(Graphics::BLEND_MODE::BLEND_MODE_ALPHA);
+}
+
+
+
+//**********//
+//	Easing  //
+//**********//
+
+static float easeOutBounce(float t) {
+	if (t < 1.0f / 2.75f)
+		return 7.5625f * t * t;
+	if (t < 2.0f / 2.75f) {
+		t -= 1.5f / 2.75f;
+		return 7.5625f * t * t + 0.75f;
+	}
+	if (t < 2.5f / 2.75f) {
+		t -= 2.25f / 2.75f;
+		return 7.5625f * t * t + 0.9375f;
+	}
+	t -= 2.625f / 2.75f;
+	return 7.5625f * t * t + 0.984375f;
+}
+
+float Storyboard::ease(int easing, float t) {
+	static const float PI_F = 3.14159265358979323846f;
+	static const float ELASTIC_CONST = 2.0f * PI_F / 0.3f;
+	static const float ELASTIC_CONST2 = 0.3f / 4.0f;
+	static const float BACK_CONST = 1.70158f;
+	static const float BACK_CONST2 = BACK_CONST * 1.525f;
+
+	float u;
+	switch (easing) {
+	case 1: // out
+	case 4: // quad out
+		return t * (2.0f - t);
+	case 2: // in
+	case 3: // quad in
+		return t * t;
+	case 5: // quad in out
+		u = 2.0f - 2.0f * t;
+		return (t < 0.5f ? 2.0f * t * t : 1.0f - u * u * 0.5f);
+
+	case 6: // cubic in
+		return t * t * t;
+	case 7: // cubic out
+		u = 1.0f - t;
+		return 1.0f - u * u * u;
+	case 8: // cubic in out
+		u = 2.0f - 2.0f * t;
+		return (t < 0.5f ? 4.0f * t * t * t : 1.0f - u * u * u * 0.5f);
+
+	case 9: // quart in
+		return t * t * t * t;
+	case 10: // quart out
+		u = 1.0f - t;
+		return 1.0f - u * u * u * u;
+	case 11: // quart in out
+		u = 2.0f - 2.0f * t;
+		return (t < 0.5f ? 8.0f * t * t * t * t : 1.0f - u * u * u * u * 0.5f);
+
+	case 12: // quint in
+		return t * t * t * t * t;
+	case 13: // quint out
+		u = 1.0f - t;
+		return 1.0f - u * u * u * u * u;
+	case 14: // quint in out
+		u = 2.0f - 2.0f * t;
+		return (t < 0.5f ? 16.0f * t * t * t * t * t : 1.0f - u * u * u * u * u * 0.5f);
+
+	case 15: // sine in
+		return 1.0f - std::cos(t * PI_F * 0.5f);
+	case 16: // sine out
+		return std::sin(t * PI_F * 0.5f);
+	case 17: // sine in out
+		return -(std::cos(PI_F * t) - 1.0f) * 0.5f;
+
+	case 18: // expo in
+		return (t <= 0.0f ? 0.0f : std::exp2(10.0f * t - 10.0f));
+	case 19: // expo out
+		return (t >= 1.0f ? 1.0f : 1.0f - std::exp2(-10.0f * t));
+	case 20: // expo in out
+		if (t <= 0.0f) return 0.0f;
+		if (t >= 1.0f) return 1.0f;
+		return (t < 0.5f ? std::exp2(20.0f * t - 10.0f) * 0.5f : (2.0f - std::exp2(-20.0f * t + 10.0f)) * 0.5f);
+
+	case 21: // circ in
+		return 1.0f - std::sqrt(1.0f - t * t);
+	case 22: // circ out
+		return std::sqrt(1.0f - (t - 1.0f) * (t - 1.0f));
+	case 23: // circ in out
+		u = 2.0f - 2.0f * t;
+		return (t < 0.5f ? (1.0f - std::sqrt(1.0f - 4.0f * t * t)) * 0.5f : (std::sqrt(1.0f - u * u) + 1.0f) * 0.5f);
+
+	case 24: // elastic in
+		return -std::exp2(-10.0f + 10.0f * t) * std::sin((1.0f - ELASTIC_CONST2 - t) * ELASTIC_CONST);
+	case 25: // elastic out
+		return std::exp2(-10.0f * t) * std::sin((t - ELASTIC_CONST2) * ELASTIC_CONST) + 1.0f;
+	case 26: // elastic half out
+		return std::exp2(-10.0f * t) * std::sin((0.5f * t - ELASTIC_CONST2) * ELASTIC_CONST) + 1.0f;
+	case 27: // elastic quarter out
+		return std::exp2(-10.0f * t) * std::sin((0.25f * t - ELASTIC_CONST2) * ELASTIC_CONST) + 1.0f;
+	case 28: // elastic in out
+		t *= 2.0f;
+		if (t < 1.0f)
+			return -0.5f * std::exp2(-10.0f + 10.0f * t) * std::sin((1.0f - ELASTIC_CONST2 * 1.5f - t) * ELASTIC_CONST / 1.5f);
+		t -= 1.0f;
+		return 0.5f * std::exp2(-10.0f * t) * std::sin((t - ELASTIC_CONST2 * 1.5f) * ELASTIC_CONST / 1.5f) + 1.0f;
+
+	case 29: // back in
+		return t * t * ((BACK_CONST + 1.0f) * t - BACK_CONST);
+	case 30: // back out
+		t -= 1.0f;
+		return t * t * ((BACK_CONST + 1.0f) * t + BACK_CONST) + 1.0f;
+	case 31: // back in out
+		t *= 2.0f;
+		if (t < 1.0f)
+			return 0.5f * (t * t * ((BACK_CONST2 + 1.0f) * t - BACK_CONST2));
+		t -= 2.0f;
+		return 0.5f * (t * t * ((BACK_CONST2 + 1.0f) * t + BACK_CONST2) + 2.0f);
+
+	case 32: // bounce in
+		return 1.0f - easeOutBounce(1.0f - t);
+	case 33: // bounce out
+		return easeOutBounce(t);
+	case 34: // bounce in out
+		return (t < 0.5f ? 0.5f - 0.5f * easeOutBounce(1.0f - t * 2.0f) : easeOutBounce((t - 0.5f) * 2.0f) * 0.5f + 0.5f);
+
+	default: // linear
+		return t;
+	}
+}
+
+const float* Storyboard::getEasingCurves() {
+	// linear interpolation between 1024 samples stays within 5e-5 of ease() for the smooth ones (even elastic)
+	static const std::vector<float> curves = [] {
+		std::vector<float> samples((size_t)NUM_EASINGS * (EASING_CURVE_SAMPLES + 1));
+		for (int easing = 0; easing < NUM_EASINGS; easing++) {
+			for (int i = 0; i <= EASING_CURVE_SAMPLES; i++) {
+				samples[(size_t)easing * (EASING_CURVE_SAMPLES + 1) + i] = ease(easing, (float)i / (float)EASING_CURVE_SAMPLES);
+			}
+		}
+		return samples;
+	}();
+	return curves.data();
+}
+
+
+
+//**************//
+//	Benchmark  //
+//**************//
+
+// 30k moving/scaling/rotating/fading/colored sprites (with loops), all alive at the same time
+static std::string buildBenchmarkStoryboard(int numSprites) {
+	std::mt19937 rng(1337);
+	std::uniform_int_distribution<int> xDist(-100, 740);
+	std::uniform_int_distribution<int> yDist(0, 480);
+
+	std::string source = "[Events]\n";
+	source.reserve((size_t)numSprites * 256);
+
+	char line[256];
+	for (int i = 0; i < numSprites; i++) {
+		// contiguous runs of the same image, so that the batching has something to batch
+		std::snprintf(line, sizeof(line), "Sprite,Foreground,Centre,\"sb/particle%i.png\",%i,%i\n", (i * 8) / numSprites, xDist(rng), yDist(rng));
+		source += line;
+		std::snprintf(line, sizeof(line), " F,0,0,1000,0,1\n M,%i,0,60000,%i,%i,%i,%i\n S,0,0,60000,0.25,1.5\n R,0,0,60000,0,6.28\n C,0,0,30000,255,255,255,255,128,0\n", i % 35, xDist(rng), yDist(rng), xDist(rng), yDist(rng));
+		source += line;
+		std::snprintf(line, sizeof(line), " L,1000,%i\n  F,%i,0,1500,1,0.5\n  F,%i,1500,3000,0.5,1\n", 19 + (i % 3), i % 35, i % 35);
+		source += line;
+		if (i % 16 == 0)
+			source += " P,0,0,60000,A\n";
+	}
+
+	return source;
+}
+
+// the budget is 1 ms for 30k alive sprites, i.e. per sprite that is inside of its lifetime
+static const double STORYBOARD_BENCHMARK_BUDGET_PER_ALIVE_SPRITE = 0.001 / 30000.0;
+
+static bool benchmarkStoryboard(Storyboard &storyboard, const char *name, double loadTime) {
+	const int maxFrames = 3600;
+
+	debugLog("Storyboard: %s, %i sprites, %i keyframes, %i skipped triggers, %f ms to parse/compile\n", name, storyboard.getNumSprites(), storyboard.getNumKeyframes(), storyboard.getNumSkippedTriggers(), loadTime * 1000.0);
+
+	// headless: images are never loaded, placeholder sizes are used for culling
+	const float startTime = storyboard.getStartTime();
+	const float endTime = storyboard.getEndTime();
+	const int numFrames = clamp<int>((int)((endTime - startTime) / (1000.0f / 60.0f)) + 1, 1, maxFrames);
+	const float step = (numFrames > 1 ? (endTime - startTime) / (float)(numFrames - 1) : 0.0f);
+
+	Timer timer;
+	double totalTime = 0.0;
+	double maxTime = 0.0;
+	long long totalVisible = 0;
+	long long totalAlive = 0;
+	Storyboard::STATS peakStats = Storyboard::STATS();
+	for (int f = 0; f < numFrames; f++) {
+		timer.start();
+		storyboard.update(startTime + step * f);
+		timer.update();
+
+		const double frameTime = timer.getElapsedTime();
+		totalTime += frameTime;
+		maxTime = std::max(maxTime, frameTime);
+
+		const Storyboard::STATS &stats = storyboard.getStats();
+		totalVisible += stats.numVisible;
+		totalAlive += stats.numSprites - stats.numCulledTime;
+		if (stats.numVisible > peakStats.numVisible)
+			peakStats = stats;
+	}
+
+	// frames with (almost) nothing alive are dominated by the fixed cost, so the verdict is per alive sprite
+	const double timePerAliveSprite = (totalAlive > 0 ? totalTime / (double)totalAlive : 0.0);
+	const bool passed = (timePerAliveSprite <= STORYBOARD_BENCHMARK_BUDGET_PER_ALIVE_SPRITE);
+
+	debugLog("Storyboard: %i frames over %f ms, update avg = %f ms, max = %f ms, avg visible = %i, avg alive = %i\n", numFrames, endTime - startTime, (totalTime / numFrames) * 1000.0, maxTime * 1000.0, (int)(totalVisible / numFrames), (int)(totalAlive / numFrames));
+	debugLog("Storyboard: peak frame: %i visible in %i batches, culled %i time, %i alpha, %i offscreen\n", peakStats.numVisible, peakStats.numBatches, peakStats.numCulledTime, peakStats.numCulledAlpha, peakStats.numCulledOffscreen);
+	debugLog("Storyboard: %f ns per alive sprite (budget %f ns) %s\n", timePerAliveSprite * 1000000000.0, STORYBOARD_BENCHMARK_BUDGET_PER_ALIVE_SPRITE * 1000000000.0, passed ? "PASSED" : "FAILED");
+
+	return passed;
+}
+
+// recursively benchmarks every .osb in the folder, real storyboards have a very different command mix than the synthetic one
+static void benchmarkStoryboardFolder(UString folder, int &numStoryboards, int &numPassed) {
+	if (folder.length() > 0 && folder[folder.length() - 1] != L'/' && folder[folder.length() - 1] != L'\\')
+		folder.append("/");
+
+	const std::vector<UString> files = env->getFilesInFolder(folder);
+	for (size_t i = 0; i < files.size(); i++) {
+		UString extension = env->getFileExtensionFromFilePath(files[i]);
+		extension.lowerCase();
+		if (extension != "osb")
+			continue;
+
+		UString path = folder;
+		path.append(files[i]);
+
+		Storyboard storyboard;
+		Timer timer;
+		timer.start();
+		const bool loaded = storyboard.load(path);
+		timer.update();
+		if (!loaded)
+			continue;
+
+		numStoryboards++;
+		if (benchmarkStoryboard(storyboard, path.toUtf8(), timer.getElapsedTime()))
+			numPassed++;
+	}
+
+	const std::vector<UString> folders = env->getFildersInFolder(folder);
+	for (size_t i = 0; i < folders.size(); i++) {
+		if (folders[i] == "." || folders[i] == "..")
+			continue;
+
+		UString subFolder = folder;
+		subFolder.append(folders[i]);
+		benchmarkStoryboardFolder(subFolder, numStoryboards, numPassed);
+	}
+}
+
+void _storyboard_benchmark(UString args) {
+	const int numSyntheticSprites = 30000;
+
+	if (args.length() > 0 && env->directoryExists(args)) {
+		int numStoryboards = 0;
+		int numPassed = 0;
+		benchmarkStoryboardFolder(args, numStoryboards, numPassed);
+		debugLog("Storyboard: %i/%i storyboards within budget\n", numPassed, numStoryboards);
+		return;
+	}
+
+	Storyboard storyboard;
+	Timer timer;
+
+	timer.start();
+	bool loaded = false;
+	if (args.length() > 0)
+		loaded = storyboard.load(args);
+	else {
+		const std::string source = buildBenchmarkStoryboard(numSyntheticSprites);
+		timer.start(); // don't count the generation
+		loaded = storyboard.loadFromString(source, "");
+	}
+	timer.update();
+
+	if (!loaded) {
+		debugLog("Usage: storyboard_benchmark [path to .osb/.osu or a folder of them, default is a synthetic %i sprite storyboard]\n", numSyntheticSprites);
+		return;
+	}
+
+	benchmarkStoryboard(storyboard, args.length() > 0 ? args.toUtf8() : "synthetic", timer.getElapsedTime());
+}
+
+ConVar _storyboard_benchmark_("storyboard_benchmark", "headless storyboard evaluation benchmark, optional argument: path to a .osb/.osu file or a folder of beatmaps (default: synthetic 30k sprites)", _storyboard_benchmark);
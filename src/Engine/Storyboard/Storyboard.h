@@ -0,0 +1,228 @@
+#ifndef STORYBOARD_H
+#define STORYBOARD_H
+
+#include "cbase.h"
+
+class Image;
+
+// osu! storyboard player (.osb, or the [Events] section of a .osu)
+// all commands (including unrolled loops) are compiled into flat keyframe tracks, one track per sprite and property, sorted by start time
+// evaluation only walks the sprites which are alive (a list in draw order, maintained incrementally from the sprites sorted by start time, rebuilt when seeking backwards),
+// reading compact per sprite arrays and the active keyframe of each track, fully transparent sprites and sprites outside of the visible rect are culled,
+// every other sprite becomes one Graphics::SPRITE_INSTANCE, consecutive sprites with the same image and blend mode are drawn as one instanced batch
+// coordinates are in storyboard space (640x480, widescreen extends from -107 to 747), times are in milliseconds
+// trigger groups (T) are parsed and counted (getNumSkippedTriggers()) but not played, the engine has no gameplay events to fire them (loading logs a warning once)
+class Storyboard {
+public:
+	enum class LAYER {
+		LAYER_BACKGROUND,
+		LAYER_FAIL,
+		LAYER_PASS,
+		LAYER_FOREGROUND,
+		LAYER_OVERLAY,
+		LAYER_COUNT // not a layer
+	};
+
+	struct STATS {
+		int numSprites;
+		int numVisible;
+		int numCulledTime;		// outside of their lifetime (or on the inactive fail/pass layer)
+		int numCulledAlpha;
+		int numCulledOffscreen;
+		int numBatches;
+	};
+
+	static float ease(int easing, float t); // osu! easing ids (0 - 34), t in [0, 1]
+
+public:
+	Storyboard();
+	~Storyboard();
+
+	bool load(UString filePath); // parses and compiles, does not load any images
+	bool loadFromString(const std::string& source, const std::string& folder);
+	void loadImages(); // main thread, through the ResourceManager
+	void unload();
+
+	void update(float time); // evaluate all sprites at time
+	void draw(Graphics* g); // draws the result of the last update(), in storyboard space (push your own transform)
+
+	void setPassing(bool passing) { m_bPassing = passing; }
+	void setVisibleRect(Rects visibleRect) { m_visibleRect = visibleRect; }
+	void setPlaceholderImageSize(Vector2 size) { m_vPlaceholderImageSize = size; } // used for images which are not loaded (headless)
+
+	inline bool isLoaded() const { return m_bLoaded; }
+	inline int getNumSprites() const { return (int)m_sprites.size(); }
+	inline int getNumKeyframes() const { return (int)m_keyframes.size(); }
+	inline int getNumSkippedTriggers() const { return m_iNumSkippedTriggers; }
+	inline float getStartTime() const { return m_fStartTime; }
+	inline float getEndTime() const { return m_fEndTime; }
+	inline const STATS& getStats() const { return m_stats; }
+	inline const std::vector<Graphics::SPRITE_INSTANCE>& getInstances() const { return m_instances; }
+
+private:
+	enum class PROPERTY {
+		X,
+		Y,
+		SCALE_X,
+		SCALE_Y,
+		ROTATION,
+		ALPHA,
+		COLOR_R,
+		COLOR_G,
+		COLOR_B,
+		FLIP_H,		// boolean (P,H), 1 while active
+		FLIP_V,		// boolean (P,V)
+		ADDITIVE,	// boolean (P,A)
+		COUNT // not a property
+	};
+
+	struct KEYFRAME {
+		float startTime;
+		float endTime;
+		float startValue;
+		float endValue;
+		int easing;
+	};
+
+	// the keyframe which is active in [startTime, validUntil), prepared for value = startValue + ease(min((time - startTime) * invDuration, 1)) * delta
+	// playback only streams through these, and only reads m_keyframes when a track moves on to its next keyframe (or seeks)
+	// boolean tracks go from 1 to 0 over their keyframe, they are active while the value is above 0
+	struct TRACK_STATE {
+		float startTime;
+		float validUntil;
+		float invDuration; // 0 for instant keyframes and before the first keyframe, the value is constant
+		float startValue;
+		float delta;
+		int easingCurve; // offset into the sampled easing curves, or minus the easing for the ones which aren't sampled
+	};
+
+	// range in m_keyframes, same index as the state
+	struct TRACK {
+		unsigned int first;
+		unsigned int count;
+		unsigned int cursor; // index (relative to first) of the active keyframe
+		PROPERTY property;
+		int numFollowers; // the next tracks of the sprite have the same keyframe times and easings (M, S, V, C), they are activated with this one and share its eased factor (-1 for followers)
+	};
+
+	struct SPRITE {
+		LAYER layer;
+		float originX, originY; // 0 - 1
+		float x, y;
+		int image; // index into m_imagePaths, first frame for animations
+
+		// animations
+		int frameCount;
+		float frameDelay;
+		bool loopForever;
+
+		float startTime;
+		float endTime;
+
+		// only the properties which have commands get a track, they are consecutive in m_tracks (in draw order, like the sprites) and sorted by property
+		unsigned int firstTrack;
+		unsigned short trackMask; // bit per property
+		unsigned short followerMask; // the properties whose track follows the previous one
+	};
+
+	// parsing only
+	struct RAW_KEYFRAME {
+		unsigned int sprite;
+		PROPERTY property;
+		unsigned int order; // keeps the declaration order for equal start times
+		KEYFRAME keyframe;
+	};
+
+	struct RAW_COMMAND {
+		PROPERTY property;
+		KEYFRAME keyframe;
+	};
+
+	struct BATCH {
+		int image;
+		bool additive;
+		int first;
+		int count;
+	};
+
+	static int tokenize(const std::string& line, size_t start, std::vector<std::string>& tokens);
+	static bool parseOrigin(const std::string& origin, float& originX, float& originY);
+	static bool parseLayer(const std::string& layer, LAYER& out);
+
+	void parseEventLine(const std::string& line, int depth, std::vector<RAW_KEYFRAME>& keyframes);
+	void parseCommand(const std::vector<std::string>& tokens, int numTokens, std::vector<RAW_COMMAND>& commands);
+	void flushGroup(std::vector<RAW_KEYFRAME>& keyframes);
+	void addRawKeyframe(std::vector<RAW_KEYFRAME>& keyframes, PROPERTY property, const KEYFRAME& keyframe);
+	void compile(std::vector<RAW_KEYFRAME>& keyframes);
+	int addImagePath(const std::string& path);
+
+	// ease() sampled per easing id, the per frame evaluation interpolates these instead of switching on the easing
+	static const int NUM_EASINGS = 35;
+	static const int EASING_CURVE_SAMPLES = 1024;
+	static const float* getEasingCurves();
+
+	inline const KEYFRAME* findKeyframe(TRACK& track, float time) const;
+	void activateKeyframe(unsigned int track, float time);
+	void prepareTrackState(unsigned int track, const KEYFRAME* keyframe);
+	void updateActiveSprites(float time);
+	inline float evaluateFactor(unsigned int track, float time); // the eased percent, value = startValue + factor * delta
+
+	bool m_bLoaded;
+	std::string m_sFolder;
+	const float* m_easingCurves;
+
+	// compiled
+	std::vector<SPRITE> m_sprites; // in draw order
+	std::vector<TRACK> m_tracks;
+	std::vector<TRACK_STATE> m_trackStates;
+	std::vector<KEYFRAME> m_keyframes;
+	std::vector<std::string> m_imagePaths;
+	std::unordered_map<std::string, int> m_imagePathIndices;
+	std::vector<Image*> m_images;
+	std::vector<Vector2> m_imageSizes;
+	float m_fStartTime;
+	float m_fEndTime;
+	int m_iNumSkippedTriggers;
+
+	// parser state
+	std::vector<std::pair<std::string, std::string>> m_variables;
+	int m_iCurrentSprite;
+	bool m_bInLoop;
+	bool m_bInTrigger;
+	float m_fLoopStartTime;
+	int m_iLoopCount;
+	std::vector<RAW_COMMAND> m_groupCommands;
+	std::vector<RAW_COMMAND> m_commands; // scratch
+	std::vector<std::string> m_tokens; // scratch
+	unsigned int m_iRawKeyframeCounter;
+
+	// hot per sprite state for update(), copied from m_sprites (same index)
+	std::vector<unsigned int> m_spriteFirstTracks;
+	std::vector<unsigned short> m_spriteTrackMasks;
+	std::vector<unsigned short> m_spriteFollowerMasks;
+	std::vector<float> m_spriteEndTimes;
+	std::vector<Vector2> m_spritePositions; // without X/Y tracks
+	std::vector<Vector2> m_spriteCenterOffsets; // from the origin to the center, relative to the size
+	std::vector<int> m_spriteImages;
+	std::vector<int> m_spriteFrameCounts; // above 1 for animations, the rest of the animation is read from the sprite
+	std::vector<float> m_spriteRotations; // last rotation, and its sine/cosine (only for sprites which don't rotate around their center)
+	std::vector<Vector2> m_spriteRotationSinCos;
+
+	// alive sprites
+	std::vector<unsigned int> m_spritesByStartTime; // without the ones which are never visible
+	std::vector<unsigned int> m_activeSprites; // in draw order
+	std::vector<unsigned int> m_activeSpritesScratch;
+	size_t m_iNextSprite; // in m_spritesByStartTime
+	float m_fActiveTime;
+	bool m_bActivePassing;
+
+	// per frame
+	bool m_bPassing;
+	Rects m_visibleRect;
+	Vector2 m_vPlaceholderImageSize;
+	std::vector<Graphics::SPRITE_INSTANCE> m_instances;
+	std::vector<BATCH> m_batches;
+	STATS m_stats;
+};
+
+#endif // !STORYBOARD_H
@@ -0,0 +1,770 @@
+#include "JobSystem.h"
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "Timer/Timer.h"
+#include "Thread/Thread.h"
+#include "Profiler/Profiler.h"
+
+#include <thread>
+
+void _job_threads_callback(UString oldValue, UString newValue);
+
+ConVar job_threads("job_threads", -1, "number of job system worker threads, -1 is one less than the number of cores (the main thread helps while waiting)", _job_threads_callback);
+
+static int _getNumDefaultThreads() {
+	const int numThreads = job_threads.getInt();
+	if (numThreads >= 0)
+		return numThreads;
+
+	return std::max((int)std::thread::hardware_concurrency() - 1, 1);
+}
+
+static std::atomic<JobSystem*> g_jobSystem(NULL);
+
+void _job_threads_callback(UString oldValue, UString newValue) {
+	// otherwise read on creation; workers can't be replaced while jobs might be running, so this is applied by update()
+	JobSystem* jobSystem = JobSystem::getIfCreated();
+	if (jobSystem != NULL)
+		jobSystem->requestNumThreads(_getNumDefaultThreads());
+}
+
+struct JobSystem::JOB {
+	void (*function)(JOB* job);
+	JobSystem* system;
+	COUNTER* counter;
+
+	// depends on the function
+	void* data;
+	int begin;
+	int end;
+	std::function<void()> userFunction;
+};
+
+struct JobSystem::WORKER {
+	JobSystem* system;
+	TacoThread* thread;
+	JobDeque deque;
+	unsigned int random; // victim selection
+};
+
+struct JobSystem::PARALLEL_FOR {
+	const std::function<void(int, int)>* function;
+	int grainSize;
+	COUNTER counter;
+};
+
+struct JobSystem::JOB_CACHE {
+	JobSystem* system;
+	JOB* jobs[JOBSYSTEM_JOB_CACHE_SIZE];
+	int numJobs;
+};
+
+constinit thread_local JobSystem::WORKER* JobSystem::s_currentWorker = NULL;
+thread_local JobSystem::JOB_CACHE JobSystem::s_jobCache;
+
+JobSystem* JobSystem::get() {
+	static JobSystem jobSystem;
+	g_jobSystem.store(&jobSystem, std::memory_order_release);
+	return &jobSystem;
+}
+
+JobSystem* JobSystem::getIfCreated() {
+	return g_jobSystem.load(std::memory_order_acquire);
+}
+
+
+
+//****************//
+//	JobGraph     //
+//****************//
+
+JobGraph::JobGraph() {
+	m_iNumUnfinished = 0;
+}
+
+int JobGraph::addJob(std::function<void()> function) {
+	m_nodes.emplace_back();
+	m_nodes.back().function = std::move(function);
+	return (int)m_nodes.size() - 1;
+}
+
+void JobGraph::addDependency(int job, int prerequisite) {
+	if (job < 0 || job >= (int)m_nodes.size() || prerequisite < 0 || prerequisite >= (int)m_nodes.size() || job == prerequisite) {
+		debugLog("JobGraph: invalid dependency %i -> %i\n", prerequisite, job);
+		return;
+	}
+
+	m_nodes[prerequisite].successors.push_back(job);
+	m_nodes[job].numPrerequisites++;
+}
+
+void JobGraph::clear() {
+	m_nodes.clear();
+}
+
+
+
+//****************//
+//	JobDeque     //
+//****************//
+
+JobSystem::JobDeque::JobDeque() {
+	m_iTop = 0;
+	m_iBottom = 0;
+	for (int i = 0; i < JOBSYSTEM_DEQUE_SIZE; i++) {
+		m_jobs[i].store(NULL, std::memory_order_relaxed);
+	}
+}
+
+// see "Correct and Efficient Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli), without resizing
+
+bool JobSystem::JobDeque::push(JOB* job) {
+	const long long bottom = m_iBottom.load(std::memory_order_relaxed);
+	const long long top = m_iTop.load(std::memory_order_acquire);
+	if (bottom - top >= JOBSYSTEM_DEQUE_SIZE)
+		return false;
+
+	m_jobs[bottom & (JOBSYSTEM_DEQUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+	m_iBottom.store(bottom + 1, std::memory_order_release);
+	return true;
+}
+
+JobSystem::JOB* JobSystem::JobDeque::pop() {
+	const long long bottom = m_iBottom.load(std::memory_order_relaxed) - 1;
+	m_iBottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long top = m_iTop.load(std::memory_order_relaxed);
+
+	if (top > bottom) {
+		// empty
+		m_iBottom.store(bottom + 1, std::memory_order_relaxed);
+		return NULL;
+	}
+
+	JOB* job = m_jobs[bottom & (JOBSYSTEM_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (top == bottom) {
+		// the last one, race against thieves
+		if (!m_iTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = NULL;
+		m_iBottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+JobSystem::JOB* JobSystem::JobDeque::steal() {
+	long long top = m_iTop.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const long long bottom = m_iBottom.load(std::memory_order_acquire);
+	if (top >= bottom)
+		return NULL;
+
+	JOB* job = m_jobs[top & (JOBSYSTEM_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (!m_iTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return NULL;
+
+	return job;
+}
+
+
+
+//*****************//
+//	JobSystem     //
+//*****************//
+
+JobSystem::JobSystem() {
+	m_iNumWorkers = 0;
+	m_bRunning = false;
+	m_iQueueSize = 0;
+	m_iWorkEpoch = 0;
+	m_iNumSleeping = 0;
+	m_iNumExternalThreads = 0;
+	m_bResizing = false;
+	m_iRequestedNumThreads = -1;
+
+	startWorkers(_getNumDefaultThreads());
+}
+
+JobSystem::~JobSystem() {
+	g_jobSystem = NULL;
+	stopWorkers();
+
+	// jobs which were never waited for
+	for (size_t i = 0; i < m_queue.size(); i++) {
+		execute(m_queue[i]);
+	}
+	m_queue.clear();
+
+	for (size_t i = 0; i < m_jobBlocks.size(); i++) {
+		delete[] m_jobBlocks[i];
+	}
+	m_jobBlocks.clear();
+	m_freeJobs.clear();
+
+	if (s_jobCache.system == this)
+		s_jobCache.system = NULL;
+}
+
+void JobSystem::run(std::function<void()> function, COUNTER* counter) {
+	const bool external = enterExternal();
+
+	JOB* job = allocateJob();
+	job->function = executeFunction;
+	job->counter = counter;
+	job->userFunction = std::move(function);
+	if (counter != NULL)
+		counter->fetch_add(1, std::memory_order_relaxed);
+
+	submit(job);
+
+	if (external)
+		leaveExternal();
+}
+
+void JobSystem::run(JobGraph& graph) {
+	const int numNodes = graph.getNumJobs();
+	if (numNodes < 1) return;
+
+	const bool external = enterExternal();
+
+	graph.m_iNumUnfinished.store(numNodes, std::memory_order_relaxed);
+	for (int i = 0; i < numNodes; i++) {
+		graph.m_nodes[i].numPending.store(graph.m_nodes[i].numPrerequisites, std::memory_order_relaxed);
+	}
+
+	// all counts are set before the first job can finish
+	for (int i = 0; i < numNodes; i++) {
+		if (graph.m_nodes[i].numPrerequisites > 0) continue;
+
+		JOB* job = allocateJob();
+		job->function = executeGraphNode;
+		job->counter = &graph.m_iNumUnfinished;
+		job->data = &graph;
+		job->begin = i;
+		submit(job);
+	}
+
+	if (external)
+		leaveExternal();
+}
+
+void JobSystem::wait(COUNTER* counter) {
+	if (counter == NULL) return;
+
+	const bool external = enterExternal();
+
+	WORKER* worker = (s_currentWorker != NULL && s_currentWorker->system == this ? s_currentWorker : NULL);
+	int numIdleSpins = 0;
+	while (counter->load(std::memory_order_acquire) > 0) {
+		JOB* job = findJob(worker);
+		if (job != NULL) {
+			execute(job);
+			numIdleSpins = 0;
+		}
+		else if (++numIdleSpins > 64) {
+			// the remaining jobs are running on other threads
+			std::this_thread::yield();
+		}
+	}
+
+	if (external)
+		leaveExternal();
+}
+
+void JobSystem::wait(JobGraph& graph) {
+	wait(&graph.m_iNumUnfinished);
+}
+
+void JobSystem::parallelFor(int begin, int end, const std::function<void(int, int)>& function, int minGrainSize) {
+	if (begin >= end) return;
+
+	const bool external = enterExternal();
+
+	PARALLEL_FOR parallelFor;
+	parallelFor.function = &function;
+	parallelFor.grainSize = std::max(minGrainSize, 1);
+	parallelFor.counter = 0;
+
+	// the calling thread starts with the whole range, everything which it splits off is waited for
+	JOB job;
+	job.system = this;
+	job.data = &parallelFor;
+	job.begin = begin;
+	job.end = end;
+	executeParallelFor(&job);
+
+	wait(&parallelFor.counter);
+
+	if (external)
+		leaveExternal();
+}
+
+bool JobSystem::tryExecuteJob() {
+	const bool external = enterExternal();
+
+	JOB* job = findJob(s_currentWorker != NULL && s_currentWorker->system == this ? s_currentWorker : NULL);
+	if (job != NULL)
+		execute(job);
+
+	if (external)
+		leaveExternal();
+	return (job != NULL);
+}
+
+bool JobSystem::enterExternal() {
+	// workers are covered by the idle check of update()
+	if (s_currentWorker != NULL && s_currentWorker->system == this)
+		return false;
+
+	// pairs with update() (both seq_cst): either it sees this thread inside, or this sees it resizing and waits until it's done
+	while (true) {
+		m_iNumExternalThreads.fetch_add(1, std::memory_order_seq_cst);
+		if (!m_bResizing.load(std::memory_order_seq_cst))
+			return true;
+
+		m_iNumExternalThreads.fetch_sub(1, std::memory_order_seq_cst);
+		while (m_bResizing.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::leaveExternal() {
+	m_iNumExternalThreads.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::executeFunction(JOB* job) {
+	job->userFunction();
+	job->userFunction = NULL; // captures are released right away, not when the job is reused
+}
+
+void JobSystem::executeGraphNode(JOB* job) {
+	JobGraph* graph = (JobGraph*)job->data;
+	JobGraph::NODE& node = graph->m_nodes[job->begin];
+	node.function();
+
+	// successors are submitted before this job counts as finished, so the graph can't finish early
+	for (size_t i = 0; i < node.successors.size(); i++) {
+		JobGraph::NODE& successor = graph->m_nodes[node.successors[i]];
+		if (successor.numPending.fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+
+		JOB* successorJob = job->system->allocateJob();
+		successorJob->function = executeGraphNode;
+		successorJob->counter = &graph->m_iNumUnfinished;
+		successorJob->data = graph;
+		successorJob->begin = node.successors[i];
+		job->system->submit(successorJob);
+	}
+}
+
+void JobSystem::executeParallelFor(JOB* job) {
+	PARALLEL_FOR* parallelFor = (PARALLEL_FOR*)job->data;
+	JobSystem* self = job->system;
+	WORKER* worker = (s_currentWorker != NULL && s_currentWorker->system == self ? s_currentWorker : NULL);
+
+	int begin = job->begin;
+	int end = job->end;
+	while (begin < end) {
+		// lazy binary splitting: hand out the upper half while there is nothing else to steal
+		while (end - begin > parallelFor->grainSize && !self->hasQueuedWork(worker)) {
+			const int middle = begin + (end - begin) / 2;
+
+			JOB* split = self->allocateJob();
+			split->function = executeParallelFor;
+			split->counter = &parallelFor->counter;
+			split->data = parallelFor;
+			split->begin = middle;
+			split->end = end;
+			parallelFor->counter.fetch_add(1, std::memory_order_relaxed);
+			self->submit(split);
+
+			end = middle;
+		}
+
+		const int chunkEnd = std::min(end, begin + parallelFor->grainSize);
+		(*parallelFor->function)(begin, chunkEnd);
+		begin = chunkEnd;
+	}
+}
+
+JobSystem::JOB* JobSystem::allocateJob() {
+	JOB_CACHE& cache = s_jobCache;
+	if (cache.system != this) {
+		cache.system = this;
+		cache.numJobs = 0;
+	}
+
+	if (cache.numJobs < 1) {
+		std::lock_guard<std::mutex> lock(m_freeJobsMutex);
+
+		if ((int)m_freeJobs.size() < JOBSYSTEM_JOB_CACHE_SIZE / 2) {
+			JOB* block = new JOB[JOBSYSTEM_JOB_CACHE_SIZE];
+			m_jobBlocks.push_back(block);
+			for (int i = 0; i < JOBSYSTEM_JOB_CACHE_SIZE; i++) {
+				m_freeJobs.push_back(&block[i]);
+			}
+		}
+
+		for (int i = 0; i < JOBSYSTEM_JOB_CACHE_SIZE / 2; i++) {
+			cache.jobs[cache.numJobs++] = m_freeJobs.back();
+			m_freeJobs.pop_back();
+		}
+	}
+
+	JOB* job = cache.jobs[--cache.numJobs];
+	job->system = this;
+	job->counter = NULL;
+	job->data = NULL;
+	return job;
+}
+
+void JobSystem::freeJob(JOB* job) {
+	JOB_CACHE& cache = s_jobCache;
+	if (cache.system != this) {
+		cache.system = this;
+		cache.numJobs = 0;
+	}
+
+	// threads which mostly finish jobs (workers) hand them back to the ones which mostly create them
+	if (cache.numJobs >= JOBSYSTEM_JOB_CACHE_SIZE) {
+		std::lock_guard<std::mutex> lock(m_freeJobsMutex);
+		for (int i = 0; i < JOBSYSTEM_JOB_CACHE_SIZE / 2; i++) {
+			m_freeJobs.push_back(cache.jobs[--cache.numJobs]);
+		}
+	}
+
+	cache.jobs[cache.numJobs++] = job;
+}
+
+void JobSystem::submit(JOB* job) {
+	// without workers nobody else would ever run it
+	if (m_iNumWorkers.load(std::memory_order_relaxed) < 1) {
+		execute(job);
+		return;
+	}
+
+	WORKER* worker = (s_currentWorker != NULL && s_currentWorker->system == this ? s_currentWorker : NULL);
+	if (worker != NULL) {
+		if (!worker->deque.push(job)) {
+			execute(job);
+			return;
+		}
+	}
+	else {
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_queue.push_back(job);
+		m_iQueueSize.store((int)m_queue.size(), std::memory_order_relaxed);
+	}
+
+	wakeWorkers();
+}
+
+JobSystem::JOB* JobSystem::findJob(WORKER* worker) {
+	if (worker != NULL) {
+		JOB* job = worker->deque.pop();
+		if (job != NULL)
+			return job;
+	}
+
+	// like the deques: threads which submit into the queue take their newest jobs (usually the children of what they are waiting for),
+	// workers take the oldest ones (usually the biggest), otherwise waiting threads could nest ever bigger jobs on their stack
+	if (m_iQueueSize.load(std::memory_order_relaxed) > 0) {
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		if (m_queue.size() > 0) {
+			JOB* job = NULL;
+			if (worker != NULL) {
+				job = m_queue.front();
+				m_queue.pop_front();
+			}
+			else {
+				job = m_queue.back();
+				m_queue.pop_back();
+			}
+			m_iQueueSize.store((int)m_queue.size(), std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	// steal, starting at a random victim
+	const int numWorkers = m_iNumWorkers.load(std::memory_order_acquire);
+	if (numWorkers < 1)
+		return NULL;
+
+	unsigned int start = 0;
+	if (worker != NULL) {
+		worker->random ^= worker->random << 13;
+		worker->random ^= worker->random >> 17;
+		worker->random ^= worker->random << 5;
+		start = worker->random;
+	}
+	else
+		start = (unsigned int)std::hash<std::thread::id>()(std::this_thread::get_id());
+
+	for (int i = 0; i < numWorkers; i++) {
+		WORKER* victim = m_workers[(start + i) % numWorkers];
+		if (victim == worker) continue;
+
+		JOB* job = victim->deque.steal();
+		if (job != NULL)
+			return job;
+	}
+
+	return NULL;
+}
+
+void JobSystem::execute(JOB* job) {
+	job->function(job);
+
+	// the counter is the last thing which is touched, waiters may destroy what it belongs to right after
+	COUNTER* counter = job->counter;
+	freeJob(job);
+	if (counter != NULL)
+		counter->fetch_sub(1, std::memory_order_release);
+}
+
+bool JobSystem::hasQueuedWork(WORKER* worker) {
+	if (worker != NULL)
+		return !worker->deque.isEmpty();
+
+	return (m_iQueueSize.load(std::memory_order_relaxed) > 0);
+}
+
+void JobSystem::wakeWorkers() {
+	// pairs with the epoch check of a worker which is about to sleep (both seq_cst): either it sees the new epoch, or this sees it sleeping
+	m_iWorkEpoch.fetch_add(1, std::memory_order_seq_cst);
+	if (m_iNumSleeping.load(std::memory_order_seq_cst) > 0) {
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_sleepCondition.notify_one();
+	}
+}
+
+void *JobSystem::workerThread(void *data) {
+	WORKER* worker = (WORKER*)data;
+	JobSystem* self = worker->system;
+	s_currentWorker = worker;
+
+	VPROF_THREAD_NAME("JobWorker");
+	while (true) {
+		VPROF_THREAD_FRAME();
+
+		// a few rounds of looking for work before going to sleep
+		const unsigned int epoch = self->m_iWorkEpoch.load(std::memory_order_seq_cst);
+		bool executed = false;
+		for (int i = 0; i < 64; i++) {
+			JOB* job = self->findJob(worker);
+			if (job != NULL) {
+				self->execute(job);
+				executed = true;
+				break;
+			}
+			std::this_thread::yield();
+		}
+		if (executed) continue;
+		if (!self->m_bRunning.load(std::memory_order_acquire)) break;
+
+		std::unique_lock<std::mutex> lock(self->m_sleepMutex);
+		self->m_iNumSleeping.fetch_add(1, std::memory_order_seq_cst);
+		self->m_sleepCondition.wait(lock, [self, epoch] { return (self->m_iWorkEpoch.load(std::memory_order_seq_cst) != epoch || !self->m_bRunning.load(std::memory_order_acquire)); });
+		self->m_iNumSleeping.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	s_currentWorker = NULL;
+	return NULL;
+}
+
+void JobSystem::setNumThreads(int numThreads) {
+	if (numThreads == getNumThreads()) return;
+
+	stopWorkers();
+	startWorkers(numThreads);
+}
+
+void JobSystem::requestNumThreads(int numThreads) {
+	m_iRequestedNumThreads.store(std::max(numThreads, 0), std::memory_order_release);
+}
+
+void JobSystem::update() {
+	int numThreads = m_iRequestedNumThreads.load(std::memory_order_acquire);
+	if (numThreads < 0) return;
+
+	// stopWorkers() deletes the workers which findJob() iterates, so only while no other thread is inside and every worker sleeps with nothing queued
+	m_bResizing.store(true, std::memory_order_seq_cst);
+	bool idle = (m_iNumExternalThreads.load(std::memory_order_seq_cst) == 0 && m_iQueueSize.load(std::memory_order_acquire) == 0);
+	if (idle) {
+		int numWorkerThreads = 0;
+		for (size_t i = 0; i < m_workers.size(); i++) {
+			if (m_workers[i]->thread != NULL)
+				numWorkerThreads++;
+		}
+		idle = (m_iNumSleeping.load(std::memory_order_seq_cst) == numWorkerThreads);
+	}
+	if (idle)
+		setNumThreads(numThreads);
+	m_bResizing.store(false, std::memory_order_release);
+
+	// otherwise tried again next frame, unless another value was requested in the meantime
+	if (idle)
+		m_iRequestedNumThreads.compare_exchange_strong(numThreads, -1, std::memory_order_acq_rel);
+}
+
+void JobSystem::startWorkers(int numThreads) {
+	m_bRunning = true;
+
+	// all workers exist before the first one can start stealing
+	for (int i = 0; i < numThreads; i++) {
+		WORKER* worker = new WORKER();
+		worker->system = this;
+		worker->thread = NULL;
+		worker->random = 0x9E3779B9u * (unsigned int)(i + 1);
+		m_workers.push_back(worker);
+	}
+	m_iNumWorkers.store((int)m_workers.size(), std::memory_order_release);
+
+	for (size_t i = 0; i < m_workers.size(); i++) {
+		m_workers[i]->thread = new TacoThread(JobSystem::workerThread, (void*)m_workers[i]);
+		if (!m_workers[i]->thread->isReady()) {
+			// stays in the list with an empty deque
+			debugLog("JobSystem: Couldn't create worker thread #%i!\n", (int)i);
+			SAFE_DELETE(m_workers[i]->thread);
+		}
+	}
+}
+
+void JobSystem::stopWorkers() {
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_bRunning = false;
+	}
+	m_sleepCondition.notify_all();
+
+	// workers only exit once there is nothing left to do
+	for (size_t i = 0; i < m_workers.size(); i++) {
+		SAFE_DELETE(m_workers[i]->thread); // joins
+	}
+
+	m_iNumWorkers.store(0, std::memory_order_release);
+	for (size_t i = 0; i < m_workers.size(); i++) {
+		delete m_workers[i];
+	}
+	m_workers.clear();
+}
+
+
+
+//**************//
+//	Commands    //
+//**************//
+
+static void _spinWork(int iterations, volatile float* sink) {
+	float value = *sink;
+	for (int i = 0; i < iterations; i++) {
+		value = value * 0.999f + 0.001f;
+	}
+	*sink = value;
+}
+
+static void _runTaskTree(JobSystem* jobSystem, int depth, std::atomic<int>* numLeaves) {
+	if (depth == 0) {
+		volatile float sink = 0.0f;
+		_spinWork(256, &sink);
+		numLeaves->fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	JobSystem::COUNTER counter(0);
+	jobSystem->run([=]() { _runTaskTree(jobSystem, depth - 1, numLeaves); }, &counter);
+	_runTaskTree(jobSystem, depth - 1, numLeaves);
+	jobSystem->wait(&counter);
+}
+
+void _job_benchmark(void) {
+	JobSystem* jobSystem = JobSystem::get();
+	const int previousNumThreads = jobSystem->getNumThreads();
+
+	const int numElements = 1 << 22;
+	const int taskTreeDepth = 16;
+	const int numGraphLayers = 32;
+	const int numGraphJobsPerLayer = 128;
+
+	std::vector<float> elements(numElements);
+	for (int i = 0; i < numElements; i++) {
+		elements[i] = (float)(i % 1000);
+	}
+
+	// layered graph, every job depends on two of the previous layer
+	JobGraph graph;
+	std::vector<int> graphResults(numGraphLayers * numGraphJobsPerLayer);
+	for (int layer = 0; layer < numGraphLayers; layer++) {
+		for (int i = 0; i < numGraphJobsPerLayer; i++) {
+			const int index = layer * numGraphJobsPerLayer + i;
+			graph.addJob([&graphResults, index, layer, i, numGraphJobsPerLayer]() {
+				volatile float sink = 0.0f;
+				_spinWork(2048, &sink);
+				graphResults[index] = (layer > 0 ? graphResults[index - numGraphJobsPerLayer] + graphResults[(layer - 1) * numGraphJobsPerLayer + (i + 1) % numGraphJobsPerLayer] : 1) % 1000003;
+			});
+			if (layer > 0) {
+				graph.addDependency(index, index - numGraphJobsPerLayer);
+				graph.addDependency(index, (layer - 1) * numGraphJobsPerLayer + (i + 1) % numGraphJobsPerLayer);
+			}
+		}
+	}
+
+	debugLog("JobSystem: %i hardware threads, parallelFor over %i elements, task tree of depth %i, graph of %i x %i jobs\n", (int)std::thread::hardware_concurrency(), numElements, taskTreeDepth, numGraphLayers, numGraphJobsPerLayer);
+
+	double baseline[3] = {0.0, 0.0, 0.0};
+	int expectedGraphResult = 0;
+	const int threadCounts[] = {1, 2, 4, 8, 16, 32};
+	for (int t = 0; t < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); t++) {
+		// the calling thread is one of them
+		jobSystem->setNumThreads(threadCounts[t] - 1);
+
+		int numErrors = 0;
+		double times[3];
+		Timer timer;
+
+		std::atomic<long long> sum(0);
+		timer.start();
+		jobSystem->parallelFor(0, numElements, [&](int begin, int end) {
+			float partialSum = 0.0f;
+			for (int i = begin; i < end; i++) {
+				partialSum += std::sqrt(elements[i]);
+			}
+			sum.fetch_add((long long)partialSum, std::memory_order_relaxed);
+		}, 4096);
+		timer.update();
+		times[0] = timer.getElapsedTime();
+		if (sum.load() < 1)
+			numErrors++;
+
+		std::atomic<int> numLeaves(0);
+		timer.start();
+		_runTaskTree(jobSystem, taskTreeDepth, &numLeaves);
+		timer.update();
+		times[1] = timer.getElapsedTime();
+		if (numLeaves.load() != (1 << taskTreeDepth))
+			numErrors++;
+
+		timer.start();
+		jobSystem->run(graph);
+		jobSystem->wait(graph);
+		timer.update();
+		times[2] = timer.getElapsedTime();
+		if (t == 0)
+			expectedGraphResult = graphResults.back();
+		else if (graphResults.back() != expectedGraphResult)
+			numErrors++;
+
+		if (t == 0) {
+			for (int i = 0; i < 3; i++) {
+				baseline[i] = times[i];
+			}
+		}
+
+		debugLog("JobSystem: %2i threads: parallelFor %.2f ms (x%.2f), task tree %.2f ms (x%.2f), graph %.2f ms (x%.2f), %i errors\n", threadCounts[t], times[0] * 1000.0, baseline[0] / times[0], times[1] * 1000.0, baseline[1] / times[1], times[2] * 1000.0, baseline[2] / times[2], numErrors);
+	}
+
+	jobSystem->setNumThreads(previousNumThreads);
+}
+
+ConVar _job_benchmark_("job_benchmark", "measures parallelFor, nested jobs and a job graph with 1 to 32 threads", _job_benchmark);
@@ -0,0 +1,160 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include "cbase.h"
+
+#include <mutex>
+#include <deque>
+#include <condition_variable>
+
+#define JOBSYSTEM_DEQUE_SIZE	4096 // jobs per worker, power of two, pushing onto a full deque runs the job inline
+#define JOBSYSTEM_JOB_CACHE_SIZE	64 // recycled jobs per thread
+
+class TacoThread;
+class JobSystem;
+
+// dependency-counted task graph: a job runs once all of its prerequisites have finished
+// the graph must be acyclic, and must not be modified or destroyed while it is running (see JobSystem::wait())
+// it can be run again once finished, which doesn't allocate anymore
+class JobGraph {
+	friend class JobSystem;
+
+public:
+	JobGraph();
+
+	int addJob(std::function<void()> function); // returns the index of the job
+	void addDependency(int job, int prerequisite); // job runs after prerequisite
+	void clear();
+
+	inline int getNumJobs() const { return (int)m_nodes.size(); }
+	inline bool isFinished() const { return (m_iNumUnfinished.load(std::memory_order_acquire) == 0); }
+
+private:
+	struct NODE {
+		std::function<void()> function;
+		std::vector<int> successors;
+		int numPrerequisites;
+		std::atomic<int> numPending; // prerequisites which have not finished yet in the current run
+
+		NODE() : numPrerequisites(0), numPending(0) { ; }
+		NODE(NODE&& other) noexcept : function(std::move(other.function)), successors(std::move(other.successors)), numPrerequisites(other.numPrerequisites), numPending(0) { ; }
+	};
+
+	std::vector<NODE> m_nodes;
+	std::atomic<int> m_iNumUnfinished;
+};
+
+// engine wide pool of worker threads (TacoThread) for cpu bound work, shared by all subsystems instead of each one spawning their own threads
+// every worker owns a work stealing deque (chase-lev): it pushes/pops its own jobs at the bottom, idle workers steal from the top of others
+// jobs submitted by other threads (main thread, loader threads) go into a shared queue
+// waiting (wait()) never blocks while there is work: the waiting thread executes queued jobs until the awaited ones have finished
+// jobs themselves may submit and wait, nested parallelFor() is fine
+// the number of workers is job_threads (default: one less than the number of cores, the main thread helps while waiting), see job_benchmark
+class JobSystem {
+public:
+	typedef std::atomic<int> COUNTER; // number of unfinished jobs, see run() and wait()
+
+	static JobSystem* get(); // created on first use
+	static JobSystem* getIfCreated(); // NULL until the first get(), for code which shouldn't create it
+
+public:
+	JobSystem();
+	~JobSystem();
+
+	// counter (optional) is incremented now and decremented once the job has finished
+	void run(std::function<void()> function, COUNTER* counter = NULL);
+	void run(JobGraph& graph);
+
+	// helps executing jobs until the counter is 0 (or the graph has finished)
+	void wait(COUNTER* counter);
+	void wait(JobGraph& graph);
+
+	// calls function(begin, end) for subranges of [begin, end) in parallel, and waits for all of them
+	// ranges are split lazily: a subrange is only split in half while the thread running it has no other queued work (so that idle threads can steal the other half),
+	// and never below minGrainSize iterations, which should cover at least a microsecond of work
+	void parallelFor(int begin, int end, const std::function<void(int, int)>& function, int minGrainSize = 1);
+
+	void setNumThreads(int numThreads); // number of worker threads, not counting the threads which wait; must not be called while jobs are running
+	void requestNumThreads(int numThreads); // any time, applied by update() once no job is running
+	inline int getNumThreads() const { return (int)m_workers.size(); }
+
+	void update(); // frame boundary of the main thread
+
+	// executes one queued job on the calling thread if there is one (for threads with their own loops)
+	bool tryExecuteJob();
+
+private:
+	struct JOB;
+	struct WORKER;
+	struct PARALLEL_FOR;
+	struct JOB_CACHE;
+
+	// chase-lev deque with a fixed size: the owning worker pushes and pops at the bottom, any thread steals from the top
+	class JobDeque {
+	public:
+		JobDeque();
+
+		bool push(JOB* job); // owner, false if full
+		JOB* pop(); // owner
+		JOB* steal(); // any thread, NULL if empty or if another thread won the race
+
+		inline bool isEmpty() const { return (m_iBottom.load(std::memory_order_relaxed) <= m_iTop.load(std::memory_order_relaxed)); }
+
+	private:
+		std::atomic<long long> m_iTop;
+		std::atomic<long long> m_iBottom;
+		std::atomic<JOB*> m_jobs[JOBSYSTEM_DEQUE_SIZE];
+	};
+
+	static void *workerThread(void *data);
+
+	static constinit thread_local WORKER* s_currentWorker;
+	static thread_local JOB_CACHE s_jobCache;
+
+	static void executeFunction(JOB* job);
+	static void executeGraphNode(JOB* job);
+	static void executeParallelFor(JOB* job);
+
+	JOB* allocateJob();
+	void freeJob(JOB* job);
+
+	void submit(JOB* job);
+	JOB* findJob(WORKER* worker);
+	void execute(JOB* job);
+	bool hasQueuedWork(WORKER* worker);
+	void wakeWorkers();
+
+	void startWorkers(int numThreads);
+	void stopWorkers();
+
+	// threads which aren't workers of this system, while they are inside of it (returns false for workers, which don't count)
+	bool enterExternal();
+	void leaveExternal();
+
+	std::vector<WORKER*> m_workers;
+	std::atomic<int> m_iNumWorkers; // read by stealing threads, workers are only added or removed while idle
+	std::atomic<bool> m_bRunning;
+
+	// jobs of threads which are not workers
+	std::mutex m_queueMutex;
+	std::deque<JOB*> m_queue;
+	std::atomic<int> m_iQueueSize;
+
+	// sleeping workers, woken up whenever the epoch changes
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+	std::atomic<unsigned int> m_iWorkEpoch;
+	std::atomic<int> m_iNumSleeping;
+
+	// deferred job_threads changes, see update()
+	std::atomic<int> m_iNumExternalThreads;
+	std::atomic<bool> m_bResizing;
+	std::atomic<int> m_iRequestedNumThreads; // -1 if none
+
+	// recycled jobs, threads keep a local cache and exchange batches with this one
+	std::mutex m_freeJobsMutex;
+	std::vector<JOB*> m_freeJobs;
+	std::vector<JOB*> m_jobBlocks;
+};
+
+#endif // !JOBSYSTEM_H
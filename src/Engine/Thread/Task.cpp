@@ -0,0 +1,431 @@
+#include "Task.h"
+#include "Engine.h"
+#include "ConVar/ConVar.h"
+#include "Timer/Timer.h"
+#include "Thread/Thread.h"
+#include "Thread/JobSystem.h"
+#include "Profiler/Profiler.h"
+#include "Environment/Environment.h"
+#include "Resource/Resource.h"
+#include "ResourceManager/ResourceManager.h"
+
+#include <fstream>
+#include <filesystem>
+
+void _task_io_threads_callback(UString oldValue, UString newValue);
+
+ConVar task_io_threads("task_io_threads", 2, "number of threads for the blocking file reads of coroutine tasks (TaskScheduler::readFile()), 0 reads on the thread of the task", _task_io_threads_callback);
+ConVar task_main_thread_budget("task_main_thread_budget", 4.0f, "milliseconds per frame for continuing tasks on the main thread (at least one always continues), the rest waits for the next frame, 0 is unlimited");
+
+static std::atomic<TaskScheduler*> g_taskScheduler(NULL);
+
+void _task_io_threads_callback(UString oldValue, UString newValue) {
+	// otherwise read on creation
+	TaskScheduler* taskScheduler = TaskScheduler::getIfCreated();
+	if (taskScheduler != NULL)
+		taskScheduler->setNumIOThreads(std::max(task_io_threads.getInt(), 0));
+}
+
+TaskScheduler* TaskScheduler::get() {
+	static TaskScheduler taskScheduler;
+	g_taskScheduler.store(&taskScheduler, std::memory_order_release);
+	return &taskScheduler;
+}
+
+TaskScheduler* TaskScheduler::getIfCreated() {
+	return g_taskScheduler.load(std::memory_order_acquire);
+}
+
+bool TaskScheduler::readFileNow(UString filePath, std::vector<char>& data) {
+	data.clear();
+
+	std::ifstream file(filePath.toUtf8(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.good()) {
+		debugLog("TaskScheduler: can't open %s\n", filePath.toUtf8());
+		return false;
+	}
+
+	data.resize((size_t)file.tellg());
+	file.seekg(0);
+	file.read(data.data(), data.size());
+	if (!file.good()) {
+		debugLog("TaskScheduler: can't read %s\n", filePath.toUtf8());
+		data.clear();
+		return false;
+	}
+
+	return true;
+}
+
+
+
+//*****************//
+//	Awaiters      //
+//*****************//
+
+// careful: once a coroutine is queued, another thread may resume (and finish) it before await_suspend() returns, the awaiter is part of its frame
+
+bool TaskScheduler::IO_THREAD_AWAITER::await_suspend(std::coroutine_handle<> handle) {
+	return TaskScheduler::get()->scheduleIO(handle, NULL);
+}
+
+bool TaskScheduler::READ_FILE_AWAITER::await_suspend(std::coroutine_handle<> handle) {
+	if (TaskScheduler::get()->scheduleIO(handle, this))
+		return true;
+
+	// no i/o threads
+	readFileNow(filePath, data);
+	return false;
+}
+
+void TaskScheduler::JOB_SYSTEM_AWAITER::await_suspend(std::coroutine_handle<> handle) {
+	JobSystem::get()->run([handle]() {
+		handle.resume();
+	});
+}
+
+void TaskScheduler::MAIN_THREAD_AWAITER::await_suspend(std::coroutine_handle<> handle) {
+	TaskScheduler::get()->scheduleMainThread(handle);
+}
+
+
+
+//*********************//
+//	TaskScheduler     //
+//*********************//
+
+TaskScheduler::TaskScheduler() {
+	m_bIORunning = false;
+
+	startIOThreads(std::max(task_io_threads.getInt(), 0));
+}
+
+TaskScheduler::~TaskScheduler() {
+	g_taskScheduler = NULL;
+	stopIOThreads();
+}
+
+void TaskScheduler::update() {
+	VPROF_BUDGET("TaskScheduler::update", VPROF_BUDGETGROUP_UPDATE);
+
+	// only the ones which were already waiting, tasks which wait for the main thread again continue in the next frame
+	const size_t numTasks = getNumMainThreadTasks();
+	const double budget = task_main_thread_budget.getFloat() / 1000.0;
+
+	Timer timer;
+	timer.start();
+	for (size_t i = 0; i < numTasks; i++) {
+		std::coroutine_handle<> handle;
+		{
+			std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+			handle = m_mainThreadQueue.front();
+			m_mainThreadQueue.pop_front();
+		}
+
+		handle.resume();
+
+		if (budget > 0.0) {
+			timer.update();
+			if (timer.getElapsedTime() >= budget) break;
+		}
+	}
+}
+
+size_t TaskScheduler::getNumMainThreadTasks() {
+	std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+	return m_mainThreadQueue.size();
+}
+
+void TaskScheduler::setNumIOThreads(int numThreads) {
+	if (numThreads == getNumIOThreads()) return;
+
+	stopIOThreads();
+	startIOThreads(numThreads);
+}
+
+bool TaskScheduler::scheduleIO(std::coroutine_handle<> handle, READ_FILE_AWAITER* readFile) {
+	{
+		std::lock_guard<std::mutex> lock(m_ioMutex);
+		if (m_ioThreads.size() < 1)
+			return false;
+
+		IO_WORK work;
+		work.handle = handle;
+		work.readFile = readFile;
+		m_ioQueue.push_back(work);
+	}
+	m_ioCondition.notify_one();
+
+	return true;
+}
+
+void TaskScheduler::scheduleMainThread(std::coroutine_handle<> handle) {
+	std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+	m_mainThreadQueue.push_back(handle);
+}
+
+void TaskScheduler::startIOThreads(int numThreads) {
+	std::lock_guard<std::mutex> lock(m_ioMutex);
+	m_bIORunning = true;
+
+	for (int i = 0; i < numThreads; i++) {
+		TacoThread* thread = new TacoThread(TaskScheduler::ioThread, (void*)this);
+		if (!thread->isReady()) {
+			debugLog("TaskScheduler: Couldn't create i/o thread #%i!\n", i);
+			SAFE_DELETE(thread);
+			continue;
+		}
+		m_ioThreads.push_back(thread);
+	}
+}
+
+void TaskScheduler::stopIOThreads() {
+	std::vector<TacoThread*> threads;
+	{
+		std::lock_guard<std::mutex> lock(m_ioMutex);
+		m_bIORunning = false;
+		threads.swap(m_ioThreads);
+	}
+	m_ioCondition.notify_all();
+
+	// threads only exit once the queue is empty
+	for (size_t i = 0; i < threads.size(); i++) {
+		delete threads[i]; // joins
+	}
+}
+
+void *TaskScheduler::ioThread(void *data) {
+	TaskScheduler* self = (TaskScheduler*)data;
+
+	VPROF_THREAD_NAME("TaskIO");
+	while (true) {
+		VPROF_THREAD_FRAME();
+
+		IO_WORK work;
+		{
+			std::unique_lock<std::mutex> lock(self->m_ioMutex);
+			self->m_ioCondition.wait(lock, [self] { return (self->m_ioQueue.size() > 0 || !self->m_bIORunning); });
+			if (self->m_ioQueue.size() < 1) break;
+
+			work = self->m_ioQueue.front();
+			self->m_ioQueue.pop_front();
+		}
+
+		if (work.readFile != NULL) {
+			VPROF_BUDGET("TaskScheduler::readFile", VPROF_BUDGETGROUP_UPDATE);
+			readFileNow(work.readFile->filePath, work.readFile->data);
+		}
+
+		// until the task awaits something else
+		VPROF_BUDGET("Task", VPROF_BUDGETGROUP_UPDATE);
+		work.handle.resume();
+	}
+
+	return NULL;
+}
+
+
+
+//*****************//
+//	Benchmark     //
+//*****************//
+
+// loads synthetic resources through the ResourceManager: a file is decoded into four times its size (palette plus some arithmetic per byte, standing in for png/ogg decoding),
+// and "uploaded" on the main thread (copied into a shared buffer, checksummed)
+// either loadAsync()/load() on the loader threads (the two-phase path), the same through Resource::loadTask(), or pipelined (read on an i/o thread, decode on the job system)
+class TaskBenchmarkResource : public Resource {
+public:
+	static std::vector<unsigned char> s_texture;
+
+	TaskBenchmarkResource(UString filePath, bool pipelined) : Resource(filePath) {
+		m_bPipelined = pipelined;
+		m_iChecksum = 0;
+	}
+	virtual ~TaskBenchmarkResource() { destroy(); }
+
+	virtual Task<void> loadTask() {
+		if (!m_bPipelined)
+			return Resource::loadTask();
+
+		return loadTaskPipelined();
+	}
+
+	inline unsigned int getChecksum() const { return m_iChecksum; }
+
+protected:
+	virtual void init() {
+		if (s_texture.size() < m_pixels.size())
+			s_texture.resize(m_pixels.size());
+		memcpy(s_texture.data(), m_pixels.data(), m_pixels.size());
+
+		m_iChecksum = 0;
+		for (size_t i = 0; i < m_pixels.size(); i += 61) {
+			m_iChecksum = m_iChecksum * 31 + s_texture[i];
+		}
+
+		m_bReady = true;
+	}
+
+	virtual void initAsync() {
+		std::vector<char> data;
+		TaskScheduler::readFileNow(m_sFilePath, data);
+		decode(data);
+
+		m_bAsyncReady = true;
+	}
+
+	virtual void destroy() {
+		m_pixels = std::vector<unsigned char>();
+	}
+
+private:
+	Task<void> loadTaskPipelined() {
+		std::vector<char> data = co_await TaskScheduler::readFile(m_sFilePath);
+
+		co_await TaskScheduler::resumeOnJobSystem();
+		decode(data);
+		m_bAsyncReady = true;
+
+		co_await TaskScheduler::resumeOnMainThread();
+		load();
+	}
+
+	void decode(const std::vector<char>& data) {
+		m_pixels.resize(data.size() * 4);
+		for (size_t i = 0; i < data.size(); i++) {
+			unsigned int value = (unsigned char)data[i] * 0x9E3779B9u;
+			for (int c = 0; c < 4; c++) {
+				value ^= value >> 15;
+				value *= 0x85EBCA6Bu;
+				value ^= value >> 13;
+				m_pixels[i * 4 + c] = (unsigned char)value;
+			}
+		}
+	}
+
+	bool m_bPipelined;
+	std::vector<unsigned char> m_pixels;
+	unsigned int m_iChecksum;
+};
+
+std::vector<unsigned char> TaskBenchmarkResource::s_texture;
+
+struct TASK_BENCHMARK_RESULT {
+	double time;
+	int numFrames;
+	double mainThreadTime;
+	double maxFrameTime;
+};
+
+static TASK_BENCHMARK_RESULT _runLoadBenchmark(ResourceManager* rm, const std::vector<UString>& filePaths, bool tasks, bool pipelined, std::vector<unsigned int>& checksums) {
+	ConVar* rm_tasks = convar->getConVarByName("rm_tasks");
+	const bool previousTasks = rm_tasks->getBool();
+	rm_tasks->setValue(tasks ? 1.0f : 0.0f);
+
+	TASK_BENCHMARK_RESULT result;
+	result.numFrames = 0;
+	result.mainThreadTime = 0.0;
+	result.maxFrameTime = 0.0;
+
+	Timer timer;
+	Timer frameTimer;
+	timer.start();
+
+	std::vector<TaskBenchmarkResource*> resources;
+	for (size_t i = 0; i < filePaths.size(); i++) {
+		resources.push_back(new TaskBenchmarkResource(filePaths[i], pipelined));
+		rm->requestNextLoadAsync();
+		rm->loadResource(resources.back());
+	}
+
+	// frames of about a millisecond, until everything is uploaded
+	bool loading = true;
+	while (loading) {
+		frameTimer.start();
+		rm->update();
+		frameTimer.update();
+		result.numFrames++;
+		result.mainThreadTime += frameTimer.getElapsedTime();
+		result.maxFrameTime = std::max(result.maxFrameTime, frameTimer.getElapsedTime());
+
+		loading = false;
+		for (size_t i = 0; i < resources.size(); i++) {
+			if (!resources[i]->isReady()) {
+				loading = true;
+				break;
+			}
+		}
+		if (loading)
+			env->sleep(1000);
+	}
+
+	timer.update();
+	result.time = timer.getElapsedTime();
+
+	checksums.clear();
+	for (size_t i = 0; i < resources.size(); i++) {
+		checksums.push_back(resources[i]->getChecksum());
+		rm->destroyResource(resources[i]);
+	}
+
+	rm_tasks->setValue(previousTasks ? 1.0f : 0.0f);
+	return result;
+}
+
+void _task_benchmark(void) {
+	ResourceManager* rm = engine->getResourceManager();
+	if (rm == NULL) return;
+	if (rm->isLoading()) {
+		debugLog("TaskScheduler: can't benchmark while resources are loading\n");
+		return;
+	}
+
+	const int numFiles = 48;
+	const size_t fileSize = 512 * 1024;
+
+	// the files are in the page cache after writing them, this measures the overlap of decoding and uploading more than that of disk i/o
+	std::vector<UString> filePaths;
+	std::vector<char> data(fileSize);
+	unsigned int random = 0x12345678u;
+	for (int i = 0; i < numFiles; i++) {
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / ("task_benchmark_" + std::to_string(i) + ".bin");
+		for (size_t c = 0; c < data.size(); c++) {
+			random = random * 1664525u + 1013904223u;
+			data[c] = (char)(random >> 24);
+		}
+
+		std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(data.data(), data.size());
+		if (!file.good()) {
+			debugLog("TaskScheduler: can't write %s\n", path.string().c_str());
+			return;
+		}
+		filePaths.push_back(UString(path.string().c_str()));
+	}
+
+	debugLog("TaskScheduler: loading %i resources of %i KB (%i KB decoded), %i loader threads, %i i/o threads, %i job system workers\n", numFiles, (int)(fileSize / 1024), (int)(fileSize * 4 / 1024), (int)rm->getNumThreads(), TaskScheduler::get()->getNumIOThreads(), JobSystem::get()->getNumThreads());
+
+	const char* names[] = {"loader threads (loadAsync/load)", "tasks (loadAsync/load)", "tasks (read/decode/upload)"};
+	const bool tasks[] = {false, true, true};
+	const bool pipelined[] = {false, false, true};
+
+	std::vector<unsigned int> expectedChecksums;
+	std::vector<unsigned int> checksums;
+	double baseline = 0.0;
+	for (int i = 0; i < 3; i++) {
+		const TASK_BENCHMARK_RESULT result = _runLoadBenchmark(rm, filePaths, tasks[i], pipelined[i], checksums);
+		if (i == 0) {
+			expectedChecksums = checksums;
+			baseline = result.time;
+		}
+
+		debugLog("%32s: %8.2f ms (%.2fx), %i frames, main thread %.2f ms (max %.2f ms per frame)%s\n", names[i], result.time * 1000.0, (result.time > 0.0 ? baseline / result.time : 0.0), result.numFrames, result.mainThreadTime * 1000.0, result.maxFrameTime * 1000.0, (checksums != expectedChecksums ? ", WRONG CHECKSUMS" : ""));
+	}
+
+	std::error_code error;
+	for (size_t i = 0; i < filePaths.size(); i++) {
+		std::filesystem::remove(filePaths[i].toUtf8(), error);
+	}
+}
+
+ConVar _task_benchmark_("task_benchmark", "loads synthetic resources with the loader threads (initAsync/init) and with coroutine tasks, plain and pipelined (read on an i/o thread, decode on the job system)", _task_benchmark);
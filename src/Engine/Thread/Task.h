@@ -0,0 +1,235 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "cbase.h"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <mutex>
+#include <deque>
+#include <condition_variable>
+
+class TacoThread;
+
+// c++20 coroutines for asynchronous work which hops between threads, instead of splitting it into callbacks or initAsync()/init() with atomics
+// a loading pipeline reads top to bottom, e.g.:
+//
+//	Task<void> MyResource::loadTask() {
+//		std::vector<char> data = co_await TaskScheduler::readFile(m_sFilePath); // continues on an i/o thread
+//		co_await TaskScheduler::resumeOnJobSystem(); // decode on the job system workers
+//		decode(data);
+//		co_await TaskScheduler::resumeOnMainThread(); // upload on the main thread, in the next TaskScheduler::update()
+//		upload();
+//	}
+//
+// while one task decodes, the i/o threads are already reading the files of the next ones
+// tasks are lazy: they start once they are awaited by another task, or with start() by normal code (which then polls isDone())
+// a Task owns its coroutine, and must not be destroyed while the coroutine is running
+
+template <typename T>
+class Task;
+
+class TaskPromiseBase {
+public:
+	struct FINAL_AWAITER {
+		bool await_ready() const noexcept { return false; }
+		void await_resume() const noexcept { ; }
+
+		// symmetric transfer to the awaiting task (if any), on the same thread, without growing the stack
+		template <typename PROMISE>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<PROMISE> handle) noexcept {
+			TaskPromiseBase& promise = handle.promise();
+			const std::coroutine_handle<> continuation = promise.m_continuation;
+
+			// the owner of a started task may destroy it as soon as it sees this, nothing of the frame is touched afterwards
+			promise.m_bDone.store(true, std::memory_order_release);
+
+			return (continuation ? continuation : std::noop_coroutine());
+		}
+	};
+
+	TaskPromiseBase() : m_bDone(false) { ; }
+
+	std::suspend_always initial_suspend() const noexcept { return std::suspend_always(); }
+	FINAL_AWAITER final_suspend() const noexcept { return FINAL_AWAITER(); }
+
+	void unhandled_exception() { m_exception = std::current_exception(); }
+
+	inline void setContinuation(std::coroutine_handle<> continuation) { m_continuation = continuation; }
+	inline bool isDone() const { return m_bDone.load(std::memory_order_acquire); }
+
+protected:
+	void rethrowException() {
+		if (m_exception)
+			std::rethrow_exception(m_exception);
+	}
+
+private:
+	std::coroutine_handle<> m_continuation;
+	std::exception_ptr m_exception;
+	std::atomic<bool> m_bDone;
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+	Task<T> get_return_object();
+
+	template <typename U>
+	void return_value(U&& value) { m_value.emplace(std::forward<U>(value)); }
+
+	T getResult() {
+		rethrowException();
+		return std::move(*m_value);
+	}
+
+private:
+	std::optional<T> m_value;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+	Task<void> get_return_object();
+
+	void return_void() { ; }
+
+	void getResult() { rethrowException(); }
+};
+
+template <typename T>
+class Task {
+public:
+	typedef TaskPromise<T> promise_type;
+
+public:
+	Task() { ; }
+	explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) { ; }
+	Task(Task&& other) noexcept : m_handle(other.m_handle) { other.m_handle = {}; }
+	~Task() { destroy(); }
+
+	Task(const Task&) = delete;
+	Task& operator = (const Task&) = delete;
+
+	Task& operator = (Task&& other) noexcept {
+		if (this != &other) {
+			destroy();
+			m_handle = other.m_handle;
+			other.m_handle = {};
+		}
+		return *this;
+	}
+
+	// runs the task on the calling thread until its first suspension, for tasks which are not awaited by another one
+	void start() { m_handle.resume(); }
+
+	inline bool isValid() const { return (bool)m_handle; }
+	inline bool isDone() const { return (m_handle && m_handle.promise().isDone()); }
+
+	// once isDone(), rethrows an exception which escaped the task, the value is moved out
+	T getResult() { return m_handle.promise().getResult(); }
+
+	// awaiting starts the task, the awaiting task continues where this one finishes
+	bool await_ready() const noexcept { return false; }
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+		m_handle.promise().setContinuation(continuation);
+		return m_handle;
+	}
+	T await_resume() { return m_handle.promise().getResult(); }
+
+private:
+	void destroy() {
+		if (m_handle) {
+			m_handle.destroy();
+			m_handle = {};
+		}
+	}
+
+	std::coroutine_handle<promise_type> m_handle;
+};
+
+template <typename T>
+inline Task<T> TaskPromise<T>::get_return_object() { return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this)); }
+
+inline Task<void> TaskPromise<void>::get_return_object() { return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this)); }
+
+// where tasks continue: i/o threads (blocking file reads, owned by the scheduler, task_io_threads), the job system (cpu bound work, see JobSystem) or the main thread (graphics)
+// the main thread part runs in update(), once per frame (ResourceManager::update()), limited to task_main_thread_budget milliseconds
+class TaskScheduler {
+public:
+	struct IO_THREAD_AWAITER {
+		bool await_ready() const noexcept { return false; }
+		bool await_suspend(std::coroutine_handle<> handle);
+		void await_resume() const noexcept { ; }
+	};
+
+	struct READ_FILE_AWAITER {
+		UString filePath;
+		std::vector<char> data{};
+
+		bool await_ready() const noexcept { return false; }
+		bool await_suspend(std::coroutine_handle<> handle);
+		std::vector<char> await_resume() { return std::move(data); }
+	};
+
+	struct JOB_SYSTEM_AWAITER {
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume() const noexcept { ; }
+	};
+
+	struct MAIN_THREAD_AWAITER {
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume() const noexcept { ; }
+	};
+
+	static TaskScheduler* get(); // created on first use, which starts the i/o threads
+	static TaskScheduler* getIfCreated(); // NULL until the first get(), for per frame code which shouldn't create it
+
+	// the awaiters, without i/o threads (task_io_threads 0) the i/o part runs inline
+	static inline IO_THREAD_AWAITER resumeOnIOThread() { return IO_THREAD_AWAITER(); }
+	static inline READ_FILE_AWAITER readFile(UString filePath) { return READ_FILE_AWAITER{filePath, {}}; } // continues on the i/o thread, empty if the file couldn't be read
+	static inline JOB_SYSTEM_AWAITER resumeOnJobSystem() { return JOB_SYSTEM_AWAITER(); }
+	static inline MAIN_THREAD_AWAITER resumeOnMainThread() { return MAIN_THREAD_AWAITER(); } // always waits for the next update(), even on the main thread
+
+	static bool readFileNow(UString filePath, std::vector<char>& data); // blocking
+
+public:
+	TaskScheduler();
+	~TaskScheduler();
+
+	void update(); // main thread, resumes the tasks which are waiting for it
+
+	void setNumIOThreads(int numThreads); // must not be called while tasks are reading
+	inline int getNumIOThreads() const { return (int)m_ioThreads.size(); }
+	size_t getNumMainThreadTasks();
+
+private:
+	struct IO_WORK {
+		std::coroutine_handle<> handle;
+		READ_FILE_AWAITER* readFile; // NULL if it only continues there
+	};
+
+	static void *ioThread(void *data);
+
+	bool scheduleIO(std::coroutine_handle<> handle, READ_FILE_AWAITER* readFile);
+	void scheduleMainThread(std::coroutine_handle<> handle);
+
+	void startIOThreads(int numThreads);
+	void stopIOThreads();
+
+	// i/o
+	std::vector<TacoThread*> m_ioThreads;
+	std::mutex m_ioMutex;
+	std::condition_variable m_ioCondition;
+	std::deque<IO_WORK> m_ioQueue;
+	bool m_bIORunning;
+
+	// main thread
+	std::mutex m_mainThreadMutex;
+	std::deque<std::coroutine_handle<>> m_mainThreadQueue;
+};
+
+#endif // !TASK_H
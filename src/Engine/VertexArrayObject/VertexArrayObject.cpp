@@ -120,6 +120,14 @@ void VertexArrayObject::setVertex(int index, float x, float y, float z) {
 	m_partialUpdateVertexIndices.push_back(index);
 }
 
+void VertexArrayObject::setTexcoord(int index, float u, float v, unsigned int textureUnit) {
+	if (textureUnit >= m_texcoords.size() || index < 0 || index > (m_texcoords[textureUnit].size() - 1)) return;
+
+	m_texcoords[textureUnit][index] = Vector2(u, v);
+
+	m_partialUpdateVertexIndices.push_back(index); // part of the vertex
+}
+
 void VertexArrayObject::setColor(int index, Color color) {
 	if (index < 0 || index>(m_colors.size() - 1)) return;
 
@@ -27,6 +27,8 @@ public:
 	void setVertex(int index, Vector3 v);
 	void setVertex(int index, float x, float y, float z = 0);
 
+	void setTexcoord(int index, float u, float v, unsigned int textureUnit = 0);
+
 	void setColor(int index, Color color);
 
 	void setType(Graphics::PRIMITIVE primitive);
@@ -1,9 +1,13 @@
 #include "KeyboardEvent.h"
 
+#include "Profiler/FrameStats.h"
+
 KeyboardEvent::KeyboardEvent(KEYCODE keyCode)
 {
 	m_keyCode = keyCode;
 	m_bConsumed = false;
+
+	FrameStats::onInput();
 }
 
 void KeyboardEvent::consume()
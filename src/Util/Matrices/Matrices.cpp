@@ -144,12 +144,7 @@ Matrix3& Matrix3::invert()
 ///////////////////////////////////////////////////////////////////////////////
 Matrix4& Matrix4::transpose()
 {
-    std::swap(m[1], m[4]);
-    std::swap(m[2], m[8]);
-    std::swap(m[3], m[12]);
-    std::swap(m[6], m[9]);
-    std::swap(m[7], m[13]);
-    std::swap(m[11], m[14]);
+    MatricesSIMD::transpose(m, m);
 
     return *this;
 }
@@ -348,57 +343,9 @@ Matrix4& Matrix4::invertProjective()
 ///////////////////////////////////////////////////////////////////////////////
 Matrix4& Matrix4::invertGeneral()
 {
-    // get cofactors of minor matrices
-    float cofactor0 = getCofactor(m[5], m[6], m[7], m[9], m[10], m[11], m[13], m[14], m[15]);
-    float cofactor1 = getCofactor(m[4], m[6], m[7], m[8], m[10], m[11], m[12], m[14], m[15]);
-    float cofactor2 = getCofactor(m[4], m[5], m[7], m[8], m[9], m[11], m[12], m[13], m[15]);
-    float cofactor3 = getCofactor(m[4], m[5], m[6], m[8], m[9], m[10], m[12], m[13], m[14]);
-
-    // get determinant
-    float determinant = m[0] * cofactor0 - m[1] * cofactor1 + m[2] * cofactor2 - m[3] * cofactor3;
-    if (fabs(determinant) <= EPSILON)
-    {
+    // block wise simd inverse if available, cramer's rule otherwise (see MatricesSIMD::invertScalar())
+    if (!MatricesSIMD::invert(m, m))
         return identity();
-    }
-
-    // get rest of cofactors for adj(M)
-    float cofactor4 = getCofactor(m[1], m[2], m[3], m[9], m[10], m[11], m[13], m[14], m[15]);
-    float cofactor5 = getCofactor(m[0], m[2], m[3], m[8], m[10], m[11], m[12], m[14], m[15]);
-    float cofactor6 = getCofactor(m[0], m[1], m[3], m[8], m[9], m[11], m[12], m[13], m[15]);
-    float cofactor7 = getCofactor(m[0], m[1], m[2], m[8], m[9], m[10], m[12], m[13], m[14]);
-
-    float cofactor8 = getCofactor(m[1], m[2], m[3], m[5], m[6], m[7], m[13], m[14], m[15]);
-    float cofactor9 = getCofactor(m[0], m[2], m[3], m[4], m[6], m[7], m[12], m[14], m[15]);
-    float cofactor10 = getCofactor(m[0], m[1], m[3], m[4], m[5], m[7], m[12], m[13], m[15]);
-    float cofactor11 = getCofactor(m[0], m[1], m[2], m[4], m[5], m[6], m[12], m[13], m[14]);
-
-    float cofactor12 = getCofactor(m[1], m[2], m[3], m[5], m[6], m[7], m[9], m[10], m[11]);
-    float cofactor13 = getCofactor(m[0], m[2], m[3], m[4], m[6], m[7], m[8], m[10], m[11]);
-    float cofactor14 = getCofactor(m[0], m[1], m[3], m[4], m[5], m[7], m[8], m[9], m[11]);
-    float cofactor15 = getCofactor(m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10]);
-
-    // build inverse matrix = adj(M) / det(M)
-    // adjugate of M is the transpose of the cofactor matrix of M
-    float invDeterminant = 1.0f / determinant;
-    m[0] = invDeterminant * cofactor0;
-    m[1] = -invDeterminant * cofactor4;
-    m[2] = invDeterminant * cofactor8;
-    m[3] = -invDeterminant * cofactor12;
-
-    m[4] = -invDeterminant * cofactor1;
-    m[5] = invDeterminant * cofactor5;
-    m[6] = -invDeterminant * cofactor9;
-    m[7] = invDeterminant * cofactor13;
-
-    m[8] = invDeterminant * cofactor2;
-    m[9] = -invDeterminant * cofactor6;
-    m[10] = invDeterminant * cofactor10;
-    m[11] = -invDeterminant * cofactor14;
-
-    m[12] = -invDeterminant * cofactor3;
-    m[13] = invDeterminant * cofactor7;
-    m[14] = -invDeterminant * cofactor11;
-    m[15] = invDeterminant * cofactor15;
 
     return *this;
 }
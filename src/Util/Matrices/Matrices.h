@@ -22,6 +22,7 @@
 #include <iostream>
 #include <iomanip>
 #include "Vectors/Vectors.h"
+#include "Matrices/MatricesSIMD.h"
 
 ///////////////////////////////////////////////////////////////////////////
 // 2x2 matrix
@@ -736,10 +737,7 @@ inline const float* Matrix4::get() const
 
 inline const float* Matrix4::getTranspose()
 {
-    tm[0] = m[0];   tm[1] = m[4];   tm[2] = m[8];   tm[3] = m[12];
-    tm[4] = m[1];   tm[5] = m[5];   tm[6] = m[9];   tm[7] = m[13];
-    tm[8] = m[2];   tm[9] = m[6];   tm[10] = m[10];  tm[11] = m[14];
-    tm[12] = m[3];   tm[13] = m[7];   tm[14] = m[11];  tm[15] = m[15];
+    MatricesSIMD::transpose(m, tm);
     return tm;
 }
 
@@ -817,17 +815,16 @@ inline Vector3 Matrix4::operator*(const Vector3& rhs) const
 
 inline Matrix4 Matrix4::operator*(const Matrix4& n) const
 {
-    return Matrix4(m[0] * n[0] + m[4] * n[1] + m[8] * n[2] + m[12] * n[3], m[1] * n[0] + m[5] * n[1] + m[9] * n[2] + m[13] * n[3], m[2] * n[0] + m[6] * n[1] + m[10] * n[2] + m[14] * n[3], m[3] * n[0] + m[7] * n[1] + m[11] * n[2] + m[15] * n[3],
-        m[0] * n[4] + m[4] * n[5] + m[8] * n[6] + m[12] * n[7], m[1] * n[4] + m[5] * n[5] + m[9] * n[6] + m[13] * n[7], m[2] * n[4] + m[6] * n[5] + m[10] * n[6] + m[14] * n[7], m[3] * n[4] + m[7] * n[5] + m[11] * n[6] + m[15] * n[7],
-        m[0] * n[8] + m[4] * n[9] + m[8] * n[10] + m[12] * n[11], m[1] * n[8] + m[5] * n[9] + m[9] * n[10] + m[13] * n[11], m[2] * n[8] + m[6] * n[9] + m[10] * n[10] + m[14] * n[11], m[3] * n[8] + m[7] * n[9] + m[11] * n[10] + m[15] * n[11],
-        m[0] * n[12] + m[4] * n[13] + m[8] * n[14] + m[12] * n[15], m[1] * n[12] + m[5] * n[13] + m[9] * n[14] + m[13] * n[15], m[2] * n[12] + m[6] * n[13] + m[10] * n[14] + m[14] * n[15], m[3] * n[12] + m[7] * n[13] + m[11] * n[14] + m[15] * n[15]);
+    Matrix4 result;
+    MatricesSIMD::multiply(m, n.m, result.m);
+    return result;
 }
 
 
 
 inline Matrix4& Matrix4::operator*=(const Matrix4& rhs)
 {
-    *this = *this * rhs;
+    MatricesSIMD::multiply(m, rhs.m, m);
     return *this;
 }
 
@@ -0,0 +1,423 @@
+#include "MatricesSIMD.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#define MATRICESSIMD_AVX2
+#define MATRICESSIMD_SSE2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATRICESSIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+const char* MatricesSIMD::getInstructionSet() {
+#if defined(MATRICESSIMD_AVX2)
+	return "avx2";
+#elif defined(MATRICESSIMD_SSE2)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
+
+
+
+//*********//
+//	Scalar  //
+//*********//
+
+void MatricesSIMD::multiplyScalar(const float* a, const float* b, float* out) {
+	float r[16];
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++) {
+			r[c * 4 + row] = a[row] * b[c * 4] + a[4 + row] * b[c * 4 + 1] + a[8 + row] * b[c * 4 + 2] + a[12 + row] * b[c * 4 + 3];
+		}
+	}
+	std::memcpy(out, r, sizeof(r));
+}
+
+void MatricesSIMD::transposeScalar(const float* m, float* out) {
+	float r[16];
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++) {
+			r[row * 4 + c] = m[c * 4 + row];
+		}
+	}
+	std::memcpy(out, r, sizeof(r));
+}
+
+static inline float matricesSIMDCofactor(float m0, float m1, float m2, float m3, float m4, float m5, float m6, float m7, float m8) {
+	return m0 * (m4 * m8 - m5 * m7) - m1 * (m3 * m8 - m5 * m6) + m2 * (m3 * m7 - m4 * m6);
+}
+
+bool MatricesSIMD::invertScalar(const float* m, float* out) {
+	// cramer's rule, see Matrix4::invertGeneral()
+	const float cofactor0 = matricesSIMDCofactor(m[5], m[6], m[7], m[9], m[10], m[11], m[13], m[14], m[15]);
+	const float cofactor1 = matricesSIMDCofactor(m[4], m[6], m[7], m[8], m[10], m[11], m[12], m[14], m[15]);
+	const float cofactor2 = matricesSIMDCofactor(m[4], m[5], m[7], m[8], m[9], m[11], m[12], m[13], m[15]);
+	const float cofactor3 = matricesSIMDCofactor(m[4], m[5], m[6], m[8], m[9], m[10], m[12], m[13], m[14]);
+
+	const float determinant = m[0] * cofactor0 - m[1] * cofactor1 + m[2] * cofactor2 - m[3] * cofactor3;
+	if (std::fabs(determinant) <= INVERT_EPSILON)
+		return false;
+
+	const float cofactor4 = matricesSIMDCofactor(m[1], m[2], m[3], m[9], m[10], m[11], m[13], m[14], m[15]);
+	const float cofactor5 = matricesSIMDCofactor(m[0], m[2], m[3], m[8], m[10], m[11], m[12], m[14], m[15]);
+	const float cofactor6 = matricesSIMDCofactor(m[0], m[1], m[3], m[8], m[9], m[11], m[12], m[13], m[15]);
+	const float cofactor7 = matricesSIMDCofactor(m[0], m[1], m[2], m[8], m[9], m[10], m[12], m[13], m[14]);
+
+	const float cofactor8 = matricesSIMDCofactor(m[1], m[2], m[3], m[5], m[6], m[7], m[13], m[14], m[15]);
+	const float cofactor9 = matricesSIMDCofactor(m[0], m[2], m[3], m[4], m[6], m[7], m[12], m[14], m[15]);
+	const float cofactor10 = matricesSIMDCofactor(m[0], m[1], m[3], m[4], m[5], m[7], m[12], m[13], m[15]);
+	const float cofactor11 = matricesSIMDCofactor(m[0], m[1], m[2], m[4], m[5], m[6], m[12], m[13], m[14]);
+
+	const float cofactor12 = matricesSIMDCofactor(m[1], m[2], m[3], m[5], m[6], m[7], m[9], m[10], m[11]);
+	const float cofactor13 = matricesSIMDCofactor(m[0], m[2], m[3], m[4], m[6], m[7], m[8], m[10], m[11]);
+	const float cofactor14 = matricesSIMDCofactor(m[0], m[1], m[3], m[4], m[5], m[7], m[8], m[9], m[11]);
+	const float cofactor15 = matricesSIMDCofactor(m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10]);
+
+	const float invDeterminant = 1.0f / determinant;
+	const float r[16] = {
+		invDeterminant * cofactor0, -invDeterminant * cofactor4, invDeterminant * cofactor8, -invDeterminant * cofactor12,
+		-invDeterminant * cofactor1, invDeterminant * cofactor5, -invDeterminant * cofactor9, invDeterminant * cofactor13,
+		invDeterminant * cofactor2, -invDeterminant * cofactor6, invDeterminant * cofactor10, -invDeterminant * cofactor14,
+		-invDeterminant * cofactor3, invDeterminant * cofactor7, -invDeterminant * cofactor11, invDeterminant * cofactor15
+	};
+	std::memcpy(out, r, sizeof(r));
+
+	return true;
+}
+
+void MatricesSIMD::transformPointsScalar(const float* m, const Vector2* in, Vector2* out, int count) {
+	for (int i = 0; i < count; i++) {
+		const float x = in[i].x;
+		const float y = in[i].y;
+		out[i].x = m[0] * x + m[4] * y + m[12];
+		out[i].y = m[1] * x + m[5] * y + m[13];
+	}
+}
+
+void MatricesSIMD::transformPointsScalar(const float* m, const Vector3* in, Vector3* out, int count) {
+	for (int i = 0; i < count; i++) {
+		const float x = in[i].x;
+		const float y = in[i].y;
+		const float z = in[i].z;
+		out[i].x = m[0] * x + m[4] * y + m[8] * z + m[12];
+		out[i].y = m[1] * x + m[5] * y + m[9] * z + m[13];
+		out[i].z = m[2] * x + m[6] * y + m[10] * z + m[14];
+	}
+}
+
+void MatricesSIMD::transformPointsScalar(const float* m, const float* inX, const float* inY, float* outX, float* outY, int count) {
+	const float m0 = m[0], m1 = m[1], m4 = m[4], m5 = m[5], m12 = m[12], m13 = m[13];
+	for (int i = 0; i < count; i++) {
+		const float x = inX[i];
+		const float y = inY[i];
+		outX[i] = m0 * x + m4 * y + m12;
+		outY[i] = m1 * x + m5 * y + m13;
+	}
+}
+
+void MatricesSIMD::transformPointsScalar(const float* m, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ, int count) {
+	const float m0 = m[0], m1 = m[1], m2 = m[2], m4 = m[4], m5 = m[5], m6 = m[6], m8 = m[8], m9 = m[9], m10 = m[10], m12 = m[12], m13 = m[13], m14 = m[14];
+	for (int i = 0; i < count; i++) {
+		const float x = inX[i];
+		const float y = inY[i];
+		const float z = inZ[i];
+		outX[i] = m0 * x + m4 * y + m8 * z + m12;
+		outY[i] = m1 * x + m5 * y + m9 * z + m13;
+		outZ[i] = m2 * x + m6 * y + m10 * z + m14;
+	}
+}
+
+
+
+//*******//
+//	SIMD  //
+//*******//
+
+#ifdef MATRICESSIMD_SSE2
+
+#define MATRICESSIMD_SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define MATRICESSIMD_SWIZZLE(v, x, y, z, w) _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(v), MATRICESSIMD_SHUFFLE_MASK(x, y, z, w)))
+#define MATRICESSIMD_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, MATRICESSIMD_SHUFFLE_MASK(x, y, z, w))
+
+// 2x2 blocks stored as (m00, m01, m10, m11)
+static inline __m128 matricesSIMDMat2Mul(__m128 a, __m128 b) {
+	return _mm_add_ps(_mm_mul_ps(a, MATRICESSIMD_SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(MATRICESSIMD_SWIZZLE(a, 1, 0, 3, 2), MATRICESSIMD_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adj(a) * b
+static inline __m128 matricesSIMDMat2AdjMul(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(MATRICESSIMD_SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(MATRICESSIMD_SWIZZLE(a, 1, 1, 2, 2), MATRICESSIMD_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// a * adj(b)
+static inline __m128 matricesSIMDMat2MulAdj(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(a, MATRICESSIMD_SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(MATRICESSIMD_SWIZZLE(a, 1, 0, 3, 2), MATRICESSIMD_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+#endif
+
+void MatricesSIMD::multiply(const float* a, const float* b, float* out) {
+#if defined(MATRICESSIMD_AVX2)
+	// two result columns per iteration, the 128 bit lanes hold column j and j + 1
+	const __m256 a0 = _mm256_broadcast_ps((const __m128*)(a + 0));
+	const __m256 a1 = _mm256_broadcast_ps((const __m128*)(a + 4));
+	const __m256 a2 = _mm256_broadcast_ps((const __m128*)(a + 8));
+	const __m256 a3 = _mm256_broadcast_ps((const __m128*)(a + 12));
+
+	const __m256 b01 = _mm256_loadu_ps(b);
+	const __m256 b23 = _mm256_loadu_ps(b + 8);
+
+	__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1, _mm256_permute_ps(b01, 0x55)));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2, _mm256_permute_ps(b01, 0xaa)));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3, _mm256_permute_ps(b01, 0xff)));
+
+	__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1, _mm256_permute_ps(b23, 0x55)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2, _mm256_permute_ps(b23, 0xaa)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3, _mm256_permute_ps(b23, 0xff)));
+
+	_mm256_storeu_ps(out, r01);
+	_mm256_storeu_ps(out + 8, r23);
+#elif defined(MATRICESSIMD_SSE2)
+	const __m128 a0 = _mm_loadu_ps(a + 0);
+	const __m128 a1 = _mm_loadu_ps(a + 4);
+	const __m128 a2 = _mm_loadu_ps(a + 8);
+	const __m128 a3 = _mm_loadu_ps(a + 12);
+
+	__m128 r[4];
+	for (int c = 0; c < 4; c++) {
+		const __m128 bc = _mm_loadu_ps(b + c * 4);
+		__m128 rc = _mm_mul_ps(a0, MATRICESSIMD_SWIZZLE(bc, 0, 0, 0, 0));
+		rc = _mm_add_ps(rc, _mm_mul_ps(a1, MATRICESSIMD_SWIZZLE(bc, 1, 1, 1, 1)));
+		rc = _mm_add_ps(rc, _mm_mul_ps(a2, MATRICESSIMD_SWIZZLE(bc, 2, 2, 2, 2)));
+		rc = _mm_add_ps(rc, _mm_mul_ps(a3, MATRICESSIMD_SWIZZLE(bc, 3, 3, 3, 3)));
+		r[c] = rc;
+	}
+
+	// b may alias out, so only store after all columns are done
+	_mm_storeu_ps(out + 0, r[0]);
+	_mm_storeu_ps(out + 4, r[1]);
+	_mm_storeu_ps(out + 8, r[2]);
+	_mm_storeu_ps(out + 12, r[3]);
+#else
+	multiplyScalar(a, b, out);
+#endif
+}
+
+void MatricesSIMD::transpose(const float* m, float* out) {
+#ifdef MATRICESSIMD_SSE2
+	__m128 c0 = _mm_loadu_ps(m + 0);
+	__m128 c1 = _mm_loadu_ps(m + 4);
+	__m128 c2 = _mm_loadu_ps(m + 8);
+	__m128 c3 = _mm_loadu_ps(m + 12);
+
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+	_mm_storeu_ps(out + 0, c0);
+	_mm_storeu_ps(out + 4, c1);
+	_mm_storeu_ps(out + 8, c2);
+	_mm_storeu_ps(out + 12, c3);
+#else
+	transposeScalar(m, out);
+#endif
+}
+
+bool MatricesSIMD::invert(const float* m, float* out) {
+#ifdef MATRICESSIMD_SSE2
+	// block wise inverse with 2x2 sub matrices | A B | (the transposed layout doesn't matter, inv(transpose(M)) = transpose(inv(M)))
+	//                                          | C D |
+	const __m128 c0 = _mm_loadu_ps(m + 0);
+	const __m128 c1 = _mm_loadu_ps(m + 4);
+	const __m128 c2 = _mm_loadu_ps(m + 8);
+	const __m128 c3 = _mm_loadu_ps(m + 12);
+
+	const __m128 A = _mm_movelh_ps(c0, c1);
+	const __m128 B = _mm_movehl_ps(c1, c0);
+	const __m128 C = _mm_movelh_ps(c2, c3);
+	const __m128 D = _mm_movehl_ps(c3, c2);
+
+	// (|A|, |B|, |C|, |D|)
+	const __m128 detSub = _mm_sub_ps(_mm_mul_ps(MATRICESSIMD_SHUFFLE(c0, c2, 0, 2, 0, 2), MATRICESSIMD_SHUFFLE(c1, c3, 1, 3, 1, 3)), _mm_mul_ps(MATRICESSIMD_SHUFFLE(c0, c2, 1, 3, 1, 3), MATRICESSIMD_SHUFFLE(c1, c3, 0, 2, 0, 2)));
+	const __m128 detA = MATRICESSIMD_SWIZZLE(detSub, 0, 0, 0, 0);
+	const __m128 detB = MATRICESSIMD_SWIZZLE(detSub, 1, 1, 1, 1);
+	const __m128 detC = MATRICESSIMD_SWIZZLE(detSub, 2, 2, 2, 2);
+	const __m128 detD = MATRICESSIMD_SWIZZLE(detSub, 3, 3, 3, 3);
+
+	const __m128 D_C = matricesSIMDMat2AdjMul(D, C);
+	const __m128 A_B = matricesSIMDMat2AdjMul(A, B);
+
+	__m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), matricesSIMDMat2Mul(B, D_C));
+	__m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), matricesSIMDMat2Mul(C, A_B));
+	__m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), matricesSIMDMat2MulAdj(D, A_B));
+	__m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), matricesSIMDMat2MulAdj(A, D_C));
+
+	// |M| = |A| |D| + |B| |C| - tr((A#B)(D#C))
+	__m128 tr = _mm_mul_ps(A_B, MATRICESSIMD_SWIZZLE(D_C, 0, 2, 1, 3));
+	tr = _mm_add_ps(tr, MATRICESSIMD_SWIZZLE(tr, 2, 3, 0, 1));
+	tr = _mm_add_ps(tr, MATRICESSIMD_SWIZZLE(tr, 1, 0, 3, 2));
+	const __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+	if (std::fabs(_mm_cvtss_f32(detM)) <= INVERT_EPSILON)
+		return false;
+
+	const __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+	X_ = _mm_mul_ps(X_, rDetM);
+	Y_ = _mm_mul_ps(Y_, rDetM);
+	Z_ = _mm_mul_ps(Z_, rDetM);
+	W_ = _mm_mul_ps(W_, rDetM);
+
+	// adjugate shuffle and store shuffle combined
+	_mm_storeu_ps(out + 0, MATRICESSIMD_SHUFFLE(X_, Y_, 3, 1, 3, 1));
+	_mm_storeu_ps(out + 4, MATRICESSIMD_SHUFFLE(X_, Y_, 2, 0, 2, 0));
+	_mm_storeu_ps(out + 8, MATRICESSIMD_SHUFFLE(Z_, W_, 3, 1, 3, 1));
+	_mm_storeu_ps(out + 12, MATRICESSIMD_SHUFFLE(Z_, W_, 2, 0, 2, 0));
+
+	return true;
+#else
+	return invertScalar(m, out);
+#endif
+}
+
+void MatricesSIMD::transformPoints(const float* m, const Vector2* in, Vector2* out, int count) {
+	int i = 0;
+	const float* src = (const float*)in;
+	float* dst = (float*)out;
+
+#if defined(MATRICESSIMD_AVX2)
+	// 4 interleaved points per register: (x0 y0 x1 y1 | x2 y2 x3 y3)
+	const __m256 cx = _mm256_setr_ps(m[0], m[1], m[0], m[1], m[0], m[1], m[0], m[1]);
+	const __m256 cy = _mm256_setr_ps(m[4], m[5], m[4], m[5], m[4], m[5], m[4], m[5]);
+	const __m256 t = _mm256_setr_ps(m[12], m[13], m[12], m[13], m[12], m[13], m[12], m[13]);
+	for (; i + 4 <= count; i += 4) {
+		const __m256 v = _mm256_loadu_ps(src + i * 2);
+		const __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, _mm256_permute_ps(v, 0xa0)), _mm256_mul_ps(cy, _mm256_permute_ps(v, 0xf5))), t);
+		_mm256_storeu_ps(dst + i * 2, r);
+	}
+#elif defined(MATRICESSIMD_SSE2)
+	// 2 interleaved points per register: (x0 y0 x1 y1)
+	const __m128 cx = _mm_setr_ps(m[0], m[1], m[0], m[1]);
+	const __m128 cy = _mm_setr_ps(m[4], m[5], m[4], m[5]);
+	const __m128 t = _mm_setr_ps(m[12], m[13], m[12], m[13]);
+	for (; i + 2 <= count; i += 2) {
+		const __m128 v = _mm_loadu_ps(src + i * 2);
+		const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, MATRICESSIMD_SWIZZLE(v, 0, 0, 2, 2)), _mm_mul_ps(cy, MATRICESSIMD_SWIZZLE(v, 1, 1, 3, 3))), t);
+		_mm_storeu_ps(dst + i * 2, r);
+	}
+#endif
+
+	transformPointsScalar(m, in + i, out + i, count - i);
+}
+
+void MatricesSIMD::transformPoints(const float* m, const Vector3* in, Vector3* out, int count) {
+	int i = 0;
+
+#ifdef MATRICESSIMD_SSE2
+	// 4 points = 3 registers, transposed to structure of arrays and back
+	const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+	const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+	const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+	const __m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+	for (; i + 4 <= count; i += 4) {
+		const float* src = (const float*)(in + i);
+		const __m128 v0 = _mm_loadu_ps(src + 0); // x0 y0 z0 x1
+		const __m128 v1 = _mm_loadu_ps(src + 4); // y1 z1 x2 y2
+		const __m128 v2 = _mm_loadu_ps(src + 8); // z2 x3 y3 z3
+
+		const __m128 x0x1y1z1 = MATRICESSIMD_SHUFFLE(v0, v1, 0, 3, 0, 1);
+		const __m128 x2y2z2x3 = MATRICESSIMD_SHUFFLE(v1, v2, 2, 3, 0, 1);
+		const __m128 x = MATRICESSIMD_SHUFFLE(x0x1y1z1, x2y2z2x3, 0, 1, 0, 3);
+
+		const __m128 y0z0y1z1 = MATRICESSIMD_SHUFFLE(v0, v1, 1, 2, 0, 1);
+		const __m128 y2z2y3z3 = MATRICESSIMD_SHUFFLE(v1, v2, 3, 3, 2, 3); // y2 y2 y3 z3
+		const __m128 y = MATRICESSIMD_SHUFFLE(y0z0y1z1, y2z2y3z3, 0, 2, 0, 2);
+
+		const __m128 z0z1 = MATRICESSIMD_SHUFFLE(v0, v1, 2, 2, 1, 1); // z0 z0 z1 z1
+		const __m128 z2z3 = MATRICESSIMD_SHUFFLE(v2, v2, 0, 0, 3, 3); // z2 z2 z3 z3
+		const __m128 z = MATRICESSIMD_SHUFFLE(z0z1, z2z3, 0, 2, 0, 2);
+
+		const __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), _mm_add_ps(_mm_mul_ps(m8, z), m12));
+		const __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), _mm_add_ps(_mm_mul_ps(m9, z), m13));
+		const __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(m6, y)), _mm_add_ps(_mm_mul_ps(m10, z), m14));
+
+		// back to x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+		const __m128 xy01 = _mm_unpacklo_ps(rx, ry); // x0 y0 x1 y1
+		const __m128 o0 = MATRICESSIMD_SHUFFLE(xy01, _mm_unpacklo_ps(rz, rx), 0, 1, 0, 3); // x0 y0 | z0 x1
+		const __m128 y1z1 = MATRICESSIMD_SHUFFLE(ry, rz, 1, 1, 1, 1); // y1 y1 z1 z1
+		const __m128 x2y2 = _mm_unpackhi_ps(rx, ry); // x2 y2 x3 y3
+		const __m128 o1 = MATRICESSIMD_SHUFFLE(y1z1, x2y2, 0, 2, 0, 1); // y1 z1 | x2 y2
+		const __m128 z2x3 = MATRICESSIMD_SHUFFLE(rz, rx, 2, 2, 3, 3); // z2 z2 x3 x3
+		const __m128 y3z3 = MATRICESSIMD_SHUFFLE(ry, rz, 3, 3, 3, 3); // y3 y3 z3 z3
+		const __m128 o2 = MATRICESSIMD_SHUFFLE(z2x3, y3z3, 0, 2, 0, 2); // z2 x3 | y3 z3
+
+		float* dst = (float*)(out + i);
+		_mm_storeu_ps(dst + 0, o0);
+		_mm_storeu_ps(dst + 4, o1);
+		_mm_storeu_ps(dst + 8, o2);
+	}
+#endif
+
+	transformPointsScalar(m, in + i, out + i, count - i);
+}
+
+void MatricesSIMD::transformPoints(const float* m, const float* inX, const float* inY, float* outX, float* outY, int count) {
+	int i = 0;
+
+#if defined(MATRICESSIMD_AVX2)
+	const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m12 = _mm256_set1_ps(m[12]), m13 = _mm256_set1_ps(m[13]);
+	for (; i + 8 <= count; i += 8) {
+		const __m256 x = _mm256_loadu_ps(inX + i);
+		const __m256 y = _mm256_loadu_ps(inY + i);
+		_mm256_storeu_ps(outX + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, x), _mm256_mul_ps(m4, y)), m12));
+		_mm256_storeu_ps(outY + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1, x), _mm256_mul_ps(m5, y)), m13));
+	}
+#elif defined(MATRICESSIMD_SSE2)
+	const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]);
+	for (; i + 4 <= count; i += 4) {
+		const __m128 x = _mm_loadu_ps(inX + i);
+		const __m128 y = _mm_loadu_ps(inY + i);
+		_mm_storeu_ps(outX + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), m12));
+		_mm_storeu_ps(outY + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), m13));
+	}
+#endif
+
+	transformPointsScalar(m, inX + i, inY + i, outX + i, outY + i, count - i);
+}
+
+void MatricesSIMD::transformPoints(const float* m, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ, int count) {
+	int i = 0;
+
+#if defined(MATRICESSIMD_AVX2)
+	const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+	const __m256 m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6 = _mm256_set1_ps(m[6]);
+	const __m256 m8 = _mm256_set1_ps(m[8]), m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]);
+	const __m256 m12 = _mm256_set1_ps(m[12]), m13 = _mm256_set1_ps(m[13]), m14 = _mm256_set1_ps(m[14]);
+	for (; i + 8 <= count; i += 8) {
+		const __m256 x = _mm256_loadu_ps(inX + i);
+		const __m256 y = _mm256_loadu_ps(inY + i);
+		const __m256 z = _mm256_loadu_ps(inZ + i);
+		_mm256_storeu_ps(outX + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, x), _mm256_mul_ps(m4, y)), _mm256_add_ps(_mm256_mul_ps(m8, z), m12)));
+		_mm256_storeu_ps(outY + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1, x), _mm256_mul_ps(m5, y)), _mm256_add_ps(_mm256_mul_ps(m9, z), m13)));
+		_mm256_storeu_ps(outZ + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m2, x), _mm256_mul_ps(m6, y)), _mm256_add_ps(_mm256_mul_ps(m10, z), m14)));
+	}
+#elif defined(MATRICESSIMD_SSE2)
+	const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+	const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+	const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+	const __m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+	for (; i + 4 <= count; i += 4) {
+		const __m128 x = _mm_loadu_ps(inX + i);
+		const __m128 y = _mm_loadu_ps(inY + i);
+		const __m128 z = _mm_loadu_ps(inZ + i);
+		_mm_storeu_ps(outX + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), _mm_add_ps(_mm_mul_ps(m8, z), m12)));
+		_mm_storeu_ps(outY + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), _mm_add_ps(_mm_mul_ps(m9, z), m13)));
+		_mm_storeu_ps(outZ + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(m6, y)), _mm_add_ps(_mm_mul_ps(m10, z), m14)));
+	}
+#endif
+
+	transformPointsScalar(m, inX + i, inY + i, inZ + i, outX + i, outY + i, outZ + i, count - i);
+}
@@ -0,0 +1,39 @@
+#ifndef MATH_MATRICESSIMD_H
+#define MATH_MATRICESSIMD_H
+
+#include "Vectors/Vectors.h"
+
+// sse2/avx2 kernels for the hot Matrix4 operations, and batch point transforms
+// all matrices are 16 floats in column major order (Matrix4::get()), in and out may alias for multiply/transpose/invert
+// the path is chosen at compile time (MATRICESSIMD_AVX2 / MATRICESSIMD_SSE2), every other target (e.g. arm) uses the scalar path,
+// which is written as plain loops so that the compiler can auto vectorize it (neon)
+class MatricesSIMD {
+public:
+	static const char* getInstructionSet(); // "avx2", "sse2" or "scalar"
+
+	// out = a * b
+	static void multiply(const float* a, const float* b, float* out);
+	static void transpose(const float* m, float* out);
+	static bool invert(const float* m, float* out); // false (and out untouched) if singular
+
+	// points (w = 1, no perspective divide), out[i] = m * in[i]
+	static void transformPoints(const float* m, const Vector2* in, Vector2* out, int count);
+	static void transformPoints(const float* m, const Vector3* in, Vector3* out, int count);
+
+	// structure of arrays variants
+	static void transformPoints(const float* m, const float* inX, const float* inY, float* outX, float* outY, int count);
+	static void transformPoints(const float* m, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ, int count);
+
+	// reference implementations, always scalar
+	static void multiplyScalar(const float* a, const float* b, float* out);
+	static void transposeScalar(const float* m, float* out);
+	static bool invertScalar(const float* m, float* out);
+	static void transformPointsScalar(const float* m, const Vector2* in, Vector2* out, int count);
+	static void transformPointsScalar(const float* m, const Vector3* in, Vector3* out, int count);
+	static void transformPointsScalar(const float* m, const float* inX, const float* inY, float* outX, float* outY, int count);
+	static void transformPointsScalar(const float* m, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ, int count);
+
+	static constexpr float INVERT_EPSILON = 0.00001f; // same as Matrix4::invertGeneral()
+};
+
+#endif // !MATH_MATRICESSIMD_H
@@ -10,6 +10,14 @@ Rects::Rects(Vector2 pos, Vector2 size, bool isCentered)
 	set(pos.x, pos.y, size.x, size.y, isCentered);
 }
 
+Rects::Rects(const Rects& rect)
+{
+	m_fMinX = rect.m_fMinX;
+	m_fMaxX = rect.m_fMaxX;
+	m_fMinY = rect.m_fMinY;
+	m_fMaxY = rect.m_fMaxY;
+}
+
 void Rects::set(float x, float y, float width, float height, bool isCentered)
 {
 	if (isCentered)
@@ -8,6 +8,7 @@ class Rects
 public:
 	Rects(float x = 0, float y = 0, float width = 0, float height = 0, bool isCentered = false);
 	Rects(Vector2 pos, Vector2 size, bool isCentered = false);
+	Rects(const Rects& rect);
 
 	void set(float x, float y, float width, float height, bool isCentered = false);
 
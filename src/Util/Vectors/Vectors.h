@@ -2,6 +2,8 @@
 #define VECTORS_H
 
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
 
@@ -11,17 +13,17 @@
 /*
 quick inverse square root, no division cause division gay
 */
-float q_rsqrt(float number)
+inline float q_rsqrt(float number)
 {
-	long i;
+	int32_t i;
 	float x2, y;
 	const float threehalfs = 1.5F;
 
 	x2 = number * 0.5F;
 	y = number;
-	i = *(long*)&y;                       // evil floating point bit level hacking
+	std::memcpy(&i, &y, sizeof(i));         // evil floating point bit level hacking (32 bit, long is 64 bit on some platforms)
 	i = 0x5f3759df - (i >> 1);               // what the fuck?
-	y = *(float*)&i;
+	std::memcpy(&y, &i, sizeof(y));
 	y = y * (threehalfs - (x2 * y * y));   // 1st iteration
 	// y  = y * ( threehalfs - ( x2 * y * y ) );   // 2nd iteration, this can be removed
 
@@ -5,6 +5,7 @@
 #include <vector>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <random>
 #include <memory>
 #include <atomic>